@@ -0,0 +1,487 @@
+#include "analysis_suite.h"
+#include "synthetic_source.h"
+#include <stdio.h>
+#include <float.h>
+#include <vector>
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+namespace
+{
+    const uint32_t SUITE_SAMPLE_RATE  = 48000;
+    const double   SUITE_SECONDS      = 4.0;
+    const double   REFERENCE_FLOOR    = -120.0; // the processing noise floor, in dB.
+    const double   CHECKED_FLOOR      = -100.0; // buckets quieter than this in the reference aren't checked, float rounding dominates there.
+    const double   MAX_BUCKET_ERROR   = 0.05;   // dB
+    const double   MIN_SPECTRUM_PEAK  = 1e-6;   // windows whose loudest reference bin is quieter (-120 dB) aren't checked, they're only leakage and rounding.
+    const double   MAX_SPECTRUM_ERROR = 1e-4;   // relative to the loudest bin of the window.
+    const double   MAX_RMS_ERROR      = 1e-4;   // relative
+    const double   MAX_LOUDNESS_ERROR = 0.05;   // LU, for the sines, against the filter response at their frequencies.
+
+    struct SuiteCase
+    {
+        SyntheticSignal Signal;
+        uint32_t        ChannelCount;
+        double          Frequency;
+        float           Amplitude;
+    };
+
+    const SuiteCase SUITE_CASES[] =
+    {
+        { SyntheticSignal::SINE, 2, 1000.0, 0.5f },
+        { SyntheticSignal::SINE, 1, 440.0, 0.5f },
+        { SyntheticSignal::SWEEP, 2, 0.0, 0.5f },
+        { SyntheticSignal::WHITE_NOISE, 2, 0.0, 0.5f },
+        { SyntheticSignal::PINK_NOISE, 2, 0.0, 1.0f },
+        { SyntheticSignal::IMPULSE, 2, 0.0, 1.0f }
+    };
+
+    const char* const STAGE_NAMES[] = { "window", "fft", "spectrum", "smoothing", "onsets", "loudness", "low band", "texture" };
+
+    struct SuiteErrors
+    {
+        double BucketDb;
+        double Spectrum;
+        double RMS;
+        double Loudness; // negative when not checked.
+    };
+
+    // The same analysis as AudioProcessing (main window only) in double precision, written for clarity rather than speed.
+    class ReferenceAnalysis
+    {
+    public:
+
+        // Set up for the period, smoothing, bucketing and bucket ranges (in Hz, low and high for each bucket) of the processing.
+        void Initialize( size_t samplesPerPeriod, 
+                         double sampleRate, 
+                         double smoothing, 
+                         const float* bucketRanges, 
+                         FrequencyBucketing bucketing,
+                         uint32_t bucketCount,
+                         uint32_t firstBucket )
+        {
+            Samples_        = samplesPerPeriod;
+            BinCount_       = samplesPerPeriod / 2 + 1;
+            Smoothing_      = smoothing;
+            UsesFilterbank_ = bucketing != FrequencyBucketing::PEAK_BINS;
+            BucketCount_    = bucketCount;
+            FirstBucket_    = firstBucket;
+
+            Window_.resize( Samples_ );
+            Twiddles_.resize( Samples_ / 2 );
+            Real_.resize( Samples_ );
+            Imaginary_.resize( Samples_ );
+            Magnitudes_.resize( BinCount_ * 2 );
+
+            for ( size_t sample = 0; sample < Samples_; ++sample )
+            {
+                Window_[ sample ] = 0.5 - 0.5 * cos( ( 2.0 * M_PI * sample ) / ( Samples_ - 1 ) );
+            }
+
+            for ( size_t twiddle = 0; twiddle < Samples_ / 2; ++twiddle )
+            {
+                Twiddles_[ twiddle ] = ( -2.0 * M_PI * twiddle ) / Samples_;
+            }
+
+            double binFrequency = sampleRate / Samples_;
+            double sum          = 0.0;
+            double sumSquares   = 0.0;
+
+            for ( size_t sample = 0; sample < Samples_; ++sample )
+            {
+                sum        += Window_[ sample ];
+                sumSquares += Window_[ sample ] * Window_[ sample ];
+            }
+
+            // A filterbank sums the leakage of a tone, so divide by the window's equivalent noise bandwidth in bins.
+            PowerScale_ = ( sum * sum ) / ( sumSquares * Samples_ );
+
+            if ( UsesFilterbank_ )
+            {
+                InitializeFilterbank( binFrequency, bucketRanges );
+            }
+
+            for ( uint32_t bucket = 0; bucket < BucketCount_; ++bucket )
+            {
+                double low  = bucketRanges[ bucket * 2 ];
+                double high = bucketRanges[ bucket * 2 + 1 ];
+
+                // Buckets without any bins have no range.
+                Bins_[ bucket ][ 0 ] = high > 0.0 ? static_cast< size_t >( floor( low / binFrequency + 0.5 ) ) : 1;
+                Bins_[ bucket ][ 1 ] = high > 0.0 ? static_cast< size_t >( floor( high / binFrequency + 0.5 ) ) + 1 : 1;
+            }
+
+            for ( uint32_t channel = 0; channel < 2; ++channel )
+            {
+                RMS_[ channel ] = 0.0;
+
+                for ( uint32_t bucket = 0; bucket < BucketCount_; ++bucket )
+                {
+                    Buckets_[ bucket ][ channel ] = REFERENCE_FLOOR;
+                }
+            }
+        }
+
+        // Analyze a window, smoothing it into the reference values.
+        void Update( const float* left, const float* right )
+        {
+            const float* channels[ 2 ] = { left, right };
+
+            for ( uint32_t channel = 0; channel < 2; ++channel )
+            {
+                double sumSquares = 0.0;
+
+                for ( size_t sample = 0; sample < Samples_; ++sample )
+                {
+                    double value = channels[ channel ][ sample ];
+
+                    sumSquares            += value * value;
+                    Real_[ sample ]        = value * Window_[ sample ];
+                    Imaginary_[ sample ]   = 0.0;
+                }
+
+                Transform();
+
+                RMS_[ channel ] += ( sqrt( sumSquares / Samples_ ) - RMS_[ channel ] ) * Smoothing_;
+
+                // Amplitude of a full scale sine is 1, with the window's coherent gain (0.5) cancelling the 2 for one sided spectra.
+                double* magnitudes = Magnitudes_.data() + channel * BinCount_;
+
+                for ( size_t bin = 0; bin < BinCount_; ++bin )
+                {
+                    magnitudes[ bin ] = ( 2.0 * sqrt( Real_[ bin ] * Real_[ bin ] + Imaginary_[ bin ] * Imaginary_[ bin ] ) ) / BinCount_;
+                }
+
+                for ( uint32_t bucket = FirstBucket_; bucket < BucketCount_; ++bucket )
+                {
+                    double power = 0.0;
+
+                    if ( UsesFilterbank_ )
+                    {
+                        const double* weights = FilterWeights_.data() + bucket * BinCount_;
+
+                        for ( size_t bin = 0; bin < BinCount_; ++bin )
+                        {
+                            power += weights[ bin ] * magnitudes[ bin ] * magnitudes[ bin ];
+                        }
+
+                        power *= PowerScale_;
+                    }
+                    else
+                    {
+                        for ( size_t bin = Bins_[ bucket ][ 0 ]; bin < Bins_[ bucket ][ 1 ]; ++bin )
+                        {
+                            power = magnitudes[ bin ] * magnitudes[ bin ] > power ? magnitudes[ bin ] * magnitudes[ bin ] : power;
+                        }
+                    }
+
+                    double value = power > 0.0 ? 10.0 * log10( power ) : REFERENCE_FLOOR;
+
+                    value = value > REFERENCE_FLOOR ? value : REFERENCE_FLOOR;
+
+                    Buckets_[ bucket ][ channel ] += ( value - Buckets_[ bucket ][ channel ] ) * Smoothing_;
+                }
+            }
+        }
+
+        // Check the processing results for the last window against the reference, keeping the worst errors.
+        void Compare( const PerFrameConstants& constants, const float* textureData, SuiteErrors& errors ) const
+        {
+            for ( uint32_t channel = 0; channel < 2; ++channel )
+            {
+                const double* magnitudes = Magnitudes_.data() + channel * BinCount_;
+                double        peak       = 0.0;
+
+                for ( size_t bin = 0; bin < BinCount_; ++bin )
+                {
+                    peak = magnitudes[ bin ] > peak ? magnitudes[ bin ] : peak;
+                }
+
+                for ( size_t bin = 0; bin < BinCount_ && peak >= MIN_SPECTRUM_PEAK; ++bin )
+                {
+                    double error = fabs( textureData[ bin * 4 + 2 + channel ] - magnitudes[ bin ] ) / peak;
+
+                    errors.Spectrum = error > errors.Spectrum ? error : errors.Spectrum;
+                }
+
+                for ( uint32_t bucket = FirstBucket_; bucket < BucketCount_; ++bucket )
+                {
+                    if ( Buckets_[ bucket ][ channel ] > CHECKED_FLOOR )
+                    {
+                        double error = fabs( constants.SoundFrequencyBuckets[ bucket ][ channel ] - Buckets_[ bucket ][ channel ] );
+
+                        errors.BucketDb = error > errors.BucketDb ? error : errors.BucketDb;
+                    }
+                }
+
+                if ( RMS_[ channel ] > 0.0 )
+                {
+                    double error = fabs( constants.SoundRMS[ channel ] - RMS_[ channel ] ) / RMS_[ channel ];
+
+                    errors.RMS = error > errors.RMS ? error : errors.RMS;
+                }
+            }
+        }
+
+    private:
+
+        // Dense triangular filter weights for each bucket. The bucket ranges are the outer edges of
+        // each triangle, and the peak of one is where the next starts (or the last ends the one before it).
+        void InitializeFilterbank( double binFrequency, const float* bucketRanges )
+        {
+            FilterWeights_.assign( BucketCount_ * BinCount_, 0.0 );
+
+            for ( uint32_t bucket = 0; bucket < BucketCount_; ++bucket )
+            {
+                double  lower   = bucketRanges[ bucket * 2 ];
+                double  upper   = bucketRanges[ bucket * 2 + 1 ];
+                double  center  = bucket + 1 < BucketCount_ ? bucketRanges[ ( bucket + 1 ) * 2 ] : bucketRanges[ ( bucket - 1 ) * 2 + 1 ];
+                double* weights = FilterWeights_.data() + bucket * BinCount_;
+                bool    empty   = true;
+
+                for ( size_t bin = 1; bin < BinCount_; ++bin )
+                {
+                    double frequency = bin * binFrequency;
+
+                    if ( frequency > lower && frequency < upper )
+                    {
+                        weights[ bin ] = frequency <= center ? ( frequency - lower ) / ( center - lower ) : ( upper - frequency ) / ( upper - center );
+                        empty          = false;
+                    }
+                }
+
+                // Narrower than a bin, so share the peak between the bins either side of it.
+                if ( empty )
+                {
+                    double position = center / binFrequency;
+                    size_t first    = position > 1.0 ? static_cast< size_t >( position ) : 1;
+
+                    first = first < BinCount_ - 2 ? first : BinCount_ - 2;
+
+                    double fraction = position - first;
+
+                    fraction = fraction < 0.0 ? 0.0 : ( fraction > 1.0 ? 1.0 : fraction );
+
+                    weights[ first ]     = 1.0 - fraction;
+                    weights[ first + 1 ] = fraction;
+                }
+            }
+        }
+
+        // In place radix 2 FFT of Real_ and Imaginary_.
+        void Transform()
+        {
+            for ( size_t index = 1, reversed = 0; index < Samples_; ++index )
+            {
+                size_t bit = Samples_ >> 1;
+
+                for ( ; ( reversed & bit ) != 0; bit >>= 1 )
+                {
+                    reversed ^= bit;
+                }
+
+                reversed |= bit;
+
+                if ( index < reversed )
+                {
+                    double real      = Real_[ index ];
+                    double imaginary = Imaginary_[ index ];
+
+                    Real_[ index ]         = Real_[ reversed ];
+                    Imaginary_[ index ]    = Imaginary_[ reversed ];
+                    Real_[ reversed ]      = real;
+                    Imaginary_[ reversed ] = imaginary;
+                }
+            }
+
+            for ( size_t span = 2; span <= Samples_; span <<= 1 )
+            {
+                size_t stride = Samples_ / span;
+
+                for ( size_t start = 0; start < Samples_; start += span )
+                {
+                    for ( size_t offset = 0; offset < span / 2; ++offset )
+                    {
+                        double angle     = Twiddles_[ offset * stride ];
+                        double cosine    = cos( angle );
+                        double sine      = sin( angle );
+                        size_t even      = start + offset;
+                        size_t odd       = even + span / 2;
+                        double real      = Real_[ odd ] * cosine - Imaginary_[ odd ] * sine;
+                        double imaginary = Real_[ odd ] * sine + Imaginary_[ odd ] * cosine;
+
+                        Real_[ odd ]       = Real_[ even ] - real;
+                        Imaginary_[ odd ]  = Imaginary_[ even ] - imaginary;
+                        Real_[ even ]      += real;
+                        Imaginary_[ even ] += imaginary;
+                    }
+                }
+            }
+        }
+
+        size_t                Samples_;
+        size_t                BinCount_;
+        double                Smoothing_;
+        double                PowerScale_;
+        bool                  UsesFilterbank_;
+        uint32_t              BucketCount_;
+        uint32_t              FirstBucket_;
+        size_t                Bins_[ FREQUENCY_BUCKETS ][ 2 ]; // [ first, end ) bins of each bucket.
+        double                Buckets_[ FREQUENCY_BUCKETS ][ 2 ];
+        double                RMS_[ 2 ];
+        std::vector< double > Window_;
+        std::vector< double > Twiddles_; // angles, so each twiddle is as exact as cos and sin make it.
+        std::vector< double > Real_;
+        std::vector< double > Imaginary_;
+        std::vector< double > Magnitudes_; // left bins then right bins.
+        std::vector< double > FilterWeights_; // BinCount_ weights for each bucket, when using a filterbank.
+    };
+
+    // Run one case, printing its timings and errors. Returns false on error or if a check failed.
+    bool RunCase( const SuiteCase& suiteCase, const AudioProcessingSettings& settings )
+    {
+        SyntheticAudioSource    source;
+        AudioProcessing         processing;
+        AudioProcessingSettings timedSettings = settings;
+        PerFrameConstants       constants     = {};
+        ReferenceAnalysis       reference;
+
+        timedSettings.TimeStages = true;
+
+        if ( !source.Open( suiteCase.Signal, SUITE_SAMPLE_RATE, suiteCase.ChannelCount, SUITE_SECONDS, suiteCase.Frequency, suiteCase.Amplitude ) ||
+             !processing.Initialize( source, timedSettings, constants ) )
+        {
+            printf( "Couldn't initialize audio processing for the %s signal\n", SyntheticSignalName( suiteCase.Signal ) );
+            return false;
+        }
+
+        reference.Initialize( processing.SamplesPerPeriod(), 
+                              source.SampleRate(), 
+                              processing.Smoothing(), 
+                              processing.BucketRanges(), 
+                              processing.Bucketing(), 
+                              processing.BucketCount(), 
+                              processing.LowBandBuckets() );
+
+        SuiteErrors errors  = { 0.0, 0.0, 0.0, -1.0 };
+        uint64_t    windows = 0;
+
+        for ( ;; )
+        {
+            AudioUpdateResult result = processing.Update( constants );
+
+            if ( result == AudioUpdateResult::AUDIO_ERROR )
+            {
+                printf( "Error generating the %s signal\n", SyntheticSignalName( suiteCase.Signal ) );
+                return false;
+            }
+            else if ( result == AudioUpdateResult::END_OF_STREAM )
+            {
+                break;
+            }
+            else if ( result == AudioUpdateResult::UPDATED )
+            {
+                ++windows;
+
+                reference.Update( source.GetChannel( 0 ), source.GetChannel( 1 ) );
+                reference.Compare( constants, processing.AudioTextureData(), errors );
+            }
+        }
+
+        if ( windows == 0 )
+        {
+            printf( "No windows were processed for the %s signal\n", SyntheticSignalName( suiteCase.Signal ) );
+            return false;
+        }
+
+        if ( suiteCase.Signal == SyntheticSignal::SINE )
+        {
+            // A sine of amplitude A has a mean square of A^2 / 2, which the K-weighting scales by its power gain.
+            // The signal is steady for all of the last 3s, so the short-term loudness should be exactly this.
+            double amplitude  = static_cast< double >( suiteCase.Amplitude );
+            double meanSquare = 0.0;
+
+            for ( uint32_t channel = 0; channel < 2; ++channel )
+            {
+                meanSquare += 0.5 * amplitude * amplitude * processing.Loudness().WeightingPower( source.SineFrequency( channel ) );
+            }
+
+            errors.Loudness = fabs( constants.SoundLoudnessShortTerm - ( -0.691 + 10.0 * log10( meanSquare ) ) );
+        }
+
+        bool passed = errors.BucketDb <= MAX_BUCKET_ERROR && 
+                      errors.Spectrum <= MAX_SPECTRUM_ERROR && 
+                      errors.RMS <= MAX_RMS_ERROR && 
+                      errors.Loudness <= MAX_LOUDNESS_ERROR;
+        char name[ 32 ];
+
+        ::snprintf( name, sizeof( name ), "%s%s", SyntheticSignalName( suiteCase.Signal ), suiteCase.ChannelCount == 1 ? " (mono)" : "" );
+
+        printf( "%-18s %7llu", name, static_cast< unsigned long long >( windows ) );
+
+        uint64_t total = 0;
+
+        for ( uint32_t stage = 0; stage < static_cast< uint32_t >( AudioStage::COUNT ); ++stage )
+        {
+            uint64_t nanoseconds = processing.StageNanoseconds( static_cast< AudioStage >( stage ) );
+
+            total += nanoseconds;
+
+            printf( " %9.0f", static_cast< double >( nanoseconds ) / static_cast< double >( windows ) );
+        }
+
+        printf( " %9.0f   %8.5f %10.2e %10.2e",
+                static_cast< double >( total ) / static_cast< double >( windows ),
+                errors.BucketDb,
+                errors.Spectrum,
+                errors.RMS );
+
+        if ( errors.Loudness >= 0.0 )
+        {
+            printf( " %8.4f", errors.Loudness );
+        }
+        else
+        {
+            printf( " %8s", "-" );
+        }
+
+        printf( "  %s\n", passed ? "pass" : "FAIL" );
+
+        return passed;
+    }
+}
+
+bool RunAnalysisSuite( const AudioProcessingSettings& settings )
+{
+    printf( "Synthetic signals, %.1f s at %u Hz, ns per window for each stage and worst error against the double precision reference:\n",
+            SUITE_SECONDS,
+            SUITE_SAMPLE_RATE );
+    printf( "%-18s %7s", "signal", "windows" );
+
+    for ( const char* stageName : STAGE_NAMES )
+    {
+        printf( " %9s", stageName );
+    }
+
+    printf( " %9s   %8s %10s %10s %8s\n", "total", "bucket dB", "spectrum", "rms", "lufs" );
+
+    bool passed = true;
+
+    for ( const SuiteCase& suiteCase : SUITE_CASES )
+    {
+        passed = RunCase( suiteCase, settings ) && passed;
+    }
+
+    printf( "Limits: buckets above %.0f dB within %.2f dB, spectrum within %.0e of the peak above %.0e, RMS within %.0e, sine loudness within %.2f LU\n",
+            CHECKED_FLOOR,
+            MAX_BUCKET_ERROR,
+            MAX_SPECTRUM_ERROR,
+            MIN_SPECTRUM_PEAK,
+            MAX_RMS_ERROR,
+            MAX_LOUDNESS_ERROR );
+    printf( "%s\n", passed ? "All checks passed" : "Some checks FAILED" );
+
+    return passed;
+}
@@ -0,0 +1,13 @@
+#ifndef BOONDOGGLE_ANALYSIS_SUITE_H__
+#define BOONDOGGLE_ANALYSIS_SUITE_H__
+
+#pragma once
+
+#include "../boondoggle/audio.h"
+
+// Run synthetic signals (sines, a sweep, white and pink noise and impulses) through processing with the given
+// settings. Reports the time per window of each stage and checks the buckets, RMS and spectrum of every
+// window against a double precision reference of the same analysis. Returns false if any check fails.
+bool RunAnalysisSuite( const AudioProcessingSettings& settings );
+
+#endif // -- BOONDOGGLE_ANALYSIS_SUITE_H__
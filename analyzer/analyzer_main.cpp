@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "../boondoggle/audio.h"
+#include "../boondoggle/audio_file_source.h"
+#include "../boondoggle/audio_features.h"
+#include "../common/allocation_tracker.h"
+#include "../common/arena_allocator.h"
+#include "fft_benchmark.h"
+#include "texture_benchmark.h"
+#include "package_benchmark.h"
+#include "analysis_suite.h"
+#include "package_suite.h"
+#include "filterbank_benchmark.h"
+
+// Headless driver for the audio analysis pipeline. Runs a wav file or a raw float stream
+// through AudioProcessing as fast as it will go and reports throughput and the final values.
+
+namespace
+{
+    void PrintUsage()
+    {
+        printf( "Usage: \n" );
+        printf( "    boondoggle_analyzer [options] <input.wav>\n" );
+        printf( "    boondoggle_analyzer --bench-fft\n" );
+        printf( "        (compare the FFT engines for accuracy and speed)\n" );
+        printf( "    boondoggle_analyzer --bench-package <package.bdg>\n" );
+        printf( "        (time loading an effects package from a cold and warm page cache)\n" );
+        printf( "    boondoggle_analyzer --bench-validate [package.bdg]\n" );
+        printf( "        (measure content hash throughput, and the cost of each part of validating a package)\n" );
+        printf( "    boondoggle_analyzer --bench-reload <old.bdg> <new.bdg>\n" );
+        printf( "        (reload one package over another with a mock device, counting the resources kept)\n" );
+        printf( "    boondoggle_analyzer [options] --suite\n" );
+        printf( "        (time each processing stage on synthetic signals and check them against a double precision reference,\n" );
+        printf( "        then check package validation rejects corrupted packages)\n" );
+        printf( "    boondoggle_analyzer [options] --raw <sample_rate> <channels> <input_file or - for stdin>\n" );
+        printf( "        (raw input is interleaved 32 bit float samples)\n" );
+        printf( "Options: \n" );
+        printf( "    --hop <samples>    samples between analysis windows (power of two, default is a whole period)\n" );
+        printf( "    --kernels <set>    processing kernels to use: auto, scalar, sse41 or avx2 (default auto)\n" );
+        printf( "    --low-band <factor> decimation factor for the multi-resolution low band (default off)\n" );
+        printf( "    --fft <engine>     FFT engine to use: kiss or specialized (default specialized)\n" );
+        printf( "    --rate <hz>        resample the input to this analysis rate first (default off)\n" );
+        printf( "    --buckets <count>  frequency buckets to analyze, up to %u (default %u)\n", FREQUENCY_BUCKETS, DEFAULT_FREQUENCY_BUCKETS );
+        printf( "    --filterbank <scale> bucketing: peak (loudest bin), mel or bark triangular filters (default peak)\n" );
+        printf( "    --edges <hz,hz,...> triangular filters on these edges, one bucket for every edge past the second\n" );
+        printf( "    --write-features <file> write a feature file (a record per hop) for the runtime to play back\n" );
+        printf( "    --texture <format> sound texture format to produce: float32 or half (default float32)\n" );
+        printf( "    --bench-texture    report upload bandwidth and precision of the sound texture formats instead\n" );
+        printf( "    --bench-filterbank compare the cost and steadiness of the bucketings on synthetic noise instead\n" );
+    }
+
+    const char* InstructionSetName( AudioInstructionSet instructionSet )
+    {
+        switch ( instructionSet )
+        {
+        case AudioInstructionSet::SCALAR:
+
+            return "scalar";
+
+        case AudioInstructionSet::SSE41:
+
+            return "sse41";
+
+        case AudioInstructionSet::AVX2:
+
+            return "avx2";
+
+        default:
+
+            return "auto";
+        }
+    }
+
+    // Parse an instruction set name, returns false if it isn't one we know.
+    bool ParseInstructionSet( const char* name, AudioInstructionSet& instructionSet )
+    {
+        const AudioInstructionSet sets[] = { AudioInstructionSet::AUTO, AudioInstructionSet::SCALAR, AudioInstructionSet::SSE41, AudioInstructionSet::AVX2 };
+
+        for ( AudioInstructionSet set : sets )
+        {
+            if ( ::strcmp( name, InstructionSetName( set ) ) == 0 )
+            {
+                instructionSet = set;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Parse a bucketing scale name (custom buckets come from --edges), returns false if it isn't one we know.
+    bool ParseBucketing( const char* name, FrequencyBucketing& bucketing )
+    {
+        const FrequencyBucketing scales[] = { FrequencyBucketing::PEAK_BINS, FrequencyBucketing::MEL, FrequencyBucketing::BARK };
+
+        for ( FrequencyBucketing scale : scales )
+        {
+            if ( ::strcmp( name, FrequencyBucketingName( scale ) ) == 0 )
+            {
+                bucketing = scale;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Parse comma separated edge frequencies, returns the number of edges or 0 if there are too many or any aren't numbers.
+    uint32_t ParseEdges( const char* list, float* edges, uint32_t maxEdges )
+    {
+        uint32_t edgeCount = 0;
+
+        for ( const char* cursor = list; edgeCount < maxEdges; ++cursor )
+        {
+            char* end = nullptr;
+
+            edges[ edgeCount++ ] = ::strtof( cursor, &end );
+
+            if ( end == cursor || ( *end != ',' && *end != '\0' ) )
+            {
+                return 0;
+            }
+
+            if ( *end == '\0' )
+            {
+                return edgeCount;
+            }
+
+            cursor = end;
+        }
+
+        return 0;
+    }
+
+    // Map a feature file we just wrote and check it holds what we wrote, returns false if it doesn't.
+    bool CheckFeatures( const char* featuresPath, uint64_t expectedRecords, const AudioProcessing& processing, const PerFrameConstants& lastConstants )
+    {
+        AudioFeatureStream features;
+
+        if ( !features.Open( featuresPath ) )
+        {
+            printf( "Couldn't map feature file %s\n", featuresPath );
+            return false;
+        }
+
+        uint64_t          last      = features.RecordAt( features.Duration() + 1.0 );
+        PerFrameConstants constants = {};
+
+        features.ApplyRecord( last, constants );
+
+        if ( features.RecordCount() != expectedRecords ||
+             last != expectedRecords - 1 ||
+             features.BucketCount() != processing.BucketCount() ||
+             ::memcmp( features.BucketRanges(), processing.BucketRanges(), sizeof( float ) * FREQUENCY_BUCKETS * 2 ) != 0 ||
+             ::memcmp( constants.SoundFrequencyBuckets, lastConstants.SoundFrequencyBuckets, sizeof( constants.SoundFrequencyBuckets ) ) != 0 ||
+             ::memcmp( features.TextureData( last ), processing.AudioTextureData(), features.TextureSamples() * sizeof( float ) * 4 ) != 0 )
+        {
+            printf( "Feature file %s doesn't match the analysis\n", featuresPath );
+            return false;
+        }
+
+        printf( "Feature records:     %llu (%.1f MB, %.3f s)\n",
+                static_cast< unsigned long long >( features.RecordCount() ),
+                static_cast< double >( features.RecordCount() * features.Header().RecordSize ) / ( 1024.0 * 1024.0 ),
+                features.Duration() );
+
+        return true;
+    }
+
+    // Run the source through processing until the stream ends, returns false on error.
+    // If featuresPath isn't null, a feature file is written from the updates.
+    bool RunAnalysis( AudioSource& source, const AudioProcessingSettings& settings, const char* featuresPath )
+    {
+        AudioProcessing   processing;
+        PerFrameConstants constants = {};
+
+        if ( !processing.Initialize( source, settings, constants ) )
+        {
+            printf( "Couldn't initialize audio processing for the input\n" );
+            return false;
+        }
+
+        uint64_t           updates = 0;
+        LatencyStats       latency;
+        AudioFeatureWriter features;
+
+        if ( featuresPath != nullptr &&
+             !features.Open( featuresPath,
+                             source.SampleRate(),
+                             static_cast< uint32_t >( source.HopSamples() ),
+                             static_cast< uint32_t >( source.SamplesPerPeriod() ),
+                             processing.BucketCount(),
+                             processing.BucketRanges() ) )
+        {
+            printf( "Couldn't open feature file %s for writing\n", featuresPath );
+            return false;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for ( ;; )
+        {
+            // Same as the audio thread, debug builds assert the processing doesn't touch the heap.
+            NoHeapAllocationScope updateAllocations;
+
+            AudioUpdateResult result = processing.Update( constants );
+
+            if ( result == AudioUpdateResult::AUDIO_ERROR )
+            {
+                printf( "Error reading audio input\n" );
+                return false;
+            }
+            else if ( result == AudioUpdateResult::END_OF_STREAM )
+            {
+                break;
+            }
+            else if ( result == AudioUpdateResult::UPDATED )
+            {
+                ++updates;
+
+                // No render stages here, so only the audio ones get recorded.
+                latency.RecordFrame( processing.Timestamps(), true, 0, 0 );
+
+                if ( featuresPath != nullptr && !features.Write( source.WindowEndCursor(), constants, processing.AudioTextureData() ) )
+                {
+                    printf( "Error writing feature file %s\n", featuresPath );
+                    return false;
+                }
+            }
+        }
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        if ( featuresPath != nullptr && !features.Close() )
+        {
+            printf( "Error writing feature file %s\n", featuresPath );
+            return false;
+        }
+
+        double   elapsedSeconds = std::chrono::duration< double >( end - start ).count();
+        uint64_t audioSamples   = updates > 0 ? source.SamplesPerPeriod() + ( updates - 1 ) * source.HopSamples() : 0;
+        double   audioSeconds   = static_cast< double >( audioSamples ) / static_cast< double >( source.SampleRate() );
+
+        printf( "Kernels:             %s\n", InstructionSetName( processing.InstructionSet() ) );
+        printf( "FFT:                 %s\n", processing.FFTUsed() == FFTImplementation::KISS ? "kiss" : "specialized" );
+        printf( "Sample rate:         %u\n", source.SampleRate() );
+
+        if ( source.IsResampling() )
+        {
+            printf( "Resampled from:      %u\n", source.InputSampleRate() );
+        }
+
+        printf( "Samples per period:  %u\n", static_cast< uint32_t >( source.SamplesPerPeriod() ) );
+        printf( "Hop samples:         %u\n", static_cast< uint32_t >( source.HopSamples() ) );
+        printf( "Bucketing:           %s (%u buckets)\n", FrequencyBucketingName( processing.Bucketing() ), processing.BucketCount() );
+        printf( "Low band buckets:    %u\n", processing.LowBandBuckets() );
+        printf( "Windows processed:   %llu\n", static_cast< unsigned long long >( updates ) );
+        printf( "Audio duration:      %.3f s\n", audioSeconds );
+        printf( "Processing time:     %.3f s\n", elapsedSeconds );
+
+        if ( updates > 0 && elapsedSeconds > 0.0 )
+        {
+            printf( "Time per window:     %.0f ns\n", ( elapsedSeconds * 1e9 ) / static_cast< double >( updates ) );
+            printf( "Real-time factor:    %.1fx\n", audioSeconds / elapsedSeconds );
+        }
+
+        printf( "Latency:\n" );
+
+        latency.Print( stdout );
+
+        printf( "Memory:\n" );
+
+        ArenaAllocator::PrintReport( stdout );
+
+        printf( "RMS (L/R):           %f %f\n", constants.SoundRMS[ 0 ], constants.SoundRMS[ 1 ] );
+        printf( "Loudness:            %.2f LUFS momentary, %.2f LUFS short-term (gain %.2f)\n", 
+                constants.SoundLoudnessMomentary, 
+                constants.SoundLoudnessShortTerm, 
+                constants.SoundLoudnessGain );
+        printf( "Tempo:               %.1f BPM (confidence %.2f)\n", constants.SoundBPM, constants.SoundBeatConfidence );
+        printf( "Beat phase:          %.2f\n", constants.SoundBeatPhase );
+        printf( "Onset strength:      %.2f\n", constants.SoundOnsetStrength );
+        printf( "Buckets (dB SPL L/R, Hz range):\n" );
+
+        for ( uint32_t bucket = 0; bucket < processing.BucketCount(); ++bucket )
+        {
+            printf( "    %2u: %8.2f %8.2f  [%8.1f, %8.1f]\n",
+                    bucket,
+                    constants.SoundFrequencyBuckets[ bucket ][ 0 ],
+                    constants.SoundFrequencyBuckets[ bucket ][ 1 ],
+                    processing.BucketRanges()[ bucket * 2 ],
+                    processing.BucketRanges()[ bucket * 2 + 1 ] );
+        }
+
+        if ( featuresPath != nullptr && updates > 0 )
+        {
+            return CheckFeatures( featuresPath, features.RecordCount(), processing, constants );
+        }
+
+        return true;
+    }
+}
+
+int main( int argc, const char** argv )
+{
+    AudioProcessingSettings settings;
+    const char*             featuresPath = nullptr;
+    bool                    benchTexture = false;
+    bool                    runSuite     = false;
+    bool                    benchBuckets = false;
+    float                   edges[ FREQUENCY_BUCKETS + 2 ];
+
+    if ( argc == 2 && ::strcmp( argv[ 1 ], "--bench-fft" ) == 0 )
+    {
+        return RunFFTBenchmark() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( argc == 3 && ::strcmp( argv[ 1 ], "--bench-package" ) == 0 )
+    {
+        return RunPackageBenchmark( argv[ 2 ] ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( ( argc == 2 || argc == 3 ) && ::strcmp( argv[ 1 ], "--bench-validate" ) == 0 )
+    {
+        return RunValidationBenchmark( argc == 3 ? argv[ 2 ] : nullptr ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( argc == 4 && ::strcmp( argv[ 1 ], "--bench-reload" ) == 0 )
+    {
+        return RunReloadBenchmark( argv[ 2 ], argv[ 3 ] ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int argument = 1;
+
+    for ( ; argument < argc && ::strncmp( argv[ argument ], "--", 2 ) == 0 && ::strcmp( argv[ argument ], "--raw" ) != 0; ++argument )
+    {
+        if ( ::strcmp( argv[ argument ], "--hop" ) == 0 && argument + 1 < argc )
+        {
+            settings.HopSamples = static_cast< uint32_t >( ::strtoul( argv[ ++argument ], nullptr, 10 ) );
+        }
+        else if ( ::strcmp( argv[ argument ], "--fft" ) == 0 && argument + 1 < argc && ::strcmp( argv[ argument + 1 ], "kiss" ) == 0 )
+        {
+            settings.FFT = FFTImplementation::KISS;
+            ++argument;
+        }
+        else if ( ::strcmp( argv[ argument ], "--fft" ) == 0 && argument + 1 < argc && ::strcmp( argv[ argument + 1 ], "specialized" ) == 0 )
+        {
+            settings.FFT = FFTImplementation::SPECIALIZED;
+            ++argument;
+        }
+        else if ( ::strcmp( argv[ argument ], "--low-band" ) == 0 && argument + 1 < argc )
+        {
+            settings.LowBandDecimation = static_cast< uint32_t >( ::strtoul( argv[ ++argument ], nullptr, 10 ) );
+        }
+        else if ( ::strcmp( argv[ argument ], "--rate" ) == 0 && argument + 1 < argc )
+        {
+            settings.AnalysisRate = static_cast< uint32_t >( ::strtoul( argv[ ++argument ], nullptr, 10 ) );
+        }
+        else if ( ::strcmp( argv[ argument ], "--buckets" ) == 0 && argument + 1 < argc )
+        {
+            settings.BucketCount = static_cast< uint32_t >( ::strtoul( argv[ ++argument ], nullptr, 10 ) );
+        }
+        else if ( ::strcmp( argv[ argument ], "--filterbank" ) == 0 && argument + 1 < argc && ParseBucketing( argv[ argument + 1 ], settings.Bucketing ) )
+        {
+            ++argument;
+        }
+        else if ( ::strcmp( argv[ argument ], "--edges" ) == 0 && argument + 1 < argc )
+        {
+            uint32_t edgeCount = ParseEdges( argv[ ++argument ], edges, FREQUENCY_BUCKETS + 2 );
+
+            if ( edgeCount < 4 )
+            {
+                printf( "Need 4 to %u comma separated edge frequencies\n", FREQUENCY_BUCKETS + 2 );
+                return EXIT_FAILURE;
+            }
+
+            settings.Bucketing   = FrequencyBucketing::CUSTOM;
+            settings.BucketCount = edgeCount - 2;
+            settings.BucketEdges = edges;
+        }
+        else if ( ::strcmp( argv[ argument ], "--texture" ) == 0 && argument + 1 < argc && ::strcmp( argv[ argument + 1 ], "float32" ) == 0 )
+        {
+            settings.TextureFormat = SoundTextureFormat::FLOAT32;
+            ++argument;
+        }
+        else if ( ::strcmp( argv[ argument ], "--texture" ) == 0 && argument + 1 < argc && ::strcmp( argv[ argument + 1 ], "half" ) == 0 )
+        {
+            settings.TextureFormat = SoundTextureFormat::HALF;
+            ++argument;
+        }
+        else if ( ::strcmp( argv[ argument ], "--suite" ) == 0 )
+        {
+            runSuite = true;
+        }
+        else if ( ::strcmp( argv[ argument ], "--bench-texture" ) == 0 )
+        {
+            benchTexture = true;
+        }
+        else if ( ::strcmp( argv[ argument ], "--bench-filterbank" ) == 0 )
+        {
+            benchBuckets = true;
+        }
+        else if ( ::strcmp( argv[ argument ], "--write-features" ) == 0 && argument + 1 < argc )
+        {
+            featuresPath = argv[ ++argument ];
+        }
+        else if ( ::strcmp( argv[ argument ], "--kernels" ) == 0 && argument + 1 < argc && ParseInstructionSet( argv[ argument + 1 ], settings.Kernels ) )
+        {
+            ++argument;
+        }
+        else
+        {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ( runSuite )
+    {
+        bool passed = RunAnalysisSuite( settings );
+
+        passed = RunPackageCorruptionSuite() && passed;
+        passed = RunPackageReloadSuite() && passed;
+
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( benchBuckets )
+    {
+        return RunFilterbankBenchmark( settings ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ( argument >= argc )
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    if ( ::strcmp( argv[ argument ], "--raw" ) == 0 )
+    {
+        if ( argument + 3 >= argc )
+        {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+
+        RawStreamAudioSource source;
+
+        uint32_t sampleRate   = static_cast< uint32_t >( ::strtoul( argv[ argument + 1 ], nullptr, 10 ) );
+        uint32_t channelCount = static_cast< uint32_t >( ::strtoul( argv[ argument + 2 ], nullptr, 10 ) );
+
+        if ( !source.Open( argv[ argument + 3 ], sampleRate, channelCount ) )
+        {
+            printf( "Couldn't open raw input %s\n", argv[ argument + 3 ] );
+            return EXIT_FAILURE;
+        }
+
+        if ( benchTexture )
+        {
+            return RunTextureBenchmark( source, settings ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        return RunAnalysis( source, settings, featuresPath ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    WavFileAudioSource source;
+
+    if ( !source.Open( argv[ argument ] ) )
+    {
+        printf( "Couldn't open wav file %s\n", argv[ argument ] );
+        return EXIT_FAILURE;
+    }
+
+    if ( benchTexture )
+    {
+        return RunTextureBenchmark( source, settings ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    return RunAnalysis( source, settings, featuresPath ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,36 @@
+#include "counting_backend.h"
+
+void* CountingBackend::Create( const PackageView& package, PackageResourceKinds kind, uint32_t index )
+{
+    if ( ++Attempts_ == FailOn_ )
+    {
+        return nullptr;
+    }
+
+    switch ( kind )
+    {
+    case PackageResourceKinds::PIXEL_SHADER:
+
+        UploadedBytes_ += package.Shaders()[ index ].Size;
+        break;
+
+    case PackageResourceKinds::VERTEX_SHADER:
+
+        UploadedBytes_ += package.ScreenAlignedQuadVS().Size;
+        break;
+
+    case PackageResourceKinds::STATIC_TEXTURE:
+
+        UploadedBytes_ += package.StaticTextures()[ index ].Size;
+        break;
+
+    default:
+
+        break;
+    }
+
+    ++Live_;
+    ++Created_;
+
+    return reinterpret_cast< void* >( ++NextHandle_ );
+}
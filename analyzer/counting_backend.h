@@ -0,0 +1,49 @@
+#ifndef BOONDOGGLE_COUNTING_BACKEND_H__
+#define BOONDOGGLE_COUNTING_BACKEND_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../common/package_resources.h"
+
+// Stands in for the device, handing out numbers as resources and counting what would be uploaded. It can be
+// told to fail a creation, to check what a failed reload leaves behind.
+class CountingBackend : public PackageResourceBackend
+{
+public:
+
+    CountingBackend() : NextHandle_( 0 ), Live_( 0 ), Created_( 0 ), Attempts_( 0 ), FailOn_( 0 ), UploadedBytes_( 0 ) {}
+
+    void* Create( const PackageView& package, PackageResourceKinds kind, uint32_t index ) override;
+
+    void Release( PackageResourceKinds, void* ) override { --Live_; }
+
+    // Start counting creations and uploads again.
+    void ResetCounts()
+    {
+        Created_       = 0;
+        Attempts_      = 0;
+        UploadedBytes_ = 0;
+    }
+
+    // Fail the creation-th call to Create after the last ResetCounts (counting from 1), 0 to not fail any.
+    void FailOn( uint32_t creation ) { FailOn_ = creation; }
+
+    uint32_t Live() const { return Live_; }
+
+    uint32_t Created() const { return Created_; }
+
+    size_t UploadedBytes() const { return UploadedBytes_; }
+
+private:
+
+    uintptr_t NextHandle_;
+    uint32_t  Live_;
+    uint32_t  Created_;
+    uint32_t  Attempts_;
+    uint32_t  FailOn_;
+    size_t    UploadedBytes_;
+};
+
+#endif // -- BOONDOGGLE_COUNTING_BACKEND_H__
@@ -0,0 +1,170 @@
+#include "fft_benchmark.h"
+#include "../boondoggle/audio_fft.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+namespace
+{
+    const uint32_t BENCHMARK_SIZES[]         = { 1024, 2048, 4096 };
+    const uint32_t BENCHMARK_SAMPLES_TOTAL   = 1u << 26; // transforms per size are scaled so each size does about the same work.
+    const char*    IMPLEMENTATION_NAMES[]    = { "kiss", "specialized" };
+
+    // Double precision DFT of a complex signal, the reference the engines are checked against.
+    void ReferenceDFT( const std::vector< kiss_fft_cpx >& input, std::vector< double >& outputReal, std::vector< double >& outputImaginary )
+    {
+        size_t size = input.size();
+
+        std::vector< double > cosTable( size );
+        std::vector< double > sinTable( size );
+
+        for ( size_t where = 0; where < size; ++where )
+        {
+            double angle = ( -2.0 * M_PI * where ) / size;
+
+            cosTable[ where ] = cos( angle );
+            sinTable[ where ] = sin( angle );
+        }
+
+        outputReal.assign( size, 0.0 );
+        outputImaginary.assign( size, 0.0 );
+
+        for ( size_t bin = 0; bin < size; ++bin )
+        {
+            double real      = 0.0;
+            double imaginary = 0.0;
+
+            for ( size_t sample = 0; sample < size; ++sample )
+            {
+                size_t twiddle = ( bin * sample ) & ( size - 1 );
+
+                real      += input[ sample ].r * cosTable[ twiddle ] - input[ sample ].i * sinTable[ twiddle ];
+                imaginary += input[ sample ].r * sinTable[ twiddle ] + input[ sample ].i * cosTable[ twiddle ];
+            }
+
+            outputReal[ bin ]      = real;
+            outputImaginary[ bin ] = imaginary;
+        }
+    }
+
+    // Max error of the bins against the reference, relative to the largest reference magnitude.
+    double RelativeError( const kiss_fft_cpx* bins, size_t binCount, const std::vector< double >& referenceReal, const std::vector< double >& referenceImaginary )
+    {
+        double maxError     = 0.0;
+        double maxMagnitude = 0.0;
+
+        for ( size_t bin = 0; bin < binCount; ++bin )
+        {
+            double errorReal      = bins[ bin ].r - referenceReal[ bin ];
+            double errorImaginary = bins[ bin ].i - referenceImaginary[ bin ];
+            double error          = sqrt( errorReal * errorReal + errorImaginary * errorImaginary );
+            double magnitude      = sqrt( referenceReal[ bin ] * referenceReal[ bin ] + referenceImaginary[ bin ] * referenceImaginary[ bin ] );
+
+            maxError     = error > maxError ? error : maxError;
+            maxMagnitude = magnitude > maxMagnitude ? magnitude : maxMagnitude;
+        }
+
+        return maxMagnitude > 0.0 ? maxError / maxMagnitude : maxError;
+    }
+
+    template < typename TransformType >
+    double NanosecondsPerTransform( uint32_t iterations, TransformType transform )
+    {
+        // warm up caches and twiddles before timing.
+        for ( uint32_t iteration = 0; iteration < 16; ++iteration )
+        {
+            transform();
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for ( uint32_t iteration = 0; iteration < iterations; ++iteration )
+        {
+            transform();
+        }
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration< double, std::nano >( end - start ).count() / iterations;
+    }
+}
+
+bool RunFFTBenchmark()
+{
+    printf( "%6s %-12s %14s %14s %12s %12s\n", "size", "engine", "complex error", "real error", "complex ns", "real ns" );
+
+    for ( uint32_t size : BENCHMARK_SIZES )
+    {
+        std::vector< kiss_fft_cpx > complexInput( size );
+        std::vector< kiss_fft_cpx > realAsComplex( size );
+        std::vector< float >        realInput( size );
+        std::vector< kiss_fft_cpx > output( size );
+        uint32_t                    random = 0x12345678;
+
+        for ( uint32_t sample = 0; sample < size; ++sample )
+        {
+            float values[ 2 ];
+
+            for ( float& value : values )
+            {
+                random = random * 1664525u + 1013904223u;
+                value  = static_cast< float >( random >> 8 ) / static_cast< float >( 1u << 24 ) * 2.0f - 1.0f;
+            }
+
+            complexInput[ sample ].r  = values[ 0 ];
+            complexInput[ sample ].i  = values[ 1 ];
+            realInput[ sample ]       = values[ 0 ];
+            realAsComplex[ sample ].r = values[ 0 ];
+            realAsComplex[ sample ].i = 0.0f;
+        }
+
+        std::vector< double > complexReal;
+        std::vector< double > complexImaginary;
+        std::vector< double > realReal;
+        std::vector< double > realImaginary;
+
+        ReferenceDFT( complexInput, complexReal, complexImaginary );
+        ReferenceDFT( realAsComplex, realReal, realImaginary );
+
+        uint32_t iterations = BENCHMARK_SAMPLES_TOTAL / size;
+
+        for ( FFTImplementation implementation : { FFTImplementation::KISS, FFTImplementation::SPECIALIZED } )
+        {
+            FFTEngine* engine = CreateFFTEngine( implementation, size );
+
+            if ( engine == nullptr )
+            {
+                printf( "Couldn't create %s FFT engine for size %u\n", IMPLEMENTATION_NAMES[ static_cast< uint32_t >( implementation ) ], size );
+                return false;
+            }
+
+            engine->Forward( complexInput.data(), output.data() );
+
+            double complexError = RelativeError( output.data(), size, complexReal, complexImaginary );
+
+            engine->ForwardReal( realInput.data(), output.data() );
+
+            double realError = RelativeError( output.data(), size / 2 + 1, realReal, realImaginary );
+
+            double complexNs = NanosecondsPerTransform( iterations, [&]() { engine->Forward( complexInput.data(), output.data() ); } );
+            double realNs    = NanosecondsPerTransform( iterations, [&]() { engine->ForwardReal( realInput.data(), output.data() ); } );
+
+            printf( "%6u %-12s %14.3e %14.3e %12.0f %12.0f\n",
+                    size,
+                    IMPLEMENTATION_NAMES[ static_cast< uint32_t >( engine->Implementation() ) ],
+                    complexError,
+                    realError,
+                    complexNs,
+                    realNs );
+
+            delete engine;
+        }
+    }
+
+    return true;
+}
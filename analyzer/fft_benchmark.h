@@ -0,0 +1,10 @@
+#ifndef BOONDOGGLE_FFT_BENCHMARK_H__
+#define BOONDOGGLE_FFT_BENCHMARK_H__
+
+#pragma once
+
+// Compare the FFT engines against a double precision reference DFT for accuracy and time
+// each of them, for every period size AudioSource uses. Returns false if an engine couldn't be created.
+bool RunFFTBenchmark();
+
+#endif // -- BOONDOGGLE_FFT_BENCHMARK_H__
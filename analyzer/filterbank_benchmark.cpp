@@ -0,0 +1,160 @@
+#include "filterbank_benchmark.h"
+#include "synthetic_source.h"
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+namespace
+{
+    const uint32_t BENCHMARK_SAMPLE_RATE = 48000;
+    const double   BENCHMARK_SECONDS     = 20.0;
+    const double   SETTLE_SECONDS        = 1.0; // smoothing starts from the floor, so leave the first second out of the jitter.
+
+    struct BucketingResult
+    {
+        double SpectrumNanoseconds; // per window.
+        double JitterTop; // mean absolute change in dB per window of the top half of the buckets.
+        double JitterAll;
+    };
+
+    // Run white noise through processing with the settings, returns false on error.
+    bool RunBucketing( const AudioProcessingSettings& settings, BucketingResult& result )
+    {
+        SyntheticAudioSource source;
+        AudioProcessing      processing;
+        PerFrameConstants    constants = {};
+
+        if ( !source.Open( SyntheticSignal::WHITE_NOISE, BENCHMARK_SAMPLE_RATE, 2, BENCHMARK_SECONDS, 0.0, 0.5f ) ||
+             !processing.Initialize( source, settings, constants ) )
+        {
+            printf( "Couldn't initialize audio processing with %s bucketing\n", FrequencyBucketingName( settings.Bucketing ) );
+            return false;
+        }
+
+        uint32_t             bucketCount   = processing.BucketCount();
+        uint64_t             settleWindows = static_cast< uint64_t >( ( SETTLE_SECONDS * BENCHMARK_SAMPLE_RATE ) / processing.Source().HopSamples() );
+        uint64_t             windows       = 0;
+        uint64_t             measured      = 0;
+        double               changeTop     = 0.0;
+        double               changeAll     = 0.0;
+        std::vector< float > previous( bucketCount * 2 );
+
+        for ( ;; )
+        {
+            AudioUpdateResult updateResult = processing.Update( constants );
+
+            if ( updateResult == AudioUpdateResult::AUDIO_ERROR )
+            {
+                printf( "Error generating the benchmark signal\n" );
+                return false;
+            }
+            else if ( updateResult == AudioUpdateResult::END_OF_STREAM )
+            {
+                break;
+            }
+            else if ( updateResult != AudioUpdateResult::UPDATED )
+            {
+                continue;
+            }
+
+            if ( windows++ > settleWindows )
+            {
+                for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+                {
+                    for ( uint32_t channel = 0; channel < 2; ++channel )
+                    {
+                        double change = fabs( constants.SoundFrequencyBuckets[ bucket ][ channel ] - previous[ bucket * 2 + channel ] );
+
+                        changeAll += change;
+                        changeTop += bucket >= bucketCount / 2 ? change : 0.0;
+                    }
+                }
+
+                ++measured;
+            }
+
+            for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+            {
+                previous[ bucket * 2 ]     = constants.SoundFrequencyBuckets[ bucket ][ 0 ];
+                previous[ bucket * 2 + 1 ] = constants.SoundFrequencyBuckets[ bucket ][ 1 ];
+            }
+        }
+
+        if ( measured == 0 )
+        {
+            printf( "Too few windows to measure\n" );
+            return false;
+        }
+
+        uint32_t topCount = bucketCount - bucketCount / 2;
+
+        result.SpectrumNanoseconds = static_cast< double >( processing.StageNanoseconds( AudioStage::SPECTRUM ) ) / static_cast< double >( windows );
+        result.JitterTop           = changeTop / ( static_cast< double >( measured ) * topCount * 2 );
+        result.JitterAll           = changeAll / ( static_cast< double >( measured ) * bucketCount * 2 );
+
+        return true;
+    }
+
+    const char* KernelName( AudioInstructionSet instructionSet )
+    {
+        switch ( instructionSet )
+        {
+        case AudioInstructionSet::SSE41:
+
+            return "sse41";
+
+        case AudioInstructionSet::AVX2:
+
+            return "avx2";
+
+        default:
+
+            return "scalar";
+        }
+    }
+}
+
+bool RunFilterbankBenchmark( const AudioProcessingSettings& settings )
+{
+    std::vector< FrequencyBucketing > bucketings = { FrequencyBucketing::PEAK_BINS, FrequencyBucketing::MEL, FrequencyBucketing::BARK };
+
+    if ( settings.Bucketing == FrequencyBucketing::CUSTOM )
+    {
+        bucketings.push_back( FrequencyBucketing::CUSTOM );
+    }
+
+    AudioInstructionSet bestSupported = DetectAudioInstructionSet();
+
+    printf( "White noise, %.0f s at %u Hz. Spectrum is the ns per window for the magnitudes and bucketing, jitter the mean\n", 
+            BENCHMARK_SECONDS, 
+            BENCHMARK_SAMPLE_RATE );
+    printf( "change of a bucket in dB from one window to the next (after smoothing, which is what effects see):\n" );
+    printf( "%-8s %-8s %12s %14s %14s\n", "kernels", "buckets", "spectrum ns", "jitter top dB", "jitter all dB" );
+
+    for ( uint32_t set = static_cast< uint32_t >( AudioInstructionSet::SCALAR ); set <= static_cast< uint32_t >( bestSupported ); ++set )
+    {
+        for ( FrequencyBucketing bucketing : bucketings )
+        {
+            AudioProcessingSettings benchSettings = settings;
+            BucketingResult         result;
+
+            benchSettings.Kernels    = static_cast< AudioInstructionSet >( set );
+            benchSettings.Bucketing  = bucketing;
+            benchSettings.TimeStages = true;
+
+            if ( !RunBucketing( benchSettings, result ) )
+            {
+                return false;
+            }
+
+            printf( "%-8s %-8s %12.0f %14.3f %14.3f\n",
+                    KernelName( benchSettings.Kernels ),
+                    FrequencyBucketingName( bucketing ),
+                    result.SpectrumNanoseconds,
+                    result.JitterTop,
+                    result.JitterAll );
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef BOONDOGGLE_FILTERBANK_BENCHMARK_H__
+#define BOONDOGGLE_FILTERBANK_BENCHMARK_H__
+
+#pragma once
+
+#include "../boondoggle/audio.h"
+
+// Run synthetic white noise through processing with each bucketing (the loudest bin buckets and the mel and bark
+// filterbanks, plus custom edges if the settings have them) on each supported instruction set. Reports the time per
+// window of the spectrum and bucketing stage and how much the buckets jitter from one window to the next.
+// Returns false on error.
+bool RunFilterbankBenchmark( const AudioProcessingSettings& settings );
+
+#endif // -- BOONDOGGLE_FILTERBANK_BENCHMARK_H__
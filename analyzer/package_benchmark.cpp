@@ -0,0 +1,509 @@
+#include "package_benchmark.h"
+#include "counting_backend.h"
+#include "../common/package_view.h"
+#include "../common/package_resources.h"
+#include "../common/content_hash.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const uint32_t COLD_ITERATIONS = 5;
+    const uint32_t WARM_ITERATIONS = 20;
+    const size_t   HASH_BENCHMARK_SIZE = 256 * 1024 * 1024;
+    const uint32_t HASH_ITERATIONS     = 5;
+    const uint32_t VALIDATE_ITERATIONS = 10;
+
+    typedef std::chrono::steady_clock Clock;
+
+    double MillisecondsSince( Clock::time_point start )
+    {
+        return std::chrono::duration< double, std::milli >( Clock::now() - start ).count();
+    }
+
+    struct LoadTiming
+    {
+        double OpenMilliseconds;  // map, validate, prefetch and decompress.
+        double ReadyMilliseconds; // and read every payload.
+    };
+
+    // Say why a package didn't open.
+    void PrintOpenFailure( const PackageView& view, const char* path )
+    {
+        if ( view.Outdated() )
+        {
+            printf( "Package %s is from an older version of the package format, recompile it\n", path );
+        }
+        else
+        {
+            printf( "Couldn't open package %s\n", path );
+        }
+    }
+
+    // Drop the file's pages from the page cache, so the next open reads it from disk. Returns false if it couldn't.
+    bool EvictFromPageCache( const char* path )
+    {
+#if defined( _WIN32 )
+        // Opening without buffering flushes the file's cached pages when nothing else has it open.
+        HANDLE file = ::CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr );
+
+        if ( file == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+
+        ::CloseHandle( file );
+
+        return true;
+#else
+        int file = ::open( path, O_RDONLY );
+
+        if ( file < 0 )
+        {
+            return false;
+        }
+
+        bool result = ::posix_fadvise( file, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+
+        ::close( file );
+
+        return result;
+#endif
+    }
+
+    // Read every byte of every payload, like creating the resources would, returning a sum so it isn't optimized out.
+    uint64_t ReadPayloads( const PackageView& view )
+    {
+        uint64_t        sum      = 0;
+        PackageBlobSpan blobs[ 2 ] = { view.Shaders(), view.StaticTextures() };
+
+        for ( const PackageBlobSpan& span : blobs )
+        {
+            for ( uint32_t blobIndex = 0; blobIndex < span.Count(); ++blobIndex )
+            {
+                PackageBlob blob = span[ blobIndex ];
+
+                for ( uint32_t where = 0; where < blob.Size; ++where )
+                {
+                    sum += blob.Data[ where ];
+                }
+            }
+        }
+
+        return sum;
+    }
+
+    bool TimeLoad( const char* path, bool prefetch, LoadTiming& timing, uint64_t& checksum )
+    {
+        Clock::time_point start = Clock::now();
+        PackageView       view;
+
+        // Every load is deep validated, so the timings don't depend on a verdict left by an earlier one.
+        if ( !view.Open( path, prefetch ? PACKAGE_OPEN_PREFETCH : 0 ) )
+        {
+            return false;
+        }
+
+        Clock::time_point opened = Clock::now();
+
+        checksum = ReadPayloads( view );
+
+        Clock::time_point ready = Clock::now();
+
+        timing.OpenMilliseconds  = std::chrono::duration< double, std::milli >( opened - start ).count();
+        timing.ReadyMilliseconds = std::chrono::duration< double, std::milli >( ready - start ).count();
+
+        return true;
+    }
+
+    double Median( std::vector< double > values )
+    {
+        std::sort( values.begin(), values.end() );
+
+        return values[ values.size() / 2 ];
+    }
+
+    // Median time of a number of runs of something.
+    template < typename Function >
+    double MedianMilliseconds( uint32_t iterations, Function function )
+    {
+        std::vector< double > times;
+
+        for ( uint32_t iteration = 0; iteration < iterations; ++iteration )
+        {
+            Clock::time_point start = Clock::now();
+
+            function();
+
+            times.push_back( MillisecondsSince( start ) );
+        }
+
+        return Median( times );
+    }
+
+    void PrintThroughput( const char* name, double milliseconds, size_t bytes )
+    {
+        printf( "    %-26s %10.3f ms %10.1f MB/s\n", name, milliseconds, bytes / ( 1024.0 * 1024.0 ) / ( milliseconds / 1000.0 ) );
+    }
+
+    // Bytes of payload a package's resources are made from.
+    size_t PayloadBytes( const PackageView& package )
+    {
+        PackageBlobSpan shaders  = package.Shaders();
+        PackageBlobSpan textures = package.StaticTextures();
+        size_t          result   = package.ScreenAlignedQuadVS().Size;
+
+        for ( uint32_t shaderIndex = 0; shaderIndex < shaders.Count(); ++shaderIndex )
+        {
+            result += shaders[ shaderIndex ].Size;
+        }
+
+        for ( uint32_t textureIndex = 0; textureIndex < textures.Count(); ++textureIndex )
+        {
+            result += textures[ textureIndex ].Size;
+        }
+
+        return result;
+    }
+}
+
+bool RunPackageBenchmark( const char* path )
+{
+    PackageView view;
+
+    if ( !view.Open( path, PACKAGE_OPEN_PREFETCH ) )
+    {
+        PrintOpenFailure( view, path );
+        return false;
+    }
+
+    const BoondogglePackageHeader& header = view.Header();
+
+    printf( "Package: %.1f KB, version %s, %u shaders, %u static textures, %u effects\n",
+            view.Size() / 1024.0,
+            header.Version == CodeVersions::VERSION_2_0 ? "2.0" : "1.1",
+            header.ShaderCount,
+            header.StaticTextureCount,
+            header.EffectCount );
+
+    if ( header.Version == CodeVersions::VERSION_2_0 )
+    {
+        const char* sectionNames[ PACKAGE_SECTION_COUNT ] = { "metadata", "shader data", "texture data" };
+
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            const PackageSection& section    = header.Sections[ sectionIndex ];
+            uint64_t              storedSize = 0;
+
+            for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
+            {
+                storedSize += section.Blocks[ blockIndex ].StoredSize;
+            }
+
+            printf( "    %-14s %-5s %10.1f KB, %10.1f KB stored\n",
+                    sectionNames[ sectionIndex ],
+                    section.Codec == SectionCodecs::LZ4 ? "lz4" : "none",
+                    section.Size / 1024.0,
+                    storedSize / 1024.0 );
+        }
+    }
+
+    view.Close();
+
+    bool evicted = EvictFromPageCache( path );
+
+    if ( !evicted )
+    {
+        printf( "Couldn't evict the package from the page cache, cold timings will be warm\n" );
+    }
+
+    printf( "%-6s %-9s %14s %14s %14s\n", "cache", "prefetch", "open ms", "ready ms", "best ready ms" );
+
+    uint64_t expectedChecksum = 0;
+    bool     haveChecksum     = false;
+
+    for ( uint32_t cold = 0; cold < 2; ++cold )
+    {
+        for ( uint32_t prefetch = 0; prefetch < 2; ++prefetch )
+        {
+            uint32_t              iterations = cold == 0 ? COLD_ITERATIONS : WARM_ITERATIONS;
+            std::vector< double > openTimes;
+            std::vector< double > readyTimes;
+
+            // Warm runs start with an untimed load to fill the cache.
+            if ( cold != 0 )
+            {
+                LoadTiming timing;
+                uint64_t   checksum;
+
+                TimeLoad( path, prefetch != 0, timing, checksum );
+            }
+
+            for ( uint32_t iteration = 0; iteration < iterations; ++iteration )
+            {
+                LoadTiming timing;
+                uint64_t   checksum;
+
+                if ( cold == 0 )
+                {
+                    EvictFromPageCache( path );
+                }
+
+                if ( !TimeLoad( path, prefetch != 0, timing, checksum ) )
+                {
+                    printf( "Couldn't open package %s\n", path );
+                    return false;
+                }
+
+                if ( haveChecksum && checksum != expectedChecksum )
+                {
+                    printf( "Package payloads differ between loads\n" );
+                    return false;
+                }
+
+                expectedChecksum = checksum;
+                haveChecksum     = true;
+
+                openTimes.push_back( timing.OpenMilliseconds );
+                readyTimes.push_back( timing.ReadyMilliseconds );
+            }
+
+            printf( "%-6s %-9s %14.3f %14.3f %14.3f\n",
+                    cold == 0 ? "cold" : "warm",
+                    prefetch != 0 ? "yes" : "no",
+                    Median( openTimes ),
+                    Median( readyTimes ),
+                    *std::min_element( readyTimes.begin(), readyTimes.end() ) );
+        }
+    }
+
+    return true;
+}
+
+bool RunValidationBenchmark( const char* path )
+{
+    // Hash in section sized pieces like validation does, from data that doesn't compress to anything trivial.
+    std::vector< uint8_t > data( HASH_BENCHMARK_SIZE );
+    uint64_t               state = 0x9E3779B97F4A7C15ULL;
+
+    for ( size_t where = 0; where < data.size(); ++where )
+    {
+        state        = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[ where ] = static_cast< uint8_t >( state >> 56 );
+    }
+
+    uint64_t simdHash   = 0;
+    uint64_t scalarHash = 0;
+
+    printf( "Content hash over %.0f MB in %u KB pieces:\n", HASH_BENCHMARK_SIZE / ( 1024.0 * 1024.0 ), SECTION_BLOCK_SIZE / 1024 );
+
+    double simdTime = MedianMilliseconds( HASH_ITERATIONS, [&]()
+    {
+        simdHash = 0;
+
+        for ( size_t offset = 0; offset < data.size(); offset += SECTION_BLOCK_SIZE )
+        {
+            simdHash ^= ContentHash64( data.data() + offset, SECTION_BLOCK_SIZE, offset );
+        }
+    } );
+
+    double scalarTime = MedianMilliseconds( HASH_ITERATIONS, [&]()
+    {
+        scalarHash = 0;
+
+        for ( size_t offset = 0; offset < data.size(); offset += SECTION_BLOCK_SIZE )
+        {
+            scalarHash ^= ContentHash64Scalar( data.data() + offset, SECTION_BLOCK_SIZE, offset );
+        }
+    } );
+
+    PrintThroughput( "simd", simdTime, data.size() );
+    PrintThroughput( "scalar", scalarTime, data.size() );
+
+    if ( simdHash != scalarHash )
+    {
+        printf( "SIMD and scalar content hashes differ (%016llx, %016llx)\n",
+                static_cast< unsigned long long >( simdHash ),
+                static_cast< unsigned long long >( scalarHash ) );
+        return false;
+    }
+
+    if ( path == nullptr )
+    {
+        return true;
+    }
+
+    PackageView view;
+
+    if ( !view.Open( path, 0 ) )
+    {
+        PrintOpenFailure( view, path );
+        return false;
+    }
+
+    const BoondogglePackageHeader& header      = view.Header();
+    const uint8_t*                 packageEnd  = reinterpret_cast< const uint8_t* >( &header ) + view.Size();
+    size_t                         packageSize = view.Size();
+    size_t                         storedSize  = 0;
+    bool                           valid       = true;
+
+    if ( header.Version != CodeVersions::VERSION_2_0 )
+    {
+        printf( "Version 1.1 packages have no section hashes\n" );
+        return true;
+    }
+
+    for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        for ( uint32_t blockIndex = 0; blockIndex < header.Sections[ sectionIndex ].BlockCount; ++blockIndex )
+        {
+            storedSize += header.Sections[ sectionIndex ].Blocks[ blockIndex ].StoredSize;
+        }
+    }
+
+    uint32_t metadataSize = header.Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ].Size;
+
+    printf( "Package %.1f MB (warm page cache):\n", packageSize / ( 1024.0 * 1024.0 ) );
+
+    double structureTime = MedianMilliseconds( VALIDATE_ITERATIONS, [&]()
+    {
+        valid = valid && ValidatePackage( header, packageEnd );
+    } );
+
+    double hashTime = MedianMilliseconds( VALIDATE_ITERATIONS, [&]()
+    {
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            valid = valid && HashSection( header.Sections[ sectionIndex ] ) == header.SectionHashes[ sectionIndex ];
+        }
+    } );
+
+    view.Close();
+
+    PackageView timedView;
+    bool        trusted = true;
+
+    double deepTime = MedianMilliseconds( VALIDATE_ITERATIONS, [&]()
+    {
+        valid = valid && timedView.Open( path, 0 );
+    } );
+
+    // Opening once with the cache writes the verdict for the timed opens to trust.
+    valid = valid && timedView.Open( path, PACKAGE_OPEN_CACHE_VERDICT );
+
+    double trustedTime = MedianMilliseconds( VALIDATE_ITERATIONS, [&]()
+    {
+        valid   = valid && timedView.Open( path, PACKAGE_OPEN_CACHE_VERDICT );
+        trusted = trusted && timedView.Trusted();
+    } );
+
+    if ( !valid )
+    {
+        printf( "Package failed validation\n" );
+        return false;
+    }
+
+    // The structure walk only reads the metadata, the opens include decompressing.
+    PrintThroughput( "structure walk", structureTime, metadataSize );
+    PrintThroughput( "section hashes (1 thread)", hashTime, storedSize );
+    PrintThroughput( "deep validating open", deepTime, packageSize );
+    PrintThroughput( "trusted verdict open", trustedTime, packageSize );
+
+    if ( !trusted )
+    {
+        printf( "The cached verdict wasn't trusted, couldn't it be written next to the package?\n" );
+    }
+
+    return true;
+}
+
+bool RunReloadBenchmark( const char* oldPath, const char* newPath )
+{
+    CountingBackend  backend;
+    PackageView      current;
+    PackageResources currentResources;
+
+    if ( !current.Open( oldPath, 0 ) )
+    {
+        PrintOpenFailure( current, oldPath );
+        return false;
+    }
+
+    currentResources.Prepare( current );
+
+    if ( !currentResources.Create( backend, current, nullptr ) )
+    {
+        printf( "Couldn't create the resources of %s\n", oldPath );
+        return false;
+    }
+
+    uint32_t initialCount = backend.Created();
+    size_t   initialBytes = backend.UploadedBytes();
+
+    // What the watcher does on its thread: copy, validate and decompress, then key the resources.
+    PackageView      loaded;
+    PackageResources loadedResources;
+
+    Clock::time_point openStart = Clock::now();
+
+    if ( !loaded.Open( newPath, PACKAGE_OPEN_COPY ) )
+    {
+        PrintOpenFailure( loaded, newPath );
+        return false;
+    }
+
+    double openTime = MillisecondsSince( openStart );
+
+    Clock::time_point prepareStart = Clock::now();
+
+    loadedResources.Prepare( loaded );
+
+    double prepareTime = MillisecondsSince( prepareStart );
+
+    // What the render thread does between frames.
+    backend.ResetCounts();
+
+    Clock::time_point swapStart = Clock::now();
+
+    if ( !loadedResources.Create( backend, loaded, &currentResources ) )
+    {
+        printf( "Couldn't create the resources of %s\n", newPath );
+        return false;
+    }
+
+    currentResources.Release();
+    current.Close();
+
+    double swapTime = MillisecondsSince( swapStart );
+
+    printf( "Initial load of %s: %u resources, %.1f KB of payloads\n", oldPath, initialCount, initialBytes / 1024.0 );
+    printf( "Reload of %s:\n", newPath );
+    printf( "    %-26s %10.3f ms\n", "copy and open (watcher)", openTime );
+    printf( "    %-26s %10.3f ms\n", "prepare keys (watcher)", prepareTime );
+    printf( "    %-26s %10.3f ms (mock device, so this is just the bookkeeping)\n", "create and swap (frame)", swapTime );
+    printf( "    %u resources created, %u kept, %.1f KB of %.1f KB payloads uploaded again\n",
+            loadedResources.CreatedCount(),
+            loadedResources.ReusedCount(),
+            backend.UploadedBytes() / 1024.0,
+            PayloadBytes( loaded ) / 1024.0 );
+
+    loadedResources.Release();
+
+    if ( backend.Live() != 0 )
+    {
+        printf( "%u resources weren't released\n", backend.Live() );
+        return false;
+    }
+
+    return true;
+}
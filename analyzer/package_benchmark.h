@@ -0,0 +1,22 @@
+#ifndef BOONDOGGLE_PACKAGE_BENCHMARK_H__
+#define BOONDOGGLE_PACKAGE_BENCHMARK_H__
+
+#pragma once
+
+// Time opening an effects package with PackageView until every payload has been read once (what creating the
+// resources needs), with and without prefetching, from a cold page cache (the file evicted before each open) and
+// a warm one. Returns false if the package couldn't be opened.
+bool RunPackageBenchmark( const char* path );
+
+// Measure the throughput of content hashing (SSE2 against scalar, which must agree) on a few hundred MB of
+// synthetic data, then if a package is given, time each part of validating it: the structure walk, hashing the
+// sections, a deep validating open and an open that trusts the cached verdict. Returns false if the hashes
+// disagree or the package couldn't be opened.
+bool RunValidationBenchmark( const char* path );
+
+// Reload newPath over oldPath the way the runtime's package watching does, with a mock device that counts the
+// resources made, and report how many were kept, how many payload bytes would have been uploaded again and how
+// long preparing and swapping in the new version took. Returns false if either package couldn't be loaded.
+bool RunReloadBenchmark( const char* oldPath, const char* newPath );
+
+#endif // -- BOONDOGGLE_PACKAGE_BENCHMARK_H__
@@ -0,0 +1,838 @@
+#include "package_suite.h"
+#include "counting_backend.h"
+#include "../common/binary_effects_format.h"
+#include "../common/block_compression.h"
+#include "../common/package_sections.h"
+#include "../common/package_view.h"
+#include "../common/package_reloader.h"
+#include "../common/arena_allocator.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const size_t   PACKAGE_RESERVE       = 16 * 1024 * 1024;
+    const uint32_t CORRUPTIONS_PER_BUILD = 4000;
+    const uint32_t OPENS_PER_BUILD       = 1000;
+    const uint32_t MAX_FLIPPED_BYTES     = 4;
+    const char*    SUITE_PACKAGE_PATH    = "boondoggle_package_suite.bdg";
+    const char*    SUITE_RELOAD_PATH     = "boondoggle_reload_suite.bdg";
+    const uint32_t RELOAD_POLL_MS        = 10;
+    const uint32_t RELOAD_TIMEOUT_MS     = 5000;
+    const uint32_t RELOAD_WRITE_DELAY_MS = 50; // so the modified time changes where it's only kept coarsely.
+
+    // The reloader takes wide paths on Windows.
+#if defined( _WIN32 )
+    const wchar_t* SUITE_RELOAD_WATCH_PATH = L"boondoggle_reload_suite.bdg";
+#else
+    const char*    SUITE_RELOAD_WATCH_PATH = "boondoggle_reload_suite.bdg";
+#endif
+
+    // Edits BuildPackage can make, so reloads have something to find changed.
+    const uint32_t PACKAGE_EDIT_SHADER  = 1; // the second shader's payload.
+    const uint32_t PACKAGE_EDIT_TEXTURE = 2; // the static texture's payload.
+
+    // A range of bytes in a package.
+    struct ByteRange
+    {
+        size_t Begin;
+        size_t End;
+    };
+
+    // Bytes of a package flipped by Corrupt, to be put back by Restore.
+    struct Corruption
+    {
+        uint32_t Flips;
+        size_t   Offsets[ MAX_FLIPPED_BYTES ];
+        uint8_t  Originals[ MAX_FLIPPED_BYTES ];
+    };
+
+    // Repeatable pseudo random numbers, so a failure can be reproduced.
+    class SuiteRandom
+    {
+    public:
+
+        SuiteRandom() : State_( 0x9E3779B97F4A7C15ULL ) {}
+
+        uint32_t Next()
+        {
+            State_ = State_ * 6364136223846793005ULL + 1442695040888963407ULL;
+
+            return static_cast< uint32_t >( State_ >> 32 );
+        }
+
+    private:
+
+        uint64_t State_;
+    };
+
+    // Payload bytes that compress some, but not to nothing.
+    void AppendPayload( std::vector< uint8_t >& section, ResourceBlob& blob, size_t size, SuiteRandom& random )
+    {
+        blob.ResourceSize         = static_cast< uint32_t >( size );
+        blob.Data.RelativeAddress = static_cast< int32_t >( section.size() );
+
+        for ( size_t where = 0; where < size; ++where )
+        {
+            section.push_back( static_cast< uint8_t >( ( where / 7 ) ^ ( random.Next() & 3 ) ) );
+        }
+    }
+
+    // Index lists for effects and procedurals.
+    uint32_t* AllocateIndices( ArenaAllocator& memory, std::initializer_list< uint32_t > indices )
+    {
+        uint32_t* result = memory.Allocate< uint32_t >( indices.size() );
+
+        ::memcpy( result, indices.begin(), indices.size() * sizeof( uint32_t ) );
+
+        return result;
+    }
+
+    // Build a package like the compiler would, with two shaders, a static texture, a procedural texture, two
+    // samplers and two effects, with one byte of each payload in edits (PACKAGE_EDIT_*) changed. Returns the
+    // package, copied to exactly its size so a sanitizer catches any read past the end.
+    bool BuildPackage( bool compress, std::vector< uint8_t >& package, uint32_t edits = 0 )
+    {
+        ArenaAllocator         memory;
+        SuiteRandom            random;
+        std::vector< uint8_t > shaderData;
+        std::vector< uint8_t > textureData;
+
+        if ( !memory.Initialize( "package suite", PACKAGE_RESERVE ) )
+        {
+            return false;
+        }
+
+        BoondogglePackageHeader* header = memory.Allocate< BoondogglePackageHeader >();
+
+        header->MagicCode            = MagicCodes::HEADER_CODE;
+        header->Version              = CodeVersions::VERSION_2_0;
+        header->FrequencyBucketCount = 16;
+        header->ShaderCount          = 2;
+        header->Shaders              = memory.Allocate< ResourceBlob >( header->ShaderCount );
+        header->StaticTextureCount   = 1;
+        header->StaticTextures       = memory.Allocate< ResourceBlob >( header->StaticTextureCount );
+
+        // The first shader spans a block boundary, so compressed shader data has a couple of blocks.
+        AppendPayload( shaderData, header->Shaders[ 0 ], SECTION_BLOCK_SIZE + 1000, random );
+        AppendPayload( shaderData, header->Shaders[ 1 ], 3000, random );
+        AppendPayload( shaderData, header->ScreenAlignedQuadVS, 500, random );
+        AppendPayload( textureData, header->StaticTextures[ 0 ], 20000, random );
+
+        if ( ( edits & PACKAGE_EDIT_SHADER ) != 0 )
+        {
+            shaderData[ header->Shaders[ 1 ].Data.RelativeAddress ] ^= 0xFF;
+        }
+
+        if ( ( edits & PACKAGE_EDIT_TEXTURE ) != 0 )
+        {
+            textureData[ header->StaticTextures[ 0 ].Data.RelativeAddress ] ^= 0xFF;
+        }
+
+        header->ProceduralTextureCount = 1;
+        header->ProceduralTextures     = memory.Allocate< ProceduralTexture >( header->ProceduralTextureCount );
+
+        ProceduralTexture& procedural = header->ProceduralTextures[ 0 ];
+
+        procedural.ShaderId           = 1;
+        procedural.Format             = ProceduralFormats::RGBA16F;
+        procedural.Width              = 256;
+        procedural.Height             = 256;
+        procedural.SourceTextureCount = 1;
+        procedural.SourceTextures     = AllocateIndices( memory, { 1 } );
+        procedural.SourceSamplerCount = 1;
+        procedural.SourceSamplers     = AllocateIndices( memory, { 0 } );
+        procedural.GenerateMipMaps    = true;
+        procedural.GenerateAtStart    = true;
+
+        header->SamplerCount = 2;
+        header->Samplers     = memory.Allocate< Sampler >( header->SamplerCount );
+
+        for ( uint32_t samplerIndex = 0; samplerIndex < header->SamplerCount; ++samplerIndex )
+        {
+            Sampler& sampler = header->Samplers[ samplerIndex ];
+
+            sampler.AddressModes[ 0 ] = sampler.AddressModes[ 1 ] = sampler.AddressModes[ 2 ] = TextureAddressMode::WRAP;
+            sampler.Filter            = samplerIndex == 0 ? TextureFilterMode::TRILINEAR : TextureFilterMode::ANISOTROPIC;
+            sampler.MaxAnisotropy     = 8;
+        }
+
+        header->EffectCount = 2;
+        header->Effects     = memory.Allocate< VisualEffect >( header->EffectCount );
+
+        for ( uint32_t effectIndex = 0; effectIndex < header->EffectCount; ++effectIndex )
+        {
+            VisualEffect& effect = header->Effects[ effectIndex ];
+
+            effect.ShaderId               = effectIndex;
+            effect.SourceTextureCount     = 3;
+            effect.SourceTextures         = AllocateIndices( memory, { 0, 2, SoundHistoryTextureIndex( *header ) } );
+            effect.SourceSamplerCount     = 2;
+            effect.SourceSamplers         = AllocateIndices( memory, { 0, 1 } );
+            effect.ProceduralTextureCount = 1;
+            effect.ProceduralTextures     = AllocateIndices( memory, { 0 } );
+            effect.TransitionInTime       = 1.0f;
+            effect.TransitionOutTime      = 1.0f;
+            effect.UseSoundTexture        = true;
+        }
+
+        std::vector< uint8_t >* dataSections[ PACKAGE_SECTION_COUNT ] = { nullptr, &shaderData, &textureData };
+
+        header->SectionCount = PACKAGE_SECTION_COUNT;
+        header->Sections     = memory.Allocate< PackageSection >( PACKAGE_SECTION_COUNT );
+
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            PackageSection& section = header->Sections[ sectionIndex ];
+            size_t          size    = dataSections[ sectionIndex ] != nullptr ? dataSections[ sectionIndex ]->size() : 0;
+
+            section.Type       = static_cast< PackageSectionTypes >( sectionIndex );
+            section.Codec      = compress && sectionIndex > 0 ? SectionCodecs::LZ4 : SectionCodecs::NONE;
+            section.Size       = static_cast< uint32_t >( size );
+            section.BlockCount = section.Codec == SectionCodecs::LZ4 ? static_cast< uint32_t >( ( size + SECTION_BLOCK_SIZE - 1 ) / SECTION_BLOCK_SIZE ) : 1;
+            section.Blocks     = memory.Allocate< SectionBlock >( section.BlockCount );
+        }
+
+        PackageSection& metadataSection = header->Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ];
+
+        // Pad the metadata out to where the first data block goes, so it covers everything before the data.
+        memory.Allocate( 0, 16 );
+
+        metadataSection.Size                   = static_cast< uint32_t >( memory.Used() );
+        metadataSection.Blocks[ 0 ].StoredSize = metadataSection.Size;
+        metadataSection.Blocks[ 0 ].Data       = reinterpret_cast< const uint8_t* >( header );
+
+        std::vector< uint8_t > compressed( CompressBlockBound( SECTION_BLOCK_SIZE ) );
+
+        for ( uint32_t sectionIndex = 1; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            PackageSection&               section = header->Sections[ sectionIndex ];
+            const std::vector< uint8_t >& payload = *dataSections[ sectionIndex ];
+
+            for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
+            {
+                const uint8_t* blockData = payload.data() + static_cast< size_t >( blockIndex ) * SECTION_BLOCK_SIZE;
+                size_t         blockSize = payload.size() - static_cast< size_t >( blockIndex ) * SECTION_BLOCK_SIZE;
+
+                blockSize = section.Codec == SectionCodecs::NONE || blockSize < SECTION_BLOCK_SIZE ? blockSize : SECTION_BLOCK_SIZE;
+
+                size_t compressedSize = section.Codec == SectionCodecs::LZ4 ? CompressBlock( blockData, blockSize, compressed.data(), compressed.size() ) : 0;
+
+                if ( compressedSize > 0 && compressedSize < blockSize )
+                {
+                    blockData = compressed.data();
+                    blockSize = compressedSize;
+                }
+
+                uint8_t* stored = reinterpret_cast< uint8_t* >( memory.Allocate( blockSize, 16 ) );
+
+                ::memcpy( stored, blockData, blockSize );
+
+                section.Blocks[ blockIndex ].StoredSize = static_cast< uint32_t >( blockSize );
+                section.Blocks[ blockIndex ].Data       = stored;
+            }
+        }
+
+        header->SectionHashes = memory.Allocate< uint64_t >( PACKAGE_SECTION_COUNT );
+
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            header->SectionHashes[ sectionIndex ] = HashSection( header->Sections[ sectionIndex ] );
+        }
+
+        // Relative addresses move with the package.
+        package.assign( memory.Base(), memory.Base() + memory.Used() );
+
+        return true;
+    }
+
+    // The header, the section table and each section's block table of an intact package, followed by all of
+    // its metadata. Found from the intact package, as corrupting them changes where they seem to be.
+    std::vector< ByteRange > CorruptibleRegions( const std::vector< uint8_t >& package )
+    {
+        const BoondogglePackageHeader& header  = *reinterpret_cast< const BoondogglePackageHeader* >( package.data() );
+        const uint8_t*                 base    = package.data();
+        std::vector< ByteRange >       regions;
+
+        regions.push_back( { 0, sizeof( BoondogglePackageHeader ) } );
+        regions.push_back( { static_cast< size_t >( reinterpret_cast< const uint8_t* >( header.Sections.Raw() ) - base ),
+                             static_cast< size_t >( reinterpret_cast< const uint8_t* >( header.Sections.Raw() + PACKAGE_SECTION_COUNT ) - base ) } );
+
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            const PackageSection& section = header.Sections[ sectionIndex ];
+
+            regions.push_back( { static_cast< size_t >( reinterpret_cast< const uint8_t* >( section.Blocks.Raw() ) - base ),
+                                 static_cast< size_t >( reinterpret_cast< const uint8_t* >( section.Blocks.Raw() + section.BlockCount ) - base ) } );
+        }
+
+        regions.push_back( { 0, header.Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ].Size } );
+
+        return regions;
+    }
+
+    // Flip 1 to MAX_FLIPPED_BYTES random bytes in a region of a package.
+    void Corrupt( std::vector< uint8_t >& package, const ByteRange& region, SuiteRandom& random, Corruption& corruption )
+    {
+        corruption.Flips = 1 + random.Next() % MAX_FLIPPED_BYTES;
+
+        for ( uint32_t flip = 0; flip < corruption.Flips; ++flip )
+        {
+            corruption.Offsets[ flip ]   = region.Begin + random.Next() % ( region.End - region.Begin );
+            corruption.Originals[ flip ] = package[ corruption.Offsets[ flip ] ];
+
+            package[ corruption.Offsets[ flip ] ] ^= static_cast< uint8_t >( 1 + random.Next() % 255 );
+        }
+    }
+
+    // Put the bytes back in reverse, in case the same one was flipped twice.
+    void Restore( std::vector< uint8_t >& package, const Corruption& corruption )
+    {
+        for ( uint32_t flip = corruption.Flips; flip-- > 0; )
+        {
+            package[ corruption.Offsets[ flip ] ] = corruption.Originals[ flip ];
+        }
+    }
+
+    bool WritePackage( const std::vector< uint8_t >& package, const char* path )
+    {
+        FILE* file = ::fopen( path, "wb" );
+
+        if ( file == nullptr )
+        {
+            return false;
+        }
+
+        bool written = ::fwrite( package.data(), 1, package.size(), file ) == package.size();
+
+        return ::fclose( file ) == 0 && written;
+    }
+
+    // Use everything in a package that passed validation, the way the runtime would, returning a sum so it
+    // isn't optimized out. Returns false if the sections couldn't be loaded, which is fine for a corrupt package.
+    bool ReadPackage( const BoondogglePackageHeader& header, bool verifyHashes, uint64_t& sum )
+    {
+        PackageSections sections;
+
+        if ( !sections.Load( header, verifyHashes ) )
+        {
+            return false;
+        }
+
+        const ResourceBlob* blobs[] = { header.Shaders.Raw(), header.StaticTextures.Raw(), &header.ScreenAlignedQuadVS };
+        uint32_t            counts[] = { header.ShaderCount, header.StaticTextureCount, 1 };
+
+        for ( uint32_t list = 0; list < 3; ++list )
+        {
+            PackageSectionTypes dataSection = list == 1 ? PackageSectionTypes::TEXTURE_DATA : PackageSectionTypes::SHADER_DATA;
+
+            for ( uint32_t blobIndex = 0; blobIndex < counts[ list ]; ++blobIndex )
+            {
+                const ResourceBlob& blob = blobs[ list ][ blobIndex ];
+                const uint8_t*      data = sections.BlobData( blob, dataSection );
+
+                for ( uint32_t where = 0; where < blob.ResourceSize; ++where )
+                {
+                    sum += data[ where ];
+                }
+            }
+        }
+
+        for ( uint32_t proceduralIndex = 0; proceduralIndex < header.ProceduralTextureCount; ++proceduralIndex )
+        {
+            const ProceduralTexture& procedural = header.ProceduralTextures[ proceduralIndex ];
+
+            sum += header.Shaders[ procedural.ShaderId ].ResourceSize + procedural.GenerateMipMaps + procedural.GenerateAtStart;
+
+            for ( uint32_t sourceIndex = 0; sourceIndex < procedural.SourceSamplerCount; ++sourceIndex )
+            {
+                sum += header.Samplers[ procedural.SourceSamplers[ sourceIndex ] ].MaxAnisotropy;
+            }
+        }
+
+        for ( uint32_t effectIndex = 0; effectIndex < header.EffectCount; ++effectIndex )
+        {
+            const VisualEffect& effect = header.Effects[ effectIndex ];
+
+            sum += header.Shaders[ effect.ShaderId ].ResourceSize + effect.UseSoundTexture;
+
+            for ( uint32_t sourceIndex = 0; sourceIndex < effect.SourceSamplerCount; ++sourceIndex )
+            {
+                sum += header.Samplers[ effect.SourceSamplers[ sourceIndex ] ].MaxAnisotropy;
+            }
+
+            for ( uint32_t sourceIndex = 0; sourceIndex < effect.ProceduralTextureCount; ++sourceIndex )
+            {
+                sum += header.ProceduralTextures[ effect.ProceduralTextures[ sourceIndex ] ].Width;
+            }
+
+            for ( uint32_t sourceIndex = 0; sourceIndex < effect.SourceTextureCount; ++sourceIndex )
+            {
+                sum += effect.SourceTextures[ sourceIndex ];
+            }
+        }
+
+        return true;
+    }
+
+    void SumPayload( const PackageBlob& blob, uint64_t& sum )
+    {
+        for ( uint32_t where = 0; where < blob.Size; ++where )
+        {
+            sum += blob.Data[ where ];
+        }
+    }
+
+    // Use everything in an open package through the view's spans, returning a sum so it isn't optimized out.
+    void ReadView( const PackageView& view, uint64_t& sum )
+    {
+        PackageBlobSpan shaders  = view.Shaders();
+        PackageBlobSpan textures = view.StaticTextures();
+
+        for ( uint32_t shaderIndex = 0; shaderIndex < shaders.Count(); ++shaderIndex )
+        {
+            SumPayload( shaders[ shaderIndex ], sum );
+        }
+
+        for ( uint32_t textureIndex = 0; textureIndex < textures.Count(); ++textureIndex )
+        {
+            SumPayload( textures[ textureIndex ], sum );
+        }
+
+        SumPayload( view.ScreenAlignedQuadVS(), sum );
+
+        PackageSpan< ProceduralTexture > procedurals = view.ProceduralTextures();
+        PackageSpan< Sampler >           samplers    = view.Samplers();
+        PackageSpan< VisualEffect >      effects     = view.Effects();
+
+        for ( uint32_t effectIndex = 0; effectIndex < effects.Count(); ++effectIndex )
+        {
+            const VisualEffect&     effect            = effects[ effectIndex ];
+            PackageSpan< uint32_t > sourceSamplers    = PackageView::Indices( effect.SourceSamplers, effect.SourceSamplerCount );
+            PackageSpan< uint32_t > sourceProcedurals = PackageView::Indices( effect.ProceduralTextures, effect.ProceduralTextureCount );
+
+            sum += shaders[ effect.ShaderId ].Size;
+
+            for ( uint32_t sourceIndex = 0; sourceIndex < sourceSamplers.Count(); ++sourceIndex )
+            {
+                sum += samplers[ sourceSamplers[ sourceIndex ] ].MaxAnisotropy;
+            }
+
+            for ( uint32_t sourceIndex = 0; sourceIndex < sourceProcedurals.Count(); ++sourceIndex )
+            {
+                sum += procedurals[ sourceProcedurals[ sourceIndex ] ].Width;
+            }
+        }
+    }
+
+    // Corrupt a package over and over, checking each corrupt version is rejected or safe to read.
+    bool RunCorruptions( bool compress )
+    {
+        std::vector< uint8_t > package;
+
+        if ( !BuildPackage( compress, package ) )
+        {
+            printf( "Couldn't build the %s test package\n", compress ? "compressed" : "stored" );
+            return false;
+        }
+
+        const BoondogglePackageHeader& header = *reinterpret_cast< const BoondogglePackageHeader* >( package.data() );
+        const uint8_t*                 end    = package.data() + package.size();
+        uint64_t                       sum    = 0;
+
+        if ( !ValidatePackage( header, end ) || !ReadPackage( header, true, sum ) )
+        {
+            printf( "The intact %s test package failed validation\n", compress ? "compressed" : "stored" );
+            return false;
+        }
+
+        // The header, the section table, each section's block table and then anywhere in the metadata are
+        // corrupted in turn.
+        std::vector< ByteRange > regions  = CorruptibleRegions( package );
+        SuiteRandom              random;
+        uint32_t                 rejected = 0;
+        uint32_t                 accepted = 0;
+
+        for ( uint32_t corruptionIndex = 0; corruptionIndex < CORRUPTIONS_PER_BUILD; ++corruptionIndex )
+        {
+            Corruption corruption;
+
+            Corrupt( package, regions[ corruptionIndex % regions.size() ], random, corruption );
+
+            // Without checking the hashes, like an open trusting a cached verdict, so validation alone has to
+            // make the package safe to read.
+            if ( ValidatePackage( header, end ) && ReadPackage( header, false, sum ) )
+            {
+                ++accepted;
+            }
+            else
+            {
+                ++rejected;
+            }
+
+            Restore( package, corruption );
+        }
+
+        printf( "%-18s %7u corruptions of 1 to %u bytes in the metadata, %u rejected, %u safe to read (checksum %08x)\n",
+                compress ? "compressed" : "stored",
+                CORRUPTIONS_PER_BUILD,
+                MAX_FLIPPED_BYTES,
+                rejected,
+                accepted,
+                static_cast< uint32_t >( sum ) );
+
+        return true;
+    }
+
+    // Metadata that doesn't start the package or stops before the first data block leaves tables its hash
+    // doesn't cover, which an open trusting a cached verdict would read unchecked. Each has to be rejected,
+    // even with the metadata hash updated to match.
+    bool RunMetadataChecks( bool compress )
+    {
+        std::vector< uint8_t > intact;
+
+        if ( !BuildPackage( compress, intact ) )
+        {
+            printf( "Couldn't build the %s test package\n", compress ? "compressed" : "stored" );
+            return false;
+        }
+
+        const uint32_t metadataIndex = static_cast< uint32_t >( PackageSectionTypes::METADATA );
+        const uint32_t metadataSize  = reinterpret_cast< const BoondogglePackageHeader* >( intact.data() )->Sections[ metadataIndex ].Size;
+
+        struct MetadataCase
+        {
+            const char* Name;
+            uint32_t    Size;
+            uint32_t    Start;
+            bool        Valid;
+        };
+
+        const MetadataCase cases[] =
+        {
+            { "intact",                            metadataSize,                                             0,  true  },
+            { "stops at the header",               static_cast< uint32_t >( sizeof( BoondogglePackageHeader ) ), 0,  false },
+            { "stops before the first data block", metadataSize - 16,                                        0,  false },
+            { "starts past the header",            metadataSize - 16,                                        16, false },
+        };
+
+        bool passed = true;
+
+        for ( const MetadataCase& metadataCase : cases )
+        {
+            std::vector< uint8_t >   package  = intact;
+            BoondogglePackageHeader& header   = *reinterpret_cast< BoondogglePackageHeader* >( package.data() );
+            PackageSection&          metadata = header.Sections[ metadataIndex ];
+
+            metadata.Size                   = metadataCase.Size;
+            metadata.Blocks[ 0 ].StoredSize = metadataCase.Size;
+            metadata.Blocks[ 0 ].Data       = package.data() + metadataCase.Start;
+
+            header.SectionHashes[ metadataIndex ] = HashSection( metadata );
+
+            if ( ValidatePackage( header, package.data() + package.size() ) != metadataCase.Valid )
+            {
+                printf( "%-18s metadata that %s was %s\n",
+                        compress ? "compressed" : "stored",
+                        metadataCase.Name,
+                        metadataCase.Valid ? "rejected" : "accepted" );
+                passed = false;
+            }
+        }
+
+        if ( passed )
+        {
+            printf( "%-18s %7u short or moved metadata sections rejected\n",
+                    compress ? "compressed" : "stored",
+                    static_cast< uint32_t >( sizeof( cases ) / sizeof( cases[ 0 ] ) ) - 1 );
+        }
+
+        return passed;
+    }
+
+    // Write corrupt packages out and open them with PackageView, alternately mapped and copied, checking each
+    // is rejected or every payload can be read through the view. Only the header, section table and block
+    // tables are corrupted, the package hashes catch anything past them.
+    bool RunViewCorruptions( bool compress )
+    {
+        std::vector< uint8_t > package;
+        PackageView            view;
+        uint64_t               sum = 0;
+
+        if ( !BuildPackage( compress, package ) ||
+             !WritePackage( package, SUITE_PACKAGE_PATH ) ||
+             !view.Open( SUITE_PACKAGE_PATH, 0 ) )
+        {
+            printf( "Couldn't open the %s test package as %s\n", compress ? "compressed" : "stored", SUITE_PACKAGE_PATH );
+            ::remove( SUITE_PACKAGE_PATH );
+            return false;
+        }
+
+        ReadView( view, sum );
+        view.Close();
+
+        std::vector< ByteRange > regions  = CorruptibleRegions( package );
+        SuiteRandom              random;
+        uint32_t                 rejected = 0;
+        uint32_t                 accepted = 0;
+        bool                     written  = true;
+
+        // The last region is the whole of the metadata.
+        regions.pop_back();
+
+        for ( uint32_t corruptionIndex = 0; written && corruptionIndex < OPENS_PER_BUILD; ++corruptionIndex )
+        {
+            Corruption corruption;
+
+            Corrupt( package, regions[ corruptionIndex % regions.size() ], random, corruption );
+
+            written = WritePackage( package, SUITE_PACKAGE_PATH );
+
+            if ( written && view.Open( SUITE_PACKAGE_PATH, corruptionIndex % 2 == 0 ? 0 : PACKAGE_OPEN_COPY ) )
+            {
+                ReadView( view, sum );
+                view.Close();
+                ++accepted;
+            }
+            else
+            {
+                ++rejected;
+            }
+
+            Restore( package, corruption );
+        }
+
+        ::remove( SUITE_PACKAGE_PATH );
+
+        if ( !written )
+        {
+            printf( "Couldn't write the %s test package to %s\n", compress ? "compressed" : "stored", SUITE_PACKAGE_PATH );
+            return false;
+        }
+
+        printf( "%-18s %7u opens of 1 to %u corrupt bytes in the tables, %u rejected, %u safe to read (checksum %08x)\n",
+                compress ? "compressed view" : "stored view",
+                OPENS_PER_BUILD,
+                MAX_FLIPPED_BYTES,
+                rejected,
+                accepted,
+                static_cast< uint32_t >( sum ) );
+
+        return true;
+    }
+
+    // Every handle in a set of resources, to check a failed Create left it as it was.
+    std::vector< void* > ResourceHandles( const PackageResources& resources )
+    {
+        std::vector< void* > handles;
+
+        for ( uint32_t kind = 0; kind < PACKAGE_RESOURCE_KIND_COUNT; ++kind )
+        {
+            for ( uint32_t index = 0; index < resources.Count( static_cast< PackageResourceKinds >( kind ) ); ++index )
+            {
+                handles.push_back( resources.Get( static_cast< PackageResourceKinds >( kind ), index ) );
+            }
+        }
+
+        return handles;
+    }
+
+    // Wait for the reloader to have a new version ready, nullptr if it doesn't in RELOAD_TIMEOUT_MS.
+    LoadedPackage* WaitForReload( PackageReloader& reloader )
+    {
+        for ( uint32_t waited = 0; waited < RELOAD_TIMEOUT_MS; waited += RELOAD_POLL_MS )
+        {
+            LoadedPackage* ready = reloader.TakeReady();
+
+            if ( ready != nullptr )
+            {
+                return ready;
+            }
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( RELOAD_POLL_MS ) );
+        }
+
+        return nullptr;
+    }
+
+    // Load the package at SUITE_RELOAD_PATH, then check a reload of it with one shader changed and one with a
+    // shader and the texture changed whose texture fails to create. The watcher and the resources are declared
+    // after the backend, so whatever is left on a failure is released before it goes.
+    bool RunReloads( const std::vector< uint8_t >& edited, const std::vector< uint8_t >& failing )
+    {
+        CountingBackend backend;
+        LoadedPackage   current;
+        LoadedPackage   spare;
+        LoadedPackage   failed;
+        PackageReloader reloader;
+
+        // Copied, like the reloader does, as the file is written again while it's in use.
+        if ( !current.View.Open( SUITE_RELOAD_PATH, PACKAGE_OPEN_COPY ) )
+        {
+            printf( "Couldn't open the reload test package as %s\n", SUITE_RELOAD_PATH );
+            return false;
+        }
+
+        current.Resources.Prepare( current.View );
+
+        if ( !current.Resources.Create( backend, current.View, nullptr ) )
+        {
+            printf( "Couldn't create the resources of the reload test package\n" );
+            return false;
+        }
+
+        uint32_t resourceCount = backend.Live();
+
+        if ( !reloader.Start( SUITE_RELOAD_WATCH_PATH, spare, RELOAD_POLL_MS ) )
+        {
+            printf( "Couldn't watch %s\n", SUITE_RELOAD_PATH );
+            return false;
+        }
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( RELOAD_WRITE_DELAY_MS ) );
+
+        if ( !WritePackage( edited, SUITE_RELOAD_PATH ) )
+        {
+            printf( "Couldn't write the edited package to %s\n", SUITE_RELOAD_PATH );
+            return false;
+        }
+
+        LoadedPackage* ready = WaitForReload( reloader );
+
+        if ( ready == nullptr )
+        {
+            printf( "The edited package wasn't reloaded within %u ms\n", RELOAD_TIMEOUT_MS );
+            return false;
+        }
+
+        bool passed = true;
+
+        // The second creation is the texture, after the changed shader was made, and both shaders, the vertex
+        // shader and the samplers would have been taken from the current set.
+        bool opened = WritePackage( failing, SUITE_PACKAGE_PATH ) && failed.View.Open( SUITE_PACKAGE_PATH, PACKAGE_OPEN_COPY );
+
+        ::remove( SUITE_PACKAGE_PATH );
+
+        if ( !opened )
+        {
+            printf( "Couldn't open the failing reload package as %s\n", SUITE_PACKAGE_PATH );
+            return false;
+        }
+
+        std::vector< void* > currentHandles = ResourceHandles( current.Resources );
+
+        failed.Resources.Prepare( failed.View );
+        backend.ResetCounts();
+        backend.FailOn( 2 );
+
+        bool failedCreated = failed.Resources.Create( backend, failed.View, &current.Resources );
+
+        backend.FailOn( 0 );
+
+        if ( failedCreated ||
+             failed.Resources.FailedKind() != PackageResourceKinds::STATIC_TEXTURE ||
+             backend.Live() != resourceCount ||
+             ResourceHandles( current.Resources ) != currentHandles )
+        {
+            printf( "A reload failing on its second creation %s, with %u resources live of %u\n",
+                    failedCreated ? "succeeded" : "didn't leave the current resources as they were",
+                    backend.Live(),
+                    resourceCount );
+            passed = false;
+        }
+        else
+        {
+            printf( "%-18s %7u resources, failing the texture released the %u made and kept the current set\n",
+                    "failed reload",
+                    resourceCount,
+                    backend.Created() );
+        }
+
+        // What the render thread does between frames: create what changed, release what's left of the
+        // current set, and hand it back to be loaded into next.
+        backend.ResetCounts();
+
+        if ( !ready->Resources.Create( backend, ready->View, &current.Resources ) ||
+             ready->Resources.CreatedCount() != 1 ||
+             ready->Resources.ReusedCount() != resourceCount - 1 )
+        {
+            printf( "Reloading one changed shader created %u resources and kept %u, rather than 1 and %u\n",
+                    ready->Resources.CreatedCount(),
+                    ready->Resources.ReusedCount(),
+                    resourceCount - 1 );
+            passed = false;
+        }
+        else
+        {
+            printf( "%-18s %7u resources, %u created and %u kept reloading one changed shader\n",
+                    "reload",
+                    resourceCount,
+                    ready->Resources.CreatedCount(),
+                    ready->Resources.ReusedCount() );
+        }
+
+        reloader.Recycle( current );
+        reloader.Stop();
+        ready->Resources.Release();
+
+        if ( backend.Live() != 0 )
+        {
+            printf( "%u resources weren't released after the reload\n", backend.Live() );
+            passed = false;
+        }
+
+        return passed;
+    }
+}
+
+bool RunPackageCorruptionSuite()
+{
+    printf( "Package validation against corrupt packages:\n" );
+
+    bool passed = RunCorruptions( false );
+
+    passed = RunCorruptions( true ) && passed;
+    passed = RunMetadataChecks( false ) && passed;
+    passed = RunMetadataChecks( true ) && passed;
+    passed = RunViewCorruptions( false ) && passed;
+    passed = RunViewCorruptions( true ) && passed;
+
+    printf( "%s\n", passed ? "Package checks passed" : "Package checks FAILED" );
+
+    return passed;
+}
+
+
+bool RunPackageReloadSuite()
+{
+    printf( "Package reloads with a mock device:\n" );
+
+    std::vector< uint8_t > original;
+    std::vector< uint8_t > edited;
+    std::vector< uint8_t > failing;
+
+    if ( !BuildPackage( true, original ) ||
+         !BuildPackage( true, edited, PACKAGE_EDIT_SHADER ) ||
+         !BuildPackage( true, failing, PACKAGE_EDIT_SHADER | PACKAGE_EDIT_TEXTURE ) ||
+         !WritePackage( original, SUITE_RELOAD_PATH ) )
+    {
+        printf( "Couldn't write the reload test package to %s\n", SUITE_RELOAD_PATH );
+        ::remove( SUITE_RELOAD_PATH );
+        return false;
+    }
+
+    bool passed = RunReloads( edited, failing );
+
+    // The reloader caches the verdict on the version it loaded.
+    ::remove( SUITE_RELOAD_PATH );
+    ::remove( ( std::string( SUITE_RELOAD_PATH ) + ".verified" ).c_str() );
+
+    printf( "%s\n", passed ? "Reload checks passed" : "Reload checks FAILED" );
+
+    return passed;
+}
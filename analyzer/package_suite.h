@@ -0,0 +1,20 @@
+#ifndef BOONDOGGLE_PACKAGE_SUITE_H__
+#define BOONDOGGLE_PACKAGE_SUITE_H__
+
+#pragma once
+
+// Build small version 2 packages (with stored and with compressed data sections), then flip a few random bytes
+// at a time in their header, section table, block tables and the rest of their metadata, checking validation
+// either rejects each corrupt package or accepts one that's safe to use. Every payload and index of an accepted
+// one is read without checking the section hashes, so run under a sanitizer this finds any read outside the
+// package. Then corrupt packages written to a file go through PackageView::Open, mapped and copied, and every
+// payload of any that open is read through the view. Returns false if an intact package fails.
+bool RunPackageCorruptionSuite();
+
+// Reload a package through PackageReloader with a mock device after changing one shader, checking only that
+// shader is created again and the rest move over from the current resources. A reload whose texture fails to
+// create has to release what it made and leave the current resources as they were, and nothing is left
+// unreleased at the end. Returns false if any of that doesn't hold.
+bool RunPackageReloadSuite();
+
+#endif // -- BOONDOGGLE_PACKAGE_SUITE_H__
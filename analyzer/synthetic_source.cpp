@@ -0,0 +1,209 @@
+#include "synthetic_source.h"
+#include <string.h>
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+namespace
+{
+    const double SWEEP_LOW         = 20.0;
+    const double SWEEP_HIGH        = 20000.0;
+    const double IMPULSE_SECONDS   = 0.1;
+    const double RIGHT_SINE_FACTOR = 3.1;
+
+    // Paul Kellet's pink noise filter, a sum of 1st order low-passes of white noise (within 0.05 dB above 9.2 Hz at 44.1 kHz).
+    const float PINK_POLES[ 6 ]   = { 0.99886f, 0.99332f, 0.96900f, 0.86650f, 0.55000f, -0.7616f };
+    const float PINK_GAINS[ 6 ]   = { 0.0555179f, 0.0750759f, 0.1538520f, 0.3104856f, 0.5329522f, -0.0168980f };
+    const float PINK_DIRECT       = 0.5362f;
+    const float PINK_DELAYED      = 0.115926f;
+    const float PINK_NORMALIZE    = 0.11f; // brings the filter gain back to about unity.
+}
+
+const char* SyntheticSignalName( SyntheticSignal signal )
+{
+    switch ( signal )
+    {
+    case SyntheticSignal::SINE:
+
+        return "sine";
+
+    case SyntheticSignal::SWEEP:
+
+        return "sweep";
+
+    case SyntheticSignal::WHITE_NOISE:
+
+        return "white noise";
+
+    case SyntheticSignal::PINK_NOISE:
+
+        return "pink noise";
+
+    case SyntheticSignal::IMPULSE:
+
+        return "impulse";
+
+    default:
+
+        return "unknown";
+    }
+}
+
+SyntheticAudioSource::SyntheticAudioSource() :
+    Signal_( SyntheticSignal::SINE ),
+    StreamSampleRate_( 0 ),
+    ChannelCount_( 0 ),
+    Frame_( 0 ),
+    FrameCount_( 0 ),
+    Frequency_( 0.0 ),
+    Amplitude_( 0.0f )
+{
+    NoiseState_[ 0 ] = 0;
+    NoiseState_[ 1 ] = 0;
+
+    ::memset( Pink_, 0, sizeof( Pink_ ) );
+}
+
+bool SyntheticAudioSource::Open( SyntheticSignal signal, uint32_t sampleRate, uint32_t channelCount, double seconds, double frequency, float amplitude )
+{
+    if ( signal >= SyntheticSignal::COUNT || sampleRate == 0 || channelCount == 0 || channelCount > 2 || seconds <= 0.0 )
+    {
+        return false;
+    }
+
+    Signal_           = signal;
+    StreamSampleRate_ = sampleRate;
+    ChannelCount_     = channelCount;
+    Frame_            = 0;
+    FrameCount_       = static_cast< uint64_t >( seconds * sampleRate );
+    Frequency_        = frequency;
+    Amplitude_        = amplitude;
+
+    // Fixed seeds, so every run sees the same noise.
+    NoiseState_[ 0 ] = 0x9E3779B9u;
+    NoiseState_[ 1 ] = 0x7F4A7C15u;
+
+    ::memset( Pink_, 0, sizeof( Pink_ ) );
+
+    return true;
+}
+
+bool SyntheticAudioSource::Initialize( uint32_t requiredFrequency )
+{
+    return StreamSampleRate_ != 0 && InitializeBuffer( StreamSampleRate_, requiredFrequency );
+}
+
+double SyntheticAudioSource::SineFrequency( uint32_t channel ) const
+{
+    return channel == 0 || ChannelCount_ == 1 ? Frequency_ : Frequency_ * RIGHT_SINE_FACTOR;
+}
+
+float SyntheticAudioSource::NextNoise( uint32_t channel )
+{
+    // xorshift32
+    uint32_t state = NoiseState_[ channel ];
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    NoiseState_[ channel ] = state;
+
+    return static_cast< float >( static_cast< int32_t >( state ) ) * ( 1.0f / 2147483648.0f );
+}
+
+void SyntheticAudioSource::Generate( uint32_t frameCount )
+{
+    double sampleRate   = static_cast< double >( StreamSampleRate_ );
+    double duration     = static_cast< double >( FrameCount_ ) / sampleRate;
+    double sweepOctaves = log( SWEEP_HIGH / SWEEP_LOW );
+    double sweepScale   = ( 2.0 * M_PI * SWEEP_LOW * duration ) / sweepOctaves;
+
+    for ( uint32_t frame = 0; frame < frameCount; ++frame )
+    {
+        uint64_t position = Frame_ + frame;
+        double   time     = static_cast< double >( position ) / sampleRate;
+        float    values[ 2 ];
+
+        switch ( Signal_ )
+        {
+        case SyntheticSignal::SINE:
+
+            values[ 0 ] = static_cast< float >( sin( 2.0 * M_PI * Frequency_ * time ) );
+            values[ 1 ] = static_cast< float >( sin( 2.0 * M_PI * Frequency_ * RIGHT_SINE_FACTOR * time ) );
+            break;
+
+        case SyntheticSignal::SWEEP:
+
+            // Phase is the integral of the exponentially rising frequency, the right channel runs it backwards.
+            values[ 0 ] = static_cast< float >( sin( sweepScale * ( exp( ( time / duration ) * sweepOctaves ) - 1.0 ) ) );
+            values[ 1 ] = static_cast< float >( sin( sweepScale * ( exp( ( 1.0 - time / duration ) * sweepOctaves ) - 1.0 ) ) );
+            break;
+
+        case SyntheticSignal::WHITE_NOISE:
+
+            values[ 0 ] = NextNoise( 0 );
+            values[ 1 ] = NextNoise( 1 );
+            break;
+
+        case SyntheticSignal::PINK_NOISE:
+
+            for ( uint32_t channel = 0; channel < 2; ++channel )
+            {
+                float  white = NextNoise( channel );
+                float* state = Pink_[ channel ];
+                float  pink  = white * PINK_DIRECT + state[ 6 ];
+
+                for ( uint32_t pole = 0; pole < 6; ++pole )
+                {
+                    state[ pole ]  = PINK_POLES[ pole ] * state[ pole ] + white * PINK_GAINS[ pole ];
+                    pink          += state[ pole ];
+                }
+
+                state[ 6 ]        = white * PINK_DELAYED;
+                values[ channel ] = pink * PINK_NORMALIZE;
+            }
+            break;
+
+        default:
+        {
+            uint64_t period = static_cast< uint64_t >( IMPULSE_SECONDS * sampleRate );
+
+            values[ 0 ] = position % period == 0 ? 1.0f : 0.0f;
+            values[ 1 ] = values[ 0 ];
+            break;
+        }
+        }
+
+        for ( uint32_t channel = 0; channel < ChannelCount_; ++channel )
+        {
+            Block_[ frame * ChannelCount_ + channel ] = values[ channel ] * Amplitude_;
+        }
+    }
+}
+
+AudioUpdateResult SyntheticAudioSource::PullAudio()
+{
+    size_t framesNeeded = 0;
+
+    while ( ( framesNeeded = InputFramesUntilUpdate() ) > 0 )
+    {
+        uint64_t framesLeft  = FrameCount_ - Frame_;
+        uint32_t framesToAdd = static_cast< uint32_t >( framesNeeded < BLOCK_FRAMES ? framesNeeded : BLOCK_FRAMES );
+
+        if ( framesLeft == 0 )
+        {
+            return AudioUpdateResult::END_OF_STREAM;
+        }
+
+        framesToAdd = framesToAdd < framesLeft ? framesToAdd : static_cast< uint32_t >( framesLeft );
+
+        Generate( framesToAdd );
+        WriteFrames( Block_, framesToAdd, ChannelCount_ );
+
+        Frame_ += framesToAdd;
+    }
+
+    return CheckForUpdate();
+}
@@ -0,0 +1,64 @@
+#ifndef BOONDOGGLE_SYNTHETIC_SOURCE_H__
+#define BOONDOGGLE_SYNTHETIC_SOURCE_H__
+
+#pragma once
+
+#include <stdint.h>
+#include "../boondoggle/audio_source.h"
+
+enum class SyntheticSignal : uint32_t
+{
+    SINE        = 0, // a sine on the left, another at 3.1 times the frequency on the right.
+    SWEEP       = 1, // exponential sweep from 20 Hz to 20 kHz, falling on the right as it rises on the left.
+    WHITE_NOISE = 2,
+    PINK_NOISE  = 3,
+    IMPULSE     = 4, // a single sample click every 100ms.
+    COUNT       = 5
+};
+
+// Name of a synthetic signal, for reports.
+const char* SyntheticSignalName( SyntheticSignal signal );
+
+// Generates a test signal of a fixed length, for benchmarks and checking the analysis against known input.
+// Like the file sources, each pull generates exactly enough to complete the next window.
+class SyntheticAudioSource : public AudioSource
+{
+public:
+
+    SyntheticAudioSource();
+
+    // Set up the signal to generate, frequency is the sine frequency (unused for the others).
+    // Mono sources generate the left channel only.
+    bool Open( SyntheticSignal signal, uint32_t sampleRate, uint32_t channelCount, double seconds, double frequency, float amplitude );
+
+    bool Initialize( uint32_t requiredFrequency ) override;
+
+    // Frequency of the sine in a channel of the analysis (mono sources are heard in both).
+    double SineFrequency( uint32_t channel ) const;
+
+    // Generate the next window, returns END_OF_STREAM once the signal is done.
+    AudioUpdateResult PullAudio() override;
+
+private:
+
+    static const uint32_t BLOCK_FRAMES = 1024;
+
+    // Next sample of uniform noise in [-1, 1) for a channel.
+    float NextNoise( uint32_t channel );
+
+    // Generate frames into Block_.
+    void Generate( uint32_t frameCount );
+
+    SyntheticSignal Signal_;
+    uint32_t        StreamSampleRate_;
+    uint32_t        ChannelCount_;
+    uint64_t        Frame_;
+    uint64_t        FrameCount_;
+    double          Frequency_;
+    float           Amplitude_;
+    uint32_t        NoiseState_[ 2 ];
+    float           Pink_[ 2 ][ 7 ]; // pink noise filter state per channel.
+    float           Block_[ BLOCK_FRAMES * 2 ];
+};
+
+#endif // -- BOONDOGGLE_SYNTHETIC_SOURCE_H__
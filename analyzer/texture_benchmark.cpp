@@ -0,0 +1,170 @@
+#include "texture_benchmark.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <math.h>
+
+namespace
+{
+    // Spectrum magnitudes below this (-100 dB) are left out of the relative error, half denormals lose precision there.
+    const double SPECTRUM_ERROR_FLOOR = 1e-5;
+
+    // Reference decode of a half, to check the conversion against.
+    double HalfToDouble( uint16_t value )
+    {
+        int      exponent = ( value >> 10 ) & 0x1F;
+        uint32_t mantissa = value & 0x3FF;
+        double   sign     = ( value & 0x8000 ) != 0 ? -1.0 : 1.0;
+
+        if ( exponent == 0 )
+        {
+            return sign * ldexp( static_cast< double >( mantissa ), -24 );
+        }
+        else if ( exponent == 31 )
+        {
+            return mantissa != 0 ? NAN : sign * HUGE_VAL;
+        }
+
+        return sign * ldexp( static_cast< double >( mantissa | 0x400 ), exponent - 25 );
+    }
+
+    struct FormatErrors
+    {
+        double   WaveformMax;
+        double   WaveformSquares;
+        uint64_t WaveformCount;
+        double   SpectrumMaxRelative;
+        double   SpectrumMaxDb;
+    };
+
+    // Accumulate the error of the half texture against the float texture for one update.
+    void AccumulateErrors( const float* texture, const uint16_t* halfTexture, size_t texels, FormatErrors& errors )
+    {
+        for ( size_t texel = 0; texel < texels; ++texel )
+        {
+            for ( uint32_t channel = 0; channel < 4; ++channel )
+            {
+                double expected = texture[ texel * 4 + channel ];
+                double actual   = HalfToDouble( halfTexture[ texel * 4 + channel ] );
+                double error    = fabs( actual - expected );
+
+                if ( channel < 2 )
+                {
+                    errors.WaveformMax      = error > errors.WaveformMax ? error : errors.WaveformMax;
+                    errors.WaveformSquares += error * error;
+                    errors.WaveformCount   += 1;
+                }
+                else if ( expected >= SPECTRUM_ERROR_FLOOR )
+                {
+                    double relative = error / expected;
+                    double db       = fabs( 20.0 * log10( actual / expected ) );
+
+                    errors.SpectrumMaxRelative = relative > errors.SpectrumMaxRelative ? relative : errors.SpectrumMaxRelative;
+                    errors.SpectrumMaxDb       = db > errors.SpectrumMaxDb ? db : errors.SpectrumMaxDb;
+                }
+            }
+        }
+    }
+}
+
+bool RunTextureBenchmark( AudioSource& source, const AudioProcessingSettings& settings )
+{
+    AudioProcessingSettings halfSettings = settings;
+    AudioProcessing         processing;
+    PerFrameConstants       constants    = {};
+
+    halfSettings.TextureFormat = SoundTextureFormat::HALF;
+
+    if ( !processing.Initialize( source, halfSettings, constants ) )
+    {
+        printf( "Couldn't initialize audio processing for the input\n" );
+        return false;
+    }
+
+    size_t                  texels        = processing.SamplesPerPeriod();
+    const AudioKernels&     scalarKernels = GetAudioKernels( AudioInstructionSet::SCALAR );
+    const AudioKernels&     bestKernels   = GetAudioKernels( settings.Kernels );
+    std::vector< uint16_t > converted( texels * 4 );
+    FormatErrors            errors        = {};
+    uint64_t                updates       = 0;
+    double                  scalarSeconds = 0.0;
+    double                  bestSeconds   = 0.0;
+
+    for ( ;; )
+    {
+        AudioUpdateResult result = processing.Update( constants );
+
+        if ( result == AudioUpdateResult::AUDIO_ERROR )
+        {
+            printf( "Error reading audio input\n" );
+            return false;
+        }
+        else if ( result == AudioUpdateResult::END_OF_STREAM )
+        {
+            break;
+        }
+        else if ( result != AudioUpdateResult::UPDATED )
+        {
+            continue;
+        }
+
+        ++updates;
+
+        const float*    texture     = processing.AudioTextureData();
+        const uint16_t* halfTexture = reinterpret_cast< const uint16_t* >( processing.AudioTexture() );
+
+        AccumulateErrors( texture, halfTexture, texels, errors );
+
+        // Time the conversion on its own with each kernel, it's too quick to see in the whole update.
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        scalarKernels.FloatToHalf( texture, texels * 4, converted.data() );
+
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+        bestKernels.FloatToHalf( texture, texels * 4, converted.data() );
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        scalarSeconds += std::chrono::duration< double >( middle - start ).count();
+        bestSeconds   += std::chrono::duration< double >( end - middle ).count();
+
+        if ( ::memcmp( converted.data(), halfTexture, texels * 4 * sizeof( uint16_t ) ) != 0 )
+        {
+            printf( "Half conversion kernels don't match\n" );
+            return false;
+        }
+    }
+
+    if ( updates == 0 )
+    {
+        printf( "No audio was processed\n" );
+        return false;
+    }
+
+    double updatesPerSecond = static_cast< double >( source.SampleRate() ) / static_cast< double >( source.HopSamples() );
+
+    printf( "Texels per update:   %u\n", static_cast< uint32_t >( texels ) );
+    printf( "Updates per second:  %.1f (one per hop)\n", updatesPerSecond );
+    printf( "%-8s %14s %14s\n", "format", "bytes/update", "KB/s upload" );
+
+    for ( SoundTextureFormat format : { SoundTextureFormat::FLOAT32, SoundTextureFormat::HALF } )
+    {
+        size_t bytes = texels * SoundTexelBytes( format );
+
+        printf( "%-8s %14u %14.1f\n",
+                format == SoundTextureFormat::HALF ? "half" : "float32",
+                static_cast< uint32_t >( bytes ),
+                ( static_cast< double >( bytes ) * updatesPerSecond ) / 1024.0 );
+    }
+
+    printf( "Half precision loss against float32 over %llu updates:\n", static_cast< unsigned long long >( updates ) );
+    printf( "    waveform max abs error:   %.3e (rms %.3e)\n", errors.WaveformMax, sqrt( errors.WaveformSquares / static_cast< double >( errors.WaveformCount ) ) );
+    printf( "    spectrum max rel error:   %.3e (%.4f dB, magnitudes above -100 dB)\n", errors.SpectrumMaxRelative, errors.SpectrumMaxDb );
+    printf( "Conversion per update:\n" );
+    printf( "    scalar:                   %.0f ns\n", ( scalarSeconds * 1e9 ) / static_cast< double >( updates ) );
+    printf( "    %-26s%.0f ns\n", bestKernels.InstructionSet == AudioInstructionSet::AVX2 ? "f16c:" : "best kernels:", ( bestSeconds * 1e9 ) / static_cast< double >( updates ) );
+
+    return true;
+}
@@ -0,0 +1,13 @@
+#ifndef BOONDOGGLE_TEXTURE_BENCHMARK_H__
+#define BOONDOGGLE_TEXTURE_BENCHMARK_H__
+
+#pragma once
+
+#include "../boondoggle/audio.h"
+
+// Run the source through processing with the half precision sound texture and report, for each
+// sound texture format, the bytes uploaded per second at the update rate, the precision lost against
+// the full precision data and the cost of the conversion. Returns false on error.
+bool RunTextureBenchmark( AudioSource& source, const AudioProcessingSettings& settings );
+
+#endif // -- BOONDOGGLE_TEXTURE_BENCHMARK_H__
@@ -1,10 +1,7 @@
 #include "audio.h"
-#include <windows.h>
-#include <mmdeviceapi.h>
-#include <audioclient.h>
 #include "../common/boondoggle_helpers.h"
 #include <float.h>
-#include <assert.h>
+#include <string.h>
 
 #define _USE_MATH_DEFINES
 
@@ -20,556 +17,660 @@ namespace
     const float    DBSPL_SCALE                   = 20.0f;
     const float    SMOOTHING_RATE                = 0.17f;
     const float    DEFAULT_SMOOTHING_FREQUENCY   = 50.0f;
-}
-
-AudioCapture::AudioCapture() :
-    Device_( nullptr ),
-    Cursor_( 0 ),
-    BufferSize_( 0 ),
-    SilenceClient_( nullptr ),
-    CaptureClient_( nullptr ),
-    SilenceRender_( nullptr ),
-    Capture_( nullptr ),
-    SampleRate_( 0 ),
-    SilenceFrameCount_( 0 ),
-    NumberChannelsCapture_( 0 ),
-    NumberChannelsSilence_( 0 ),
-    LastReadCursor_( 0 )
-{
-    Channels_[ 0 ] = nullptr;
-    Channels_[ 1 ] = nullptr;
-}
+    const float    MIN_LOW_BAND_FREQUENCY        = 20.0f;
+    const float    LOW_BAND_CROSSOVER            = 0.8f; // fraction of the decimated nyquist the low band is used up to.
+    const uint32_t CATCH_UP_BACKLOG_PERIODS      = 15; // a 16 period ring, 340ms at 48kHz.
+    const size_t   MEMORY_RESERVE                = 16 * 1024 * 1024; // address space for the processing buffers, only what's used is committed.
+    const size_t   BUFFER_ALIGNMENT              = 32; // for AVX loads and stores.
 
-AudioCapture::~AudioCapture()
-{
-    if ( SilenceClient_ != nullptr )
+    // Normalized power of a bin of both channels from the spectrum of a stereo pair transformed together (see TransformStereo).
+    void SplitBinPower( const kiss_fft_cpx* packed, uint32_t fftSize, uint32_t bin, float normalizationSquared, float& leftPower, float& rightPower )
     {
-        SilenceClient_->Stop();
-    }
+        const kiss_fft_cpx& forward = packed[ bin ];
+        const kiss_fft_cpx& mirror  = packed[ ( fftSize - bin ) & ( fftSize - 1 ) ];
 
-    if ( CaptureClient_ != nullptr )
-    {
-        CaptureClient_->Stop();
+        float leftReal       = forward.r + mirror.r;
+        float leftImaginary  = forward.i - mirror.i;
+        float rightReal      = forward.i + mirror.i;
+        float rightImaginary = mirror.r - forward.r;
+
+        leftPower  = ( leftReal * leftReal + leftImaginary * leftImaginary ) * normalizationSquared;
+        rightPower = ( rightReal * rightReal + rightImaginary * rightImaginary ) * normalizationSquared;
     }
 
-    COMRelease( Device_ );
-    COMRelease( SilenceClient_ );
-    COMRelease( CaptureClient_ );
-    COMRelease( Capture_ );
-    COMRelease( SilenceRender_ );
+    // The upper frequency of a bucket for the sqrt bucket curve.
+    float BucketUpperFrequency( uint32_t bucket, uint32_t bucketCount, float minBinFrequency, float inverseMaxRelevantFrequency )
+    {
+        float curvePosition = ( bucket + 0.5f ) / ( bucketCount - 1 );
 
-    // both channels memory is one contiguous allocation, so this deletes the buffer for both channels.
-    delete[] Channels_[ 0 ]; 
-    Channels_[ 0 ] = nullptr;
-    Channels_[ 1 ] = nullptr;
+        return minBinFrequency + ( curvePosition * curvePosition ) / inverseMaxRelevantFrequency;
+    }
 }
 
-bool AudioCapture::Initialize( uint32_t requiredFrequency )
+AudioProcessing::AudioProcessing() :
+    Source_( nullptr ),
+    Kernels_( &GetAudioKernels() ),
+    FFT_( nullptr ),
+    Window_( nullptr ),
+    AudioTextureData_( nullptr ),
+    AudioTextureHalf_( nullptr ),
+    TextureFormat_( SoundTextureFormat::FLOAT32 ),
+    RelevantBins_( 0 ),
+    Bucketing_( FrequencyBucketing::PEAK_BINS ),
+    BucketCount_( DEFAULT_FREQUENCY_BUCKETS ),
+    Power_( nullptr ),
+    PowerStride_( 0 ),
+    Smoothing_( 0 ),
+    LowBandCursor_( 0 ),
+    LowBandInputCursor_( 0 ),
+    LowBandPending_( 0 ),
+    LowBandBuckets_( 0 ),
+    LowBandSmoothing_( 0 ),
+    LowBandPower_( nullptr ),
+    LowBandPowerStride_( 0 ),
+    CatchUpWindows_( 0 ),
+    WindowsProcessed_( 0 ),
+    TimeStages_( false ),
+    StageMark_( 0 )
 {
-    COMAutoPtr< IMMDeviceEnumerator > deviceEnumerator;
+    Timestamps_.Captured  = 0;
+    Timestamps_.Pulled    = 0;
+    Timestamps_.Processed = 0;
 
-    HRESULT deviceEnumeratorResult =
-        CoCreateInstance( __uuidof( MMDeviceEnumerator ), 
-                          nullptr,
-                          CLSCTX_ALL,
-                          __uuidof( IMMDeviceEnumerator ),
-                          reinterpret_cast< void** >( &deviceEnumerator.raw ) );
+    ::memset( StageNanoseconds_, 0, sizeof( StageNanoseconds_ ) );
+    ::memset( BucketEdges_, 0, sizeof( BucketEdges_ ) );
 
-    if ( FAILED( deviceEnumeratorResult ) )
-    {
-        return false;
-    }
+    LowBand_[ 0 ]   = nullptr;
+    LowBand_[ 1 ]   = nullptr;
+    Decimated_[ 0 ] = nullptr;
+    Decimated_[ 1 ] = nullptr;
 
-    HRESULT defaultEndpointResult =
-        deviceEnumerator->GetDefaultAudioEndpoint( eRender, eConsole, &Device_ );
+    Windowed_       = nullptr;
+    Packed_         = nullptr;
+    Frequency_[ 0 ] = nullptr;
+    Frequency_[ 1 ] = nullptr;
 
-    if ( FAILED( defaultEndpointResult ) )
+    for ( uint32_t where = 0; where <= FREQUENCY_BUCKETS; ++where )
     {
-        return false;
+        BucketBoundaries_[ where ]  = 0;
+        LowBandBoundaries_[ where ] = 0;
     }
 
-    HRESULT activateSilenceResult =
-        Device_->Activate( __uuidof( IAudioClient ), CLSCTX_ALL, nullptr, reinterpret_cast<void**>( &SilenceClient_ ) );
-
-    if ( FAILED( activateSilenceResult ) )
+    for ( uint32_t where = 0; where < FREQUENCY_BUCKETS; ++where )
     {
-        return false;
+        BucketRange_[ where ][ 0 ] = FLT_MAX;
+        BucketRange_[ where ][ 1]  = -FLT_MAX;
     }
+}
 
-    HRESULT activateCaptureResult =
-        Device_->Activate( __uuidof( IAudioClient ), CLSCTX_ALL, nullptr, reinterpret_cast<void**>( &CaptureClient_ ) );
+AudioProcessing::~AudioProcessing()
+{
+    delete FFT_;
+}
 
-    if ( FAILED( activateCaptureResult ) )
+bool AudioProcessing::Initialize( AudioSource& source, const AudioProcessingSettings& settings, PerFrameConstants& toUpdate )
+{
+    Source_         = &source;
+    Kernels_        = &GetAudioKernels( settings.Kernels );
+    TextureFormat_  = settings.TextureFormat;
+    TimeStages_     = settings.TimeStages;
+    CatchUpWindows_ = settings.CatchUpWindows;
+    Bucketing_      = settings.Bucketing;
+    BucketCount_    = settings.BucketCount != 0 ? settings.BucketCount : DEFAULT_FREQUENCY_BUCKETS;
+    LowBandBuckets_ = 0;
+
+    // The ranges are worked out again from the settings, so a re-initialize doesn't keep the last one's.
+    for ( uint32_t where = 0; where < FREQUENCY_BUCKETS; ++where )
     {
-        return false;
+        BucketRange_[ where ][ 0 ] = FLT_MAX;
+        BucketRange_[ where ][ 1 ] = -FLT_MAX;
     }
 
-    WAVEFORMATEX* silenceWaveFormat;
+    Source_->SetKernels( *Kernels_ );
+    Source_->SetAnalysisRate( settings.AnalysisRate );
+    Source_->SetCatchUp( settings.CatchUpWindows > 0 ? CATCH_UP_BACKLOG_PERIODS : 0 );
 
-    HRESULT silentMixFormatResult =
-        SilenceClient_->GetMixFormat( &silenceWaveFormat );
+    bool result = BucketCount_ >= 2 && 
+                  BucketCount_ <= FREQUENCY_BUCKETS &&
+                  Source_->Initialize( MIN_REQUIRED_FREQUENCY ) && 
+                  Source_->SetHopSamples( settings.HopSamples );
 
-    if ( FAILED( silentMixFormatResult ) )
+    if ( result )
     {
-        return false;
-    }
+        size_t samplesPerPeriod = Source_->SamplesPerPeriod();
+        size_t realFFTSamples   = ( samplesPerPeriod / 2 ) + 1;
 
-    NumberChannelsSilence_ = silenceWaveFormat->nChannels;
-    
-    HRESULT silenceClientInitResult =
-        SilenceClient_->Initialize(
-            AUDCLNT_SHAREMODE_SHARED,
-            0,
-            0,
-            0,
-            silenceWaveFormat,
-            nullptr );
+        float minBinFrequency = static_cast<float>( Source_->SampleRate() ) / static_cast<float>( samplesPerPeriod );
 
-    CoTaskMemFree( silenceWaveFormat );
+        // Calculate the top bin above our frequency ceiling for audio cut-off.
+        RelevantBins_ = static_cast< uint32_t >( ceilf( MAX_REQUIRED_BUCKET_FREQUENCY / minBinFrequency ) ) + 1;
 
-    if ( FAILED( silenceClientInitResult ) )
-    {
-        return false;
-    }
-    
-    HRESULT getRenderClientResult =
-        SilenceClient_->GetService(
-            __uuidof( IAudioRenderClient ),
-            reinterpret_cast< void** >( &SilenceRender_ ) );
+        // Clamp the relevant bin to the actual number of bins we actually have.
+        if ( RelevantBins_ > realFFTSamples )
+        {
+            RelevantBins_ = static_cast< uint32_t >( realFFTSamples );
+        }
 
-    if ( FAILED( getRenderClientResult ) )
-    {
-        return false;
-    }
+        PowerStride_ = Filterbank::PowerStride( static_cast< uint32_t >( realFFTSamples ) );
 
-    WAVEFORMATEX* captureFormat;
-    
-    HRESULT captureMixFormatResult =
-        CaptureClient_->GetMixFormat( &captureFormat );
+        // All the buffers come from the arena, so a re-initialize re-uses the same memory. The texture data is zeroed
+        // here once and after that every update overwrites all of it (the power padding stays zero for the filterbank).
+        result = Memory_.Base() != nullptr || Memory_.Initialize( "audio processing", MEMORY_RESERVE );
 
-    if ( FAILED( captureMixFormatResult ) )
-    {
-        return false;
-    }
+        Memory_.Reset();
 
-    NumberChannelsCapture_ = captureFormat->nChannels;
-    
-    // try and force float output on capture.
-    switch ( captureFormat->wFormatTag )
-    {
-    case WAVE_FORMAT_PCM:
+        AudioTextureData_ = Memory_.Allocate< float >( samplesPerPeriod * 4, BUFFER_ALIGNMENT );
+        Window_           = Memory_.Allocate< float >( samplesPerPeriod, BUFFER_ALIGNMENT );
+        Windowed_         = Memory_.Allocate< float >( samplesPerPeriod * 2, BUFFER_ALIGNMENT );
+        Packed_           = Memory_.Allocate< kiss_fft_cpx >( samplesPerPeriod, BUFFER_ALIGNMENT );
+        Frequency_[ 0 ]   = Memory_.Allocate< kiss_fft_cpx >( realFFTSamples, BUFFER_ALIGNMENT );
+        Frequency_[ 1 ]   = Memory_.Allocate< kiss_fft_cpx >( realFFTSamples, BUFFER_ALIGNMENT );
+        AudioTextureHalf_ = Memory_.Allocate< uint16_t >( samplesPerPeriod * 4, BUFFER_ALIGNMENT );
+        Power_            = Memory_.Allocate< float >( PowerStride_ * 2, BUFFER_ALIGNMENT );
 
-        captureFormat->wFormatTag      = WAVE_FORMAT_IEEE_FLOAT;
-        captureFormat->wBitsPerSample  = 32;
-        captureFormat->nBlockAlign     = captureFormat->nChannels * sizeof( float );
-        captureFormat->nAvgBytesPerSec = captureFormat->nBlockAlign * captureFormat->nBlockAlign;
-        break;
+        result = result && Power_ != nullptr;
 
-    case WAVE_FORMAT_EXTENSIBLE:
+        if ( !result )
         {
-            WAVEFORMATEXTENSIBLE* extensible = reinterpret_cast<WAVEFORMATEXTENSIBLE*>( captureFormat );
-
-            if ( !IsEqualGUID( KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, extensible->SubFormat ) )
-            {
-                extensible->SubFormat                   = KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
-                extensible->Samples.wValidBitsPerSample = 32;
-                captureFormat->wBitsPerSample           = 32;
-                captureFormat->nBlockAlign              = captureFormat->nChannels * sizeof( float );
-                captureFormat->nAvgBytesPerSec          = captureFormat->nBlockAlign * captureFormat->nBlockAlign;
-            }
+            return false;
         }
-    }
 
-    SampleRate_ = captureFormat->nSamplesPerSec;
+        delete FFT_;
 
-    uint32_t captureSamples = 1024;
-
-    while ( captureFormat->nSamplesPerSec / captureSamples > requiredFrequency )
-    {
-        captureSamples *= 2;
-    }
+        FFT_ = CreateFFTEngine( settings.FFT, static_cast< uint32_t >( samplesPerPeriod ) );
 
-    BufferSize_    = captureSamples * 2;
+        result = FFT_ != nullptr;
 
-    Channels_[ 0 ] = new float[ BufferSize_ * 2 ];
-    Channels_[ 1 ] = Channels_[ 0 ] + BufferSize_;
+        float angleScale = static_cast< float >( M_PI * 2.0f ) / ( samplesPerPeriod - 1 );
 
-    HRESULT captureInitResult =
-        CaptureClient_->Initialize(
-            AUDCLNT_SHAREMODE_SHARED,
-            AUDCLNT_STREAMFLAGS_LOOPBACK,
-            0,
-            0,
-            captureFormat,
-            nullptr );
+        // pre-calculate hamming window weights.
+        for ( uint32_t windowPosition = 0; windowPosition < samplesPerPeriod; ++windowPosition )
+        {
+            Window_[ windowPosition ] = HAMMING_ALPHA - HAMMING_BETA * cosf( angleScale * static_cast< float >( windowPosition ) );
+        }
 
-    CoTaskMemFree( captureFormat );
+        float    inverseMaxRelevantFrequency = 1.0f / ( minBinFrequency * ( RelevantBins_ - 2 ) );
+        uint32_t nextBoundary                = 0;
 
-    if ( FAILED( captureInitResult ) )
-    {
-        return false;
-    }
+        // skip over DC
+        for ( uint32_t bin = 1; bin < RelevantBins_ && Bucketing_ == FrequencyBucketing::PEAK_BINS; ++bin )
+        {
+            float binFrequency        = bin * minBinFrequency;
 
-    HRESULT getCaptureClientResult =
-        CaptureClient_->GetService(
-            __uuidof( IAudioCaptureClient ),
-            reinterpret_cast< void** >( &Capture_ ) );
+            // uses a gamma like bucket allocation.
+            uint32_t bucket = 
+                static_cast< uint32_t >( roundf( sqrtf( ( binFrequency - minBinFrequency ) * inverseMaxRelevantFrequency ) * ( BucketCount_ - 1 ) ) );
 
-    if ( FAILED( getCaptureClientResult ) )
-    {
-        return false;
-    }
+            // The mapping only ever goes up, so each bucket is a contiguous run of bins.
+            for ( ; nextBoundary <= bucket; ++nextBoundary )
+            {
+                BucketBoundaries_[ nextBoundary ] = bin;
+            }
 
-    HRESULT silenceGetBufferSizeResult =
-        SilenceClient_->GetBufferSize( &SilenceFrameCount_ );
+            BucketRange_[ bucket ][ 0 ] = binFrequency < BucketRange_[ bucket ][ 0 ] ? binFrequency : BucketRange_[ bucket ][ 0 ];
+            BucketRange_[ bucket ][ 1 ] = binFrequency > BucketRange_[ bucket ][ 1 ] ? binFrequency : BucketRange_[ bucket ][ 1 ];
+        }
 
-    if ( FAILED( silenceGetBufferSizeResult ) )
-    {
-        return false;
-    }
+        for ( ; nextBoundary <= BucketCount_; ++nextBoundary )
+        {
+            BucketBoundaries_[ nextBoundary ] = RelevantBins_;
+        }
 
-    BYTE* silenceData = nullptr;
+        if ( Bucketing_ != FrequencyBucketing::PEAK_BINS )
+        {
+            result = result && InitializeBucketEdges( settings, minBinFrequency );
+        }
 
-    HRESULT silenceGetBufferResult = 
-        SilenceRender_->GetBuffer( SilenceFrameCount_, &silenceData );
+        // Buckets we don't use read as silence with no range, as do any the bucket curve skips over
+        // when there are more buckets than bins at the bottom.
+        for ( uint32_t bucket = 0; bucket < FREQUENCY_BUCKETS; ++bucket )
+        {
+            if ( bucket >= BucketCount_ || BucketRange_[ bucket ][ 0 ] > BucketRange_[ bucket ][ 1 ] )
+            {
+                BucketRange_[ bucket ][ 0 ] = 0.0f;
+                BucketRange_[ bucket ][ 1 ] = 0.0f;
+            }
+        }
 
-    if ( FAILED( silenceGetBufferResult ) )
-    {
-        return false;
-    }
+        float periodSmoothing = powf( SMOOTHING_RATE, minBinFrequency / DEFAULT_SMOOTHING_FREQUENCY );
+        float hopFraction     = static_cast< float >( Source_->HopSamples() ) / static_cast< float >( samplesPerPeriod );
 
-    HRESULT silenceFillResult = 
-        SilenceRender_->ReleaseBuffer( SilenceFrameCount_, AUDCLNT_BUFFERFLAGS_SILENT );
+        // Keep the same decay per second when we update more often than once a period.
+        Smoothing_ = 1.0f - powf( 1.0f - periodSmoothing, hopFraction );
 
-    if ( FAILED( silenceFillResult ) )
-    {
-        return false;
-    }
+        if ( settings.LowBandDecimation > 1 )
+        {
+            result = result && InitializeLowBand( settings.LowBandDecimation, periodSmoothing );
+        }
 
-    HRESULT silenceStartResult = SilenceClient_->Start();
+        // Low edges can leave all the filters to the low band.
+        if ( Bucketing_ != FrequencyBucketing::PEAK_BINS && LowBandBuckets_ < BucketCount_ )
+        {
+            result = result && 
+                     Filterbank_.Initialize( BucketEdges_ + LowBandBuckets_, 
+                                             BucketCount_ - LowBandBuckets_, 
+                                             minBinFrequency, 
+                                             static_cast< uint32_t >( realFFTSamples ), 
+                                             FilterbankPowerScale() );
+        }
 
-    if ( FAILED( silenceStartResult ) )
-    {
-        return false;
+        result = result && Onsets_.Initialize( RelevantBins_, Source_->SampleRate(), static_cast< uint32_t >( Source_->HopSamples() ) );
+        result = result && Loudness_.Initialize( Source_->SampleRate() );
     }
 
-    HRESULT captureStartResult = CaptureClient_->Start();
+    toUpdate.NoiseFloorDbSPL     = NOISE_FLOOR;
+    toUpdate.SoundSampleRate     = static_cast<float>( Source_->SampleRate() );
+    toUpdate.SoundSamples        = static_cast<float>( Source_->SamplesPerPeriod() );
+    toUpdate.SoundOnsetStrength  = 0.0f;
+    toUpdate.SoundBPM            = 0.0f;
+    toUpdate.SoundBeatPhase      = 0.0f;
+    toUpdate.SoundBeatConfidence = 0.0f;
 
-    if ( FAILED( captureStartResult ) )
+    toUpdate.SoundLoudnessMomentary = LOUDNESS_FLOOR;
+    toUpdate.SoundLoudnessShortTerm = LOUDNESS_FLOOR;
+    toUpdate.SoundLoudnessGain      = 1.0f;
+
+    for ( uint32_t bucket = 0; bucket < FREQUENCY_BUCKETS; ++bucket )
     {
-        return false;
+        toUpdate.SoundFrequencyBuckets[ bucket ][ 0 ] = NOISE_FLOOR;
+        toUpdate.SoundFrequencyBuckets[ bucket ][ 1 ] = NOISE_FLOOR;
     }
 
-    return true;
+    return result;
 }
 
-AudioUpdateResult AudioCapture::PullAudio()
+AudioUpdateResult AudioProcessing::Update( PerFrameConstants& toUpdate )
 {
-    uint32_t silencePadding   = 0;
+    AudioUpdateResult result = Source_->PullAudio();
 
-    HRESULT  getPaddingResult;
-    
-    for ( getPaddingResult = SilenceClient_->GetCurrentPadding( &silencePadding );
-          SUCCEEDED( getPaddingResult ) && SilenceFrameCount_ != silencePadding;
-          getPaddingResult = SilenceClient_->GetCurrentPadding( &silencePadding ) )
+    WindowsProcessed_ = 0;
+
+    if ( result == AudioUpdateResult::UPDATED )
     {
-        BYTE*   renderBuffer          = nullptr;
-        HRESULT getRenderBufferResult =
-            SilenceRender_->GetBuffer( SilenceFrameCount_ - silencePadding, &renderBuffer );
+        Timestamps_.Pulled = LatencyTimestamp();
 
-        if ( FAILED( getRenderBufferResult ) )
+        // Catching up works through the windows that built up in order, the latency is for the last one.
+        do
         {
-            return AudioUpdateResult::AUDIO_ERROR;
-        }
+            Timestamps_.Captured = Source_->WindowTimestamp();
 
-        HRESULT releaseBufferRenderResult =
-            SilenceRender_->ReleaseBuffer( SilenceFrameCount_ - silencePadding, AUDCLNT_BUFFERFLAGS_SILENT );
+            ProcessWindow( toUpdate );
 
-        if ( FAILED( releaseBufferRenderResult ) )
-        {
-            return AudioUpdateResult::AUDIO_ERROR;
+            ++WindowsProcessed_;
         }
+        while ( WindowsProcessed_ < CatchUpWindows_ && Source_->NextBufferedWindow() == AudioUpdateResult::UPDATED );
+
+        Timestamps_.Processed = LatencyTimestamp();
     }
 
-    if ( FAILED( getPaddingResult ) )
+    toUpdate.SoundSampleRate = static_cast<float>( Source_->SampleRate() );
+    toUpdate.SoundSamples    = static_cast<float>( Source_->SamplesPerPeriod() );
+
+    return result;
+}
+
+float AudioProcessing::TransformStereo( float* sumSquares )
+{
+    size_t samplesPerPeriod = Source_->SamplesPerPeriod();
+
+    Kernels_->WindowStereo( Source_->GetChannel( 0 ),
+                            Source_->GetChannel( 1 ),
+                            Window_,
+                            Windowed_,
+                            AudioTextureData_,
+                            samplesPerPeriod,
+                            sumSquares );
+
+    MarkStage( AudioStage::WINDOW );
+
+    // Left is the real part and right the imaginary part of one complex signal.
+    FFT_->Forward( reinterpret_cast< const kiss_fft_cpx* >( Windowed_ ), Packed_ );
+
+    uint32_t fftSize  = static_cast< uint32_t >( samplesPerPeriod );
+    uint32_t binCount = ( fftSize / 2 ) + 1;
+
+    // Real signals have conjugate symmetric spectra, so we can split the two back out:
+    // left[k] = ( Z[k] + conj( Z[N-k] ) ) / 2, right[k] = ( Z[k] - conj( Z[N-k] ) ) / 2i.
+    // The halves are left out here and folded into the normalization instead.
+    for ( uint32_t bin = 0; bin < binCount; ++bin )
     {
-        return AudioUpdateResult::AUDIO_ERROR;
+        const kiss_fft_cpx& forward = Packed_[ bin ];
+        const kiss_fft_cpx& mirror  = Packed_[ ( fftSize - bin ) & ( fftSize - 1 ) ];
+
+        Frequency_[ 0 ][ bin ].r = forward.r + mirror.r;
+        Frequency_[ 0 ][ bin ].i = forward.i - mirror.i;
+        Frequency_[ 1 ][ bin ].r = forward.i + mirror.i;
+        Frequency_[ 1 ][ bin ].i = mirror.r - forward.r;
     }
 
-    HRESULT  getNextPacketResult;
-    uint32_t nextPacketSize = 0;
+    return 1.0f / binCount;
+}
 
-    for ( getNextPacketResult = Capture_->GetNextPacketSize( &nextPacketSize );
-          SUCCEEDED( getNextPacketResult ) && nextPacketSize > 0;
-          getNextPacketResult = Capture_->GetNextPacketSize( &nextPacketSize ) )
-    {
-        BYTE* readBuffer;
-        uint32_t framesRead;
-        DWORD readFlags;
-
-        HRESULT getBufferResult = 
-            Capture_->GetBuffer(
-                &readBuffer,
-                &framesRead,
-                &readFlags,
-                nullptr,
-                nullptr );
-
-        if ( FAILED( getBufferResult ) )
-        {
-            return AudioUpdateResult::AUDIO_ERROR;
-        }
+float AudioProcessing::TransformMono( float* sumSquares )
+{
+    size_t samplesPerPeriod = Source_->SamplesPerPeriod();
 
-        if ( AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY == readFlags )
-        {
-            Cursor_         = 0;
-            LastReadCursor_ = 0;
-        }
+    Kernels_->WindowMono( Source_->GetChannel( 0 ), Window_, Windowed_, AudioTextureData_, samplesPerPeriod, sumSquares );
+
+    sumSquares[ 1 ] = sumSquares[ 0 ];
+
+    MarkStage( AudioStage::WINDOW );
 
-        const float* floatBuffer = reinterpret_cast< const float* >( readBuffer );
+    FFT_->ForwardReal( Windowed_, Frequency_[ 0 ] );
 
-        if ( NumberChannelsCapture_ == 1 )
+    return 2.0f / ( ( samplesPerPeriod / 2 ) + 1 );
+}
+
+bool AudioProcessing::InitializeBucketEdges( const AudioProcessingSettings& settings, float minBinFrequency )
+{
+    if ( Bucketing_ == FrequencyBucketing::CUSTOM )
+    {
+        if ( settings.BucketEdges == nullptr )
         {
-            for ( const float* currentFrame = floatBuffer, *endFrame = floatBuffer + framesRead; 
-                  currentFrame < endFrame; 
-                  ++currentFrame, ++Cursor_ )
-            {
-                Channels_[ 0 ][ Cursor_ & ( BufferSize_ - 1 ) ] = 
-                Channels_[ 1 ][ Cursor_ & ( BufferSize_ - 1 ) ] = *currentFrame;
-            }
+            return false;
         }
-        else
-        {
-            assert( NumberChannelsCapture_ < 5 );
 
-            for ( const float* currentFrame = floatBuffer, *endFrame = floatBuffer + ( framesRead * NumberChannelsCapture_ ); 
-                  currentFrame < endFrame; 
-                  currentFrame += NumberChannelsCapture_, ++Cursor_ )
-            {
-                Channels_[ 0 ][ Cursor_ & ( BufferSize_ - 1 ) ] = currentFrame[ 0 ];
-                Channels_[ 1 ][ Cursor_ & ( BufferSize_ - 1 ) ] = currentFrame[ 1 ];
-            }
-        }
+        ::memcpy( BucketEdges_, settings.BucketEdges, sizeof( float ) * ( BucketCount_ + 2 ) );
+    }
+    else
+    {
+        float nyquist       = 0.5f * static_cast< float >( Source_->SampleRate() );
+        float highFrequency = static_cast< float >( MAX_REQUIRED_BUCKET_FREQUENCY ) < nyquist ? static_cast< float >( MAX_REQUIRED_BUCKET_FREQUENCY ) : nyquist;
 
-        HRESULT bufferReleaseResult = Capture_->ReleaseBuffer( framesRead );
-    
-        if ( FAILED( bufferReleaseResult ) )
+        // Same span as the bin buckets, from the first bin above DC.
+        if ( !Filterbank::ScaleEdges( Bucketing_, BucketCount_, minBinFrequency, highFrequency, BucketEdges_ ) )
         {
-            return AudioUpdateResult::AUDIO_ERROR;
+            return false;
         }
     }
 
-    if ( FAILED( getNextPacketResult ) )
+    for ( uint32_t bucket = 0; bucket < BucketCount_; ++bucket )
     {
-        return AudioUpdateResult::AUDIO_ERROR;
+        BucketRange_[ bucket ][ 0 ] = BucketEdges_[ bucket ];
+        BucketRange_[ bucket ][ 1 ] = BucketEdges_[ bucket + 2 ];
     }
 
-    AudioUpdateResult result =
-        ( Cursor_ - LastReadCursor_ ) >= uint64_t( SamplesPerPeriod() ) ? 
-            AudioUpdateResult::UPDATED : 
-            AudioUpdateResult::NOT_UPDATED;
+    return true;
+}
 
-    if ( result == AudioUpdateResult::UPDATED )
+float AudioProcessing::FilterbankPowerScale() const
+{
+    size_t samplesPerPeriod = Source_->SamplesPerPeriod();
+    double sum              = 0.0;
+    double sumSquares       = 0.0;
+
+    for ( size_t sample = 0; sample < samplesPerPeriod; ++sample )
     {
-        LastReadCursor_ = Cursor_ & ~( ( BufferSize_ >> 1 ) - 1 );
+        sum        += Window_[ sample ];
+        sumSquares += static_cast< double >( Window_[ sample ] ) * Window_[ sample ];
     }
 
-    return result;
+    return static_cast< float >( ( sum * sum ) / ( sumSquares * samplesPerPeriod ) );
 }
 
-AudioProcessing::AudioProcessing() :
-    Kiss_( nullptr ),
-    Window_( nullptr ),
-    Intermediate_( nullptr ),
-    Frequency_( nullptr ),
-    AudioTextureData_( nullptr )
+bool AudioProcessing::InitializeLowBand( uint32_t decimation, float periodSmoothing )
 {
-    for ( uint32_t where = 0; where < FREQUENCY_BUCKETS; ++where )
+    size_t samplesPerPeriod = Source_->SamplesPerPeriod();
+
+    if ( !Decimator_.Initialize( decimation, samplesPerPeriod ) )
     {
-        BucketRange_[ where ][ 0 ] = FLT_MAX;
-        BucketRange_[ where ][ 1]  = -FLT_MAX;
+        return false;
     }
-}
 
-AudioProcessing::~AudioProcessing()
-{
-    ::_aligned_free( AudioTextureData_ );
-}
+    uint32_t lowBinCount = static_cast< uint32_t >( samplesPerPeriod / 2 ) + 1;
 
-bool AudioProcessing::Initialize( PerFrameConstants& toUpdate )
-{
-    bool result = Capture_.Initialize( MIN_REQUIRED_FREQUENCY );
+    LowBandPowerStride_ = Bucketing_ != FrequencyBucketing::PEAK_BINS ? Filterbank::PowerStride( lowBinCount ) : 0;
+    LowBand_[ 0 ]       = Memory_.Allocate< float >( samplesPerPeriod * 2, BUFFER_ALIGNMENT );
+    LowBand_[ 1 ]       = Memory_.Allocate< float >( samplesPerPeriod * 2, BUFFER_ALIGNMENT );
+    Decimated_[ 0 ]     = Memory_.Allocate< float >( Decimator_.MaxOutputFrames(), BUFFER_ALIGNMENT );
+    Decimated_[ 1 ]     = Memory_.Allocate< float >( Decimator_.MaxOutputFrames(), BUFFER_ALIGNMENT );
+    LowBandPower_       = Memory_.Allocate< float >( LowBandPowerStride_ * 2, BUFFER_ALIGNMENT );
 
-    if ( result )
+    if ( LowBandPower_ == nullptr )
     {
-        size_t kissMemLength    = 0;
-        size_t samplesPerPeriod = Capture_.SamplesPerPeriod();
-        size_t realFFTSamples   = ( samplesPerPeriod / 2 ) + 1;
+        return false;
+    }
 
-        float minBinFrequency = static_cast<float>( Capture_.SampleRate() ) / static_cast<float>( samplesPerPeriod );
+    LowBandCursor_      = 0;
+    LowBandInputCursor_ = 0;
+    LowBandPending_     = 0;
 
-        // Calculate the top bin above our frequency ceiling for audio cut-off.
-        RelevantBins_ = static_cast< uint32_t >( ceilf( MAX_REQUIRED_BUCKET_FREQUENCY / minBinFrequency ) ) + 1;
+    float sampleRate                  = static_cast< float >( Source_->SampleRate() );
+    float minBinFrequency             = sampleRate / static_cast< float >( samplesPerPeriod );
+    float inverseMaxRelevantFrequency = 1.0f / ( minBinFrequency * ( RelevantBins_ - 2 ) );
+    float lowBinFrequency             = minBinFrequency / decimation;
+    float crossover                   = LOW_BAND_CROSSOVER * 0.5f * sampleRate / decimation;
 
-        // Clamp the relevant bin to the actual number of bins we actually have.
-        if ( RelevantBins_ > realFFTSamples )
-        {
-            RelevantBins_ = static_cast< uint32_t >( realFFTSamples );
-        }
+    float hopFraction = static_cast< float >( Source_->HopSamples() * decimation ) / static_cast< float >( samplesPerPeriod );
 
-        kiss_fftr_alloc( static_cast< int >( samplesPerPeriod ), 0, nullptr, &kissMemLength );
-
-        // Make it one big 16 byte aligned allocation
-        void* blockAllocation = 
-            ::_aligned_recalloc( nullptr, 
-                                 sizeof( kiss_fft_cpx ) * realFFTSamples + 
-                                 sizeof( float ) * samplesPerPeriod * 6 +
-                                 sizeof( uint32_t ) * realFFTSamples +
-                                 kissMemLength, 
-                                 1, 
-                                 16 );
-
-        AudioTextureData_ = reinterpret_cast< float* >( blockAllocation );
-        Window_           = AudioTextureData_ + ( 4 * samplesPerPeriod );
-        Intermediate_     = Window_ + samplesPerPeriod;
-        BucketMapping_    = reinterpret_cast< uint32_t* >( Intermediate_ + samplesPerPeriod );
-        Frequency_        = reinterpret_cast< kiss_fft_cpx* >( BucketMapping_ + RelevantBins_ - 1 );
-
-        Kiss_ = kiss_fftr_alloc( static_cast< int >( samplesPerPeriod ), 
-                                 0, 
-                                 reinterpret_cast< void* >( Frequency_ + realFFTSamples ), 
-                                 &kissMemLength );
+    // The low band is processed once for every hop of decimated frames, so it gets its own smoothing.
+    LowBandSmoothing_ = 1.0f - powf( 1.0f - periodSmoothing, hopFraction );
 
-        float angleScale = static_cast< float >( M_PI * 2.0f ) / ( samplesPerPeriod - 1 );
+    if ( Bucketing_ != FrequencyBucketing::PEAK_BINS )
+    {
+        // Only filters that end under the crossover come from the low band, the same filters on finer bins.
+        for ( LowBandBuckets_ = 0; LowBandBuckets_ < BucketCount_ && BucketEdges_[ LowBandBuckets_ + 2 ] <= crossover; ++LowBandBuckets_ );
 
-        // pre-calculate hamming window weights.
-        for ( uint32_t windowPosition = 0; windowPosition < samplesPerPeriod; ++windowPosition )
-        {
-            Window_[ windowPosition ] = HAMMING_ALPHA - HAMMING_BETA * cosf( angleScale * static_cast< float >( windowPosition ) );
-        }
+        return LowBandBuckets_ == 0 || LowBandFilterbank_.Initialize( BucketEdges_, LowBandBuckets_, lowBinFrequency, lowBinCount, FilterbankPowerScale() );
+    }
 
-        float inverseMaxRelevantFrequency = 1.0f / ( minBinFrequency * ( RelevantBins_ - 2 ) );
+    // Only buckets that fit entirely under the crossover come from the low band.
+    for ( LowBandBuckets_ = 0; 
+          LowBandBuckets_ < BucketCount_ && BucketUpperFrequency( LowBandBuckets_, BucketCount_, minBinFrequency, inverseMaxRelevantFrequency ) <= crossover; 
+          ++LowBandBuckets_ );
 
-        // skip over DC
-        for ( uint32_t bin = 1; bin < RelevantBins_; ++bin )
-        {
-            float binFrequency        = bin * minBinFrequency;
+    uint32_t bin = static_cast< uint32_t >( ceilf( MIN_LOW_BAND_FREQUENCY / lowBinFrequency ) );
 
-            // uses a gamma like bucket allocation.
-            uint32_t bucket = 
-                static_cast< uint32_t >( roundf( sqrtf( ( binFrequency - minBinFrequency ) * inverseMaxRelevantFrequency ) * ( FREQUENCY_BUCKETS - 1 ) ) );
+    // Same bucket curve as the full band, just with finer bins.
+    for ( uint32_t bucket = 0; bucket < LowBandBuckets_; ++bucket )
+    {
+        float upperFrequency = BucketUpperFrequency( bucket, BucketCount_, minBinFrequency, inverseMaxRelevantFrequency );
 
-            BucketMapping_[ bin - 1 ]   = bucket;
-            BucketRange_[ bucket ][ 0 ] = binFrequency < BucketRange_[ bucket ][ 0 ] ? binFrequency : BucketRange_[ bucket ][ 0 ];
-            BucketRange_[ bucket ][ 1 ] = binFrequency > BucketRange_[ bucket ][ 1 ] ? binFrequency : BucketRange_[ bucket ][ 1 ];
-        }
+        LowBandBoundaries_[ bucket ] = bin;
 
-        Smoothing_ = powf( SMOOTHING_RATE, minBinFrequency / DEFAULT_SMOOTHING_FREQUENCY );
+        for ( ; bin * lowBinFrequency < upperFrequency; ++bin );
+
+        LowBandBoundaries_[ bucket + 1 ] = bin;
+        BucketRange_[ bucket ][ 0 ]      = LowBandBoundaries_[ bucket ] * lowBinFrequency;
+        BucketRange_[ bucket ][ 1 ]      = ( bin - 1 ) * lowBinFrequency;
     }
 
-    toUpdate.NoiseFloorDbSPL = NOISE_FLOOR;
-    toUpdate.SoundSampleRate = static_cast<float>( Capture_.SampleRate() );
-    toUpdate.SoundSamples    = static_cast<float>( Capture_.SamplesPerPeriod() );
+    return true;
+}
+
+void AudioProcessing::UpdateLowBand( PerFrameConstants& toUpdate )
+{
+    size_t   samplesPerPeriod = Source_->SamplesPerPeriod();
+    uint64_t windowEnd        = Source_->WindowEndCursor();
 
-    for ( uint32_t bucket = 0; bucket < FREQUENCY_BUCKETS; ++bucket )
+    // Feed everything since the last window, if windows were skipped or the source restarted
+    // only what's still in the window can be used.
+    uint64_t newFrames = windowEnd > LowBandInputCursor_ ? windowEnd - LowBandInputCursor_ : windowEnd;
+
+    newFrames           = newFrames > samplesPerPeriod ? samplesPerPeriod : newFrames;
+    LowBandInputCursor_ = windowEnd;
+
+    size_t offset   = samplesPerPeriod - static_cast< size_t >( newFrames );
+    size_t produced = Decimator_.Process( Source_->GetChannel( 0 ) + offset, 
+                                          Source_->GetChannel( 1 ) + offset, 
+                                          static_cast< size_t >( newFrames ), 
+                                          Decimated_[ 0 ], 
+                                          Decimated_[ 1 ] );
+
+    for ( size_t frame = 0; frame < produced; ++frame, ++LowBandCursor_ )
     {
-        toUpdate.SoundFrequencyBuckets[ bucket ][ 0 ] = NOISE_FLOOR;
-        toUpdate.SoundFrequencyBuckets[ bucket ][ 1 ] = NOISE_FLOOR;
-        toUpdate.SoundFrequencyBuckets[ bucket ][ 2 ] = BucketRange_[ bucket ][ 0 ];
-        toUpdate.SoundFrequencyBuckets[ bucket ][ 3 ] = BucketRange_[ bucket ][ 1 ];
+        size_t where = LowBandCursor_ & ( samplesPerPeriod - 1 );
+
+        LowBand_[ 0 ][ where ] = LowBand_[ 0 ][ where + samplesPerPeriod ] = Decimated_[ 0 ][ frame ];
+        LowBand_[ 1 ][ where ] = LowBand_[ 1 ][ where + samplesPerPeriod ] = Decimated_[ 1 ][ frame ];
     }
 
-    return result;
+    LowBandPending_ += produced;
+
+    if ( LowBandCursor_ >= samplesPerPeriod && LowBandPending_ >= Source_->HopSamples() )
+    {
+        LowBandPending_ = 0;
+
+        ProcessLowBand( toUpdate );
+    }
 }
 
-AudioUpdateResult AudioProcessing::Update( PerFrameConstants& toUpdate )
+void AudioProcessing::ProcessLowBand( PerFrameConstants& toUpdate )
 {
-    AudioUpdateResult result = Capture_.PullAudio();
+    size_t       samplesPerPeriod = Source_->SamplesPerPeriod();
+    size_t       windowStart      = LowBandCursor_ & ( samplesPerPeriod - 1 );
+    const float* left             = LowBand_[ 0 ] + windowStart;
+    const float* right            = LowBand_[ 1 ] + windowStart;
 
-    if ( result == AudioUpdateResult::UPDATED )
+    for ( size_t frame = 0; frame < samplesPerPeriod; ++frame )
     {
-        ProcessChannel( toUpdate, 0 );
-        ProcessChannel( toUpdate, 1 );
+        Windowed_[ frame * 2 ]     = left[ frame ] * Window_[ frame ];
+        Windowed_[ frame * 2 + 1 ] = right[ frame ] * Window_[ frame ];
     }
 
-    toUpdate.SoundSampleRate = static_cast<float>( Capture_.SampleRate() );
-    toUpdate.SoundSamples    = static_cast<float>( Capture_.SamplesPerPeriod() );
+    FFT_->Forward( reinterpret_cast< const kiss_fft_cpx* >( Windowed_ ), Packed_ );
 
-    for ( uint32_t bucket = 0; bucket < FREQUENCY_BUCKETS; ++bucket )
+    uint32_t fftSize              = static_cast< uint32_t >( samplesPerPeriod );
+    float    normalization        = 1.0f / ( ( fftSize / 2 ) + 1 );
+    float    normalizationSquared = normalization * normalization;
+
+    float bucketPower[ 2 * FREQUENCY_BUCKETS ];
+    float leftPower;
+    float rightPower;
+
+    // Only the bottom bins are needed, so split the stereo spectrum on the fly.
+    if ( Bucketing_ != FrequencyBucketing::PEAK_BINS )
     {
-        toUpdate.SoundFrequencyBuckets[ bucket ][ 2 ] = BucketRange_[ bucket ][ 0 ];
-        toUpdate.SoundFrequencyBuckets[ bucket ][ 3 ] = BucketRange_[ bucket ][ 1 ];
+        for ( uint32_t bin = 0; bin < LowBandFilterbank_.BinsUsed(); ++bin )
+        {
+            SplitBinPower( Packed_, fftSize, bin, normalizationSquared, leftPower, rightPower );
+
+            LowBandPower_[ bin ]                       = leftPower;
+            LowBandPower_[ LowBandPowerStride_ + bin ] = rightPower;
+        }
+
+        LowBandFilterbank_.Apply( *Kernels_, LowBandPower_, LowBandPowerStride_, bucketPower );
     }
+    else
+    {
+        for ( uint32_t bucket = 0; bucket < LowBandBuckets_; ++bucket )
+        {
+            float maxLeft  = 0.0f;
+            float maxRight = 0.0f;
 
+            for ( uint32_t bin = LowBandBoundaries_[ bucket ]; bin < LowBandBoundaries_[ bucket + 1 ]; ++bin )
+            {
+                SplitBinPower( Packed_, fftSize, bin, normalizationSquared, leftPower, rightPower );
 
-    return result;
+                maxLeft  = leftPower > maxLeft ? leftPower : maxLeft;
+                maxRight = rightPower > maxRight ? rightPower : maxRight;
+            }
+
+            bucketPower[ bucket ]                   = maxLeft;
+            bucketPower[ LowBandBuckets_ + bucket ] = maxRight;
+        }
+    }
+
+    for ( uint32_t bucket = 0; bucket < LowBandBuckets_; ++bucket )
+    {
+        for ( uint32_t channel = 0; channel < 2; ++channel )
+        {
+            float bucketValue = 0.5f * DBSPL_SCALE * log10f( bucketPower[ channel * LowBandBuckets_ + bucket ] );
+
+            bucketValue = ( bucketValue > NOISE_FLOOR ? bucketValue : NOISE_FLOOR );
+
+            toUpdate.SoundFrequencyBuckets[ bucket ][ channel ] += ( bucketValue - toUpdate.SoundFrequencyBuckets[ bucket ][ channel ] ) * LowBandSmoothing_;
+        }
+    }
 }
 
-void AudioProcessing::ProcessChannel( PerFrameConstants& toUpdate, uint32_t channel ) 
+void AudioProcessing::ProcessWindow( PerFrameConstants& toUpdate ) 
 {
-    const float* channelData = Capture_.GetChannel( channel );
-    size_t samplesPerPeriod  = Capture_.SamplesPerPeriod();
+    size_t   samplesPerPeriod = Source_->SamplesPerPeriod();
+    uint32_t binCount         = ( static_cast< uint32_t >( samplesPerPeriod ) / 2 ) + 1;
+    uint32_t mainBuckets      = BucketCount_ - LowBandBuckets_;
+    float    sumSquares[ 2 ];
+    float    bucketPower[ 2 * FREQUENCY_BUCKETS ];
+
+    if ( TimeStages_ )
+    {
+        StageMark_ = ProfileTimestamp();
+    }
 
-    float channelMS = 0;
+    // Mono sources duplicate the channel, so there's no point transforming it twice.
+    bool  isMono        = Source_->IsMono();
+    float normalization = isMono ? TransformMono( sumSquares ) : TransformStereo( sumSquares );
 
-    for ( uint32_t frame = 0, numberSamples = static_cast< uint32_t >( samplesPerPeriod );
-          frame < numberSamples;
-          ++frame )
+    MarkStage( AudioStage::FFT );
+
+    // Normalization is folded into the magnitude/power calculation, so the bins are only read once.
+    if ( Bucketing_ == FrequencyBucketing::PEAK_BINS )
     {
-        float channelFrameValue = channelData[ frame ];
+        Kernels_->SpectrumStereo( Frequency_[ 0 ],
+                                  Frequency_[ isMono ? 0 : 1 ],
+                                  binCount,
+                                  normalization,
+                                  BucketBoundaries_ + LowBandBuckets_,
+                                  mainBuckets,
+                                  AudioTextureData_,
+                                  bucketPower );
+    }
+    else
+    {
+        Kernels_->SpectrumPower( Frequency_[ 0 ], Frequency_[ isMono ? 0 : 1 ], binCount, normalization, AudioTextureData_, Power_, PowerStride_ );
 
-        channelMS                                   += channelFrameValue * channelFrameValue;
-        Intermediate_[ frame ]                       = channelFrameValue * Window_[ frame ];
-        AudioTextureData_[ frame * 4 + channel ]     = channelFrameValue;
-        AudioTextureData_[ frame * 4 + channel + 2 ] = 0;
+        if ( mainBuckets > 0 )
+        {
+            Filterbank_.Apply( *Kernels_, Power_, PowerStride_, bucketPower );
+        }
     }
 
-    float inverseSamples = 1.0f / static_cast< float >( Capture_.SamplesPerPeriod() );
+    MarkStage( AudioStage::SPECTRUM );
 
-    channelMS *= inverseSamples;
+    float inverseSamples = 1.0f / static_cast< float >( samplesPerPeriod );
 
-    toUpdate.SoundRMS[ channel ] += ( sqrtf( channelMS ) - toUpdate.SoundRMS[ channel ] ) * Smoothing_;
+    for ( uint32_t channel = 0; channel < 2; ++channel )
+    {
+        float channelMS = sumSquares[ channel ] * inverseSamples;
 
-    float soundDbSPL = DBSPL_SCALE * log10f( toUpdate.SoundRMS[ channel ] );
+        toUpdate.SoundRMS[ channel ] += ( sqrtf( channelMS ) - toUpdate.SoundRMS[ channel ] ) * Smoothing_;
 
-    toUpdate.SoundRMSdbSPL[ channel ] += soundDbSPL > NOISE_FLOOR ? soundDbSPL : NOISE_FLOOR;
+        float soundDbSPL = DBSPL_SCALE * log10f( toUpdate.SoundRMS[ channel ] );
 
-    kiss_fftr( Kiss_, Intermediate_, Frequency_ );
+        toUpdate.SoundRMSdbSPL[ channel ] = soundDbSPL > NOISE_FLOOR ? soundDbSPL : NOISE_FLOOR;
 
-    uint32_t binCount = ( static_cast< uint32_t >( Capture_.SamplesPerPeriod() ) / 2 ) + 1;
+        for ( uint32_t bucket = LowBandBuckets_; bucket < BucketCount_; ++bucket )
+        {
+            // power, so half the scale of amplitude; empty or silent buckets give -inf and clamp to the floor.
+            float bucketValue = 0.5f * DBSPL_SCALE * log10f( bucketPower[ channel * mainBuckets + bucket - LowBandBuckets_ ] );
 
-    float normalizationFactor = 2.0f / binCount;
+            bucketValue = ( bucketValue > NOISE_FLOOR ? bucketValue : NOISE_FLOOR );
 
-    for ( uint32_t bin = 0; bin < binCount; ++bin )
-    {
-        Frequency_[ bin ].r                        *= normalizationFactor;
-        Frequency_[ bin ].i                        *= normalizationFactor;
-        AudioTextureData_[ bin * 4 + channel + 2 ]  = sqrtf( Frequency_[ bin ].r * Frequency_[ bin ].r * + Frequency_[ bin ].i * Frequency_[ bin ].i );
+            toUpdate.SoundFrequencyBuckets[ bucket ][ channel ] += ( bucketValue - toUpdate.SoundFrequencyBuckets[ bucket ][ channel ] ) * Smoothing_;
+        }
     }
 
-    float buckets[ FREQUENCY_BUCKETS ];
+    MarkStage( AudioStage::SMOOTHING );
 
-    for ( uint32_t bucket = 0; bucket < FREQUENCY_BUCKETS; ++bucket )
-    {
-        buckets[ bucket ] = -FLT_MAX;
-    }
+    Onsets_.Update( AudioTextureData_, Source_->WindowEndCursor(), toUpdate );
+
+    MarkStage( AudioStage::ONSETS );
 
-    for ( uint32_t bin = 1; bin < RelevantBins_; ++bin )
+    Loudness_.Update( Source_->GetChannel( 0 ), Source_->GetChannel( isMono ? 0 : 1 ), samplesPerPeriod, Source_->WindowEndCursor(), toUpdate );
+
+    MarkStage( AudioStage::LOUDNESS );
+
+    if ( LowBandBuckets_ > 0 )
     {
-        uint32_t bucketMapping    = BucketMapping_[ bin - 1 ];
-        float    amplitudeSquared = Frequency_[ bin ].r * Frequency_[ bin ].r + Frequency_[ bin ].i * Frequency_[ bin ].i;
-        float    bucketValue      = buckets[ bucketMapping ];
+        UpdateLowBand( toUpdate );
 
-        buckets[ bucketMapping ] = amplitudeSquared > bucketValue ? amplitudeSquared : bucketValue;
+        MarkStage( AudioStage::LOW_BAND );
     }
 
-    for ( uint32_t bucket = 0; bucket < FREQUENCY_BUCKETS; ++bucket )
+    if ( TextureFormat_ == SoundTextureFormat::HALF )
     {
-        float bucketValue = buckets[ bucket ];
-        
-        bucketValue = 0.5f * DBSPL_SCALE * log10f( bucketValue );
-        bucketValue = ( bucketValue > NOISE_FLOOR ? bucketValue : NOISE_FLOOR );
+        Kernels_->FloatToHalf( AudioTextureData_, samplesPerPeriod * 4, AudioTextureHalf_ );
 
-        toUpdate.SoundFrequencyBuckets[ bucket ][ channel ] += ( bucketValue - toUpdate.SoundFrequencyBuckets[ bucket ][ channel ] ) * Smoothing_;
+        MarkStage( AudioStage::TEXTURE );
     }
 }
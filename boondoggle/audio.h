@@ -1,76 +1,112 @@
-#ifndef BOONDOGGLE_AUDIO_CAPTURE_H__
-#define BOONDOGGLE_AUDIO_CAPTURE_H__
+#ifndef BOONDOGGLE_AUDIO_H__
+#define BOONDOGGLE_AUDIO_H__
 
 #pragma once
 
 #include <stdint.h>
 #include "shared_render_constants.h"
-#include "../external/kissfft/kiss_fftr.h"
+#include "audio_source.h"
+#include "audio_kernels.h"
+#include "audio_fft.h"
+#include "audio_decimator.h"
+#include "audio_onset.h"
+#include "audio_loudness.h"
+#include "audio_filterbank.h"
+#include "latency_stats.h"
+#include "../common/arena_allocator.h"
 
-struct IAudioClient;
-struct IMMDevice;
-struct IAudioRenderClient;
-struct IAudioCaptureClient;
+// Formats the sound texture can be produced in, both in the AudioTextureData layout.
+enum class SoundTextureFormat : uint32_t
+{
+    FLOAT32 = 0, // RGBA32F, 16 bytes a texel.
+    HALF    = 1  // RGBA16F, 8 bytes a texel, half the upload for 3 significant digits.
+};
 
-enum class AudioUpdateResult
+// Bytes per texel of a sound texture format.
+inline size_t SoundTexelBytes( SoundTextureFormat format )
 {
-    UPDATED = 0,
-    NOT_UPDATED = 1,
-    AUDIO_ERROR = 2
+    return format == SoundTextureFormat::HALF ? sizeof( uint16_t ) * 4 : sizeof( float ) * 4;
+}
+
+// Stages of processing a window, for timing them.
+enum class AudioStage : uint32_t
+{
+    WINDOW    = 0, // window the period and fill in the texture samples.
+    FFT       = 1, // transform and split the spectrum into channels.
+    SPECTRUM  = 2, // magnitudes and bucketing, one fused pass over the bins.
+    SMOOTHING = 3, // RMS and bucket dB, smoothed into the constants.
+    ONSETS    = 4,
+    LOUDNESS  = 5, // K-weighting and the loudness blocks.
+    LOW_BAND  = 6,
+    TEXTURE   = 7, // conversion of the texture to its format.
+    COUNT     = 8
 };
 
-// Captures audio from the default device.
-class AudioCapture
+// Settings for the audio processing pipeline.
+struct AudioProcessingSettings
 {
-public:
-    
-    AudioCapture();
+    // Samples between each analysis of the (period length) window, must be a power of two 
+    // no bigger than the period. Smaller hops give lower latency at the same frequency resolution.
+    // 0 analyzes each period once, with no overlap.
+    uint32_t HopSamples;
 
-    ~AudioCapture();
+    // Instruction set for the processing kernels, AUTO picks the best supported.
+    AudioInstructionSet Kernels;
 
-    // Initialize audio capture with a required "base frequency" that is the 
-    // minimum frequency we need to capture in an audio update.
-    bool Initialize( uint32_t requiredFrequency );
+    // FFT implementation to use for the transforms.
+    FFTImplementation FFT;
 
-    // We've filled enough buffer for another period.
-    AudioUpdateResult PullAudio();
+    // Multi-resolution mode. When 2 or more, the audio is also low-passed and decimated by this
+    // factor and analyzed with a window this many times longer, which is used for the buckets that
+    // fit below the decimated band. Bass buckets get this many times finer bins, without making
+    // the main window (and its latency) any longer. 0 analyzes everything with the main window.
+    uint32_t LowBandDecimation;
 
-    // The sample rate of the audio.
-    uint32_t SampleRate() const { return SampleRate_; }
+    // Format of the sound texture (AudioTexture), the float AudioTextureData is always there too.
+    SoundTextureFormat TextureFormat;
 
-    // Number of samples in an individual period.
-    size_t SamplesPerPeriod() const { return BufferSize_ >> 1; }
+    // Rate to resample the source to before analysis, so the period, bins and buckets are the same on every device
+    // (and a 192 kHz device doesn't need 4 times the FFT). 0 analyzes at the source's own rate.
+    uint32_t AnalysisRate;
 
-    // Get left=0 or right=1 channel (always stereo)
-    const float* GetChannel( uint32_t channel ) const 
-    {
-        uint64_t innerCursor    = Cursor_ & (BufferSize_ - 1);
-        size_t   halfBufferSize = BufferSize_ >> 1;
-        size_t   offset         = (innerCursor < halfBufferSize) ? halfBufferSize : 0;
+    // Most windows to analyze in one Update when audio has built up (after a stall), oldest first, so smoothing and
+    // onsets see every hop. Whatever is left over is analyzed on later updates, up to about a third of a second
+    // behind. 0 only analyzes the latest window, skipping any before it.
+    uint32_t CatchUpWindows;
 
-        return Channels_[ channel ] + offset;
-    }
+    // How the spectrum is split into the frequency buckets. The triangular filterbanks (MEL, BARK, CUSTOM) sum
+    // the power under each filter, so buckets follow the energy in their band rather than its loudest bin.
+    FrequencyBucketing Bucketing;
 
-private:
+    // Buckets to analyze, at most FREQUENCY_BUCKETS (the room in the constants), 0 for DEFAULT_FREQUENCY_BUCKETS.
+    // Any buckets past this stay at the noise floor.
+    uint32_t BucketCount;
 
-    uint64_t             Cursor_;
-    uint64_t             LastReadCursor_;
-    IMMDevice*           Device_;
-    IAudioClient*        SilenceClient_;
-    IAudioClient*        CaptureClient_;
-    IAudioRenderClient*  SilenceRender_;
-    IAudioCaptureClient* Capture_;
-    float*               Channels_[ 2 ];
-    size_t               BufferSize_; // must be power of two
-    uint32_t             SampleRate_;
-    uint32_t             SilenceFrameCount_;
-    uint32_t             NumberChannelsSilence_;
-    uint32_t             NumberChannelsCapture_;
+    // For CUSTOM bucketing, BucketCount + 2 ascending frequencies in Hz (bucket n rises from edge n, peaks at
+    // edge n + 1 and falls to edge n + 2), copied on Initialize.
+    const float* BucketEdges;
 
+    // Time each stage of processing (see StageNanoseconds), for benchmarking. Off, it costs nothing.
+    bool TimeStages;
+
+    AudioProcessingSettings() : 
+        HopSamples( 0 ), 
+        Kernels( AudioInstructionSet::AUTO ), 
+        FFT( FFTImplementation::SPECIALIZED ), 
+        LowBandDecimation( 0 ),
+        TextureFormat( SoundTextureFormat::FLOAT32 ),
+        AnalysisRate( 0 ),
+        CatchUpWindows( 0 ),
+        Bucketing( FrequencyBucketing::PEAK_BINS ),
+        BucketCount( 0 ),
+        BucketEdges( nullptr ),
+        TimeStages( false )
+    {
+    }
 };
 
-// Audio processing - uses AudioCapture to capture audio, then runs it through
-// our processing pipeline to get values for visualization.
+// Audio processing - pulls audio from an AudioSource (live capture, a file or a pipe),
+// then runs it through our processing pipeline to get values for visualization.
 class AudioProcessing
 {
 public:
@@ -79,35 +115,154 @@ public:
 
     ~AudioProcessing();
 
-    // Initialize this - and populate the appropriate visualization constants.
-    bool Initialize( PerFrameConstants& toUpdate );
+    // Initialize this with the source to pull audio from - and populate the appropriate visualization constants.
+    // The source is initialized by this call and must outlive the processing.
+    bool Initialize( AudioSource& source, const AudioProcessingSettings& settings, PerFrameConstants& toUpdate );
+
+    // The source audio is being pulled from.
+    const AudioSource& Source() const { return *Source_; }
 
     // Number of samples in a period for processing.
-    size_t SamplesPerPeriod() const { return Capture_.SamplesPerPeriod(); }
+    size_t SamplesPerPeriod() const { return Source_->SamplesPerPeriod(); }
 
     // The data to be put in an audio texture
     // left and right channels in [0] and [1], left and right FFT amplitudes in [2] and [3].
     // Note, we don't care about phases really here.
     const float* AudioTextureData() const { return AudioTextureData_; }
 
+    // The sound texture data in the TextureFormat to upload, SamplesPerPeriod texels.
+    const void* AudioTexture() const 
+    { 
+        return TextureFormat_ == SoundTextureFormat::HALF ? static_cast< const void* >( AudioTextureHalf_ ) : AudioTextureData_; 
+    }
+
+    // Format of AudioTexture.
+    SoundTextureFormat TextureFormat() const { return TextureFormat_; }
+
+    // Size of AudioTexture in bytes.
+    size_t AudioTextureBytes() const { return SamplesPerPeriod() * SoundTexelBytes( TextureFormat_ ); }
+
     // Attempt to update the per-frame constants from the audio processing.
     // Will indicate if any processing occured of if there was an error in the return value.
+    // When catching up, several windows can be processed, the constants and texture are from the last.
     AudioUpdateResult Update( PerFrameConstants& toUpdate );
 
+    // The instruction set the processing kernels are using.
+    AudioInstructionSet InstructionSet() const { return Kernels_->InstructionSet; }
+
+    // Number of buckets (from the bottom) that come from the decimated low band, 0 if it's off.
+    uint32_t LowBandBuckets() const { return LowBandBuckets_; }
+
+    // The FFT implementation actually in use (the specialized engine falls back to kiss for some sizes).
+    FFTImplementation FFTUsed() const { return FFT_->Implementation(); }
+
+    // Windows processed by the last update.
+    uint32_t WindowsProcessed() const { return WindowsProcessed_; }
+
+    // When the window from the last update was captured, pulled and processed.
+    const AudioTimestamps& Timestamps() const { return Timestamps_; }
+
+    // The fraction of the way the RMS and buckets move to the latest window's values each update.
+    float Smoothing() const { return Smoothing_; }
+
+    // Frequency buckets in use, the rest of the constants' buckets are left at the noise floor.
+    uint32_t BucketCount() const { return BucketCount_; }
+
+    FrequencyBucketing Bucketing() const { return Bucketing_; }
+
+    // Low and high frequency in Hz of each of the FREQUENCY_BUCKETS buckets (0 for buckets not in use), laid out
+    // two buckets to a float4 like the bucket values. They're fixed on Initialize, so they aren't in the per frame constants.
+    const float* BucketRanges() const { return &BucketRange_[ 0 ][ 0 ]; }
+
+    // The filterbank for the buckets from the main window (after the low band's), null for PEAK_BINS bucketing.
+    const Filterbank* BucketFilterbank() const { return Bucketing_ != FrequencyBucketing::PEAK_BINS ? &Filterbank_ : nullptr; }
+
+    // The loudness meter, for its K-weighting response.
+    const LoudnessMeter& Loudness() const { return Loudness_; }
+
+    // Total time spent in a stage over all the windows processed, when TimeStages is set.
+    uint64_t StageNanoseconds( AudioStage stage ) const { return StageNanoseconds_[ static_cast< uint32_t >( stage ) ]; }
+
 private:
 
-    void ProcessChannel( PerFrameConstants& toUpdate, uint32_t channel );
-
-    AudioCapture  Capture_;
-    kiss_fftr_cfg Kiss_;
-    float*        Window_;
-    float*        Intermediate_;
-    kiss_fft_cpx* Frequency_;
-    uint32_t*     BucketMapping_;
-    float*        AudioTextureData_;
-    uint32_t      RelevantBins_; // the number of relevant frequency bins for bucketing.
-    float         BucketRange_[ FREQUENCY_BUCKETS ][ 2 ];
-    float         Smoothing_;
+    // Add the time since the last mark to a stage, when timing stages.
+    void MarkStage( AudioStage stage )
+    {
+        if ( TimeStages_ )
+        {
+            uint64_t now = ProfileTimestamp();
+
+            StageNanoseconds_[ static_cast< uint32_t >( stage ) ] += now - StageMark_;
+            StageMark_                                             = now;
+        }
+    }
+
+    // Process the latest window for both channels.
+    void ProcessWindow( PerFrameConstants& toUpdate );
+
+    // Window and transform both channels with a single complex FFT, returns the normalization for the bins.
+    float TransformStereo( float* sumSquares );
+
+    // Window and transform when both channels are the same, returns the normalization for the bins.
+    float TransformMono( float* sumSquares );
+
+    // Work out the bucket edges for a filterbank bucketing and their ranges, returns false if the settings are invalid.
+    bool InitializeBucketEdges( const AudioProcessingSettings& settings, float minBinFrequency );
+
+    // Power gain of a filterbank applied to the windowed bins, so a steady tone reads the power of the bin it's on
+    // after summing its leakage into the bins around it (1 over the equivalent noise bandwidth of the window).
+    float FilterbankPowerScale() const;
+
+    // Set up the decimated low band and work out which buckets it covers.
+    bool InitializeLowBand( uint32_t decimation, float periodSmoothing );
+
+    // Feed the new audio since the last update into the low band and process it if it's due.
+    void UpdateLowBand( PerFrameConstants& toUpdate );
+
+    // Transform the low band window and update the buckets it covers.
+    void ProcessLowBand( PerFrameConstants& toUpdate );
+
+    ArenaAllocator      Memory_; // the window, spectrum, texture and low band buffers.
+    AudioSource*        Source_;
+    const AudioKernels* Kernels_;
+    FFTEngine*          FFT_;
+    float*              Window_;
+    float*              Windowed_; // interleaved left/right for stereo, just the one channel for mono.
+    kiss_fft_cpx*       Packed_; // complex spectrum of both channels before they are split.
+    kiss_fft_cpx*       Frequency_[ 2 ];
+    float*              AudioTextureData_;
+    uint16_t*           AudioTextureHalf_; // half precision copy of the texture data, when that's the format.
+    SoundTextureFormat  TextureFormat_;
+    uint32_t            RelevantBins_; // the number of relevant frequency bins for bucketing.
+    uint32_t            BucketBoundaries_[ FREQUENCY_BUCKETS + 1 ]; // bucket n is the bins [ boundary n, boundary n + 1 ).
+    float               BucketRange_[ FREQUENCY_BUCKETS ][ 2 ];
+    FrequencyBucketing  Bucketing_;
+    uint32_t            BucketCount_;
+    float               BucketEdges_[ FREQUENCY_BUCKETS + 2 ]; // filterbank edges in Hz, see AudioProcessingSettings::BucketEdges.
+    Filterbank          Filterbank_; // buckets from the main window.
+    float*              Power_; // power of the main window's bins for the filterbank, left then right.
+    size_t              PowerStride_;
+    float               Smoothing_;
+    StereoDecimator     Decimator_;
+    float*              LowBand_[ 2 ]; // mirrored ring of decimated audio per channel, like AudioSource.
+    float*              Decimated_[ 2 ]; // output of the decimator for an update.
+    uint64_t            LowBandCursor_; // decimated frames written to the low band.
+    uint64_t            LowBandInputCursor_; // source frames fed through the decimator.
+    uint64_t            LowBandPending_; // decimated frames since the low band was last processed.
+    uint32_t            LowBandBuckets_;
+    uint32_t            LowBandBoundaries_[ FREQUENCY_BUCKETS + 1 ]; // low band bins for each bucket it covers.
+    float               LowBandSmoothing_;
+    Filterbank          LowBandFilterbank_;
+    float*              LowBandPower_;
+    size_t              LowBandPowerStride_;
+    OnsetTracker        Onsets_;
+    LoudnessMeter       Loudness_;
+    AudioTimestamps     Timestamps_;
+    uint32_t            CatchUpWindows_;
+    uint32_t            WindowsProcessed_;
+    bool                TimeStages_;
+    uint64_t            StageMark_;
+    uint64_t            StageNanoseconds_[ static_cast< uint32_t >( AudioStage::COUNT ) ];
 };
 
-#endif // -- BOONDOGGLE_AUDIO_CAPTURE_H__
\ No newline at end of file
+#endif // -- BOONDOGGLE_AUDIO_H__
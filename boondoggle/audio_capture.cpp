@@ -0,0 +1,337 @@
+#include "audio_capture.h"
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include "../common/boondoggle_helpers.h"
+
+AudioCapture::AudioCapture() :
+    Device_( nullptr ),
+    SilenceClient_( nullptr ),
+    CaptureClient_( nullptr ),
+    SilenceRender_( nullptr ),
+    Capture_( nullptr ),
+    SilenceFrameCount_( 0 ),
+    NumberChannelsCapture_( 0 ),
+    NumberChannelsSilence_( 0 ),
+    ComInitialized_( false )
+{
+}
+
+AudioCapture::~AudioCapture()
+{
+    if ( SilenceClient_ != nullptr )
+    {
+        SilenceClient_->Stop();
+    }
+
+    if ( CaptureClient_ != nullptr )
+    {
+        CaptureClient_->Stop();
+    }
+
+    COMRelease( Device_ );
+    COMRelease( SilenceClient_ );
+    COMRelease( CaptureClient_ );
+    COMRelease( Capture_ );
+    COMRelease( SilenceRender_ );
+
+    if ( ComInitialized_ )
+    {
+        CoUninitialize();
+    }
+}
+
+bool AudioCapture::Initialize( uint32_t requiredFrequency )
+{
+    // If this thread is already in an apartment that's fine, we just don't own it.
+    if ( !ComInitialized_ )
+    {
+        ComInitialized_ = SUCCEEDED( CoInitializeEx( nullptr, COINIT_MULTITHREADED ) );
+    }
+
+    COMAutoPtr< IMMDeviceEnumerator > deviceEnumerator;
+
+    HRESULT deviceEnumeratorResult =
+        CoCreateInstance( __uuidof( MMDeviceEnumerator ), 
+                          nullptr,
+                          CLSCTX_ALL,
+                          __uuidof( IMMDeviceEnumerator ),
+                          reinterpret_cast< void** >( &deviceEnumerator.raw ) );
+
+    if ( FAILED( deviceEnumeratorResult ) )
+    {
+        return false;
+    }
+
+    HRESULT defaultEndpointResult =
+        deviceEnumerator->GetDefaultAudioEndpoint( eRender, eConsole, &Device_ );
+
+    if ( FAILED( defaultEndpointResult ) )
+    {
+        return false;
+    }
+
+    HRESULT activateSilenceResult =
+        Device_->Activate( __uuidof( IAudioClient ), CLSCTX_ALL, nullptr, reinterpret_cast<void**>( &SilenceClient_ ) );
+
+    if ( FAILED( activateSilenceResult ) )
+    {
+        return false;
+    }
+
+    HRESULT activateCaptureResult =
+        Device_->Activate( __uuidof( IAudioClient ), CLSCTX_ALL, nullptr, reinterpret_cast<void**>( &CaptureClient_ ) );
+
+    if ( FAILED( activateCaptureResult ) )
+    {
+        return false;
+    }
+
+    WAVEFORMATEX* silenceWaveFormat;
+
+    HRESULT silentMixFormatResult =
+        SilenceClient_->GetMixFormat( &silenceWaveFormat );
+
+    if ( FAILED( silentMixFormatResult ) )
+    {
+        return false;
+    }
+
+    NumberChannelsSilence_ = silenceWaveFormat->nChannels;
+    
+    HRESULT silenceClientInitResult =
+        SilenceClient_->Initialize(
+            AUDCLNT_SHAREMODE_SHARED,
+            0,
+            0,
+            0,
+            silenceWaveFormat,
+            nullptr );
+
+    CoTaskMemFree( silenceWaveFormat );
+
+    if ( FAILED( silenceClientInitResult ) )
+    {
+        return false;
+    }
+    
+    HRESULT getRenderClientResult =
+        SilenceClient_->GetService(
+            __uuidof( IAudioRenderClient ),
+            reinterpret_cast< void** >( &SilenceRender_ ) );
+
+    if ( FAILED( getRenderClientResult ) )
+    {
+        return false;
+    }
+
+    WAVEFORMATEX* captureFormat;
+    
+    HRESULT captureMixFormatResult =
+        CaptureClient_->GetMixFormat( &captureFormat );
+
+    if ( FAILED( captureMixFormatResult ) )
+    {
+        return false;
+    }
+
+    NumberChannelsCapture_ = captureFormat->nChannels;
+
+    uint32_t channelMask = 0;
+
+    if ( captureFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE )
+    {
+        channelMask = reinterpret_cast< WAVEFORMATEXTENSIBLE* >( captureFormat )->dwChannelMask;
+    }
+
+    // Surround outputs get mixed down to stereo for analysis.
+    if ( !SetDownmixForLayout( NumberChannelsCapture_, channelMask ) )
+    {
+        CoTaskMemFree( captureFormat );
+        return false;
+    }
+    
+    // try and force float output on capture.
+    switch ( captureFormat->wFormatTag )
+    {
+    case WAVE_FORMAT_PCM:
+
+        captureFormat->wFormatTag      = WAVE_FORMAT_IEEE_FLOAT;
+        captureFormat->wBitsPerSample  = 32;
+        captureFormat->nBlockAlign     = captureFormat->nChannels * sizeof( float );
+        captureFormat->nAvgBytesPerSec = captureFormat->nBlockAlign * captureFormat->nBlockAlign;
+        break;
+
+    case WAVE_FORMAT_EXTENSIBLE:
+        {
+            WAVEFORMATEXTENSIBLE* extensible = reinterpret_cast<WAVEFORMATEXTENSIBLE*>( captureFormat );
+
+            if ( !IsEqualGUID( KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, extensible->SubFormat ) )
+            {
+                extensible->SubFormat                   = KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+                extensible->Samples.wValidBitsPerSample = 32;
+                captureFormat->wBitsPerSample           = 32;
+                captureFormat->nBlockAlign              = captureFormat->nChannels * sizeof( float );
+                captureFormat->nAvgBytesPerSec          = captureFormat->nBlockAlign * captureFormat->nBlockAlign;
+            }
+        }
+    }
+
+    if ( !InitializeBuffer( captureFormat->nSamplesPerSec, requiredFrequency ) )
+    {
+        CoTaskMemFree( captureFormat );
+        return false;
+    }
+
+    HRESULT captureInitResult =
+        CaptureClient_->Initialize(
+            AUDCLNT_SHAREMODE_SHARED,
+            AUDCLNT_STREAMFLAGS_LOOPBACK,
+            0,
+            0,
+            captureFormat,
+            nullptr );
+
+    CoTaskMemFree( captureFormat );
+
+    if ( FAILED( captureInitResult ) )
+    {
+        return false;
+    }
+
+    HRESULT getCaptureClientResult =
+        CaptureClient_->GetService(
+            __uuidof( IAudioCaptureClient ),
+            reinterpret_cast< void** >( &Capture_ ) );
+
+    if ( FAILED( getCaptureClientResult ) )
+    {
+        return false;
+    }
+
+    HRESULT silenceGetBufferSizeResult =
+        SilenceClient_->GetBufferSize( &SilenceFrameCount_ );
+
+    if ( FAILED( silenceGetBufferSizeResult ) )
+    {
+        return false;
+    }
+
+    BYTE* silenceData = nullptr;
+
+    HRESULT silenceGetBufferResult = 
+        SilenceRender_->GetBuffer( SilenceFrameCount_, &silenceData );
+
+    if ( FAILED( silenceGetBufferResult ) )
+    {
+        return false;
+    }
+
+    HRESULT silenceFillResult = 
+        SilenceRender_->ReleaseBuffer( SilenceFrameCount_, AUDCLNT_BUFFERFLAGS_SILENT );
+
+    if ( FAILED( silenceFillResult ) )
+    {
+        return false;
+    }
+
+    HRESULT silenceStartResult = SilenceClient_->Start();
+
+    if ( FAILED( silenceStartResult ) )
+    {
+        return false;
+    }
+
+    HRESULT captureStartResult = CaptureClient_->Start();
+
+    if ( FAILED( captureStartResult ) )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+AudioUpdateResult AudioCapture::PullAudio()
+{
+    uint32_t silencePadding   = 0;
+
+    HRESULT  getPaddingResult;
+    
+    for ( getPaddingResult = SilenceClient_->GetCurrentPadding( &silencePadding );
+          SUCCEEDED( getPaddingResult ) && SilenceFrameCount_ != silencePadding;
+          getPaddingResult = SilenceClient_->GetCurrentPadding( &silencePadding ) )
+    {
+        BYTE*   renderBuffer          = nullptr;
+        HRESULT getRenderBufferResult =
+            SilenceRender_->GetBuffer( SilenceFrameCount_ - silencePadding, &renderBuffer );
+
+        if ( FAILED( getRenderBufferResult ) )
+        {
+            return AudioUpdateResult::AUDIO_ERROR;
+        }
+
+        HRESULT releaseBufferRenderResult =
+            SilenceRender_->ReleaseBuffer( SilenceFrameCount_ - silencePadding, AUDCLNT_BUFFERFLAGS_SILENT );
+
+        if ( FAILED( releaseBufferRenderResult ) )
+        {
+            return AudioUpdateResult::AUDIO_ERROR;
+        }
+    }
+
+    if ( FAILED( getPaddingResult ) )
+    {
+        return AudioUpdateResult::AUDIO_ERROR;
+    }
+
+    HRESULT  getNextPacketResult;
+    uint32_t nextPacketSize = 0;
+
+    for ( getNextPacketResult = Capture_->GetNextPacketSize( &nextPacketSize );
+          SUCCEEDED( getNextPacketResult ) && nextPacketSize > 0;
+          getNextPacketResult = Capture_->GetNextPacketSize( &nextPacketSize ) )
+    {
+        BYTE* readBuffer;
+        uint32_t framesRead;
+        DWORD readFlags;
+        UINT64 qpcPosition = 0;
+
+        HRESULT getBufferResult = 
+            Capture_->GetBuffer(
+                &readBuffer,
+                &framesRead,
+                &readFlags,
+                nullptr,
+                &qpcPosition );
+
+        if ( FAILED( getBufferResult ) )
+        {
+            return AudioUpdateResult::AUDIO_ERROR;
+        }
+
+        if ( AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY == readFlags )
+        {
+            ResetCursor();
+        }
+
+        // The packet position is the performance counter in 100ns units, latency timestamps are microseconds.
+        uint64_t captureTimestamp = ( readFlags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR ) == 0 ? qpcPosition / 10 : 0;
+
+        WriteFrames( reinterpret_cast< const float* >( readBuffer ), framesRead, NumberChannelsCapture_, captureTimestamp );
+
+        HRESULT bufferReleaseResult = Capture_->ReleaseBuffer( framesRead );
+    
+        if ( FAILED( bufferReleaseResult ) )
+        {
+            return AudioUpdateResult::AUDIO_ERROR;
+        }
+    }
+
+    if ( FAILED( getNextPacketResult ) )
+    {
+        return AudioUpdateResult::AUDIO_ERROR;
+    }
+
+    return CheckForUpdate();
+}
@@ -0,0 +1,46 @@
+#ifndef BOONDOGGLE_AUDIO_CAPTURE_H__
+#define BOONDOGGLE_AUDIO_CAPTURE_H__
+
+#pragma once
+
+#include <stdint.h>
+#include "audio_source.h"
+
+struct IAudioClient;
+struct IMMDevice;
+struct IAudioRenderClient;
+struct IAudioCaptureClient;
+
+// Captures audio from the default device (WASAPI loopback).
+// Joins the multi-threaded COM apartment on the thread that initializes it, so PullAudio can be
+// called from any thread (like the audio thread) after that.
+class AudioCapture : public AudioSource
+{
+public:
+
+    AudioCapture();
+
+    ~AudioCapture();
+
+    // Initialize audio capture with a required "base frequency" that is the
+    // minimum frequency we need to capture in an audio update.
+    bool Initialize( uint32_t requiredFrequency ) override;
+
+    // We've filled enough buffer for another period.
+    AudioUpdateResult PullAudio() override;
+
+private:
+
+    IMMDevice*           Device_;
+    IAudioClient*        SilenceClient_;
+    IAudioClient*        CaptureClient_;
+    IAudioRenderClient*  SilenceRender_;
+    IAudioCaptureClient* Capture_;
+    uint32_t             SilenceFrameCount_;
+    uint32_t             NumberChannelsSilence_;
+    uint32_t             NumberChannelsCapture_;
+    bool                 ComInitialized_;
+
+};
+
+#endif // -- BOONDOGGLE_AUDIO_CAPTURE_H__
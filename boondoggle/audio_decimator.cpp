@@ -0,0 +1,166 @@
+#include "audio_decimator.h"
+#include "../common/boondoggle_helpers.h"
+#include <string.h>
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define AUDIO_DECIMATOR_SSE 1
+#include <emmintrin.h>
+#else
+#define AUDIO_DECIMATOR_SSE 0
+#endif
+
+namespace
+{
+    // Taps per unit of decimation. Blackman windowed sinc needs about 5.5 / transition width taps,
+    // and the transition band is 0.2 of the output nyquist (0.8 to 1.2, anything folding down from
+    // above 1.0 lands above 0.8 where we don't use it).
+    const uint32_t TAPS_PER_FACTOR = 28;
+}
+
+StereoDecimator::StereoDecimator() :
+    Taps_( nullptr ),
+    TapCount_( 0 ),
+    Factor_( 0 ),
+    Phase_( 0 ),
+    MaxInputFrames_( 0 )
+{
+    Lines_[ 0 ] = nullptr;
+    Lines_[ 1 ] = nullptr;
+}
+
+StereoDecimator::~StereoDecimator()
+{
+    AlignedFree( Taps_ );
+}
+
+bool StereoDecimator::Initialize( uint32_t factor, size_t maxInputFrames )
+{
+    if ( factor < 2 || maxInputFrames == 0 )
+    {
+        return false;
+    }
+
+    AlignedFree( Taps_ );
+
+    Factor_         = factor;
+    TapCount_       = TAPS_PER_FACTOR * factor + 1;
+    MaxInputFrames_ = maxInputFrames;
+
+    size_t lineLength = TapCount_ - 1 + maxInputFrames;
+
+    Taps_ = reinterpret_cast< float* >( AlignedAllocateZeroed( sizeof( float ) * ( TapCount_ + lineLength * 2 ), 16 ) );
+
+    if ( Taps_ == nullptr )
+    {
+        return false;
+    }
+
+    Lines_[ 0 ] = Taps_ + TapCount_;
+    Lines_[ 1 ] = Lines_[ 0 ] + lineLength;
+
+    double cutoff = 0.5 / factor; // cycles per input sample, the output nyquist.
+    double center = ( TapCount_ - 1 ) * 0.5;
+    double sum    = 0.0;
+
+    for ( uint32_t tap = 0; tap < TapCount_; ++tap )
+    {
+        double offset = tap - center;
+        double sinc   = offset == 0.0 ? 2.0 * cutoff : sin( 2.0 * M_PI * cutoff * offset ) / ( M_PI * offset );
+        double phase  = ( 2.0 * M_PI * tap ) / ( TapCount_ - 1 );
+        double window = 0.42 - 0.5 * cos( phase ) + 0.08 * cos( 2.0 * phase );
+
+        Taps_[ tap ]  = static_cast< float >( sinc * window );
+        sum          += sinc * window;
+    }
+
+    // unity gain at DC, so the low band levels match the full band.
+    for ( uint32_t tap = 0; tap < TapCount_; ++tap )
+    {
+        Taps_[ tap ] = static_cast< float >( Taps_[ tap ] / sum );
+    }
+
+    Reset();
+
+    return true;
+}
+
+void StereoDecimator::Reset()
+{
+    Phase_ = 0;
+
+    if ( Lines_[ 0 ] != nullptr )
+    {
+        ::memset( Lines_[ 0 ], 0, sizeof( float ) * ( TapCount_ - 1 ) );
+        ::memset( Lines_[ 1 ], 0, sizeof( float ) * ( TapCount_ - 1 ) );
+    }
+}
+
+size_t StereoDecimator::Process( const float* left, const float* right, size_t frameCount, float* outputLeft, float* outputRight )
+{
+    frameCount = frameCount > MaxInputFrames_ ? MaxInputFrames_ : frameCount;
+
+    size_t written = ProcessChannel( left, frameCount, Lines_[ 0 ], outputLeft );
+
+    ProcessChannel( right, frameCount, Lines_[ 1 ], outputRight );
+
+    if ( Phase_ >= frameCount )
+    {
+        Phase_ -= static_cast< uint32_t >( frameCount );
+    }
+    else
+    {
+        Phase_ = static_cast< uint32_t >( Phase_ + written * Factor_ - frameCount );
+    }
+
+    return written;
+}
+
+size_t StereoDecimator::ProcessChannel( const float* input, size_t frameCount, float* line, float* output ) const
+{
+    uint32_t history = TapCount_ - 1;
+    size_t   written = 0;
+
+    ::memcpy( line + history, input, sizeof( float ) * frameCount );
+
+    // The filter is symmetric, so there's no need to reverse the taps for the convolution.
+    for ( size_t frame = Phase_; frame < frameCount; frame += Factor_ )
+    {
+        const float* samples = line + frame;
+        uint32_t     tap     = 0;
+        float        sum     = 0.0f;
+
+#if AUDIO_DECIMATOR_SSE
+
+        // 2 accumulators to break the dependency chain.
+        __m128 sums[ 2 ] = { _mm_setzero_ps(), _mm_setzero_ps() };
+
+        for ( ; tap + 8 <= TapCount_; tap += 8 )
+        {
+            sums[ 0 ] = _mm_add_ps( sums[ 0 ], _mm_mul_ps( _mm_load_ps( Taps_ + tap ), _mm_loadu_ps( samples + tap ) ) );
+            sums[ 1 ] = _mm_add_ps( sums[ 1 ], _mm_mul_ps( _mm_load_ps( Taps_ + tap + 4 ), _mm_loadu_ps( samples + tap + 4 ) ) );
+        }
+
+        float lanes[ 4 ];
+
+        _mm_storeu_ps( lanes, _mm_add_ps( sums[ 0 ], sums[ 1 ] ) );
+
+        sum = ( lanes[ 0 ] + lanes[ 1 ] ) + ( lanes[ 2 ] + lanes[ 3 ] );
+
+#endif
+
+        for ( ; tap < TapCount_; ++tap )
+        {
+            sum += Taps_[ tap ] * samples[ tap ];
+        }
+
+        output[ written++ ] = sum;
+    }
+
+    ::memmove( line, line + frameCount, sizeof( float ) * history );
+
+    return written;
+}
@@ -0,0 +1,51 @@
+#ifndef BOONDOGGLE_AUDIO_DECIMATOR_H__
+#define BOONDOGGLE_AUDIO_DECIMATOR_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming low-pass FIR and decimation of a stereo signal, keeping filter history between calls
+// so the audio can be fed through in blocks of any size.
+class StereoDecimator
+{
+public:
+
+    StereoDecimator();
+
+    ~StereoDecimator();
+
+    // Initialize for a decimation factor (at least 2) and the most frames that will be passed to a Process call.
+    // The filter passes up to 0.8 of the output nyquist, aliasing only lands above that.
+    bool Initialize( uint32_t factor, size_t maxInputFrames );
+
+    // Filter and decimate frames from both channels, writing at most MaxOutputFrames() to each output.
+    // Returns the number of frames written.
+    size_t Process( const float* left, const float* right, size_t frameCount, float* outputLeft, float* outputRight );
+
+    // Clear the filter history, after a discontinuity in the input.
+    void Reset();
+
+    // The most frames one Process call can output.
+    size_t MaxOutputFrames() const { return ( MaxInputFrames_ + Factor_ - 1 ) / Factor_; }
+
+    uint32_t Factor() const { return Factor_; }
+
+    StereoDecimator( const StereoDecimator& ) = delete;
+
+    StereoDecimator& operator=( const StereoDecimator& ) = delete;
+
+private:
+
+    size_t ProcessChannel( const float* input, size_t frameCount, float* line, float* output ) const;
+
+    float*   Taps_;
+    float*   Lines_[ 2 ]; // filter history followed by the incoming frames, per channel.
+    uint32_t TapCount_;
+    uint32_t Factor_;
+    uint32_t Phase_; // input frames to skip before the next output frame.
+    size_t   MaxInputFrames_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_DECIMATOR_H__
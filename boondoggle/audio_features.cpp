@@ -0,0 +1,255 @@
+#include "audio_features.h"
+#include <string.h>
+
+namespace
+{
+    // The bucket ranges follow the header, then records start on a 64 byte boundary so the texture data is aligned for copies.
+    const uint64_t BUCKET_RANGES_OFFSET = 64;
+    const uint64_t FIRST_RECORD_OFFSET  = BUCKET_RANGES_OFFSET + ( ( sizeof( AudioFeatureBucketRanges ) + 63 ) & ~63 );
+}
+
+AudioFeatureWriter::AudioFeatureWriter() : File_( nullptr ), LastTexture_( nullptr ), Failed_( false )
+{
+    ::memset( &Header_, 0, sizeof( Header_ ) );
+    ::memset( &Last_, 0, sizeof( Last_ ) );
+}
+
+AudioFeatureWriter::~AudioFeatureWriter()
+{
+    Close();
+}
+
+bool AudioFeatureWriter::Open( const char* path, uint32_t sampleRate, uint32_t hopSamples, uint32_t samplesPerPeriod, uint32_t bucketCount, const float* bucketRanges )
+{
+    Close();
+
+    File_ = ::fopen( path, "wb" );
+
+    if ( File_ == nullptr )
+    {
+        return false;
+    }
+
+    Header_.Magic             = AUDIO_FEATURES_MAGIC;
+    Header_.Version           = AUDIO_FEATURES_VERSION;
+    Header_.SampleRate        = sampleRate;
+    Header_.HopSamples        = hopSamples;
+    Header_.SamplesPerPeriod  = samplesPerPeriod;
+    Header_.TextureTexels     = samplesPerPeriod;
+    Header_.RecordSize        = static_cast< uint32_t >( sizeof( AudioFeatureRecord ) + samplesPerPeriod * sizeof( float ) * 4 );
+    Header_.BucketCount       = bucketCount;
+    Header_.RecordCount       = 0;
+    Header_.FirstRecordOffset = FIRST_RECORD_OFFSET;
+
+    LastTexture_ = new float[ samplesPerPeriod * 4 ]();
+    Failed_      = false;
+
+    // The header gets written again with the record count when we close.
+    uint8_t padding[ FIRST_RECORD_OFFSET ] = {};
+
+    ::memcpy( padding, &Header_, sizeof( Header_ ) );
+    ::memcpy( padding + BUCKET_RANGES_OFFSET, bucketRanges, sizeof( AudioFeatureBucketRanges ) );
+
+    return ::fwrite( padding, sizeof( padding ), 1, File_ ) == 1;
+}
+
+bool AudioFeatureWriter::WriteRecord( const AudioFeatureRecord& record, const float* textureData )
+{
+    if ( ::fwrite( &record, sizeof( record ), 1, File_ ) != 1 ||
+         ::fwrite( textureData, sizeof( float ) * 4, Header_.TextureTexels, File_ ) != Header_.TextureTexels )
+    {
+        Failed_ = true;
+        return false;
+    }
+
+    ++Header_.RecordCount;
+
+    return true;
+}
+
+bool AudioFeatureWriter::Write( uint64_t windowEnd, const PerFrameConstants& constants, const float* textureData )
+{
+    if ( File_ == nullptr || Failed_ )
+    {
+        return false;
+    }
+
+    // Repeat the last record for any hops that weren't analyzed, so the record for a time is always at the same place.
+    while ( Header_.RecordCount > 0 &&
+            Header_.SamplesPerPeriod + Header_.RecordCount * Header_.HopSamples < windowEnd )
+    {
+        if ( !WriteRecord( Last_, LastTexture_ ) )
+        {
+            return false;
+        }
+    }
+
+    ::memcpy( Last_.SoundFrequencyBuckets, constants.SoundFrequencyBuckets, sizeof( Last_.SoundFrequencyBuckets ) );
+
+    Last_.SoundRMS[ 0 ]          = constants.SoundRMS[ 0 ];
+    Last_.SoundRMS[ 1 ]          = constants.SoundRMS[ 1 ];
+    Last_.SoundRMSdbSPL[ 0 ]     = constants.SoundRMSdbSPL[ 0 ];
+    Last_.SoundRMSdbSPL[ 1 ]     = constants.SoundRMSdbSPL[ 1 ];
+    Last_.NoiseFloorDbSPL        = constants.NoiseFloorDbSPL;
+    Last_.SoundOnsetStrength     = constants.SoundOnsetStrength;
+    Last_.SoundBPM               = constants.SoundBPM;
+    Last_.SoundBeatPhase         = constants.SoundBeatPhase;
+    Last_.SoundBeatConfidence    = constants.SoundBeatConfidence;
+    Last_.SoundLoudnessMomentary = constants.SoundLoudnessMomentary;
+    Last_.SoundLoudnessShortTerm = constants.SoundLoudnessShortTerm;
+    Last_.SoundLoudnessGain      = constants.SoundLoudnessGain;
+
+    ::memcpy( LastTexture_, textureData, Header_.TextureTexels * sizeof( float ) * 4 );
+
+    return WriteRecord( Last_, LastTexture_ );
+}
+
+bool AudioFeatureWriter::Close()
+{
+    if ( File_ == nullptr )
+    {
+        return !Failed_;
+    }
+
+    if ( ::fseek( File_, 0, SEEK_SET ) != 0 || ::fwrite( &Header_, sizeof( Header_ ), 1, File_ ) != 1 )
+    {
+        Failed_ = true;
+    }
+
+    if ( ::fclose( File_ ) != 0 )
+    {
+        Failed_ = true;
+    }
+
+    File_ = nullptr;
+
+    delete[] LastTexture_;
+    LastTexture_ = nullptr;
+
+    return !Failed_;
+}
+
+AudioFeatureStream::AudioFeatureStream() : Header_( nullptr ), Ranges_( nullptr ), Records_( nullptr )
+{
+}
+
+AudioFeatureStream::~AudioFeatureStream()
+{
+    Close();
+}
+
+#if defined( _WIN32 )
+
+bool AudioFeatureStream::Open( const wchar_t* path )
+{
+    Close();
+
+    File_.Open( path );
+
+    return Validate();
+}
+
+#endif
+
+bool AudioFeatureStream::Open( const char* path )
+{
+    Close();
+
+    File_.Open( path );
+
+    return Validate();
+}
+
+void AudioFeatureStream::Close()
+{
+    File_.Close();
+
+    Header_  = nullptr;
+    Ranges_  = nullptr;
+    Records_ = nullptr;
+}
+
+bool AudioFeatureStream::Validate()
+{
+    const uint8_t* mapping     = File_.Data();
+    size_t         mappingSize = File_.Size();
+
+    if ( mapping == nullptr || mappingSize < BUCKET_RANGES_OFFSET + sizeof( AudioFeatureBucketRanges ) )
+    {
+        Close();
+        return false;
+    }
+
+    const AudioFeatureFileHeader* header = reinterpret_cast< const AudioFeatureFileHeader* >( mapping );
+
+    uint64_t recordSize = sizeof( AudioFeatureRecord ) + static_cast< uint64_t >( header->TextureTexels ) * sizeof( float ) * 4;
+
+    // Checked by division so a corrupt record count can't overflow the size check.
+    if ( header->Magic != AUDIO_FEATURES_MAGIC ||
+         header->Version != AUDIO_FEATURES_VERSION ||
+         header->SampleRate == 0 ||
+         header->HopSamples == 0 ||
+         header->SamplesPerPeriod == 0 ||
+         header->TextureTexels == 0 ||
+         header->BucketCount < 2 ||
+         header->BucketCount > FREQUENCY_BUCKETS ||
+         header->RecordSize != recordSize ||
+         header->RecordCount == 0 ||
+         header->FirstRecordOffset % 16 != 0 ||
+         header->FirstRecordOffset < BUCKET_RANGES_OFFSET + sizeof( AudioFeatureBucketRanges ) ||
+         header->FirstRecordOffset > mappingSize ||
+         ( mappingSize - header->FirstRecordOffset ) / recordSize < header->RecordCount )
+    {
+        Close();
+        return false;
+    }
+
+    Header_  = header;
+    Ranges_  = reinterpret_cast< const AudioFeatureBucketRanges* >( mapping + BUCKET_RANGES_OFFSET );
+    Records_ = mapping + header->FirstRecordOffset;
+
+    return true;
+}
+
+double AudioFeatureStream::Duration() const
+{
+    uint64_t frames = Header_->SamplesPerPeriod + ( Header_->RecordCount - 1 ) * Header_->HopSamples;
+
+    return static_cast< double >( frames ) / static_cast< double >( Header_->SampleRate );
+}
+
+uint64_t AudioFeatureStream::RecordAt( double seconds ) const
+{
+    double frame = seconds * static_cast< double >( Header_->SampleRate ) - static_cast< double >( Header_->SamplesPerPeriod );
+
+    if ( frame <= 0.0 )
+    {
+        return 0;
+    }
+
+    uint64_t index = static_cast< uint64_t >( frame ) / Header_->HopSamples;
+
+    return index < Header_->RecordCount ? index : Header_->RecordCount - 1;
+}
+
+void AudioFeatureStream::ApplyRecord( uint64_t index, PerFrameConstants& toUpdate ) const
+{
+    const AudioFeatureRecord& record = Record( index );
+
+    ::memcpy( toUpdate.SoundFrequencyBuckets, record.SoundFrequencyBuckets, sizeof( toUpdate.SoundFrequencyBuckets ) );
+
+    toUpdate.SoundRMS[ 0 ]          = record.SoundRMS[ 0 ];
+    toUpdate.SoundRMS[ 1 ]          = record.SoundRMS[ 1 ];
+    toUpdate.SoundRMSdbSPL[ 0 ]     = record.SoundRMSdbSPL[ 0 ];
+    toUpdate.SoundRMSdbSPL[ 1 ]     = record.SoundRMSdbSPL[ 1 ];
+    toUpdate.SoundSampleRate        = static_cast< float >( Header_->SampleRate );
+    toUpdate.SoundSamples           = static_cast< float >( Header_->TextureTexels );
+    toUpdate.NoiseFloorDbSPL        = record.NoiseFloorDbSPL;
+    toUpdate.SoundOnsetStrength     = record.SoundOnsetStrength;
+    toUpdate.SoundBPM               = record.SoundBPM;
+    toUpdate.SoundBeatPhase         = record.SoundBeatPhase;
+    toUpdate.SoundBeatConfidence    = record.SoundBeatConfidence;
+    toUpdate.SoundLoudnessMomentary = record.SoundLoudnessMomentary;
+    toUpdate.SoundLoudnessShortTerm = record.SoundLoudnessShortTerm;
+    toUpdate.SoundLoudnessGain      = record.SoundLoudnessGain;
+}
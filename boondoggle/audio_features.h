@@ -0,0 +1,164 @@
+#ifndef BOONDOGGLE_AUDIO_FEATURES_H__
+#define BOONDOGGLE_AUDIO_FEATURES_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "shared_render_constants.h"
+#include "../common/mapped_file.h"
+
+// Pre-analyzed audio features, for fixed playlists where the analysis can be done ahead of time.
+// A feature file has one fixed size record per analysis hop, so the record for any playback time
+// can be found directly. Record n is the analysis of the window ending at frame SamplesPerPeriod + n * HopSamples.
+// The bucket frequency ranges don't change over the file, so they're stored once after the header.
+
+static const uint32_t AUDIO_FEATURES_MAGIC   = 0x46414442; // "BDAF"
+static const uint32_t AUDIO_FEATURES_VERSION = 3;
+
+struct AudioFeatureFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t SampleRate;
+    uint32_t HopSamples;
+    uint32_t SamplesPerPeriod;
+    uint32_t TextureTexels; // texels of sound texture data (4 floats each) after each record.
+    uint32_t RecordSize;    // bytes from one record to the next, including the texture data.
+    uint32_t BucketCount;   // frequency buckets analyzed, the rest of each record's buckets are at the noise floor.
+    uint64_t RecordCount;
+    uint64_t FirstRecordOffset;
+};
+
+// Follows the header, the low and high frequency of each bucket (see AudioProcessing::BucketRanges).
+struct AudioFeatureBucketRanges
+{
+    float Ranges[ FREQUENCY_BUCKETS ][ 2 ];
+};
+
+// The sound constants of one analysis window, the sound texture data follows.
+struct AudioFeatureRecord
+{
+    float SoundFrequencyBuckets[ FREQUENCY_BUCKETS ][ 2 ];
+    float SoundRMS[ 2 ];
+    float SoundRMSdbSPL[ 2 ];
+    float NoiseFloorDbSPL;
+    float SoundOnsetStrength;
+    float SoundBPM;
+    float SoundBeatPhase;
+    float SoundBeatConfidence;
+    float SoundLoudnessMomentary;
+    float SoundLoudnessShortTerm;
+    float SoundLoudnessGain;
+};
+
+// Writes a feature file from the updates of an AudioProcessing, use from the analyzer.
+class AudioFeatureWriter
+{
+public:
+
+    AudioFeatureWriter();
+
+    // Closes the file if it's still open.
+    ~AudioFeatureWriter();
+
+    // Create the file for analysis at the given rate, hop and period, with bucketCount buckets with the given
+    // ranges (FREQUENCY_BUCKETS low and high pairs). Returns false if it couldn't be written.
+    bool Open( const char* path, uint32_t sampleRate, uint32_t hopSamples, uint32_t samplesPerPeriod, uint32_t bucketCount, const float* bucketRanges );
+
+    // Write the record for the window ending at windowEnd (the source cursor). If windows were skipped since
+    // the last write, the previous record is repeated in their place so records stay one per hop.
+    bool Write( uint64_t windowEnd, const PerFrameConstants& constants, const float* textureData );
+
+    // Fill in the record count and close the file, returns false if anything failed to write.
+    bool Close();
+
+    // Records written so far.
+    uint64_t RecordCount() const { return Header_.RecordCount; }
+
+    AudioFeatureWriter( const AudioFeatureWriter& ) = delete;
+
+    AudioFeatureWriter& operator=( const AudioFeatureWriter& ) = delete;
+
+private:
+
+    bool WriteRecord( const AudioFeatureRecord& record, const float* textureData );
+
+    FILE*                  File_;
+    AudioFeatureFileHeader Header_;
+    AudioFeatureRecord     Last_;
+    float*                 LastTexture_;
+    bool                   Failed_;
+};
+
+// A memory mapped feature file, for driving the visuals from pre-analyzed audio with no processing at runtime.
+class AudioFeatureStream
+{
+public:
+
+    AudioFeatureStream();
+
+    // Unmaps the file.
+    ~AudioFeatureStream();
+
+#if defined( _WIN32 )
+    // Map a feature file, returns false if it couldn't be mapped or isn't valid.
+    bool Open( const wchar_t* path );
+#endif
+
+    // Map a feature file, returns false if it couldn't be mapped or isn't valid.
+    bool Open( const char* path );
+
+    // Unmap the file.
+    void Close();
+
+    const AudioFeatureFileHeader& Header() const { return *Header_; }
+
+    uint64_t RecordCount() const { return Header_->RecordCount; }
+
+    // Texels of sound texture data per record.
+    size_t TextureSamples() const { return Header_->TextureTexels; }
+
+    // Frequency buckets analyzed.
+    uint32_t BucketCount() const { return Header_->BucketCount; }
+
+    // Low and high frequency of each of the FREQUENCY_BUCKETS buckets, as AudioProcessing::BucketRanges.
+    const float* BucketRanges() const { return &Ranges_->Ranges[ 0 ][ 0 ]; }
+
+    // Length of the analyzed audio in seconds.
+    double Duration() const;
+
+    // The record in effect at a playback time in seconds (the last window to end by then), clamped to the records there are.
+    uint64_t RecordAt( double seconds ) const;
+
+    const AudioFeatureRecord& Record( uint64_t index ) const
+    {
+        return *reinterpret_cast< const AudioFeatureRecord* >( Records_ + index * Header_->RecordSize );
+    }
+
+    // Sound texture data of a record, TextureSamples() texels of 4 floats.
+    const float* TextureData( uint64_t index ) const
+    {
+        return reinterpret_cast< const float* >( Records_ + index * Header_->RecordSize + sizeof( AudioFeatureRecord ) );
+    }
+
+    // Set the sound constants from a record, the same fields AudioProcessing fills in.
+    void ApplyRecord( uint64_t index, PerFrameConstants& toUpdate ) const;
+
+    AudioFeatureStream( const AudioFeatureStream& ) = delete;
+
+    AudioFeatureStream& operator=( const AudioFeatureStream& ) = delete;
+
+private:
+
+    // Check the header and sizes against the mapped size.
+    bool Validate();
+
+    MappedFile                      File_;
+    const AudioFeatureFileHeader*   Header_;
+    const AudioFeatureBucketRanges* Ranges_;
+    const uint8_t*                  Records_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_FEATURES_H__
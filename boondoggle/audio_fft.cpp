@@ -0,0 +1,472 @@
+#include "audio_fft.h"
+#include "../external/kissfft/kiss_fftr.h"
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define AUDIO_FFT_SSE 1
+#include <emmintrin.h>
+#else
+#define AUDIO_FFT_SSE 0
+#endif
+
+namespace
+{
+#if AUDIO_FFT_SSE
+
+    // 4 wide float vector, SSE2 is baseline on every x64 target so no dispatch is needed.
+    typedef __m128 Float4;
+
+    inline Float4 Load4( const float* source ) { return _mm_loadu_ps( source ); }
+    inline void   Store4( float* destination, Float4 value ) { _mm_storeu_ps( destination, value ); }
+    inline Float4 Add4( Float4 left, Float4 right ) { return _mm_add_ps( left, right ); }
+    inline Float4 Sub4( Float4 left, Float4 right ) { return _mm_sub_ps( left, right ); }
+    inline Float4 Mul4( Float4 left, Float4 right ) { return _mm_mul_ps( left, right ); }
+    inline void   Transpose4( Float4& row0, Float4& row1, Float4& row2, Float4& row3 ) { _MM_TRANSPOSE4_PS( row0, row1, row2, row3 ); }
+
+#else
+
+    struct Float4
+    {
+        float Values[ 4 ];
+    };
+
+    inline Float4 Load4( const float* source )
+    {
+        Float4 result = { { source[ 0 ], source[ 1 ], source[ 2 ], source[ 3 ] } };
+        return result;
+    }
+
+    inline void Store4( float* destination, Float4 value )
+    {
+        for ( uint32_t where = 0; where < 4; ++where )
+        {
+            destination[ where ] = value.Values[ where ];
+        }
+    }
+
+    inline Float4 Add4( Float4 left, Float4 right )
+    {
+        Float4 result = { { left.Values[ 0 ] + right.Values[ 0 ], left.Values[ 1 ] + right.Values[ 1 ], left.Values[ 2 ] + right.Values[ 2 ], left.Values[ 3 ] + right.Values[ 3 ] } };
+        return result;
+    }
+
+    inline Float4 Sub4( Float4 left, Float4 right )
+    {
+        Float4 result = { { left.Values[ 0 ] - right.Values[ 0 ], left.Values[ 1 ] - right.Values[ 1 ], left.Values[ 2 ] - right.Values[ 2 ], left.Values[ 3 ] - right.Values[ 3 ] } };
+        return result;
+    }
+
+    inline Float4 Mul4( Float4 left, Float4 right )
+    {
+        Float4 result = { { left.Values[ 0 ] * right.Values[ 0 ], left.Values[ 1 ] * right.Values[ 1 ], left.Values[ 2 ] * right.Values[ 2 ], left.Values[ 3 ] * right.Values[ 3 ] } };
+        return result;
+    }
+
+    inline void Transpose4( Float4& row0, Float4& row1, Float4& row2, Float4& row3 )
+    {
+        Float4  rows[ 4 ]    = { row0, row1, row2, row3 };
+        Float4* outputs[ 4 ] = { &row0, &row1, &row2, &row3 };
+
+        for ( uint32_t row = 0; row < 4; ++row )
+        {
+            for ( uint32_t column = 0; column < 4; ++column )
+            {
+                outputs[ row ]->Values[ column ] = rows[ column ].Values[ row ];
+            }
+        }
+    }
+
+#endif
+
+    // Complex multiply of split real/imaginary vectors.
+    inline void ComplexMul4( Float4& real, Float4& imaginary, Float4 twiddleReal, Float4 twiddleImaginary )
+    {
+        Float4 resultReal = Sub4( Mul4( real, twiddleReal ), Mul4( imaginary, twiddleImaginary ) );
+
+        imaginary = Add4( Mul4( real, twiddleImaginary ), Mul4( imaginary, twiddleReal ) );
+        real      = resultReal;
+    }
+
+    // Forward radix-4 butterfly (no twiddles) on split complex vectors, in place.
+    inline void Butterfly4( Float4& real0, Float4& imaginary0,
+                            Float4& real1, Float4& imaginary1,
+                            Float4& real2, Float4& imaginary2,
+                            Float4& real3, Float4& imaginary3 )
+    {
+        Float4 sum02Real       = Add4( real0, real2 );
+        Float4 sum02Imaginary  = Add4( imaginary0, imaginary2 );
+        Float4 diff02Real      = Sub4( real0, real2 );
+        Float4 diff02Imaginary = Sub4( imaginary0, imaginary2 );
+        Float4 sum13Real       = Add4( real1, real3 );
+        Float4 sum13Imaginary  = Add4( imaginary1, imaginary3 );
+
+        // -i * ( x1 - x3 )
+        Float4 rotatedReal      = Sub4( imaginary1, imaginary3 );
+        Float4 rotatedImaginary = Sub4( real3, real1 );
+
+        real0      = Add4( sum02Real, sum13Real );
+        imaginary0 = Add4( sum02Imaginary, sum13Imaginary );
+        real1      = Add4( diff02Real, rotatedReal );
+        imaginary1 = Add4( diff02Imaginary, rotatedImaginary );
+        real2      = Sub4( sum02Real, sum13Real );
+        imaginary2 = Sub4( sum02Imaginary, sum13Imaginary );
+        real3      = Sub4( diff02Real, rotatedReal );
+        imaginary3 = Sub4( diff02Imaginary, rotatedImaginary );
+    }
+
+    // Complex FFT with the size fixed at compile time. Decimation in frequency, with one radix-2
+    // stage first for odd powers of two and radix-4 stages after that. Data is worked on in split
+    // (SoA) real and imaginary arrays, with the twiddles for each stage stored the same way, and the
+    // digit reversal is folded into writing the interleaved output.
+    template < uint32_t Log2Size >
+    class ComplexFFT
+    {
+    public:
+
+        static const uint32_t SIZE             = 1u << Log2Size;
+        static const bool     HAS_RADIX2_STAGE = ( Log2Size & 1 ) != 0;
+        static const uint32_t RADIX4_SIZE      = HAS_RADIX2_STAGE ? SIZE / 2 : SIZE;
+
+        static_assert( Log2Size >= 4, "Need at least 2 radix-4 stages" );
+
+        ComplexFFT()
+        {
+            float* twiddles = Twiddles_;
+
+            if ( HAS_RADIX2_STAGE )
+            {
+                WriteTwiddles( twiddles, SIZE, SIZE / 2, 1 );
+                twiddles += SIZE;
+            }
+
+            for ( uint32_t span = RADIX4_SIZE; span >= 16; span /= 4 )
+            {
+                for ( uint32_t power = 1; power <= 3; ++power )
+                {
+                    WriteTwiddles( twiddles, span, span / 4, power );
+                    twiddles += span / 2;
+                }
+            }
+
+            for ( uint32_t bin = 0; bin < SIZE; ++bin )
+            {
+                uint32_t position  = 0;
+                uint32_t remaining = bin;
+                uint32_t span      = SIZE;
+
+                // bin R * r + m of a span ends up in the sub-transform m, stored at m * ( span / R ).
+                if ( HAS_RADIX2_STAGE )
+                {
+                    position  += ( remaining & 1 ) * ( span / 2 );
+                    remaining >>= 1;
+                    span      /= 2;
+                }
+
+                for ( ; span > 1; span /= 4 )
+                {
+                    position  += ( remaining & 3 ) * ( span / 4 );
+                    remaining >>= 2;
+                }
+
+                Order_[ bin ] = position;
+            }
+        }
+
+        void Transform( const kiss_fft_cpx* input, kiss_fft_cpx* output )
+        {
+            const float* interleaved = reinterpret_cast< const float* >( input );
+
+            for ( uint32_t sample = 0; sample < SIZE; ++sample )
+            {
+                Real_[ sample ]      = interleaved[ sample * 2 ];
+                Imaginary_[ sample ] = interleaved[ sample * 2 + 1 ];
+            }
+
+            const float* twiddles = Twiddles_;
+
+            if ( HAS_RADIX2_STAGE )
+            {
+                Radix2Stage( twiddles );
+                twiddles += SIZE;
+            }
+
+            for ( uint32_t span = RADIX4_SIZE; span >= 16; span /= 4 )
+            {
+                Radix4Stage( span, twiddles );
+                twiddles += ( span / 2 ) * 3;
+            }
+
+            LastStage();
+
+            for ( uint32_t bin = 0; bin < SIZE; ++bin )
+            {
+                output[ bin ].r = Real_[ Order_[ bin ] ];
+                output[ bin ].i = Imaginary_[ Order_[ bin ] ];
+            }
+        }
+
+    private:
+
+        // Write the real then imaginary parts of W^( power * j ) for j in [0, count), W = exp( -2 pi i / span ).
+        static void WriteTwiddles( float* twiddles, uint32_t span, uint32_t count, uint32_t power )
+        {
+            for ( uint32_t where = 0; where < count; ++where )
+            {
+                double angle = ( -2.0 * M_PI * power * where ) / span;
+
+                twiddles[ where ]         = static_cast< float >( cos( angle ) );
+                twiddles[ where + count ] = static_cast< float >( sin( angle ) );
+            }
+        }
+
+        void Radix2Stage( const float* twiddles )
+        {
+            const uint32_t half = SIZE / 2;
+
+            for ( uint32_t where = 0; where < half; where += 4 )
+            {
+                Float4 real0      = Load4( Real_ + where );
+                Float4 imaginary0 = Load4( Imaginary_ + where );
+                Float4 real1      = Load4( Real_ + where + half );
+                Float4 imaginary1 = Load4( Imaginary_ + where + half );
+                Float4 diffReal   = Sub4( real0, real1 );
+                Float4 diffImag   = Sub4( imaginary0, imaginary1 );
+
+                ComplexMul4( diffReal, diffImag, Load4( twiddles + where ), Load4( twiddles + half + where ) );
+
+                Store4( Real_ + where, Add4( real0, real1 ) );
+                Store4( Imaginary_ + where, Add4( imaginary0, imaginary1 ) );
+                Store4( Real_ + where + half, diffReal );
+                Store4( Imaginary_ + where + half, diffImag );
+            }
+        }
+
+        void Radix4Stage( uint32_t span, const float* twiddles )
+        {
+            const uint32_t quarter = span / 4;
+            const float*   first   = twiddles;
+            const float*   second  = twiddles + quarter * 2;
+            const float*   third   = twiddles + quarter * 4;
+
+            for ( uint32_t block = 0; block < SIZE; block += span )
+            {
+                float* real      = Real_ + block;
+                float* imaginary = Imaginary_ + block;
+
+                for ( uint32_t where = 0; where < quarter; where += 4 )
+                {
+                    Float4 real0      = Load4( real + where );
+                    Float4 imaginary0 = Load4( imaginary + where );
+                    Float4 real1      = Load4( real + where + quarter );
+                    Float4 imaginary1 = Load4( imaginary + where + quarter );
+                    Float4 real2      = Load4( real + where + quarter * 2 );
+                    Float4 imaginary2 = Load4( imaginary + where + quarter * 2 );
+                    Float4 real3      = Load4( real + where + quarter * 3 );
+                    Float4 imaginary3 = Load4( imaginary + where + quarter * 3 );
+
+                    Butterfly4( real0, imaginary0, real1, imaginary1, real2, imaginary2, real3, imaginary3 );
+
+                    ComplexMul4( real1, imaginary1, Load4( first + where ), Load4( first + quarter + where ) );
+                    ComplexMul4( real2, imaginary2, Load4( second + where ), Load4( second + quarter + where ) );
+                    ComplexMul4( real3, imaginary3, Load4( third + where ), Load4( third + quarter + where ) );
+
+                    Store4( real + where, real0 );
+                    Store4( imaginary + where, imaginary0 );
+                    Store4( real + where + quarter, real1 );
+                    Store4( imaginary + where + quarter, imaginary1 );
+                    Store4( real + where + quarter * 2, real2 );
+                    Store4( imaginary + where + quarter * 2, imaginary2 );
+                    Store4( real + where + quarter * 3, real3 );
+                    Store4( imaginary + where + quarter * 3, imaginary3 );
+                }
+            }
+        }
+
+        // The last radix-4 stage has spans of 4 and no twiddles, so transpose 4 spans at a time to
+        // keep the butterflies vertical.
+        void LastStage()
+        {
+            for ( uint32_t block = 0; block < SIZE; block += 16 )
+            {
+                Float4 real0      = Load4( Real_ + block );
+                Float4 real1      = Load4( Real_ + block + 4 );
+                Float4 real2      = Load4( Real_ + block + 8 );
+                Float4 real3      = Load4( Real_ + block + 12 );
+                Float4 imaginary0 = Load4( Imaginary_ + block );
+                Float4 imaginary1 = Load4( Imaginary_ + block + 4 );
+                Float4 imaginary2 = Load4( Imaginary_ + block + 8 );
+                Float4 imaginary3 = Load4( Imaginary_ + block + 12 );
+
+                Transpose4( real0, real1, real2, real3 );
+                Transpose4( imaginary0, imaginary1, imaginary2, imaginary3 );
+
+                Butterfly4( real0, imaginary0, real1, imaginary1, real2, imaginary2, real3, imaginary3 );
+
+                Transpose4( real0, real1, real2, real3 );
+                Transpose4( imaginary0, imaginary1, imaginary2, imaginary3 );
+
+                Store4( Real_ + block, real0 );
+                Store4( Real_ + block + 4, real1 );
+                Store4( Real_ + block + 8, real2 );
+                Store4( Real_ + block + 12, real3 );
+                Store4( Imaginary_ + block, imaginary0 );
+                Store4( Imaginary_ + block + 4, imaginary1 );
+                Store4( Imaginary_ + block + 8, imaginary2 );
+                Store4( Imaginary_ + block + 12, imaginary3 );
+            }
+        }
+
+        float    Real_[ SIZE ];
+        float    Imaginary_[ SIZE ];
+        float    Twiddles_[ SIZE * 2 ]; // radix-2 stage takes SIZE, the radix-4 stages less than SIZE together.
+        uint32_t Order_[ SIZE ]; // where each output bin ends up after the last stage.
+    };
+
+    // Specialized engine, complex transforms of the whole size and real transforms done as a
+    // complex transform of half the size with a post-processing pass to split the spectrum.
+    template < uint32_t Log2Size >
+    class SpecializedFFTEngine : public FFTEngine
+    {
+    public:
+
+        static const uint32_t SIZE = 1u << Log2Size;
+
+        SpecializedFFTEngine()
+        {
+            for ( uint32_t bin = 0; bin <= SIZE / 2; ++bin )
+            {
+                double angle = ( -2.0 * M_PI * bin ) / SIZE;
+
+                RealTwiddles_[ bin ][ 0 ] = static_cast< float >( cos( angle ) );
+                RealTwiddles_[ bin ][ 1 ] = static_cast< float >( sin( angle ) );
+            }
+        }
+
+        uint32_t Size() const override { return SIZE; }
+
+        FFTImplementation Implementation() const override { return FFTImplementation::SPECIALIZED; }
+
+        void Forward( const kiss_fft_cpx* input, kiss_fft_cpx* output ) override
+        {
+            Complex_.Transform( input, output );
+        }
+
+        void ForwardReal( const float* input, kiss_fft_cpx* output ) override
+        {
+            const uint32_t half = SIZE / 2;
+
+            // even samples are the real part, odd the imaginary.
+            Half_.Transform( reinterpret_cast< const kiss_fft_cpx* >( input ), Packed_ );
+
+            // X[k] = ( Z[k] + conj( Z[M-k] ) ) / 2 - i W^k ( Z[k] - conj( Z[M-k] ) ) / 2, M = SIZE / 2.
+            for ( uint32_t bin = 0; bin <= half; ++bin )
+            {
+                const kiss_fft_cpx& forward = Packed_[ bin & ( half - 1 ) ];
+                const kiss_fft_cpx& mirror  = Packed_[ ( half - bin ) & ( half - 1 ) ];
+
+                float evenReal      = 0.5f * ( forward.r + mirror.r );
+                float evenImaginary = 0.5f * ( forward.i - mirror.i );
+                float oddReal       = 0.5f * ( forward.i + mirror.i );
+                float oddImaginary  = 0.5f * ( mirror.r - forward.r );
+                float twiddleReal   = RealTwiddles_[ bin ][ 0 ];
+                float twiddleImag   = RealTwiddles_[ bin ][ 1 ];
+
+                output[ bin ].r = evenReal + oddReal * twiddleReal - oddImaginary * twiddleImag;
+                output[ bin ].i = evenImaginary + oddReal * twiddleImag + oddImaginary * twiddleReal;
+            }
+        }
+
+    private:
+
+        ComplexFFT< Log2Size >     Complex_;
+        ComplexFFT< Log2Size - 1 > Half_;
+        kiss_fft_cpx               Packed_[ SIZE / 2 ];
+        float                      RealTwiddles_[ SIZE / 2 + 1 ][ 2 ];
+    };
+
+    class KissFFTEngine : public FFTEngine
+    {
+    public:
+
+        KissFFTEngine() : Size_( 0 ), Complex_( nullptr ), Real_( nullptr ) {}
+
+        ~KissFFTEngine()
+        {
+            kiss_fft_free( Complex_ );
+            kiss_fftr_free( Real_ );
+        }
+
+        bool Initialize( uint32_t size )
+        {
+            Size_    = size;
+            Complex_ = kiss_fft_alloc( static_cast< int >( size ), 0, nullptr, nullptr );
+            Real_    = kiss_fftr_alloc( static_cast< int >( size ), 0, nullptr, nullptr );
+
+            return Complex_ != nullptr && Real_ != nullptr;
+        }
+
+        uint32_t Size() const override { return Size_; }
+
+        FFTImplementation Implementation() const override { return FFTImplementation::KISS; }
+
+        void Forward( const kiss_fft_cpx* input, kiss_fft_cpx* output ) override
+        {
+            kiss_fft( Complex_, input, output );
+        }
+
+        void ForwardReal( const float* input, kiss_fft_cpx* output ) override
+        {
+            kiss_fftr( Real_, input, output );
+        }
+
+    private:
+
+        uint32_t      Size_;
+        kiss_fft_cfg  Complex_;
+        kiss_fftr_cfg Real_;
+    };
+}
+
+FFTEngine* CreateFFTEngine( FFTImplementation implementation, uint32_t size )
+{
+    if ( size < 4 || ( size & ( size - 1 ) ) != 0 )
+    {
+        return nullptr;
+    }
+
+    // These cover every period size AudioSource picks for sample rates up to 192kHz.
+    if ( implementation == FFTImplementation::SPECIALIZED )
+    {
+        switch ( size )
+        {
+        case 1u << 10:
+
+            return new SpecializedFFTEngine< 10 >();
+
+        case 1u << 11:
+
+            return new SpecializedFFTEngine< 11 >();
+
+        case 1u << 12:
+
+            return new SpecializedFFTEngine< 12 >();
+
+        default:
+
+            break;
+        }
+    }
+
+    KissFFTEngine* engine = new KissFFTEngine();
+
+    if ( !engine->Initialize( size ) )
+    {
+        delete engine;
+        return nullptr;
+    }
+
+    return engine;
+}
@@ -0,0 +1,40 @@
+#ifndef BOONDOGGLE_AUDIO_FFT_H__
+#define BOONDOGGLE_AUDIO_FFT_H__
+
+#pragma once
+
+#include <stdint.h>
+#include "../external/kissfft/kiss_fft.h"
+
+// FFT implementations available for audio processing.
+enum class FFTImplementation : uint32_t
+{
+    KISS        = 0, // kissfft, works for any size.
+    SPECIALIZED = 1  // compile time specialized engine for the sizes we actually use, falls back to kiss otherwise.
+};
+
+// Forward FFTs of a fixed size, in kissfft's output format (unnormalized, bins as kiss_fft_cpx).
+class FFTEngine
+{
+public:
+
+    virtual ~FFTEngine() {}
+
+    // Number of samples in the transform.
+    virtual uint32_t Size() const = 0;
+
+    // Which implementation this actually is.
+    virtual FFTImplementation Implementation() const = 0;
+
+    // Forward transform of Size() complex samples. Input and output must not overlap.
+    virtual void Forward( const kiss_fft_cpx* input, kiss_fft_cpx* output ) = 0;
+
+    // Forward transform of Size() real samples, writing Size() / 2 + 1 bins. Input and output must not overlap.
+    virtual void ForwardReal( const float* input, kiss_fft_cpx* output ) = 0;
+};
+
+// Create an FFT engine for a power of two size (at least 4). If the specialized engine doesn't support
+// the size, a kiss engine is returned instead. Returns nullptr on failure, delete the engine when done.
+FFTEngine* CreateFFTEngine( FFTImplementation implementation, uint32_t size );
+
+#endif // -- BOONDOGGLE_AUDIO_FFT_H__
@@ -0,0 +1,338 @@
+#include "audio_file_source.h"
+#include <string.h>
+
+#if defined( _WIN32 )
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace
+{
+    const uint32_t READ_FRAMES                = 1024;
+    const uint16_t WAVE_FORMAT_PCM_TAG        = 0x0001;
+    const uint16_t WAVE_FORMAT_FLOAT_TAG      = 0x0003;
+    const uint16_t WAVE_FORMAT_EXTENSIBLE_TAG = 0xFFFE;
+
+    // Little endian reads from a byte buffer, so we don't care about host endianness or alignment.
+    uint16_t ReadUInt16( const uint8_t* from )
+    {
+        return static_cast< uint16_t >( from[ 0 ] | ( from[ 1 ] << 8 ) );
+    }
+
+    uint32_t ReadUInt32( const uint8_t* from )
+    {
+        return static_cast< uint32_t >( from[ 0 ] ) |
+               ( static_cast< uint32_t >( from[ 1 ] ) << 8 ) |
+               ( static_cast< uint32_t >( from[ 2 ] ) << 16 ) |
+               ( static_cast< uint32_t >( from[ 3 ] ) << 24 );
+    }
+
+    uint32_t BytesPerSample( StreamSampleFormat format )
+    {
+        switch ( format )
+        {
+        case StreamSampleFormat::PCM_8:
+
+            return 1;
+
+        case StreamSampleFormat::PCM_16:
+
+            return 2;
+
+        case StreamSampleFormat::PCM_24:
+
+            return 3;
+
+        case StreamSampleFormat::PCM_32:
+        case StreamSampleFormat::FLOAT_32:
+
+            return 4;
+        }
+
+        return 0;
+    }
+
+    // Convert samples in a particular format to floats in the [-1, 1] range.
+    void ConvertSamples( const uint8_t* source, float* destination, size_t sampleCount, StreamSampleFormat format )
+    {
+        switch ( format )
+        {
+        case StreamSampleFormat::PCM_8:
+
+            for ( size_t sample = 0; sample < sampleCount; ++sample )
+            {
+                destination[ sample ] = ( static_cast< float >( source[ sample ] ) - 128.0f ) * ( 1.0f / 128.0f );
+            }
+            break;
+
+        case StreamSampleFormat::PCM_16:
+
+            for ( size_t sample = 0; sample < sampleCount; ++sample, source += 2 )
+            {
+                destination[ sample ] = static_cast< float >( static_cast< int16_t >( ReadUInt16( source ) ) ) * ( 1.0f / 32768.0f );
+            }
+            break;
+
+        case StreamSampleFormat::PCM_24:
+
+            for ( size_t sample = 0; sample < sampleCount; ++sample, source += 3 )
+            {
+                // shift up to the top of the word and back down to sign extend.
+                int32_t value = static_cast< int32_t >( ( static_cast< uint32_t >( source[ 0 ] ) << 8 ) |
+                                                        ( static_cast< uint32_t >( source[ 1 ] ) << 16 ) |
+                                                        ( static_cast< uint32_t >( source[ 2 ] ) << 24 ) ) >> 8;
+
+                destination[ sample ] = static_cast< float >( value ) * ( 1.0f / 8388608.0f );
+            }
+            break;
+
+        case StreamSampleFormat::PCM_32:
+
+            for ( size_t sample = 0; sample < sampleCount; ++sample, source += 4 )
+            {
+                destination[ sample ] = static_cast< float >( static_cast< int32_t >( ReadUInt32( source ) ) ) * ( 1.0f / 2147483648.0f );
+            }
+            break;
+
+        case StreamSampleFormat::FLOAT_32:
+
+            ::memcpy( destination, source, sampleCount * sizeof( float ) );
+            break;
+        }
+    }
+}
+
+RawStreamAudioSource::RawStreamAudioSource() :
+    File_( nullptr ),
+    OwnsFile_( false ),
+    FramesRemaining_( 0 ),
+    ReadBuffer_( nullptr ),
+    ConvertBuffer_( nullptr ),
+    StreamSampleRate_( 0 ),
+    ChannelCount_( 0 ),
+    BytesPerSample_( 0 ),
+    Format_( StreamSampleFormat::FLOAT_32 )
+{
+}
+
+RawStreamAudioSource::~RawStreamAudioSource()
+{
+    if ( File_ != nullptr && OwnsFile_ )
+    {
+        ::fclose( File_ );
+    }
+
+    File_ = nullptr;
+
+    delete[] ReadBuffer_;
+    ReadBuffer_ = nullptr;
+
+    delete[] ConvertBuffer_;
+    ConvertBuffer_ = nullptr;
+}
+
+bool RawStreamAudioSource::OpenFile( const char* path )
+{
+    if ( File_ != nullptr )
+    {
+        return false;
+    }
+
+    if ( ::strcmp( path, "-" ) == 0 )
+    {
+#if defined( _WIN32 )
+        // stdin defaults to text mode on windows, which mangles binary data.
+        ::_setmode( ::_fileno( stdin ), _O_BINARY );
+#endif
+        File_     = stdin;
+        OwnsFile_ = false;
+    }
+    else
+    {
+        File_     = ::fopen( path, "rb" );
+        OwnsFile_ = true;
+    }
+
+    return File_ != nullptr;
+}
+
+bool RawStreamAudioSource::SetFormat( uint32_t sampleRate, uint32_t channelCount, StreamSampleFormat format, uint64_t frameCount )
+{
+    BytesPerSample_ = BytesPerSample( format );
+
+    if ( sampleRate == 0 || channelCount == 0 || channelCount > MAX_CHANNELS || BytesPerSample_ == 0 )
+    {
+        return false;
+    }
+
+    StreamSampleRate_ = sampleRate;
+    ChannelCount_     = channelCount;
+    Format_           = format;
+    FramesRemaining_  = frameCount;
+
+    delete[] ReadBuffer_;
+    delete[] ConvertBuffer_;
+
+    ReadBuffer_    = new uint8_t[ READ_FRAMES * ChannelCount_ * BytesPerSample_ ];
+    ConvertBuffer_ = new float[ READ_FRAMES * ChannelCount_ ];
+
+    return true;
+}
+
+bool RawStreamAudioSource::Open( const char* path, uint32_t sampleRate, uint32_t channelCount, StreamSampleFormat format )
+{
+    return OpenFile( path ) && SetFormat( sampleRate, channelCount, format, UINT64_MAX );
+}
+
+bool RawStreamAudioSource::Initialize( uint32_t requiredFrequency )
+{
+    return File_ != nullptr && InitializeBuffer( StreamSampleRate_, requiredFrequency );
+}
+
+AudioUpdateResult RawStreamAudioSource::PullAudio()
+{
+    if ( File_ == nullptr )
+    {
+        return AudioUpdateResult::AUDIO_ERROR;
+    }
+
+    size_t frameSize    = ChannelCount_ * BytesPerSample_;
+    size_t framesNeeded = 0;
+
+    // Asked again after each read, as resampling doesn't turn source frames into whole window frames one for one.
+    while ( ( framesNeeded = InputFramesUntilUpdate() ) > 0 )
+    {
+        size_t framesToRead = framesNeeded < READ_FRAMES ? framesNeeded : READ_FRAMES;
+
+        if ( framesToRead > FramesRemaining_ )
+        {
+            framesToRead = static_cast< size_t >( FramesRemaining_ );
+        }
+
+        size_t framesRead = framesToRead > 0 ? ::fread( ReadBuffer_, frameSize, framesToRead, File_ ) : 0;
+
+        if ( framesRead == 0 )
+        {
+            return ::ferror( File_ ) ? AudioUpdateResult::AUDIO_ERROR : AudioUpdateResult::END_OF_STREAM;
+        }
+
+        ConvertSamples( ReadBuffer_, ConvertBuffer_, framesRead * ChannelCount_, Format_ );
+        WriteFrames( ConvertBuffer_, static_cast< uint32_t >( framesRead ), ChannelCount_ );
+
+        if ( FramesRemaining_ != UINT64_MAX )
+        {
+            FramesRemaining_ -= framesRead;
+        }
+    }
+
+    return CheckForUpdate();
+}
+
+bool WavFileAudioSource::Open( const char* path )
+{
+    if ( !OpenFile( path ) )
+    {
+        return false;
+    }
+
+    uint8_t riffHeader[ 12 ];
+
+    if ( ::fread( riffHeader, sizeof( riffHeader ), 1, File_ ) != 1 ||
+         ::memcmp( riffHeader, "RIFF", 4 ) != 0 ||
+         ::memcmp( riffHeader + 8, "WAVE", 4 ) != 0 )
+    {
+        return false;
+    }
+
+    bool               hasFormat      = false;
+    uint32_t           sampleRate     = 0;
+    uint32_t           channelCount   = 0;
+    uint32_t           channelMask    = 0;
+    uint32_t           blockAlign     = 0;
+    StreamSampleFormat format         = StreamSampleFormat::FLOAT_32;
+
+    for ( ;; )
+    {
+        uint8_t chunkHeader[ 8 ];
+
+        if ( ::fread( chunkHeader, sizeof( chunkHeader ), 1, File_ ) != 1 )
+        {
+            return false;
+        }
+
+        uint32_t chunkSize = ReadUInt32( chunkHeader + 4 );
+
+        if ( ::memcmp( chunkHeader, "fmt ", 4 ) == 0 )
+        {
+            uint8_t formatChunk[ 40 ] = {};
+
+            if ( chunkSize < 16 ||
+                 ::fread( formatChunk, chunkSize < sizeof( formatChunk ) ? chunkSize : sizeof( formatChunk ), 1, File_ ) != 1 )
+            {
+                return false;
+            }
+
+            if ( chunkSize > sizeof( formatChunk ) && ::fseek( File_, static_cast< long >( chunkSize - sizeof( formatChunk ) ), SEEK_CUR ) != 0 )
+            {
+                return false;
+            }
+
+            uint16_t formatTag     = ReadUInt16( formatChunk );
+            uint16_t bitsPerSample = ReadUInt16( formatChunk + 14 );
+
+            channelCount = ReadUInt16( formatChunk + 2 );
+            sampleRate   = ReadUInt32( formatChunk + 4 );
+            blockAlign   = ReadUInt16( formatChunk + 12 );
+
+            // extensible keeps the real format tag at the start of the sub-format guid.
+            if ( formatTag == WAVE_FORMAT_EXTENSIBLE_TAG && chunkSize >= 40 )
+            {
+                channelMask = ReadUInt32( formatChunk + 20 );
+                formatTag   = ReadUInt16( formatChunk + 24 );
+            }
+
+            if ( formatTag == WAVE_FORMAT_FLOAT_TAG && bitsPerSample == 32 )
+            {
+                format = StreamSampleFormat::FLOAT_32;
+            }
+            else if ( formatTag == WAVE_FORMAT_PCM_TAG && bitsPerSample == 8 )
+            {
+                format = StreamSampleFormat::PCM_8;
+            }
+            else if ( formatTag == WAVE_FORMAT_PCM_TAG && bitsPerSample == 16 )
+            {
+                format = StreamSampleFormat::PCM_16;
+            }
+            else if ( formatTag == WAVE_FORMAT_PCM_TAG && bitsPerSample == 24 )
+            {
+                format = StreamSampleFormat::PCM_24;
+            }
+            else if ( formatTag == WAVE_FORMAT_PCM_TAG && bitsPerSample == 32 )
+            {
+                format = StreamSampleFormat::PCM_32;
+            }
+            else
+            {
+                return false;
+            }
+
+            if ( blockAlign != channelCount * BytesPerSample( format ) )
+            {
+                return false;
+            }
+
+            hasFormat = true;
+        }
+        else if ( ::memcmp( chunkHeader, "data", 4 ) == 0 )
+        {
+            // sample data follows, so we're done with the header.
+            return hasFormat && 
+                   SetFormat( sampleRate, channelCount, format, chunkSize / blockAlign ) && 
+                   SetDownmixForLayout( channelCount, channelMask );
+        }
+        else if ( ::fseek( File_, static_cast< long >( chunkSize + ( chunkSize & 1 ) ), SEEK_CUR ) != 0 ) // chunks are padded to even sizes
+        {
+            return false;
+        }
+    }
+}
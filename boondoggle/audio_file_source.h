@@ -0,0 +1,71 @@
+#ifndef BOONDOGGLE_AUDIO_FILE_SOURCE_H__
+#define BOONDOGGLE_AUDIO_FILE_SOURCE_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "audio_source.h"
+
+enum class StreamSampleFormat : uint32_t
+{
+    PCM_8    = 0, // unsigned
+    PCM_16   = 1,
+    PCM_24   = 2,
+    PCM_32   = 3,
+    FLOAT_32 = 4
+};
+
+// Reads raw interleaved samples from a file or pipe (stdin for "-").
+// Pulls are not paced to real time; each pull reads exactly enough to complete the next period,
+// so the processing pipeline can be driven as fast as it can go.
+class RawStreamAudioSource : public AudioSource
+{
+public:
+
+    RawStreamAudioSource();
+
+    ~RawStreamAudioSource();
+
+    // Open a raw stream of samples of a particular format, rate and channel count.
+    bool Open( const char* path, uint32_t sampleRate, uint32_t channelCount, StreamSampleFormat format = StreamSampleFormat::FLOAT_32 );
+
+    bool Initialize( uint32_t requiredFrequency ) override;
+
+    // Read the next period from the stream, returns END_OF_STREAM when there isn't a complete period left.
+    AudioUpdateResult PullAudio() override;
+
+    // Number of channels in the stream (before being mapped to stereo).
+    uint32_t ChannelCount() const { return ChannelCount_; }
+
+protected:
+
+    // Open the file handle, "-" gives stdin.
+    bool OpenFile( const char* path );
+
+    // Set the format of the samples in the stream and the number of frames available (UINT64_MAX for unbounded).
+    bool SetFormat( uint32_t sampleRate, uint32_t channelCount, StreamSampleFormat format, uint64_t frameCount );
+
+    FILE*              File_;
+    bool               OwnsFile_;
+    uint64_t           FramesRemaining_;
+    uint8_t*           ReadBuffer_;
+    float*             ConvertBuffer_;
+    uint32_t           StreamSampleRate_;
+    uint32_t           ChannelCount_;
+    uint32_t           BytesPerSample_;
+    StreamSampleFormat Format_;
+
+};
+
+// Reads a RIFF WAVE file (8/16/24/32 bit integer PCM or 32 bit float).
+class WavFileAudioSource : public RawStreamAudioSource
+{
+public:
+
+    // Open a wav file and parse its header, leaving the file at the start of the sample data.
+    bool Open( const char* path );
+
+};
+
+#endif // -- BOONDOGGLE_AUDIO_FILE_SOURCE_H__
@@ -0,0 +1,218 @@
+#include "audio_filterbank.h"
+#include "../common/boondoggle_helpers.h"
+#include <math.h>
+
+namespace
+{
+    const size_t WEIGHT_ALIGNMENT = 32;
+
+    // Mel scale (O'Shaughnessy's formula).
+    double ToMel( double frequency ) { return 2595.0 * log10( 1.0 + frequency / 700.0 ); }
+
+    double FromMel( double mel ) { return 700.0 * ( pow( 10.0, mel / 2595.0 ) - 1.0 ); }
+
+    // Bark scale (Traunmuller's formula).
+    double ToBark( double frequency ) { return ( 26.81 * frequency ) / ( 1960.0 + frequency ) - 0.53; }
+
+    double FromBark( double bark ) { return ( 1960.0 * ( bark + 0.53 ) ) / ( 26.28 - bark ); }
+
+    // Weight of the triangle rising from lower to a peak at center and falling to upper, at a frequency.
+    float TriangleWeight( float lower, float center, float upper, float frequency )
+    {
+        if ( frequency <= lower || frequency >= upper )
+        {
+            return 0.0f;
+        }
+
+        return frequency <= center ? ( frequency - lower ) / ( center - lower ) : ( upper - frequency ) / ( upper - center );
+    }
+
+    // The run of bins a bucket's filter covers, [ first, last ]. If no bin is under the triangle, the
+    // run is the two bins either side of its peak and interpolate is set.
+    void BucketBins( const float* edges, float binFrequency, uint32_t binCount, uint32_t& first, uint32_t& last, bool& interpolate )
+    {
+        double lowerBin = floor( edges[ 0 ] / binFrequency ) + 1.0;
+        double upperBin = ceil( edges[ 2 ] / binFrequency ) - 1.0;
+
+        // Skip DC, the window leaks it into the bottom bins anyway.
+        first       = lowerBin > 1.0 ? static_cast< uint32_t >( lowerBin ) : 1;
+        last        = upperBin < binCount - 1 ? static_cast< uint32_t >( upperBin > 0.0 ? upperBin : 0.0 ) : binCount - 1;
+        interpolate = first > last;
+
+        if ( interpolate )
+        {
+            double peakBin = floor( edges[ 1 ] / binFrequency );
+
+            first = peakBin > 1.0 ? static_cast< uint32_t >( peakBin ) : 1;
+            first = first < binCount - 2 ? first : binCount - 2;
+            last  = first + 1;
+        }
+    }
+}
+
+const char* FrequencyBucketingName( FrequencyBucketing bucketing )
+{
+    switch ( bucketing )
+    {
+    case FrequencyBucketing::PEAK_BINS:
+
+        return "peak";
+
+    case FrequencyBucketing::MEL:
+
+        return "mel";
+
+    case FrequencyBucketing::BARK:
+
+        return "bark";
+
+    case FrequencyBucketing::CUSTOM:
+
+        return "custom";
+
+    default:
+
+        return "unknown";
+    }
+}
+
+Filterbank::Filterbank() :
+    Memory_( nullptr ),
+    Bands_( nullptr ),
+    Weights_( nullptr ),
+    BucketCount_( 0 ),
+    BinsUsed_( 0 )
+{
+}
+
+Filterbank::~Filterbank()
+{
+    AlignedFree( Memory_ );
+}
+
+bool Filterbank::ScaleEdges( FrequencyBucketing bucketing, uint32_t bucketCount, float lowFrequency, float highFrequency, float* edges )
+{
+    double ( *toScale )( double );
+    double ( *fromScale )( double );
+
+    switch ( bucketing )
+    {
+    case FrequencyBucketing::MEL:
+
+        toScale   = ToMel;
+        fromScale = FromMel;
+        break;
+
+    case FrequencyBucketing::BARK:
+
+        toScale   = ToBark;
+        fromScale = FromBark;
+        break;
+
+    default:
+
+        return false;
+    }
+
+    double low   = toScale( lowFrequency );
+    double range = toScale( highFrequency ) - low;
+
+    for ( uint32_t edge = 0; edge < bucketCount + 2; ++edge )
+    {
+        edges[ edge ] = static_cast< float >( fromScale( low + ( range * edge ) / ( bucketCount + 1 ) ) );
+    }
+
+    // Exactly the requested range, whatever the round trip through the scale did.
+    edges[ 0 ]               = lowFrequency;
+    edges[ bucketCount + 1 ] = highFrequency;
+
+    return true;
+}
+
+bool Filterbank::Initialize( const float* edges, uint32_t bucketCount, float binFrequency, uint32_t binCount, float powerScale )
+{
+    if ( bucketCount == 0 || binFrequency <= 0.0f || binCount < 3 )
+    {
+        return false;
+    }
+
+    for ( uint32_t edge = 0; edge < bucketCount + 1; ++edge )
+    {
+        if ( !( edges[ edge + 1 ] > edges[ edge ] ) )
+        {
+            return false;
+        }
+    }
+
+    size_t weightCount = 0;
+
+    for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+    {
+        uint32_t first;
+        uint32_t last;
+        bool     interpolate;
+
+        BucketBins( edges + bucket, binFrequency, binCount, first, last, interpolate );
+
+        weightCount += ( last - first + FILTERBANK_BAND_ALIGNMENT ) & ~( FILTERBANK_BAND_ALIGNMENT - 1 );
+    }
+
+    size_t bandBytes = ( sizeof( FilterbankBand ) * bucketCount + WEIGHT_ALIGNMENT - 1 ) & ~( WEIGHT_ALIGNMENT - 1 );
+
+    AlignedFree( Memory_ );
+
+    Memory_ = AlignedAllocateZeroed( bandBytes + sizeof( float ) * weightCount, WEIGHT_ALIGNMENT );
+
+    if ( Memory_ == nullptr )
+    {
+        BucketCount_ = 0;
+        return false;
+    }
+
+    Bands_       = reinterpret_cast< FilterbankBand* >( Memory_ );
+    Weights_     = reinterpret_cast< float* >( reinterpret_cast< uint8_t* >( Memory_ ) + bandBytes );
+    BucketCount_ = bucketCount;
+    BinsUsed_    = 0;
+
+    uint32_t weightOffset = 0;
+
+    for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+    {
+        const float*    bucketEdges = edges + bucket;
+        FilterbankBand& band        = Bands_[ bucket ];
+        uint32_t        first;
+        uint32_t        last;
+        bool            interpolate;
+
+        BucketBins( bucketEdges, binFrequency, binCount, first, last, interpolate );
+
+        band.FirstBin     = first;
+        band.BinCount     = ( last - first + FILTERBANK_BAND_ALIGNMENT ) & ~( FILTERBANK_BAND_ALIGNMENT - 1 );
+        band.WeightOffset = weightOffset;
+
+        float* weights = Weights_ + weightOffset;
+
+        if ( interpolate )
+        {
+            float fraction = bucketEdges[ 1 ] / binFrequency - static_cast< float >( first );
+
+            fraction = fraction < 0.0f ? 0.0f : ( fraction > 1.0f ? 1.0f : fraction );
+
+            weights[ 0 ] = ( 1.0f - fraction ) * powerScale;
+            weights[ 1 ] = fraction * powerScale;
+        }
+        else
+        {
+            for ( uint32_t bin = first; bin <= last; ++bin )
+            {
+                weights[ bin - first ] = 
+                    TriangleWeight( bucketEdges[ 0 ], bucketEdges[ 1 ], bucketEdges[ 2 ], bin * binFrequency ) * powerScale;
+            }
+        }
+
+        weightOffset += band.BinCount;
+        BinsUsed_     = last + 1 > BinsUsed_ ? last + 1 : BinsUsed_;
+    }
+
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef BOONDOGGLE_AUDIO_FILTERBANK_H__
+#define BOONDOGGLE_AUDIO_FILTERBANK_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "audio_kernels.h"
+
+// How the spectrum is split into frequency buckets.
+enum class FrequencyBucketing : uint32_t
+{
+    PEAK_BINS = 0, // the loudest bin of a contiguous run of bins, runs on a square root frequency curve.
+    MEL       = 1, // triangular filters evenly spaced on the mel scale, summing the power under them.
+    BARK      = 2, // triangular filters evenly spaced on the bark scale.
+    CUSTOM    = 3  // triangular filters on given edge frequencies.
+};
+
+// Name of a bucketing, for reports.
+const char* FrequencyBucketingName( FrequencyBucketing bucketing );
+
+// A bank of overlapping triangular filters over the power spectrum, stored as a sparse matrix: each filter
+// only keeps the weights of the run of bins it covers (padded out for the kernels). Bucket n rises from
+// edge n to a peak at edge n + 1 and falls to edge n + 2, so neighbouring filters cross at half weight and
+// a tone between two centers is shared out between them rather than jumping from one bucket to the next.
+class Filterbank
+{
+public:
+
+    Filterbank();
+
+    ~Filterbank();
+
+    // Fill bucketCount + 2 edges evenly spaced on the scale of a bucketing (MEL or BARK) from
+    // lowFrequency to highFrequency. Returns false if the bucketing doesn't have a scale.
+    static bool ScaleEdges( FrequencyBucketing bucketing, uint32_t bucketCount, float lowFrequency, float highFrequency, float* edges );
+
+    // Build the filters for bucketCount buckets on the edges (bucketCount + 2 ascending frequencies in Hz),
+    // over binCount bins binFrequency apart (DC is left out). Weights are scaled by powerScale.
+    // Filters too narrow to have any bin under them interpolate between the bins either side of their peak.
+    bool Initialize( const float* edges, uint32_t bucketCount, float binFrequency, uint32_t binCount, float powerScale );
+
+    // Bucket power for both channels (bucketPower is [2][BucketCount]) from power laid out as for the kernel.
+    void Apply( const AudioKernels& kernels, const float* power, size_t channelStride, float* bucketPower ) const
+    {
+        kernels.Filterbank( power, channelStride, Bands_, BucketCount_, Weights_, bucketPower );
+    }
+
+    uint32_t BucketCount() const { return BucketCount_; }
+
+    const FilterbankBand* Bands() const { return Bands_; }
+
+    const float* Weights() const { return Weights_; }
+
+    // Bins of power needed before the padding, one past the last bin with a weight.
+    uint32_t BinsUsed() const { return BinsUsed_; }
+
+    // Power to allocate per channel for a spectrum of binCount bins, enough for the kernels to read past the end.
+    static size_t PowerStride( uint32_t binCount )
+    {
+        return ( ( binCount + FILTERBANK_BAND_ALIGNMENT - 1 ) & ~( FILTERBANK_BAND_ALIGNMENT - 1 ) ) + FILTERBANK_BAND_ALIGNMENT;
+    }
+
+    Filterbank( const Filterbank& ) = delete;
+
+    Filterbank& operator=( const Filterbank& ) = delete;
+
+private:
+
+    void*           Memory_;
+    FilterbankBand* Bands_;
+    float*          Weights_; // 32 byte aligned, each band's weights start on a multiple of FILTERBANK_BAND_ALIGNMENT.
+    uint32_t        BucketCount_;
+    uint32_t        BinsUsed_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_FILTERBANK_H__
@@ -0,0 +1,68 @@
+#include "audio_history.h"
+#include "audio_kernels.h"
+#include "../common/boondoggle_helpers.h"
+#include <string.h>
+
+AudioHistory::AudioHistory() :
+    Rows_( nullptr ),
+    TextureRows_( 0 ),
+    RowTexels_( 0 ),
+    BucketTexels_( 0 ),
+    TextureBytes_( 0 ),
+    RowBytes_( 0 ),
+    Format_( SoundTextureFormat::FLOAT32 ),
+    Written_( 0 )
+{
+}
+
+AudioHistory::~AudioHistory()
+{
+    AlignedFree( Rows_ );
+}
+
+bool AudioHistory::Initialize( uint32_t textureRows, size_t samples, SoundTextureFormat format, uint32_t bucketCount )
+{
+    AlignedFree( Rows_ );
+
+    Rows_         = nullptr;
+    TextureRows_  = textureRows;
+    BucketTexels_ = SoundBucketRegisters( bucketCount );
+    RowTexels_    = static_cast< uint32_t >( samples ) + BucketTexels_;
+    TextureBytes_ = samples * SoundTexelBytes( format );
+    RowBytes_     = RowTexels_ * SoundTexelBytes( format );
+    Format_       = format;
+    Written_      = 0;
+
+    if ( textureRows == 0 )
+    {
+        return true;
+    }
+
+    // Zero bits are silence in either format.
+    Rows_ = reinterpret_cast< uint8_t* >( AlignedAllocateZeroed( RowBytes_ * textureRows * 2, 16 ) );
+
+    return Rows_ != nullptr;
+}
+
+void AudioHistory::Write( const void* textureData, const PerFrameConstants& constants )
+{
+    if ( Rows_ == nullptr )
+    {
+        return;
+    }
+
+    uint8_t* row = Rows_ + ( Written_ % ( static_cast< uint64_t >( TextureRows_ ) * 2 ) ) * RowBytes_;
+
+    ::memcpy( row, textureData, TextureBytes_ );
+
+    if ( Format_ == SoundTextureFormat::HALF )
+    {
+        GetAudioKernels().FloatToHalf( &constants.SoundFrequencyBuckets[ 0 ][ 0 ], BucketTexels_ * 4, reinterpret_cast< uint16_t* >( row + TextureBytes_ ) );
+    }
+    else
+    {
+        ::memcpy( row + TextureBytes_, constants.SoundFrequencyBuckets, BucketTexels_ * 4 * sizeof( float ) );
+    }
+
+    ++Written_;
+}
@@ -0,0 +1,65 @@
+#ifndef BOONDOGGLE_AUDIO_HISTORY_H__
+#define BOONDOGGLE_AUDIO_HISTORY_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "audio.h"
+
+// The sound history kept on the CPU, one row per audio update: the sound texture data followed by the frequency
+// buckets (two to a texel) in the same format, so each row is uploaded to the history texture as it is.
+//
+// One thread writes a row for every update and another uploads the rows written since its last upload, going
+// by the count published with the update. The ring holds twice the texture's rows, so the writer would have to
+// get a whole texture of updates ahead of the reader to write over a row that could still be uploading.
+class AudioHistory
+{
+public:
+
+    AudioHistory();
+
+    ~AudioHistory();
+
+    // Allocate the rows for a history texture of textureRows rows, starting silent. Returns false if it
+    // couldn't. With 0 rows there's no history and writes do nothing.
+    bool Initialize( uint32_t textureRows, size_t samples, SoundTextureFormat format, uint32_t bucketCount );
+
+    // Writer only. Add the row for an update, from its sound texture data (samples texels in the format) and
+    // the buckets in its constants.
+    void Write( const void* textureData, const PerFrameConstants& constants );
+
+    // Rows written so far, on the writer's thread. Readers use the count published with the update.
+    uint64_t Written() const { return Written_; }
+
+    // Rows in the history texture, 0 if there's no history.
+    uint32_t TextureRows() const { return TextureRows_; }
+
+    // Width of the history texture in texels.
+    uint32_t RowTexels() const { return RowTexels_; }
+
+    size_t RowBytes() const { return RowBytes_; }
+
+    SoundTextureFormat Format() const { return Format_; }
+
+    // A written row by its count, rows at the same place in the texture (count mod TextureRows) follow it
+    // in memory up to the end of the texture.
+    const void* Row( uint64_t row ) const { return Rows_ + ( row % ( static_cast< uint64_t >( TextureRows_ ) * 2 ) ) * RowBytes_; }
+
+    AudioHistory( const AudioHistory& ) = delete;
+
+    AudioHistory& operator=( const AudioHistory& ) = delete;
+
+private:
+
+    uint8_t*           Rows_;
+    uint32_t           TextureRows_;
+    uint32_t           RowTexels_;
+    uint32_t           BucketTexels_;
+    size_t             TextureBytes_;
+    size_t             RowBytes_;
+    SoundTextureFormat Format_;
+    uint64_t           Written_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_HISTORY_H__
@@ -0,0 +1,929 @@
+#include "audio_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define AUDIO_KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define AUDIO_KERNELS_X86 0
+#endif
+
+#if AUDIO_KERNELS_X86 && defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+// MSVC lets us use any intrinsics anywhere, gcc and clang need the target enabled per function.
+#if defined( _MSC_VER )
+#define AUDIO_TARGET_SSE41
+#define AUDIO_TARGET_AVX2
+#else
+#define AUDIO_TARGET_SSE41 __attribute__( ( target( "sse4.1" ) ) )
+#define AUDIO_TARGET_AVX2  __attribute__( ( target( "avx2,f16c" ) ) )
+#endif
+
+namespace
+{
+    // Normalized power of a single bin.
+    inline float BinPower( const kiss_fft_cpx& bin, float normalizationSquared )
+    {
+        return ( bin.r * bin.r + bin.i * bin.i ) * normalizationSquared;
+    }
+
+    void WindowStereoScalar( const float* left,
+                             const float* right,
+                             const float* window,
+                             float* windowed,
+                             float* textureData,
+                             size_t count,
+                             float* sumSquares )
+    {
+        float sumLeft  = 0.0f;
+        float sumRight = 0.0f;
+
+        for ( size_t frame = 0; frame < count; ++frame )
+        {
+            float leftValue  = left[ frame ];
+            float rightValue = right[ frame ];
+
+            sumLeft                       += leftValue * leftValue;
+            sumRight                      += rightValue * rightValue;
+            windowed[ frame * 2 ]          = leftValue * window[ frame ];
+            windowed[ frame * 2 + 1 ]      = rightValue * window[ frame ];
+            textureData[ frame * 4 ]       = leftValue;
+            textureData[ frame * 4 + 1 ]   = rightValue;
+        }
+
+        sumSquares[ 0 ] = sumLeft;
+        sumSquares[ 1 ] = sumRight;
+    }
+
+    void WindowMonoScalar( const float* channel,
+                           const float* window,
+                           float* windowed,
+                           float* textureData,
+                           size_t count,
+                           float* sumSquares )
+    {
+        float sum = 0.0f;
+
+        for ( size_t frame = 0; frame < count; ++frame )
+        {
+            float value = channel[ frame ];
+
+            sum                          += value * value;
+            windowed[ frame ]             = value * window[ frame ];
+            textureData[ frame * 4 ]      = value;
+            textureData[ frame * 4 + 1 ]  = value;
+        }
+
+        *sumSquares = sum;
+    }
+
+    // Write magnitudes for a range of bins without bucketing them.
+    void MagnitudesScalar( const kiss_fft_cpx* left,
+                           const kiss_fft_cpx* right,
+                           uint32_t begin,
+                           uint32_t end,
+                           float normalizationSquared,
+                           float* textureData )
+    {
+        for ( uint32_t bin = begin; bin < end; ++bin )
+        {
+            textureData[ bin * 4 + 2 ] = sqrtf( BinPower( left[ bin ], normalizationSquared ) );
+            textureData[ bin * 4 + 3 ] = sqrtf( BinPower( right[ bin ], normalizationSquared ) );
+        }
+    }
+
+    // Write magnitudes for a range of bins, returning the max power in the range for each channel.
+    void BucketScalar( const kiss_fft_cpx* left,
+                       const kiss_fft_cpx* right,
+                       uint32_t begin,
+                       uint32_t end,
+                       float normalizationSquared,
+                       float* textureData,
+                       float* maxLeft,
+                       float* maxRight )
+    {
+        float leftMax  = *maxLeft;
+        float rightMax = *maxRight;
+
+        for ( uint32_t bin = begin; bin < end; ++bin )
+        {
+            float leftPower  = BinPower( left[ bin ], normalizationSquared );
+            float rightPower = BinPower( right[ bin ], normalizationSquared );
+
+            textureData[ bin * 4 + 2 ] = sqrtf( leftPower );
+            textureData[ bin * 4 + 3 ] = sqrtf( rightPower );
+
+            leftMax  = leftPower > leftMax ? leftPower : leftMax;
+            rightMax = rightPower > rightMax ? rightPower : rightMax;
+        }
+
+        *maxLeft  = leftMax;
+        *maxRight = rightMax;
+    }
+
+    void SpectrumStereoScalar( const kiss_fft_cpx* left,
+                               const kiss_fft_cpx* right,
+                               uint32_t binCount,
+                               float normalization,
+                               const uint32_t* bucketBoundaries,
+                               uint32_t bucketCount,
+                               float* textureData,
+                               float* bucketPower )
+    {
+        float normalizationSquared = normalization * normalization;
+
+        MagnitudesScalar( left, right, 0, bucketBoundaries[ 0 ], normalizationSquared, textureData );
+
+        for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+        {
+            float maxLeft  = 0.0f;
+            float maxRight = 0.0f;
+
+            BucketScalar( left, right, bucketBoundaries[ bucket ], bucketBoundaries[ bucket + 1 ], normalizationSquared, textureData, &maxLeft, &maxRight );
+
+            bucketPower[ bucket ]               = maxLeft;
+            bucketPower[ bucketCount + bucket ] = maxRight;
+        }
+
+        MagnitudesScalar( left, right, bucketBoundaries[ bucketCount ], binCount, normalizationSquared, textureData );
+    }
+
+    // Write magnitudes and power for a range of bins.
+    void PowerScalar( const kiss_fft_cpx* left,
+                      const kiss_fft_cpx* right,
+                      uint32_t begin,
+                      uint32_t end,
+                      float normalizationSquared,
+                      float* textureData,
+                      float* powerLeft,
+                      float* powerRight )
+    {
+        for ( uint32_t bin = begin; bin < end; ++bin )
+        {
+            float leftPower  = BinPower( left[ bin ], normalizationSquared );
+            float rightPower = BinPower( right[ bin ], normalizationSquared );
+
+            textureData[ bin * 4 + 2 ] = sqrtf( leftPower );
+            textureData[ bin * 4 + 3 ] = sqrtf( rightPower );
+            powerLeft[ bin ]           = leftPower;
+            powerRight[ bin ]          = rightPower;
+        }
+    }
+
+    void SpectrumPowerScalar( const kiss_fft_cpx* left,
+                              const kiss_fft_cpx* right,
+                              uint32_t binCount,
+                              float normalization,
+                              float* textureData,
+                              float* power,
+                              size_t channelStride )
+    {
+        PowerScalar( left, right, 0, binCount, normalization * normalization, textureData, power, power + channelStride );
+    }
+
+    void FilterbankScalar( const float* power,
+                           size_t channelStride,
+                           const FilterbankBand* bands,
+                           uint32_t bandCount,
+                           const float* weights,
+                           float* bucketPower )
+    {
+        for ( uint32_t band = 0; band < bandCount; ++band )
+        {
+            const float* bandWeights = weights + bands[ band ].WeightOffset;
+            const float* left        = power + bands[ band ].FirstBin;
+            const float* right       = left + channelStride;
+            float        sumLeft     = 0.0f;
+            float        sumRight    = 0.0f;
+
+            for ( uint32_t bin = 0; bin < bands[ band ].BinCount; ++bin )
+            {
+                sumLeft  += bandWeights[ bin ] * left[ bin ];
+                sumRight += bandWeights[ bin ] * right[ bin ];
+            }
+
+            bucketPower[ band ]             = sumLeft;
+            bucketPower[ bandCount + band ] = sumRight;
+        }
+    }
+
+    void DeinterleaveScalar( const float* interleaved, size_t count, float* left, float* right )
+    {
+        for ( size_t frame = 0; frame < count; ++frame )
+        {
+            left[ frame ]  = interleaved[ frame * 2 ];
+            right[ frame ] = interleaved[ frame * 2 + 1 ];
+        }
+    }
+
+    void DownmixScalar( const float* interleaved,
+                        size_t count,
+                        uint32_t channelCount,
+                        const float* leftCoefficients,
+                        const float* rightCoefficients,
+                        float* left,
+                        float* right )
+    {
+        for ( size_t frame = 0; frame < count; ++frame, interleaved += channelCount )
+        {
+            float leftValue  = 0.0f;
+            float rightValue = 0.0f;
+
+            for ( uint32_t channel = 0; channel < channelCount; ++channel )
+            {
+                leftValue  += interleaved[ channel ] * leftCoefficients[ channel ];
+                rightValue += interleaved[ channel ] * rightCoefficients[ channel ];
+            }
+
+            left[ frame ]  = leftValue;
+            right[ frame ] = rightValue;
+        }
+    }
+
+    // Round to nearest even like the hardware conversion, out of range values go to infinity and NaNs stay NaN.
+    inline uint16_t FloatToHalfValue( float value )
+    {
+        const uint32_t HALF_OVERFLOW  = ( 127 + 16 ) << 23;               // 65536, anything this big rounds to infinity.
+        const uint32_t HALF_NORMAL    = ( 127 - 14 ) << 23;               // smallest normal half.
+        const uint32_t DENORMAL_MAGIC = ( ( 127 - 15 ) + ( 23 - 10 ) + 1 ) << 23; // 0.5, aligns denormal mantissas at the bottom.
+
+        uint32_t bits;
+
+        ::memcpy( &bits, &value, sizeof( bits ) );
+
+        uint32_t sign   = ( bits >> 16 ) & 0x8000;
+        uint32_t result = 0;
+
+        bits &= 0x7FFFFFFF;
+
+        if ( bits >= HALF_OVERFLOW )
+        {
+            result = bits > 0x7F800000 ? 0x7E00 : 0x7C00;
+        }
+        else if ( bits < HALF_NORMAL )
+        {
+            // Adding 0.5 lines the mantissa up so the float add does the rounding for us.
+            float magic;
+            float shifted;
+
+            ::memcpy( &magic, &DENORMAL_MAGIC, sizeof( magic ) );
+            ::memcpy( &shifted, &bits, sizeof( shifted ) );
+
+            shifted += magic;
+
+            ::memcpy( &result, &shifted, sizeof( result ) );
+
+            result -= DENORMAL_MAGIC;
+        }
+        else
+        {
+            uint32_t mantissaOdd = ( bits >> 13 ) & 1;
+
+            // Re-bias the exponent and round, a carry out of the mantissa bumps the exponent as it should.
+            bits  += ( static_cast< uint32_t >( 15 - 127 ) << 23 ) + 0xFFF + mantissaOdd;
+            result = bits >> 13;
+        }
+
+        return static_cast< uint16_t >( result | sign );
+    }
+
+    void FloatToHalfScalar( const float* input, size_t count, uint16_t* output )
+    {
+        for ( size_t where = 0; where < count; ++where )
+        {
+            output[ where ] = FloatToHalfValue( input[ where ] );
+        }
+    }
+
+#if AUDIO_KERNELS_X86
+
+    // Store 2 interleaved floats from each half of a register to consecutive texels.
+    AUDIO_TARGET_SSE41 inline void StoreTexelPairs( float* texel, __m128 interleaved )
+    {
+        _mm_storel_pi( reinterpret_cast< __m64* >( texel ), interleaved );
+        _mm_storeh_pi( reinterpret_cast< __m64* >( texel + 4 ), interleaved );
+    }
+
+    AUDIO_TARGET_SSE41 inline float HorizontalAdd( __m128 value )
+    {
+        value = _mm_add_ps( value, _mm_movehl_ps( value, value ) );
+        value = _mm_add_ss( value, _mm_shuffle_ps( value, value, 1 ) );
+
+        return _mm_cvtss_f32( value );
+    }
+
+    AUDIO_TARGET_SSE41 inline float HorizontalMax( __m128 value )
+    {
+        value = _mm_max_ps( value, _mm_movehl_ps( value, value ) );
+        value = _mm_max_ss( value, _mm_shuffle_ps( value, value, 1 ) );
+
+        return _mm_cvtss_f32( value );
+    }
+
+    // Normalized power of 4 consecutive bins.
+    AUDIO_TARGET_SSE41 inline __m128 BinPower4( const kiss_fft_cpx* bins, __m128 normalizationSquared )
+    {
+        __m128 low  = _mm_loadu_ps( reinterpret_cast< const float* >( bins ) );
+        __m128 high = _mm_loadu_ps( reinterpret_cast< const float* >( bins + 2 ) );
+
+        return _mm_mul_ps( _mm_hadd_ps( _mm_mul_ps( low, low ), _mm_mul_ps( high, high ) ), normalizationSquared );
+    }
+
+    AUDIO_TARGET_SSE41 void WindowStereoSSE41( const float* left,
+                                               const float* right,
+                                               const float* window,
+                                               float* windowed,
+                                               float* textureData,
+                                               size_t count,
+                                               float* sumSquares )
+    {
+        __m128 sumLeft  = _mm_setzero_ps();
+        __m128 sumRight = _mm_setzero_ps();
+        size_t frame    = 0;
+
+        for ( ; frame + 4 <= count; frame += 4 )
+        {
+            __m128 leftValues   = _mm_loadu_ps( left + frame );
+            __m128 rightValues  = _mm_loadu_ps( right + frame );
+            __m128 windowValues = _mm_loadu_ps( window + frame );
+
+            sumLeft  = _mm_add_ps( sumLeft, _mm_mul_ps( leftValues, leftValues ) );
+            sumRight = _mm_add_ps( sumRight, _mm_mul_ps( rightValues, rightValues ) );
+
+            __m128 windowedLeft  = _mm_mul_ps( leftValues, windowValues );
+            __m128 windowedRight = _mm_mul_ps( rightValues, windowValues );
+
+            _mm_storeu_ps( windowed + frame * 2, _mm_unpacklo_ps( windowedLeft, windowedRight ) );
+            _mm_storeu_ps( windowed + frame * 2 + 4, _mm_unpackhi_ps( windowedLeft, windowedRight ) );
+
+            StoreTexelPairs( textureData + frame * 4, _mm_unpacklo_ps( leftValues, rightValues ) );
+            StoreTexelPairs( textureData + frame * 4 + 8, _mm_unpackhi_ps( leftValues, rightValues ) );
+        }
+
+        WindowStereoScalar( left + frame, right + frame, window + frame, windowed + frame * 2, textureData + frame * 4, count - frame, sumSquares );
+
+        sumSquares[ 0 ] += HorizontalAdd( sumLeft );
+        sumSquares[ 1 ] += HorizontalAdd( sumRight );
+    }
+
+    AUDIO_TARGET_SSE41 void WindowMonoSSE41( const float* channel,
+                                             const float* window,
+                                             float* windowed,
+                                             float* textureData,
+                                             size_t count,
+                                             float* sumSquares )
+    {
+        __m128 sum   = _mm_setzero_ps();
+        size_t frame = 0;
+
+        for ( ; frame + 4 <= count; frame += 4 )
+        {
+            __m128 values = _mm_loadu_ps( channel + frame );
+
+            sum = _mm_add_ps( sum, _mm_mul_ps( values, values ) );
+
+            _mm_storeu_ps( windowed + frame, _mm_mul_ps( values, _mm_loadu_ps( window + frame ) ) );
+
+            StoreTexelPairs( textureData + frame * 4, _mm_unpacklo_ps( values, values ) );
+            StoreTexelPairs( textureData + frame * 4 + 8, _mm_unpackhi_ps( values, values ) );
+        }
+
+        WindowMonoScalar( channel + frame, window + frame, windowed + frame, textureData + frame * 4, count - frame, sumSquares );
+
+        *sumSquares += HorizontalAdd( sum );
+    }
+
+    AUDIO_TARGET_SSE41 void SpectrumStereoSSE41( const kiss_fft_cpx* left,
+                                                 const kiss_fft_cpx* right,
+                                                 uint32_t binCount,
+                                                 float normalization,
+                                                 const uint32_t* bucketBoundaries,
+                                                 uint32_t bucketCount,
+                                                 float* textureData,
+                                                 float* bucketPower )
+    {
+        float  normalizationSquared = normalization * normalization;
+        __m128 normalizationWide    = _mm_set1_ps( normalizationSquared );
+
+        MagnitudesScalar( left, right, 0, bucketBoundaries[ 0 ], normalizationSquared, textureData );
+
+        for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+        {
+            uint32_t bin      = bucketBoundaries[ bucket ];
+            uint32_t end      = bucketBoundaries[ bucket + 1 ];
+            __m128   maxLeft  = _mm_setzero_ps();
+            __m128   maxRight = _mm_setzero_ps();
+
+            for ( ; bin + 4 <= end; bin += 4 )
+            {
+                __m128 leftPower  = BinPower4( left + bin, normalizationWide );
+                __m128 rightPower = BinPower4( right + bin, normalizationWide );
+                __m128 leftMag    = _mm_sqrt_ps( leftPower );
+                __m128 rightMag   = _mm_sqrt_ps( rightPower );
+
+                StoreTexelPairs( textureData + bin * 4 + 2, _mm_unpacklo_ps( leftMag, rightMag ) );
+                StoreTexelPairs( textureData + bin * 4 + 10, _mm_unpackhi_ps( leftMag, rightMag ) );
+
+                maxLeft  = _mm_max_ps( maxLeft, leftPower );
+                maxRight = _mm_max_ps( maxRight, rightPower );
+            }
+
+            float bucketMaxLeft  = HorizontalMax( maxLeft );
+            float bucketMaxRight = HorizontalMax( maxRight );
+
+            BucketScalar( left, right, bin, end, normalizationSquared, textureData, &bucketMaxLeft, &bucketMaxRight );
+
+            bucketPower[ bucket ]               = bucketMaxLeft;
+            bucketPower[ bucketCount + bucket ] = bucketMaxRight;
+        }
+
+        uint32_t bin = bucketBoundaries[ bucketCount ];
+
+        for ( ; bin + 4 <= binCount; bin += 4 )
+        {
+            __m128 leftMag  = _mm_sqrt_ps( BinPower4( left + bin, normalizationWide ) );
+            __m128 rightMag = _mm_sqrt_ps( BinPower4( right + bin, normalizationWide ) );
+
+            StoreTexelPairs( textureData + bin * 4 + 2, _mm_unpacklo_ps( leftMag, rightMag ) );
+            StoreTexelPairs( textureData + bin * 4 + 10, _mm_unpackhi_ps( leftMag, rightMag ) );
+        }
+
+        MagnitudesScalar( left, right, bin, binCount, normalizationSquared, textureData );
+    }
+
+    AUDIO_TARGET_SSE41 void SpectrumPowerSSE41( const kiss_fft_cpx* left,
+                                                const kiss_fft_cpx* right,
+                                                uint32_t binCount,
+                                                float normalization,
+                                                float* textureData,
+                                                float* power,
+                                                size_t channelStride )
+    {
+        float    normalizationSquared = normalization * normalization;
+        __m128   normalizationWide    = _mm_set1_ps( normalizationSquared );
+        float*   powerLeft            = power;
+        float*   powerRight           = power + channelStride;
+        uint32_t bin                  = 0;
+
+        for ( ; bin + 4 <= binCount; bin += 4 )
+        {
+            __m128 leftPower  = BinPower4( left + bin, normalizationWide );
+            __m128 rightPower = BinPower4( right + bin, normalizationWide );
+            __m128 leftMag    = _mm_sqrt_ps( leftPower );
+            __m128 rightMag   = _mm_sqrt_ps( rightPower );
+
+            _mm_storeu_ps( powerLeft + bin, leftPower );
+            _mm_storeu_ps( powerRight + bin, rightPower );
+
+            StoreTexelPairs( textureData + bin * 4 + 2, _mm_unpacklo_ps( leftMag, rightMag ) );
+            StoreTexelPairs( textureData + bin * 4 + 10, _mm_unpackhi_ps( leftMag, rightMag ) );
+        }
+
+        PowerScalar( left, right, bin, binCount, normalizationSquared, textureData, powerLeft, powerRight );
+    }
+
+    AUDIO_TARGET_SSE41 void FilterbankSSE41( const float* power,
+                                             size_t channelStride,
+                                             const FilterbankBand* bands,
+                                             uint32_t bandCount,
+                                             const float* weights,
+                                             float* bucketPower )
+    {
+        for ( uint32_t band = 0; band < bandCount; ++band )
+        {
+            const float* bandWeights = weights + bands[ band ].WeightOffset;
+            const float* left        = power + bands[ band ].FirstBin;
+            const float* right       = left + channelStride;
+            __m128       sumLeft     = _mm_setzero_ps();
+            __m128       sumRight    = _mm_setzero_ps();
+
+            // Bands are a whole number of 8 weights, aligned, the power can be anywhere.
+            for ( uint32_t bin = 0; bin < bands[ band ].BinCount; bin += 8 )
+            {
+                __m128 weightsLow  = _mm_load_ps( bandWeights + bin );
+                __m128 weightsHigh = _mm_load_ps( bandWeights + bin + 4 );
+
+                sumLeft  = _mm_add_ps( sumLeft, _mm_mul_ps( weightsLow, _mm_loadu_ps( left + bin ) ) );
+                sumRight = _mm_add_ps( sumRight, _mm_mul_ps( weightsLow, _mm_loadu_ps( right + bin ) ) );
+                sumLeft  = _mm_add_ps( sumLeft, _mm_mul_ps( weightsHigh, _mm_loadu_ps( left + bin + 4 ) ) );
+                sumRight = _mm_add_ps( sumRight, _mm_mul_ps( weightsHigh, _mm_loadu_ps( right + bin + 4 ) ) );
+            }
+
+            bucketPower[ band ]             = HorizontalAdd( sumLeft );
+            bucketPower[ bandCount + band ] = HorizontalAdd( sumRight );
+        }
+    }
+
+    AUDIO_TARGET_SSE41 void DeinterleaveSSE41( const float* interleaved, size_t count, float* left, float* right )
+    {
+        size_t frame = 0;
+
+        for ( ; frame + 4 <= count; frame += 4 )
+        {
+            __m128 low  = _mm_loadu_ps( interleaved + frame * 2 );
+            __m128 high = _mm_loadu_ps( interleaved + frame * 2 + 4 );
+
+            _mm_storeu_ps( left + frame, _mm_shuffle_ps( low, high, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+            _mm_storeu_ps( right + frame, _mm_shuffle_ps( low, high, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+        }
+
+        DeinterleaveScalar( interleaved + frame * 2, count - frame, left + frame, right + frame );
+    }
+
+    AUDIO_TARGET_SSE41 void DownmixSSE41( const float* interleaved,
+                                          size_t count,
+                                          uint32_t channelCount,
+                                          const float* leftCoefficients,
+                                          const float* rightCoefficients,
+                                          float* left,
+                                          float* right )
+    {
+        uint32_t groups = ( channelCount + 3 ) / 4;
+        size_t   frame  = 0;
+
+        // A frame's last group reads past its channels into the following frames (zero coefficients cancel them),
+        // so the frames that would read off the end have to be done scalar.
+        size_t spareFrames = ( groups * 4 - channelCount + channelCount - 1 ) / channelCount;
+        size_t end         = count > spareFrames ? count - spareFrames : 0;
+
+        // Keep the coefficients in registers (or at least out of the way of the output stores aliasing them).
+        __m128 leftWide[ 8 ];
+        __m128 rightWide[ 8 ];
+
+        for ( uint32_t group = 0; group < groups; ++group )
+        {
+            leftWide[ group ]  = _mm_loadu_ps( leftCoefficients + group * 4 );
+            rightWide[ group ] = _mm_loadu_ps( rightCoefficients + group * 4 );
+        }
+
+        for ( ; frame + 4 <= end; frame += 4 )
+        {
+            __m128 sums[ 8 ];
+
+            for ( uint32_t lane = 0; lane < 4; ++lane )
+            {
+                const float* samples  = interleaved + ( frame + lane ) * channelCount;
+                __m128       sumLeft  = _mm_setzero_ps();
+                __m128       sumRight = _mm_setzero_ps();
+
+                for ( uint32_t group = 0; group < groups; ++group )
+                {
+                    __m128 values = _mm_loadu_ps( samples + group * 4 );
+
+                    sumLeft  = _mm_add_ps( sumLeft, _mm_mul_ps( values, leftWide[ group ] ) );
+                    sumRight = _mm_add_ps( sumRight, _mm_mul_ps( values, rightWide[ group ] ) );
+                }
+
+                sums[ lane ]     = sumLeft;
+                sums[ lane + 4 ] = sumRight;
+            }
+
+            // Two rounds of horizontal adds leave the total for each frame in its own lane.
+            _mm_storeu_ps( left + frame, _mm_hadd_ps( _mm_hadd_ps( sums[ 0 ], sums[ 1 ] ), _mm_hadd_ps( sums[ 2 ], sums[ 3 ] ) ) );
+            _mm_storeu_ps( right + frame, _mm_hadd_ps( _mm_hadd_ps( sums[ 4 ], sums[ 5 ] ), _mm_hadd_ps( sums[ 6 ], sums[ 7 ] ) ) );
+        }
+
+        DownmixScalar( interleaved + frame * channelCount,
+                       count - frame,
+                       channelCount,
+                       leftCoefficients,
+                       rightCoefficients,
+                       left + frame,
+                       right + frame );
+    }
+
+    // Store the interleaved pairs of an 8 wide unpack (lo and hi) to 8 consecutive texels.
+    AUDIO_TARGET_AVX2 inline void StoreTexelPairs8( float* texel, __m256 low, __m256 high )
+    {
+        __m128 lowFirst   = _mm256_castps256_ps128( low );
+        __m128 highFirst  = _mm256_castps256_ps128( high );
+        __m128 lowSecond  = _mm256_extractf128_ps( low, 1 );
+        __m128 highSecond = _mm256_extractf128_ps( high, 1 );
+
+        _mm_storel_pi( reinterpret_cast< __m64* >( texel ), lowFirst );
+        _mm_storeh_pi( reinterpret_cast< __m64* >( texel + 4 ), lowFirst );
+        _mm_storel_pi( reinterpret_cast< __m64* >( texel + 8 ), highFirst );
+        _mm_storeh_pi( reinterpret_cast< __m64* >( texel + 12 ), highFirst );
+        _mm_storel_pi( reinterpret_cast< __m64* >( texel + 16 ), lowSecond );
+        _mm_storeh_pi( reinterpret_cast< __m64* >( texel + 20 ), lowSecond );
+        _mm_storel_pi( reinterpret_cast< __m64* >( texel + 24 ), highSecond );
+        _mm_storeh_pi( reinterpret_cast< __m64* >( texel + 28 ), highSecond );
+    }
+
+    AUDIO_TARGET_AVX2 inline __m128 Narrow( __m256 value )
+    {
+        return _mm256_castps256_ps128( value );
+    }
+
+    // Normalized power of 8 consecutive bins.
+    AUDIO_TARGET_AVX2 inline __m256 BinPower8( const kiss_fft_cpx* bins, __m256 normalizationSquared )
+    {
+        __m256 low  = _mm256_loadu_ps( reinterpret_cast< const float* >( bins ) );
+        __m256 high = _mm256_loadu_ps( reinterpret_cast< const float* >( bins + 4 ) );
+
+        // hadd works within 128 bit lanes, giving bins 0 1 4 5 | 2 3 6 7, so permute back into order.
+        __m256 power = _mm256_hadd_ps( _mm256_mul_ps( low, low ), _mm256_mul_ps( high, high ) );
+
+        return _mm256_mul_ps( _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( power ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) ), normalizationSquared );
+    }
+
+    AUDIO_TARGET_AVX2 void WindowStereoAVX2( const float* left,
+                                             const float* right,
+                                             const float* window,
+                                             float* windowed,
+                                             float* textureData,
+                                             size_t count,
+                                             float* sumSquares )
+    {
+        __m256 sumLeft  = _mm256_setzero_ps();
+        __m256 sumRight = _mm256_setzero_ps();
+        size_t frame    = 0;
+
+        for ( ; frame + 8 <= count; frame += 8 )
+        {
+            __m256 leftValues   = _mm256_loadu_ps( left + frame );
+            __m256 rightValues  = _mm256_loadu_ps( right + frame );
+            __m256 windowValues = _mm256_loadu_ps( window + frame );
+
+            sumLeft  = _mm256_add_ps( sumLeft, _mm256_mul_ps( leftValues, leftValues ) );
+            sumRight = _mm256_add_ps( sumRight, _mm256_mul_ps( rightValues, rightValues ) );
+
+            __m256 windowedLeft  = _mm256_mul_ps( leftValues, windowValues );
+            __m256 windowedRight = _mm256_mul_ps( rightValues, windowValues );
+            __m256 pairsLow      = _mm256_unpacklo_ps( windowedLeft, windowedRight );
+            __m256 pairsHigh     = _mm256_unpackhi_ps( windowedLeft, windowedRight );
+
+            // unpack works within 128 bit lanes, so swap the middle lanes to get pairs in order.
+            _mm256_storeu_ps( windowed + frame * 2, _mm256_permute2f128_ps( pairsLow, pairsHigh, 0x20 ) );
+            _mm256_storeu_ps( windowed + frame * 2 + 8, _mm256_permute2f128_ps( pairsLow, pairsHigh, 0x31 ) );
+
+            StoreTexelPairs8( textureData + frame * 4, _mm256_unpacklo_ps( leftValues, rightValues ), _mm256_unpackhi_ps( leftValues, rightValues ) );
+        }
+
+        WindowStereoScalar( left + frame, right + frame, window + frame, windowed + frame * 2, textureData + frame * 4, count - frame, sumSquares );
+
+        sumSquares[ 0 ] += HorizontalAdd( _mm_add_ps( Narrow( sumLeft ), _mm256_extractf128_ps( sumLeft, 1 ) ) );
+        sumSquares[ 1 ] += HorizontalAdd( _mm_add_ps( Narrow( sumRight ), _mm256_extractf128_ps( sumRight, 1 ) ) );
+    }
+
+    AUDIO_TARGET_AVX2 void WindowMonoAVX2( const float* channel,
+                                           const float* window,
+                                           float* windowed,
+                                           float* textureData,
+                                           size_t count,
+                                           float* sumSquares )
+    {
+        __m256 sum   = _mm256_setzero_ps();
+        size_t frame = 0;
+
+        for ( ; frame + 8 <= count; frame += 8 )
+        {
+            __m256 values = _mm256_loadu_ps( channel + frame );
+
+            sum = _mm256_add_ps( sum, _mm256_mul_ps( values, values ) );
+
+            _mm256_storeu_ps( windowed + frame, _mm256_mul_ps( values, _mm256_loadu_ps( window + frame ) ) );
+
+            StoreTexelPairs8( textureData + frame * 4, _mm256_unpacklo_ps( values, values ), _mm256_unpackhi_ps( values, values ) );
+        }
+
+        WindowMonoScalar( channel + frame, window + frame, windowed + frame, textureData + frame * 4, count - frame, sumSquares );
+
+        *sumSquares += HorizontalAdd( _mm_add_ps( Narrow( sum ), _mm256_extractf128_ps( sum, 1 ) ) );
+    }
+
+    AUDIO_TARGET_AVX2 void SpectrumStereoAVX2( const kiss_fft_cpx* left,
+                                               const kiss_fft_cpx* right,
+                                               uint32_t binCount,
+                                               float normalization,
+                                               const uint32_t* bucketBoundaries,
+                                               uint32_t bucketCount,
+                                               float* textureData,
+                                               float* bucketPower )
+    {
+        float  normalizationSquared = normalization * normalization;
+        __m256 normalizationWide    = _mm256_set1_ps( normalizationSquared );
+
+        MagnitudesScalar( left, right, 0, bucketBoundaries[ 0 ], normalizationSquared, textureData );
+
+        for ( uint32_t bucket = 0; bucket < bucketCount; ++bucket )
+        {
+            uint32_t bin      = bucketBoundaries[ bucket ];
+            uint32_t end      = bucketBoundaries[ bucket + 1 ];
+            __m256   maxLeft  = _mm256_setzero_ps();
+            __m256   maxRight = _mm256_setzero_ps();
+
+            for ( ; bin + 8 <= end; bin += 8 )
+            {
+                __m256 leftPower  = BinPower8( left + bin, normalizationWide );
+                __m256 rightPower = BinPower8( right + bin, normalizationWide );
+                __m256 leftMag    = _mm256_sqrt_ps( leftPower );
+                __m256 rightMag   = _mm256_sqrt_ps( rightPower );
+
+                StoreTexelPairs8( textureData + bin * 4 + 2, _mm256_unpacklo_ps( leftMag, rightMag ), _mm256_unpackhi_ps( leftMag, rightMag ) );
+
+                maxLeft  = _mm256_max_ps( maxLeft, leftPower );
+                maxRight = _mm256_max_ps( maxRight, rightPower );
+            }
+
+            float bucketMaxLeft  = HorizontalMax( _mm_max_ps( Narrow( maxLeft ), _mm256_extractf128_ps( maxLeft, 1 ) ) );
+            float bucketMaxRight = HorizontalMax( _mm_max_ps( Narrow( maxRight ), _mm256_extractf128_ps( maxRight, 1 ) ) );
+
+            BucketScalar( left, right, bin, end, normalizationSquared, textureData, &bucketMaxLeft, &bucketMaxRight );
+
+            bucketPower[ bucket ]               = bucketMaxLeft;
+            bucketPower[ bucketCount + bucket ] = bucketMaxRight;
+        }
+
+        uint32_t bin = bucketBoundaries[ bucketCount ];
+
+        for ( ; bin + 8 <= binCount; bin += 8 )
+        {
+            __m256 leftMag  = _mm256_sqrt_ps( BinPower8( left + bin, normalizationWide ) );
+            __m256 rightMag = _mm256_sqrt_ps( BinPower8( right + bin, normalizationWide ) );
+
+            StoreTexelPairs8( textureData + bin * 4 + 2, _mm256_unpacklo_ps( leftMag, rightMag ), _mm256_unpackhi_ps( leftMag, rightMag ) );
+        }
+
+        MagnitudesScalar( left, right, bin, binCount, normalizationSquared, textureData );
+    }
+
+    AUDIO_TARGET_AVX2 void SpectrumPowerAVX2( const kiss_fft_cpx* left,
+                                              const kiss_fft_cpx* right,
+                                              uint32_t binCount,
+                                              float normalization,
+                                              float* textureData,
+                                              float* power,
+                                              size_t channelStride )
+    {
+        float    normalizationSquared = normalization * normalization;
+        __m256   normalizationWide    = _mm256_set1_ps( normalizationSquared );
+        float*   powerLeft            = power;
+        float*   powerRight           = power + channelStride;
+        uint32_t bin                  = 0;
+
+        for ( ; bin + 8 <= binCount; bin += 8 )
+        {
+            __m256 leftPower  = BinPower8( left + bin, normalizationWide );
+            __m256 rightPower = BinPower8( right + bin, normalizationWide );
+            __m256 leftMag    = _mm256_sqrt_ps( leftPower );
+            __m256 rightMag   = _mm256_sqrt_ps( rightPower );
+
+            _mm256_storeu_ps( powerLeft + bin, leftPower );
+            _mm256_storeu_ps( powerRight + bin, rightPower );
+
+            StoreTexelPairs8( textureData + bin * 4 + 2, _mm256_unpacklo_ps( leftMag, rightMag ), _mm256_unpackhi_ps( leftMag, rightMag ) );
+        }
+
+        PowerScalar( left, right, bin, binCount, normalizationSquared, textureData, powerLeft, powerRight );
+    }
+
+    AUDIO_TARGET_AVX2 void FilterbankAVX2( const float* power,
+                                           size_t channelStride,
+                                           const FilterbankBand* bands,
+                                           uint32_t bandCount,
+                                           const float* weights,
+                                           float* bucketPower )
+    {
+        for ( uint32_t band = 0; band < bandCount; ++band )
+        {
+            const float* bandWeights = weights + bands[ band ].WeightOffset;
+            const float* left        = power + bands[ band ].FirstBin;
+            const float* right       = left + channelStride;
+            __m256       sumLeft     = _mm256_setzero_ps();
+            __m256       sumRight    = _mm256_setzero_ps();
+
+            for ( uint32_t bin = 0; bin < bands[ band ].BinCount; bin += 8 )
+            {
+                __m256 bandWeightsWide = _mm256_load_ps( bandWeights + bin );
+
+                sumLeft  = _mm256_add_ps( sumLeft, _mm256_mul_ps( bandWeightsWide, _mm256_loadu_ps( left + bin ) ) );
+                sumRight = _mm256_add_ps( sumRight, _mm256_mul_ps( bandWeightsWide, _mm256_loadu_ps( right + bin ) ) );
+            }
+
+            bucketPower[ band ]             = HorizontalAdd( _mm_add_ps( Narrow( sumLeft ), _mm256_extractf128_ps( sumLeft, 1 ) ) );
+            bucketPower[ bandCount + band ] = HorizontalAdd( _mm_add_ps( Narrow( sumRight ), _mm256_extractf128_ps( sumRight, 1 ) ) );
+        }
+    }
+
+    AUDIO_TARGET_AVX2 void FloatToHalfF16C( const float* input, size_t count, uint16_t* output )
+    {
+        size_t where = 0;
+
+        for ( ; where + 16 <= count; where += 16 )
+        {
+            __m128i low  = _mm256_cvtps_ph( _mm256_loadu_ps( input + where ), _MM_FROUND_TO_NEAREST_INT );
+            __m128i high = _mm256_cvtps_ph( _mm256_loadu_ps( input + where + 8 ), _MM_FROUND_TO_NEAREST_INT );
+
+            _mm256_storeu_si256( reinterpret_cast< __m256i* >( output + where ), _mm256_set_m128i( high, low ) );
+        }
+
+        FloatToHalfScalar( input + where, count - where, output + where );
+    }
+
+#endif // -- AUDIO_KERNELS_X86
+
+    const AudioKernels SCALAR_KERNELS = 
+    { 
+        AudioInstructionSet::SCALAR, WindowStereoScalar, WindowMonoScalar, SpectrumStereoScalar, SpectrumPowerScalar, FilterbankScalar, DeinterleaveScalar, DownmixScalar, FloatToHalfScalar
+    };
+
+#if AUDIO_KERNELS_X86
+    const AudioKernels SSE41_KERNELS  = 
+    { 
+        AudioInstructionSet::SSE41, WindowStereoSSE41, WindowMonoSSE41, SpectrumStereoSSE41, SpectrumPowerSSE41, FilterbankSSE41, DeinterleaveSSE41, DownmixSSE41, FloatToHalfScalar
+    };
+
+    // Capture buffers are small and the deinterleave is bound by memory, so the SSE versions do fine here.
+    const AudioKernels AVX2_KERNELS   = 
+    { 
+        AudioInstructionSet::AVX2, WindowStereoAVX2, WindowMonoAVX2, SpectrumStereoAVX2, SpectrumPowerAVX2, FilterbankAVX2, DeinterleaveSSE41, DownmixSSE41, FloatToHalfF16C
+    };
+#endif
+}
+
+AudioInstructionSet DetectAudioInstructionSet()
+{
+#if AUDIO_KERNELS_X86
+
+    bool hasSSE41 = false;
+    bool hasAVX2  = false;
+
+#if defined( _MSC_VER )
+
+    int cpuInfo[ 4 ];
+
+    __cpuid( cpuInfo, 0 );
+
+    int maxLeaf = cpuInfo[ 0 ];
+
+    __cpuid( cpuInfo, 1 );
+
+    bool hasOSXSave = ( cpuInfo[ 2 ] & ( 1 << 27 ) ) != 0;
+    bool hasAVX     = ( cpuInfo[ 2 ] & ( 1 << 28 ) ) != 0;
+    bool hasF16C    = ( cpuInfo[ 2 ] & ( 1 << 29 ) ) != 0;
+
+    hasSSE41 = ( cpuInfo[ 2 ] & ( 1 << 19 ) ) != 0;
+
+    // AVX2 needs the OS to save the upper halves of the ymm registers as well as CPU support.
+    // The AVX2 kernels also use F16C, which every CPU with AVX2 has, but check anyway.
+    if ( maxLeaf >= 7 && hasOSXSave && hasAVX && hasF16C && ( _xgetbv( 0 ) & 6 ) == 6 )
+    {
+        __cpuidex( cpuInfo, 7, 0 );
+
+        hasAVX2 = ( cpuInfo[ 1 ] & ( 1 << 5 ) ) != 0;
+    }
+
+#else
+
+    __builtin_cpu_init();
+
+    hasSSE41 = __builtin_cpu_supports( "sse4.1" ) != 0;
+    hasAVX2  = __builtin_cpu_supports( "avx2" ) != 0 && __builtin_cpu_supports( "f16c" ) != 0;
+
+#endif
+
+    if ( hasAVX2 )
+    {
+        return AudioInstructionSet::AVX2;
+    }
+
+    if ( hasSSE41 )
+    {
+        return AudioInstructionSet::SSE41;
+    }
+
+#endif // -- AUDIO_KERNELS_X86
+
+    return AudioInstructionSet::SCALAR;
+}
+
+const AudioKernels& GetAudioKernels( AudioInstructionSet instructionSet )
+{
+    static const AudioInstructionSet bestSupported = DetectAudioInstructionSet();
+
+    if ( instructionSet == AudioInstructionSet::AUTO || instructionSet > bestSupported )
+    {
+        instructionSet = bestSupported;
+    }
+
+    switch ( instructionSet )
+    {
+#if AUDIO_KERNELS_X86
+    case AudioInstructionSet::AVX2:
+
+        return AVX2_KERNELS;
+
+    case AudioInstructionSet::SSE41:
+
+        return SSE41_KERNELS;
+#endif
+
+    default:
+
+        return SCALAR_KERNELS;
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef BOONDOGGLE_AUDIO_KERNELS_H__
+#define BOONDOGGLE_AUDIO_KERNELS_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../external/kissfft/kiss_fft.h"
+
+// Instruction sets we have audio kernels for.
+enum class AudioInstructionSet : uint32_t
+{
+    AUTO   = 0, // pick the best supported at runtime.
+    SCALAR = 1,
+    SSE41  = 2,
+    AVX2   = 3
+};
+
+// Filterbank band bin counts (and weight offsets) are multiples of this, so the kernels can work in whole registers.
+const uint32_t FILTERBANK_BAND_ALIGNMENT = 8;
+
+// One band of a sparse filterbank: BinCount weights starting at WeightOffset, applied to the bins from FirstBin.
+struct FilterbankBand
+{
+    uint32_t FirstBin;
+    uint32_t BinCount;
+    uint32_t WeightOffset;
+};
+
+// Function table for the hot loops in the audio processing, so we can pick the
+// implementation for the best instruction set available at runtime.
+// All implementations give the same results within floating point re-association tolerance.
+struct AudioKernels
+{
+    AudioInstructionSet InstructionSet;
+
+    // Window both channels of a period for the FFT, write the raw samples into the sound texture
+    // (texels of left, right, left magnitude, right magnitude) and sum the squares of each channel.
+    // The windowed output is interleaved left/right, ready to be used as complex input to one FFT.
+    void ( *WindowStereo )( const float* left,
+                            const float* right,
+                            const float* window,
+                            float* windowed /* [count * 2] */,
+                            float* textureData,
+                            size_t count,
+                            float* sumSquares /* [2] */ );
+
+    // Same as WindowStereo for when both channels are the same, the windowed output is
+    // just the one channel and the samples are written to both channels of the texture.
+    void ( *WindowMono )( const float* channel,
+                          const float* window,
+                          float* windowed /* [count] */,
+                          float* textureData,
+                          size_t count,
+                          float* sumSquares /* [1] */ );
+
+    // Take the FFT bins of both channels, write the normalized magnitude of each bin to the
+    // sound texture and find the maximum normalized power in each bucket, where bucket n is the
+    // bins [bucketBoundaries[n], bucketBoundaries[n+1]).
+    void ( *SpectrumStereo )( const kiss_fft_cpx* left,
+                              const kiss_fft_cpx* right,
+                              uint32_t binCount,
+                              float normalization,
+                              const uint32_t* bucketBoundaries /* [bucketCount + 1] */,
+                              uint32_t bucketCount,
+                              float* textureData,
+                              float* bucketPower /* [2][bucketCount] */ );
+
+    // Take the FFT bins of both channels, write the normalized magnitude of each bin to the sound texture
+    // and the normalized power of each bin to power (left, then right from channelStride on).
+    void ( *SpectrumPower )( const kiss_fft_cpx* left,
+                             const kiss_fft_cpx* right,
+                             uint32_t binCount,
+                             float normalization,
+                             float* textureData,
+                             float* power /* [2][channelStride] */,
+                             size_t channelStride );
+
+    // Apply a sparse filterbank to the power of both channels, each bucket is the dot product of its band's weights
+    // with the power from the band's first bin. Bands are FILTERBANK_BAND_ALIGNMENT aligned and padded with zero weights,
+    // so the power must be readable (and finite) up to FILTERBANK_BAND_ALIGNMENT past the last weighted bin.
+    void ( *Filterbank )( const float* power /* [2][channelStride] */,
+                          size_t channelStride,
+                          const FilterbankBand* bands,
+                          uint32_t bandCount,
+                          const float* weights,
+                          float* bucketPower /* [2][bandCount] */ );
+
+    // Split interleaved stereo frames into separate left and right channels.
+    void ( *Deinterleave )( const float* interleaved /* [count * 2] */, size_t count, float* left, float* right );
+
+    // Mix interleaved frames of up to 32 channels down to left and right, each output being the
+    // dot product of a frame with that side's coefficients. The coefficients are padded with zeros to a
+    // multiple of 4 channels.
+    void ( *Downmix )( const float* interleaved /* [count * channelCount] */,
+                       size_t count,
+                       uint32_t channelCount,
+                       const float* leftCoefficients,
+                       const float* rightCoefficients,
+                       float* left,
+                       float* right );
+
+    // Convert floats to IEEE half precision (round to nearest even), for the half precision sound texture.
+    void ( *FloatToHalf )( const float* input, size_t count, uint16_t* output );
+};
+
+// Find the best instruction set supported by this CPU (and OS).
+AudioInstructionSet DetectAudioInstructionSet();
+
+// Get the kernels for a particular instruction set, falling back to the best supported
+// if the requested set isn't available (AUTO always gives the best supported).
+const AudioKernels& GetAudioKernels( AudioInstructionSet instructionSet = AudioInstructionSet::AUTO );
+
+#endif // -- BOONDOGGLE_AUDIO_KERNELS_H__
@@ -0,0 +1,299 @@
+#include "audio_loudness.h"
+#include <string.h>
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define AUDIO_LOUDNESS_SSE 1
+#include <emmintrin.h>
+#else
+#define AUDIO_LOUDNESS_SSE 0
+#endif
+
+namespace
+{
+    const uint32_t MIN_SAMPLE_RATE  = 8000;
+    const float    LOUDNESS_OFFSET  = -0.691f; // makes a full scale 1kHz sine in one channel read -3.01 LUFS.
+    const float    TARGET_LOUDNESS  = -23.0f; // LUFS, EBU R 128, what SoundLoudnessGain brings the short-term loudness to.
+    const float    MAX_GAIN_DB      = 24.0f;
+    const float    DENORMAL_LIMIT   = 1e-20f; // without SSE, filter state below this is flushed after each run of frames.
+
+    // Analog prototype parameters of the K-weighting stages, from which the coefficients for any rate
+    // are derived (giving the ones tabled in BS.1770 at 48kHz).
+    const double SHELF_FREQUENCY  = 1681.974450955533;
+    const double SHELF_GAIN_DB    = 3.999843853973347;
+    const double SHELF_Q          = 0.7071752369554196;
+    const double SHELF_BANDWIDTH  = 0.4996667741545416;
+    const double HIGHPASS_FREQUENCY = 38.13547087602444;
+    const double HIGHPASS_Q         = 0.5003270373238773;
+
+#if AUDIO_LOUDNESS_SSE
+    const uint32_t FLUSH_DENORMALS = 0x8040; // flush to zero and denormals are zero, in MXCSR.
+#endif
+}
+
+LoudnessMeter::LoudnessMeter() :
+    BlockFrames_( 0 ),
+    BlockFilled_( 0 ),
+    BlockCursor_( 0 ),
+    LastWindowEnd_( 0 ),
+    SampleRate_( 0 )
+{
+    ::memset( Coefficients_, 0, sizeof( Coefficients_ ) );
+
+    Reset();
+}
+
+bool LoudnessMeter::Initialize( uint32_t sampleRate )
+{
+    if ( sampleRate < MIN_SAMPLE_RATE )
+    {
+        return false;
+    }
+
+    SampleRate_  = sampleRate;
+    BlockFrames_ = sampleRate / BLOCKS_PER_SECOND;
+
+    // High shelf, +4dB above about 1.5kHz, for the acoustic effect of the head.
+    double k        = tan( M_PI * SHELF_FREQUENCY / sampleRate );
+    double high     = pow( 10.0, SHELF_GAIN_DB / 20.0 );
+    double band     = pow( high, SHELF_BANDWIDTH );
+    double divisor  = 1.0 + k / SHELF_Q + k * k;
+
+    Coefficients_[ 0 ][ 0 ] = ( high + band * k / SHELF_Q + k * k ) / divisor;
+    Coefficients_[ 0 ][ 1 ] = 2.0 * ( k * k - high ) / divisor;
+    Coefficients_[ 0 ][ 2 ] = ( high - band * k / SHELF_Q + k * k ) / divisor;
+    Coefficients_[ 0 ][ 3 ] = 2.0 * ( k * k - 1.0 ) / divisor;
+    Coefficients_[ 0 ][ 4 ] = ( 1.0 - k / SHELF_Q + k * k ) / divisor;
+
+    // High-pass (the RLB curve), taking out the lows we don't hear as loud.
+    k       = tan( M_PI * HIGHPASS_FREQUENCY / sampleRate );
+    divisor = 1.0 + k / HIGHPASS_Q + k * k;
+
+    Coefficients_[ 1 ][ 0 ] = 1.0;
+    Coefficients_[ 1 ][ 1 ] = -2.0;
+    Coefficients_[ 1 ][ 2 ] = 1.0;
+    Coefficients_[ 1 ][ 3 ] = 2.0 * ( k * k - 1.0 ) / divisor;
+    Coefficients_[ 1 ][ 4 ] = ( 1.0 - k / HIGHPASS_Q + k * k ) / divisor;
+
+    Reset();
+
+    return true;
+}
+
+void LoudnessMeter::Reset()
+{
+    ::memset( State_, 0, sizeof( State_ ) );
+    ::memset( Blocks_, 0, sizeof( Blocks_ ) );
+
+    BlockEnergy_[ 0 ] = 0.0f;
+    BlockEnergy_[ 1 ] = 0.0f;
+    BlockFilled_      = 0;
+    BlockCursor_      = 0;
+    LastWindowEnd_    = 0;
+}
+
+double LoudnessMeter::WeightingPower( double frequency ) const
+{
+    double angle = ( 2.0 * M_PI * frequency ) / SampleRate_;
+    double power = 1.0;
+
+    for ( uint32_t stage = 0; stage < STAGES; ++stage )
+    {
+        const double* coefficients = Coefficients_[ stage ];
+
+        // Numerator and denominator at z = e^( j * angle ).
+        double numeratorReal        = coefficients[ 0 ] + coefficients[ 1 ] * cos( angle ) + coefficients[ 2 ] * cos( 2.0 * angle );
+        double numeratorImaginary   = -( coefficients[ 1 ] * sin( angle ) + coefficients[ 2 ] * sin( 2.0 * angle ) );
+        double denominatorReal      = 1.0 + coefficients[ 3 ] * cos( angle ) + coefficients[ 4 ] * cos( 2.0 * angle );
+        double denominatorImaginary = -( coefficients[ 3 ] * sin( angle ) + coefficients[ 4 ] * sin( 2.0 * angle ) );
+
+        power *= ( numeratorReal * numeratorReal + numeratorImaginary * numeratorImaginary ) /
+                 ( denominatorReal * denominatorReal + denominatorImaginary * denominatorImaginary );
+    }
+
+    return power;
+}
+
+void LoudnessMeter::Filter( const float* left, const float* right, size_t frameCount )
+{
+#if AUDIO_LOUDNESS_SSE
+
+    // The filters ring down into denormals after every transient, which are many times slower,
+    // so flush them to zero while filtering.
+    uint32_t controlStatus = _mm_getcsr();
+
+    _mm_setcsr( controlStatus | FLUSH_DENORMALS );
+
+    // Both channels go through the filters side by side, in the low 2 lanes.
+    __m128 b0[ STAGES ];
+    __m128 b1[ STAGES ];
+    __m128 b2[ STAGES ];
+    __m128 a1[ STAGES ];
+    __m128 a2[ STAGES ];
+    __m128 z1[ STAGES ];
+    __m128 z2[ STAGES ];
+
+    for ( uint32_t stage = 0; stage < STAGES; ++stage )
+    {
+        b0[ stage ] = _mm_set1_ps( static_cast< float >( Coefficients_[ stage ][ 0 ] ) );
+        b1[ stage ] = _mm_set1_ps( static_cast< float >( Coefficients_[ stage ][ 1 ] ) );
+        b2[ stage ] = _mm_set1_ps( static_cast< float >( Coefficients_[ stage ][ 2 ] ) );
+        a1[ stage ] = _mm_set1_ps( static_cast< float >( Coefficients_[ stage ][ 3 ] ) );
+        a2[ stage ] = _mm_set1_ps( static_cast< float >( Coefficients_[ stage ][ 4 ] ) );
+        z1[ stage ] = _mm_setr_ps( State_[ stage ][ 0 ][ 0 ], State_[ stage ][ 0 ][ 1 ], 0.0f, 0.0f );
+        z2[ stage ] = _mm_setr_ps( State_[ stage ][ 1 ][ 0 ], State_[ stage ][ 1 ][ 1 ], 0.0f, 0.0f );
+    }
+
+    __m128 energy = _mm_setr_ps( BlockEnergy_[ 0 ], BlockEnergy_[ 1 ], 0.0f, 0.0f );
+    float  lanes[ 4 ];
+
+    for ( size_t frame = 0; frame < frameCount; ++frame )
+    {
+        __m128 value = _mm_unpacklo_ps( _mm_load_ss( left + frame ), _mm_load_ss( right + frame ) );
+
+        for ( uint32_t stage = 0; stage < STAGES; ++stage )
+        {
+            __m128 output = _mm_add_ps( _mm_mul_ps( b0[ stage ], value ), z1[ stage ] );
+
+            z1[ stage ] = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( b1[ stage ], value ), _mm_mul_ps( a1[ stage ], output ) ), z2[ stage ] );
+            z2[ stage ] = _mm_sub_ps( _mm_mul_ps( b2[ stage ], value ), _mm_mul_ps( a2[ stage ], output ) );
+            value       = output;
+        }
+
+        energy = _mm_add_ps( energy, _mm_mul_ps( value, value ) );
+
+        if ( ++BlockFilled_ == BlockFrames_ )
+        {
+            _mm_storeu_ps( lanes, energy );
+
+            Blocks_[ BlockCursor_ % SHORT_TERM_BLOCKS ] = static_cast< double >( lanes[ 0 ] ) + lanes[ 1 ];
+
+            ++BlockCursor_;
+
+            BlockFilled_ = 0;
+            energy       = _mm_setzero_ps();
+        }
+    }
+
+    _mm_storeu_ps( lanes, energy );
+
+    BlockEnergy_[ 0 ] = lanes[ 0 ];
+    BlockEnergy_[ 1 ] = lanes[ 1 ];
+
+    for ( uint32_t stage = 0; stage < STAGES; ++stage )
+    {
+        _mm_storeu_ps( lanes, z1[ stage ] );
+
+        State_[ stage ][ 0 ][ 0 ] = lanes[ 0 ];
+        State_[ stage ][ 0 ][ 1 ] = lanes[ 1 ];
+
+        _mm_storeu_ps( lanes, z2[ stage ] );
+
+        State_[ stage ][ 1 ][ 0 ] = lanes[ 0 ];
+        State_[ stage ][ 1 ][ 1 ] = lanes[ 1 ];
+    }
+
+    _mm_setcsr( controlStatus );
+
+#else
+
+    const float* channels[ 2 ] = { left, right };
+
+    for ( size_t frame = 0; frame < frameCount; ++frame )
+    {
+        for ( uint32_t channel = 0; channel < 2; ++channel )
+        {
+            float value = channels[ channel ][ frame ];
+
+            for ( uint32_t stage = 0; stage < STAGES; ++stage )
+            {
+                const double* coefficients = Coefficients_[ stage ];
+                float*        z1           = &State_[ stage ][ 0 ][ channel ];
+                float*        z2           = &State_[ stage ][ 1 ][ channel ];
+                float         output       = static_cast< float >( coefficients[ 0 ] ) * value + *z1;
+
+                *z1   = static_cast< float >( coefficients[ 1 ] ) * value - static_cast< float >( coefficients[ 3 ] ) * output + *z2;
+                *z2   = static_cast< float >( coefficients[ 2 ] ) * value - static_cast< float >( coefficients[ 4 ] ) * output;
+                value = output;
+            }
+
+            BlockEnergy_[ channel ] += value * value;
+        }
+
+        if ( ++BlockFilled_ == BlockFrames_ )
+        {
+            Blocks_[ BlockCursor_ % SHORT_TERM_BLOCKS ] = static_cast< double >( BlockEnergy_[ 0 ] ) + BlockEnergy_[ 1 ];
+
+            ++BlockCursor_;
+
+            BlockFilled_      = 0;
+            BlockEnergy_[ 0 ] = 0.0f;
+            BlockEnergy_[ 1 ] = 0.0f;
+        }
+    }
+
+    for ( uint32_t stage = 0; stage < STAGES; ++stage )
+    {
+        for ( uint32_t which = 0; which < 2; ++which )
+        {
+            for ( uint32_t channel = 0; channel < 2; ++channel )
+            {
+                float& state = State_[ stage ][ which ][ channel ];
+
+                state = fabsf( state ) < DENORMAL_LIMIT ? 0.0f : state;
+            }
+        }
+    }
+
+#endif
+}
+
+float LoudnessMeter::BlockLoudness( uint32_t blockCount ) const
+{
+    uint32_t available = BlockCursor_ < SHORT_TERM_BLOCKS ? BlockCursor_ : SHORT_TERM_BLOCKS;
+
+    blockCount = blockCount < available ? blockCount : available;
+
+    if ( blockCount == 0 )
+    {
+        return LOUDNESS_FLOOR;
+    }
+
+    double sum = 0.0;
+
+    // Summed fresh every time (at most a few hundred adds), so there's no running total to drift.
+    for ( uint32_t block = 1; block <= blockCount; ++block )
+    {
+        sum += Blocks_[ ( BlockCursor_ - block ) % SHORT_TERM_BLOCKS ];
+    }
+
+    double meanSquare = sum / ( static_cast< double >( blockCount ) * BlockFrames_ );
+    float  loudness   = meanSquare > 0.0 ? LOUDNESS_OFFSET + 10.0f * static_cast< float >( log10( meanSquare ) ) : LOUDNESS_FLOOR;
+
+    return loudness > LOUDNESS_FLOOR ? loudness : LOUDNESS_FLOOR;
+}
+
+void LoudnessMeter::Update( const float* left, const float* right, size_t windowSamples, uint64_t windowEnd, PerFrameConstants& toUpdate )
+{
+    // Only the frames since the last window, if windows were skipped or the source restarted
+    // only what's still in the window can be used.
+    uint64_t newFrames = windowEnd > LastWindowEnd_ ? windowEnd - LastWindowEnd_ : windowEnd;
+
+    newFrames      = newFrames > windowSamples ? windowSamples : newFrames;
+    LastWindowEnd_ = windowEnd;
+
+    size_t offset = windowSamples - static_cast< size_t >( newFrames );
+
+    Filter( left + offset, right + offset, static_cast< size_t >( newFrames ) );
+
+    float gainDb = TARGET_LOUDNESS - BlockLoudness( SHORT_TERM_BLOCKS );
+
+    gainDb = gainDb > MAX_GAIN_DB ? MAX_GAIN_DB : ( gainDb < -MAX_GAIN_DB ? -MAX_GAIN_DB : gainDb );
+
+    toUpdate.SoundLoudnessMomentary = BlockLoudness( MOMENTARY_BLOCKS );
+    toUpdate.SoundLoudnessShortTerm = BlockLoudness( SHORT_TERM_BLOCKS );
+    toUpdate.SoundLoudnessGain      = powf( 10.0f, gainDb / 20.0f );
+}
@@ -0,0 +1,64 @@
+#ifndef BOONDOGGLE_AUDIO_LOUDNESS_H__
+#define BOONDOGGLE_AUDIO_LOUDNESS_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "shared_render_constants.h"
+
+// Loudness silence reads as (the absolute gate of BS.1770), in LUFS.
+const float LOUDNESS_FLOOR = -70.0f;
+
+// Loudness metering as in ITU-R BS.1770: both channels go through the K-weighting filter (a high shelf
+// for the head, then a high-pass), and the loudness is the mean square of that over a window in LUFS.
+// Momentary loudness is over the last 400ms and short-term over the last 3s, both updated every 10ms block.
+class LoudnessMeter
+{
+public:
+
+    LoudnessMeter();
+
+    // Initialize for audio at sampleRate, returns false if the rate is too low to meter.
+    bool Initialize( uint32_t sampleRate );
+
+    // Feed the new frames of the latest window (left and right are the whole window, windowSamples long)
+    // and set the loudness constants. windowEnd is the source cursor at the end of the window, frames
+    // before the window that were never fed (skipped windows) are left out.
+    void Update( const float* left, const float* right, size_t windowSamples, uint64_t windowEnd, PerFrameConstants& toUpdate );
+
+    // Forget the filter state and the blocks measured.
+    void Reset();
+
+    // Power gain of the K-weighting filter at a frequency (in double precision, from the filter coefficients).
+    double WeightingPower( double frequency ) const;
+
+    LoudnessMeter( const LoudnessMeter& ) = delete;
+
+    LoudnessMeter& operator=( const LoudnessMeter& ) = delete;
+
+private:
+
+    static const uint32_t STAGES             = 2;
+    static const uint32_t BLOCKS_PER_SECOND  = 100;
+    static const uint32_t MOMENTARY_BLOCKS   = 40;
+    static const uint32_t SHORT_TERM_BLOCKS  = 300;
+
+    // K-weight frames into the current block, moving on to the next block whenever it fills.
+    void Filter( const float* left, const float* right, size_t frameCount );
+
+    // Loudness of the mean square over the last blockCount blocks (or as many as there are), in LUFS.
+    float BlockLoudness( uint32_t blockCount ) const;
+
+    double   Coefficients_[ STAGES ][ 5 ]; // b0, b1, b2, a1, a2 of each biquad (a0 normalized to 1).
+    float    State_[ STAGES ][ 2 ][ 2 ]; // transposed direct form II state (z1, z2) of each stage, for left and right.
+    double   Blocks_[ SHORT_TERM_BLOCKS ]; // ring of the summed square of both channels per block.
+    float    BlockEnergy_[ 2 ]; // squares of the current block so far, left and right.
+    uint32_t BlockFrames_;
+    uint32_t BlockFilled_; // frames in the current block.
+    uint32_t BlockCursor_; // blocks completed.
+    uint64_t LastWindowEnd_;
+    uint32_t SampleRate_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_LOUDNESS_H__
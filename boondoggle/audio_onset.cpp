@@ -0,0 +1,301 @@
+#include "audio_onset.h"
+#include "../common/boondoggle_helpers.h"
+#include <string.h>
+#include <math.h>
+
+namespace
+{
+    const float MIN_BPM                = 60.0f;
+    const float MAX_BPM                = 180.0f;
+    const float PREFERRED_BPM          = 120.0f; // centre of the tempo prior, to pick between octaves.
+    const float TEMPO_OCTAVE_SPREAD    = 1.0f; // standard deviation of the tempo prior, in octaves.
+    const float TEMPO_WINDOW_SECONDS   = 6.0f; // onset history the tempo is estimated over.
+    const float TEMPO_UPDATE_SECONDS   = 0.5f;
+    const float TEMPO_SMOOTHING        = 0.3f; // per tempo update.
+    const float TEMPO_JUMP             = 0.08f; // relative change in tempo that's taken as a new tempo rather than drift.
+    const float STATISTICS_SECONDS     = 1.0f; // time constant of the flux mean and deviation.
+    const float ONSET_DEVIATIONS       = 3.0f; // novelty above the mean, in mean deviations, for full onset strength.
+    const float MIN_FLUX_DEVIATION     = 0.05f; // floor on the flux deviation, as a fraction of the spectrum total.
+    const float ONSET_THRESHOLD        = 0.5f; // onset strength that counts as a beat for the phase.
+    const float ONSET_RELEASE_SECONDS  = 0.15f;
+    const float PHASE_CORRECTION       = 0.25f; // fraction of the phase error corrected by a full strength onset.
+    const float MIN_ENERGY             = 1e-12f;
+
+    // Total of the values at a lag and either side of it. Beat periods fall between whole hops,
+    // so a beat's correlation can be split across two neighbouring lags.
+    float NeighbourhoodSum( const float* values, uint32_t lag )
+    {
+        return values[ lag - 1 ] + values[ lag ] + values[ lag + 1 ];
+    }
+}
+
+OnsetTracker::OnsetTracker() :
+    Memory_( nullptr ),
+    Previous_( nullptr ),
+    Envelope_( nullptr ),
+    Correlation_( nullptr ),
+    BinCount_( 0 ),
+    EnvelopeLength_( 0 ),
+    EnvelopeCursor_( 0 ),
+    EnvelopeFilled_( 0 ),
+    MinLag_( 0 ),
+    MaxLag_( 0 ),
+    HopsUntilTempo_( 0 ),
+    HopsPerTempo_( 0 ),
+    HopSamples_( 0 ),
+    LastWindowEnd_( 0 ),
+    HopRate_( 0 ),
+    FluxMean_( 0 ),
+    FluxDeviation_( 0 ),
+    StatisticsRate_( 0 ),
+    LastStrength_( 0 ),
+    Strength_( 0 ),
+    Bpm_( 0 ),
+    Phase_( 0 ),
+    Confidence_( 0 ),
+    HasPrevious_( false )
+{
+}
+
+OnsetTracker::~OnsetTracker()
+{
+    AlignedFree( Memory_ );
+}
+
+bool OnsetTracker::Initialize( uint32_t binCount, uint32_t sampleRate, uint32_t hopSamples )
+{
+    if ( binCount < 2 || sampleRate == 0 || hopSamples == 0 )
+    {
+        return false;
+    }
+
+    BinCount_       = binCount;
+    HopSamples_     = hopSamples;
+    HopRate_        = static_cast< float >( sampleRate ) / static_cast< float >( hopSamples );
+    EnvelopeLength_ = static_cast< uint32_t >( ceilf( HopRate_ * TEMPO_WINDOW_SECONDS ) );
+    MinLag_         = static_cast< uint32_t >( floorf( HopRate_ * 60.0f / MAX_BPM ) );
+    MaxLag_         = static_cast< uint32_t >( ceilf( HopRate_ * 60.0f / MIN_BPM ) );
+    HopsPerTempo_   = static_cast< uint32_t >( ceilf( HopRate_ * TEMPO_UPDATE_SECONDS ) );
+    StatisticsRate_ = 1.0f - expf( -1.0f / ( HopRate_ * STATISTICS_SECONDS ) );
+
+    // Need lags either side of the range for the peak search and interpolation, and enough history to correlate over.
+    if ( MinLag_ < 3 || MaxLag_ * 4 > EnvelopeLength_ )
+    {
+        return false;
+    }
+
+    AlignedFree( Memory_ );
+
+    Memory_ = reinterpret_cast< float* >( AlignedAllocateZeroed( sizeof( float ) * ( binCount + EnvelopeLength_ * 2 + MaxLag_ * 2 + 3 ), 16 ) );
+
+    if ( Memory_ == nullptr )
+    {
+        return false;
+    }
+
+    Previous_    = Memory_;
+    Envelope_    = Previous_ + binCount;
+    Correlation_ = Envelope_ + EnvelopeLength_ * 2;
+
+    Reset();
+
+    return true;
+}
+
+void OnsetTracker::Reset()
+{
+    EnvelopeCursor_ = 0;
+    EnvelopeFilled_ = 0;
+    HopsUntilTempo_ = HopsPerTempo_;
+    LastWindowEnd_  = 0;
+    FluxMean_       = 0;
+    FluxDeviation_  = 0;
+    LastStrength_   = 0;
+    Strength_       = 0;
+    Bpm_            = 0;
+    Phase_          = 0;
+    Confidence_     = 0;
+    HasPrevious_    = false;
+}
+
+void OnsetTracker::PushEnvelope( float value )
+{
+    Envelope_[ EnvelopeCursor_ ]                   = value;
+    Envelope_[ EnvelopeCursor_ + EnvelopeLength_ ] = value;
+
+    EnvelopeCursor_  = EnvelopeCursor_ + 1 < EnvelopeLength_ ? EnvelopeCursor_ + 1 : 0;
+    EnvelopeFilled_ += EnvelopeFilled_ < EnvelopeLength_ ? 1 : 0;
+}
+
+void OnsetTracker::Update( const float* textureData, uint64_t windowEnd, PerFrameConstants& toUpdate )
+{
+    uint32_t hops = 1;
+
+    // Windows can be skipped when processing falls behind, keep the envelope on the hop clock regardless.
+    if ( HasPrevious_ && windowEnd > LastWindowEnd_ )
+    {
+        uint64_t elapsed = ( windowEnd - LastWindowEnd_ + HopSamples_ / 2 ) / HopSamples_;
+
+        hops = elapsed < 1 ? 1 : ( elapsed > EnvelopeLength_ ? EnvelopeLength_ : static_cast< uint32_t >( elapsed ) );
+    }
+
+    float flux  = 0.0f;
+    float total = 0.0f;
+
+    // Square root compression of the mid magnitude, so quiet partials still register against loud ones.
+    // Skips DC, which is only ever offset or rumble.
+    for ( uint32_t bin = 1; bin < BinCount_; ++bin )
+    {
+        float magnitude = sqrtf( 0.5f * ( textureData[ bin * 4 + 2 ] + textureData[ bin * 4 + 3 ] ) );
+        float increase  = magnitude - Previous_[ bin ];
+
+        flux              += increase > 0.0f ? increase : 0.0f;
+        total             += magnitude;
+        Previous_[ bin ]   = magnitude;
+    }
+
+    // Relative to the whole spectrum, so the onsets don't depend on the volume.
+    flux = HasPrevious_ && total > MIN_ENERGY ? flux / total : 0.0f;
+
+    float novelty   = flux > FluxMean_ ? flux - FluxMean_ : 0.0f;
+    float deviation = fabsf( flux - FluxMean_ );
+
+    FluxMean_      += ( flux - FluxMean_ ) * StatisticsRate_;
+    FluxDeviation_ += ( deviation - FluxDeviation_ ) * StatisticsRate_;
+
+    for ( uint32_t skipped = 1; skipped < hops; ++skipped )
+    {
+        PushEnvelope( 0.0f );
+    }
+
+    PushEnvelope( novelty );
+
+    // The deviation has a floor, or the jitter in a steady tone would be scaled up to full strength onsets.
+    float spread         = FluxDeviation_ > MIN_FLUX_DEVIATION ? FluxDeviation_ : MIN_FLUX_DEVIATION;
+    float strength       = novelty / ( ONSET_DEVIATIONS * spread );
+    float elapsedSeconds = static_cast< float >( hops ) / HopRate_;
+
+    strength  = strength < 1.0f ? strength : 1.0f;
+    Strength_ = Strength_ * expf( -elapsedSeconds / ONSET_RELEASE_SECONDS );
+    Strength_ = strength > Strength_ ? strength : Strength_;
+
+    if ( Bpm_ > 0.0f )
+    {
+        Phase_ += elapsedSeconds * Bpm_ * ( 1.0f / 60.0f );
+        Phase_ -= floorf( Phase_ );
+
+        // A strong onset pulls the oscillator toward a beat landing on it.
+        if ( strength >= ONSET_THRESHOLD && LastStrength_ < ONSET_THRESHOLD )
+        {
+            float error = Phase_ > 0.5f ? Phase_ - 1.0f : Phase_;
+
+            Phase_ -= error * PHASE_CORRECTION * strength;
+            Phase_ -= floorf( Phase_ );
+        }
+    }
+
+    LastStrength_  = strength;
+    LastWindowEnd_ = windowEnd;
+    HasPrevious_   = true;
+
+    if ( hops >= HopsUntilTempo_ )
+    {
+        HopsUntilTempo_ = HopsPerTempo_;
+
+        UpdateTempo();
+    }
+    else
+    {
+        HopsUntilTempo_ -= hops;
+    }
+
+    toUpdate.SoundOnsetStrength  = Strength_;
+    toUpdate.SoundBPM            = Bpm_;
+    toUpdate.SoundBeatPhase      = Phase_;
+    toUpdate.SoundBeatConfidence = Confidence_;
+}
+
+void OnsetTracker::UpdateTempo()
+{
+    uint32_t count = EnvelopeFilled_;
+
+    if ( count < MaxLag_ * 4 )
+    {
+        return;
+    }
+
+    // Oldest first, the ring is mirrored so this is always contiguous.
+    const float* envelope = Envelope_ + EnvelopeCursor_ + EnvelopeLength_ - count;
+    float        energy   = 0.0f;
+
+    for ( uint32_t frame = 0; frame < count; ++frame )
+    {
+        energy += envelope[ frame ] * envelope[ frame ];
+    }
+
+    // Steady audio has no rhythm to track, just let the confidence fall away.
+    if ( energy <= count * MIN_FLUX_DEVIATION * MIN_FLUX_DEVIATION )
+    {
+        Confidence_ -= Confidence_ * TEMPO_SMOOTHING;
+        return;
+    }
+
+    // Lags out to twice the range, the score for a tempo includes the lag for half the tempo so a pulse
+    // train at the right tempo beats one that only lines up every other beat. Each lag is normalized
+    // for the number of products in it, so long lags aren't penalized for overlapping less.
+    for ( uint32_t lag = MinLag_ - 2; lag <= MaxLag_ * 2 + 2; ++lag )
+    {
+        float sum = 0.0f;
+
+        for ( uint32_t frame = lag; frame < count; ++frame )
+        {
+            sum += envelope[ frame ] * envelope[ frame - lag ];
+        }
+
+        Correlation_[ lag ] = ( sum * count ) / ( energy * ( count - lag ) );
+    }
+
+    uint32_t bestLag   = MinLag_;
+    float    bestScore = -1.0f;
+
+    for ( uint32_t lag = MinLag_; lag <= MaxLag_; ++lag )
+    {
+        float octaves = log2f( ( HopRate_ * 60.0f ) / ( lag * PREFERRED_BPM ) ) / TEMPO_OCTAVE_SPREAD;
+        float score   = ( NeighbourhoodSum( Correlation_, lag ) + 0.5f * NeighbourhoodSum( Correlation_, lag * 2 ) ) * expf( -0.5f * octaves * octaves );
+
+        if ( score > bestScore )
+        {
+            bestScore = score;
+            bestLag   = lag;
+        }
+    }
+
+    // Interpolate the peak of the raw correlation nearest the best lag.
+    uint32_t peakLag = bestLag;
+
+    peakLag = Correlation_[ bestLag - 1 ] > Correlation_[ peakLag ] ? bestLag - 1 : peakLag;
+    peakLag = Correlation_[ bestLag + 1 ] > Correlation_[ peakLag ] ? bestLag + 1 : peakLag;
+
+    float below  = Correlation_[ peakLag - 1 ];
+    float peak   = Correlation_[ peakLag ];
+    float above  = Correlation_[ peakLag + 1 ];
+    float curve  = below - 2.0f * peak + above;
+    float offset = curve < 0.0f ? 0.5f * ( below - above ) / curve : 0.0f;
+    float bpm    = ( HopRate_ * 60.0f ) / ( peakLag + offset );
+
+    bpm = bpm < MIN_BPM ? MIN_BPM : ( bpm > MAX_BPM ? MAX_BPM : bpm );
+
+    // Smooth small changes, but jump straight to a different tempo rather than averaging across to it.
+    if ( Bpm_ > 0.0f && fabsf( bpm - Bpm_ ) < Bpm_ * TEMPO_JUMP )
+    {
+        Bpm_ += ( bpm - Bpm_ ) * TEMPO_SMOOTHING;
+    }
+    else
+    {
+        Bpm_ = bpm;
+    }
+
+    float confidence = peak < 0.0f ? 0.0f : ( peak > 1.0f ? 1.0f : peak );
+
+    Confidence_ += ( confidence - Confidence_ ) * TEMPO_SMOOTHING;
+}
@@ -0,0 +1,70 @@
+#ifndef BOONDOGGLE_AUDIO_ONSET_H__
+#define BOONDOGGLE_AUDIO_ONSET_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "shared_render_constants.h"
+
+// Onset detection and tempo tracking from the spectrum of each analysis window.
+// Onsets come from the spectral flux (rectified increase in compressed magnitude across bins),
+// the tempo from the autocorrelation of the onset envelope over the last few seconds and
+// the beat phase from an oscillator at that tempo, pulled into line by strong onsets.
+class OnsetTracker
+{
+public:
+
+    OnsetTracker();
+
+    ~OnsetTracker();
+
+    // Initialize for spectra of binCount bins, analyzed every hopSamples at sampleRate.
+    bool Initialize( uint32_t binCount, uint32_t sampleRate, uint32_t hopSamples );
+
+    // Update from the magnitudes of the latest window, in the sound texture layout (left and right in [2] and [3]).
+    // windowEnd is the source cursor at the end of the window, used to keep time if windows were skipped.
+    void Update( const float* textureData, uint64_t windowEnd, PerFrameConstants& toUpdate );
+
+    // Forget the onset history and tempo.
+    void Reset();
+
+    OnsetTracker( const OnsetTracker& ) = delete;
+
+    OnsetTracker& operator=( const OnsetTracker& ) = delete;
+
+private:
+
+    // Estimate the tempo from the autocorrelation of the onset envelope.
+    void UpdateTempo();
+
+    // Add an onset envelope value for the latest hop.
+    void PushEnvelope( float value );
+
+    float*   Memory_;
+    float*   Previous_; // compressed magnitudes of the previous window.
+    float*   Envelope_; // mirrored ring of onset novelty per hop, like AudioSource.
+    float*   Correlation_; // autocorrelation by lag, from the last tempo update.
+    uint32_t BinCount_;
+    uint32_t EnvelopeLength_;
+    uint32_t EnvelopeCursor_;
+    uint32_t EnvelopeFilled_;
+    uint32_t MinLag_;
+    uint32_t MaxLag_;
+    uint32_t HopsUntilTempo_;
+    uint32_t HopsPerTempo_;
+    uint32_t HopSamples_;
+    uint64_t LastWindowEnd_;
+    float    HopRate_; // hops per second.
+    float    FluxMean_;
+    float    FluxDeviation_;
+    float    StatisticsRate_;
+    float    LastStrength_;
+    float    Strength_;
+    float    Bpm_;
+    float    Phase_;
+    float    Confidence_;
+    bool     HasPrevious_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_ONSET_H__
@@ -0,0 +1,252 @@
+#include "audio_resampler.h"
+#include "../common/boondoggle_helpers.h"
+#include <string.h>
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define AUDIO_RESAMPLER_SSE 1
+#include <emmintrin.h>
+#else
+#define AUDIO_RESAMPLER_SSE 0
+#endif
+
+namespace
+{
+    // Taps per phase when upsampling, in frames at the lower rate. Blackman windowed sinc needs about 5.5 / transition width taps,
+    // so this gives a transition band 0.17 of the nyquist wide centered on it, passing up to 0.91 of it (20 kHz from a 44.1 kHz device).
+    // Downsampling scales it up by the ratio, so the filter has the same shape at the output rate.
+    const uint32_t TAPS_PER_PHASE = 64;
+
+    uint32_t GreatestCommonDivisor( uint32_t a, uint32_t b )
+    {
+        while ( b != 0 )
+        {
+            uint32_t remainder = a % b;
+
+            a = b;
+            b = remainder;
+        }
+
+        return a;
+    }
+}
+
+StereoResampler::StereoResampler() :
+    Bank_( nullptr ),
+    TapsPerPhase_( 0 ),
+    Interpolation_( 0 ),
+    Decimation_( 0 ),
+    Phase_( 0 ),
+    Position_( 0 ),
+    MaxInputFrames_( 0 ),
+    DelayMicroseconds_( 0 )
+{
+    Lines_[ 0 ] = nullptr;
+    Lines_[ 1 ] = nullptr;
+}
+
+StereoResampler::~StereoResampler()
+{
+    AlignedFree( Bank_ );
+}
+
+bool StereoResampler::Initialize( uint32_t inputRate, uint32_t outputRate, size_t maxInputFrames )
+{
+    AlignedFree( Bank_ );
+
+    Bank_       = nullptr;
+    Lines_[ 0 ] = nullptr;
+    Lines_[ 1 ] = nullptr;
+
+    if ( inputRate == 0 || outputRate == 0 || inputRate == outputRate || maxInputFrames == 0 )
+    {
+        return false;
+    }
+
+    uint32_t divisor       = GreatestCommonDivisor( inputRate, outputRate );
+    uint32_t interpolation = outputRate / divisor;
+    uint32_t decimation    = inputRate / divisor;
+
+    if ( interpolation > MAX_PHASES )
+    {
+        return false;
+    }
+
+    Interpolation_  = interpolation;
+    Decimation_     = decimation;
+    MaxInputFrames_ = maxInputFrames;
+    TapsPerPhase_   = TAPS_PER_PHASE;
+
+    if ( decimation > interpolation )
+    {
+        uint64_t taps = ( static_cast< uint64_t >( TAPS_PER_PHASE ) * decimation + interpolation - 1 ) / interpolation;
+
+        // Multiple of 8 for the SIMD loop.
+        TapsPerPhase_ = static_cast< uint32_t >( ( taps + 7 ) & ~static_cast< uint64_t >( 7 ) );
+    }
+
+    size_t bankSize   = static_cast< size_t >( TapsPerPhase_ ) * interpolation;
+    size_t lineLength = TapsPerPhase_ - 1 + maxInputFrames;
+
+    Bank_ = reinterpret_cast< float* >( AlignedAllocateZeroed( sizeof( float ) * ( bankSize + lineLength * 2 ), 16 ) );
+
+    if ( Bank_ == nullptr )
+    {
+        return false;
+    }
+
+    Lines_[ 0 ] = Bank_ + bankSize;
+    Lines_[ 1 ] = Lines_[ 0 ] + lineLength;
+
+    // The prototype filter runs at the upsampled rate (inputRate * interpolation), cutting off at the lower nyquist.
+    double cutoff = 0.5 / ( interpolation > decimation ? interpolation : decimation ); // cycles per upsampled sample.
+    double center = ( bankSize - 1 ) * 0.5;
+
+    for ( uint32_t phase = 0; phase < interpolation; ++phase )
+    {
+        float* taps = Bank_ + static_cast< size_t >( phase ) * TapsPerPhase_;
+        double sum  = 0.0;
+
+        // Output frames in this phase take prototype taps phase + n * interpolation, newest input first,
+        // so reverse them to line up with the line (oldest first).
+        for ( uint32_t tap = 0; tap < TapsPerPhase_; ++tap )
+        {
+            size_t prototypeTap = phase + static_cast< size_t >( TapsPerPhase_ - 1 - tap ) * interpolation;
+            double offset       = prototypeTap - center;
+            double sinc         = offset == 0.0 ? 2.0 * cutoff : sin( 2.0 * M_PI * cutoff * offset ) / ( M_PI * offset );
+            double angle        = ( 2.0 * M_PI * prototypeTap ) / ( bankSize - 1 );
+            double window       = 0.42 - 0.5 * cos( angle ) + 0.08 * cos( 2.0 * angle );
+
+            taps[ tap ]  = static_cast< float >( sinc * window );
+            sum         += sinc * window;
+        }
+
+        // unity gain at DC in every phase, so a constant input doesn't pick up a ripple at the phase rate.
+        for ( uint32_t tap = 0; tap < TapsPerPhase_; ++tap )
+        {
+            taps[ tap ] = static_cast< float >( taps[ tap ] / sum );
+        }
+    }
+
+    DelayMicroseconds_ = static_cast< uint64_t >( ( center * 1000000.0 ) / ( static_cast< double >( inputRate ) * interpolation ) );
+
+    Reset();
+
+    return true;
+}
+
+void StereoResampler::Reset()
+{
+    Phase_    = 0;
+    Position_ = 0;
+
+    if ( Lines_[ 0 ] != nullptr )
+    {
+        ::memset( Lines_[ 0 ], 0, sizeof( float ) * ( TapsPerPhase_ - 1 ) );
+        ::memset( Lines_[ 1 ], 0, sizeof( float ) * ( TapsPerPhase_ - 1 ) );
+    }
+}
+
+size_t StereoResampler::InputFramesFor( size_t outputFrames ) const
+{
+    if ( outputFrames == 0 )
+    {
+        return 0;
+    }
+
+    // The newest input frame the last of the output frames needs, counted from the first frame of the next call.
+    uint64_t phases = Phase_ + static_cast< uint64_t >( outputFrames - 1 ) * Decimation_;
+    uint64_t newest = Position_ + phases / Interpolation_;
+
+    return static_cast< size_t >( newest + 1 );
+}
+
+size_t StereoResampler::Process( const float* left, const float* right, size_t frameCount, float* outputLeft, float* outputRight )
+{
+    frameCount = frameCount > MaxInputFrames_ ? MaxInputFrames_ : frameCount;
+
+    uint32_t history = TapsPerPhase_ - 1;
+    size_t   written = 0;
+
+    ::memcpy( Lines_[ 0 ] + history, left, sizeof( float ) * frameCount );
+    ::memcpy( Lines_[ 1 ] + history, right, sizeof( float ) * frameCount );
+
+    // Position_ is also the input index of the newest frame the output needs, as the line starts with the history.
+    while ( Position_ < frameCount )
+    {
+        ProcessFrame( Lines_[ 0 ] + Position_,
+                      Lines_[ 1 ] + Position_,
+                      Bank_ + static_cast< size_t >( Phase_ ) * TapsPerPhase_,
+                      outputLeft + written,
+                      outputRight + written );
+
+        ++written;
+
+        Phase_    += Decimation_;
+        Position_ += Phase_ / Interpolation_;
+        Phase_    %= Interpolation_;
+    }
+
+    Position_ -= frameCount;
+
+    ::memmove( Lines_[ 0 ], Lines_[ 0 ] + frameCount, sizeof( float ) * history );
+    ::memmove( Lines_[ 1 ], Lines_[ 1 ] + frameCount, sizeof( float ) * history );
+
+    return written;
+}
+
+void StereoResampler::ProcessFrame( const float* left, const float* right, const float* taps, float* outputLeft, float* outputRight ) const
+{
+#if AUDIO_RESAMPLER_SSE
+
+    // Both channels share the taps, 2 accumulators each to break the dependency chains.
+    __m128 sumsLeft[ 2 ]  = { _mm_setzero_ps(), _mm_setzero_ps() };
+    __m128 sumsRight[ 2 ] = { _mm_setzero_ps(), _mm_setzero_ps() };
+
+    for ( uint32_t tap = 0; tap < TapsPerPhase_; tap += 8 )
+    {
+        __m128 taps0 = _mm_load_ps( taps + tap );
+        __m128 taps1 = _mm_load_ps( taps + tap + 4 );
+
+        sumsLeft[ 0 ]  = _mm_add_ps( sumsLeft[ 0 ], _mm_mul_ps( taps0, _mm_loadu_ps( left + tap ) ) );
+        sumsLeft[ 1 ]  = _mm_add_ps( sumsLeft[ 1 ], _mm_mul_ps( taps1, _mm_loadu_ps( left + tap + 4 ) ) );
+        sumsRight[ 0 ] = _mm_add_ps( sumsRight[ 0 ], _mm_mul_ps( taps0, _mm_loadu_ps( right + tap ) ) );
+        sumsRight[ 1 ] = _mm_add_ps( sumsRight[ 1 ], _mm_mul_ps( taps1, _mm_loadu_ps( right + tap + 4 ) ) );
+    }
+
+    __m128 sumLeft  = _mm_add_ps( sumsLeft[ 0 ], sumsLeft[ 1 ] );
+    __m128 sumRight = _mm_add_ps( sumsRight[ 0 ], sumsRight[ 1 ] );
+
+    // Horizontal add of both at once, left ends up in lane 0 and right in lane 1.
+    __m128 low  = _mm_unpacklo_ps( sumLeft, sumRight );
+    __m128 high = _mm_unpackhi_ps( sumLeft, sumRight );
+    __m128 sums = _mm_add_ps( low, high );
+
+    sums = _mm_add_ps( sums, _mm_movehl_ps( sums, sums ) );
+
+    float lanes[ 4 ];
+
+    _mm_storeu_ps( lanes, sums );
+
+    *outputLeft  = lanes[ 0 ];
+    *outputRight = lanes[ 1 ];
+
+#else
+
+    float sumLeft  = 0.0f;
+    float sumRight = 0.0f;
+
+    for ( uint32_t tap = 0; tap < TapsPerPhase_; ++tap )
+    {
+        sumLeft  += taps[ tap ] * left[ tap ];
+        sumRight += taps[ tap ] * right[ tap ];
+    }
+
+    *outputLeft  = sumLeft;
+    *outputRight = sumRight;
+
+#endif
+}
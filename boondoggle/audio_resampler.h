@@ -0,0 +1,65 @@
+#ifndef BOONDOGGLE_AUDIO_RESAMPLER_H__
+#define BOONDOGGLE_AUDIO_RESAMPLER_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming polyphase resampling of a stereo signal between two fixed rates, keeping filter history
+// between calls so the audio can be fed through in blocks of any size. The ratio is reduced to
+// outputRate / inputRate = L / M and each output frame is one phase (of L) of a windowed sinc low-pass.
+class StereoResampler
+{
+public:
+
+    // Most filter phases, the reduced output rate. Enough for any pair of the usual device rates.
+    static const uint32_t MAX_PHASES = 1024;
+
+    StereoResampler();
+
+    ~StereoResampler();
+
+    // Initialize for a pair of rates and the most frames that will be passed to a Process call. Returns false
+    // (and is left uninitialized) if the rates are the same or their reduced ratio needs more than MAX_PHASES phases.
+    // The filter cuts off at the lower of the two nyquists, passing up to 0.91 of it.
+    bool Initialize( uint32_t inputRate, uint32_t outputRate, size_t maxInputFrames );
+
+    // Resample frames from both channels, writing at most MaxOutputFrames() to each output.
+    // Returns the number of frames written.
+    size_t Process( const float* left, const float* right, size_t frameCount, float* outputLeft, float* outputRight );
+
+    // Clear the filter history, after a discontinuity in the input.
+    void Reset();
+
+    // The most frames one Process call can output.
+    size_t MaxOutputFrames() const { return ( MaxInputFrames_ * Interpolation_ ) / Decimation_ + 1; }
+
+    // Input frames that will give at least outputFrames more output.
+    size_t InputFramesFor( size_t outputFrames ) const;
+
+    // Delay of the filter in microseconds, how far the output lags the input.
+    uint64_t DelayMicroseconds() const { return DelayMicroseconds_; }
+
+    bool IsInitialized() const { return Bank_ != nullptr; }
+
+    StereoResampler( const StereoResampler& ) = delete;
+
+    StereoResampler& operator=( const StereoResampler& ) = delete;
+
+private:
+
+    void ProcessFrame( const float* left, const float* right, const float* taps, float* outputLeft, float* outputRight ) const;
+
+    float*   Bank_;     // TapsPerPhase_ taps for each phase, in the order they multiply the line.
+    float*   Lines_[ 2 ]; // filter history followed by the incoming frames, per channel.
+    uint32_t TapsPerPhase_;
+    uint32_t Interpolation_; // L
+    uint32_t Decimation_;    // M
+    uint32_t Phase_;         // phase of the next output frame.
+    size_t   Position_;      // line position of the oldest input frame for the next output frame.
+    size_t   MaxInputFrames_;
+    uint64_t DelayMicroseconds_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_RESAMPLER_H__
@@ -0,0 +1,380 @@
+#include "audio_source.h"
+#include "latency_stats.h"
+#include <string.h>
+
+namespace
+{
+    const uint32_t MIN_PERIOD_SAMPLES = 1024;
+    const uint32_t RESAMPLE_FRAMES    = 1024; // frames resampled at a time.
+    const float    MINUS_3DB          = 0.70710678f;
+
+    // Left and right downmix coefficients for each speaker position, in channel mask bit order
+    // (front left, front right, front center, LFE, back left, back right, front left of center,
+    // front right of center, back center, side left, side right, top center, then the top front and back rows).
+    // Centers and surrounds go in at -3dB as per ITU-R BS.775, the LFE is left out.
+    const float SPEAKER_DOWNMIX[][ 2 ] =
+    {
+        { 1.0f, 0.0f },
+        { 0.0f, 1.0f },
+        { MINUS_3DB, MINUS_3DB },
+        { 0.0f, 0.0f },
+        { MINUS_3DB, 0.0f },
+        { 0.0f, MINUS_3DB },
+        { 1.0f, 0.0f },
+        { 0.0f, 1.0f },
+        { 0.5f, 0.5f },
+        { MINUS_3DB, 0.0f },
+        { 0.0f, MINUS_3DB },
+        { 0.5f, 0.5f },
+        { MINUS_3DB, 0.0f },
+        { 0.5f, 0.5f },
+        { 0.0f, MINUS_3DB },
+        { MINUS_3DB, 0.0f },
+        { 0.5f, 0.5f },
+        { 0.0f, MINUS_3DB }
+    };
+
+    const uint32_t SPEAKER_POSITIONS = sizeof( SPEAKER_DOWNMIX ) / sizeof( SPEAKER_DOWNMIX[ 0 ] );
+
+    // The usual channel masks for each channel count, for sources that don't say what their layout is
+    // (mono, stereo, 3.0, quad, 5.0, 5.1, 6.1 and 7.1).
+    const uint32_t DEFAULT_CHANNEL_MASKS[] = { 0, 0x4, 0x3, 0x7, 0x33, 0x37, 0x3F, 0x13F, 0x63F };
+
+    const uint32_t DEFAULT_CHANNEL_MASK_COUNT = sizeof( DEFAULT_CHANNEL_MASKS ) / sizeof( DEFAULT_CHANNEL_MASKS[ 0 ] );
+}
+
+AudioSource::AudioSource() :
+    Cursor_( 0 ),
+    LastReadCursor_( 0 ),
+    WriteTimestamp_( 0 ),
+    WindowTimestamp_( 0 ),
+    SkippedWindows_( 0 ),
+    Kernels_( &GetAudioKernels() ),
+    DownmixChannels_( 0 ),
+    BufferSize_( 0 ),
+    PeriodSamples_( 0 ),
+    HopSamples_( 0 ),
+    SampleRate_( 0 ),
+    InputSampleRate_( 0 ),
+    AnalysisRate_( 0 ),
+    BacklogPeriods_( 0 ),
+    IsMono_( false )
+{
+    Channels_[ 0 ] = nullptr;
+    Channels_[ 1 ] = nullptr;
+
+    ::memset( Staging_, 0, sizeof( Staging_ ) );
+
+    ::memset( DownmixCoefficients_, 0, sizeof( DownmixCoefficients_ ) );
+}
+
+AudioSource::~AudioSource()
+{
+    // both channels memory is one contiguous allocation, so this deletes the buffer for both channels.
+    delete[] Channels_[ 0 ];
+    Channels_[ 0 ] = nullptr;
+    Channels_[ 1 ] = nullptr;
+
+    delete[] Staging_[ 0 ];
+}
+
+bool AudioSource::InitializeBuffer( uint32_t sampleRate, uint32_t requiredFrequency )
+{
+    if ( sampleRate == 0 || requiredFrequency == 0 )
+    {
+        return false;
+    }
+
+    InputSampleRate_ = sampleRate;
+
+    delete[] Staging_[ 0 ];
+    ::memset( Staging_, 0, sizeof( Staging_ ) );
+
+    if ( AnalysisRate_ != 0 && Resampler_.Initialize( sampleRate, AnalysisRate_, RESAMPLE_FRAMES ) )
+    {
+        size_t outputFrames = Resampler_.MaxOutputFrames();
+
+        Staging_[ 0 ] = new float[ ( RESAMPLE_FRAMES + outputFrames ) * 2 ];
+        Staging_[ 1 ] = Staging_[ 0 ] + RESAMPLE_FRAMES;
+        Staging_[ 2 ] = Staging_[ 1 ] + RESAMPLE_FRAMES;
+        Staging_[ 3 ] = Staging_[ 2 ] + outputFrames;
+
+        sampleRate = AnalysisRate_;
+    }
+
+    SampleRate_ = sampleRate;
+
+    uint32_t captureSamples = MIN_PERIOD_SAMPLES;
+
+    while ( sampleRate / captureSamples > requiredFrequency )
+    {
+        captureSamples *= 2;
+    }
+
+    uint32_t ringPeriods = 2;
+
+    // The window being read plus the backlog, rounded up to keep the ring a power of two.
+    while ( ringPeriods < BacklogPeriods_ + 1 )
+    {
+        ringPeriods *= 2;
+    }
+
+    PeriodSamples_ = captureSamples;
+    BufferSize_    = static_cast< size_t >( captureSamples ) * ringPeriods;
+    HopSamples_    = captureSamples;
+
+    delete[] Channels_[ 0 ];
+
+    // each channel is mirrored, so it's twice the buffer size.
+    Channels_[ 0 ] = new float[ BufferSize_ * 4 ]();
+    Channels_[ 1 ] = Channels_[ 0 ] + BufferSize_ * 2;
+
+    ResetCursor();
+
+    return true;
+}
+
+bool AudioSource::SetHopSamples( uint32_t hopSamples )
+{
+    if ( hopSamples == 0 )
+    {
+        HopSamples_ = SamplesPerPeriod();
+        return true;
+    }
+
+    if ( ( hopSamples & ( hopSamples - 1 ) ) != 0 || hopSamples > SamplesPerPeriod() )
+    {
+        return false;
+    }
+
+    HopSamples_ = hopSamples;
+
+    return true;
+}
+
+bool AudioSource::SetDownmix( uint32_t channelCount, const float* leftCoefficients, const float* rightCoefficients )
+{
+    if ( channelCount == 0 || channelCount > MAX_CHANNELS )
+    {
+        return false;
+    }
+
+    ::memset( DownmixCoefficients_, 0, sizeof( DownmixCoefficients_ ) );
+    ::memcpy( DownmixCoefficients_[ 0 ], leftCoefficients, sizeof( float ) * channelCount );
+    ::memcpy( DownmixCoefficients_[ 1 ], rightCoefficients, sizeof( float ) * channelCount );
+
+    DownmixChannels_ = channelCount;
+
+    return true;
+}
+
+bool AudioSource::SetDownmixForLayout( uint32_t channelCount, uint32_t channelMask )
+{
+    if ( channelCount == 0 || channelCount > MAX_CHANNELS )
+    {
+        return false;
+    }
+
+    // Mono and stereo have their own paths that don't need a matrix.
+    if ( channelCount <= 2 )
+    {
+        DownmixChannels_ = 0;
+        return true;
+    }
+
+    if ( channelMask == 0 )
+    {
+        channelMask = channelCount < DEFAULT_CHANNEL_MASK_COUNT ? DEFAULT_CHANNEL_MASKS[ channelCount ] : ( 1u << SPEAKER_POSITIONS ) - 1;
+    }
+
+    float    leftCoefficients[ MAX_CHANNELS ]  = {};
+    float    rightCoefficients[ MAX_CHANNELS ] = {};
+    uint32_t channel                           = 0;
+
+    // Channels are in the order of the mask bits, any channels past the positions in the mask are left out.
+    for ( uint32_t position = 0; position < SPEAKER_POSITIONS && channel < channelCount; ++position )
+    {
+        if ( ( channelMask & ( 1u << position ) ) != 0 )
+        {
+            leftCoefficients[ channel ]  = SPEAKER_DOWNMIX[ position ][ 0 ];
+            rightCoefficients[ channel ] = SPEAKER_DOWNMIX[ position ][ 1 ];
+
+            ++channel;
+        }
+    }
+
+    return SetDownmix( channelCount, leftCoefficients, rightCoefficients );
+}
+
+void AudioSource::ConvertToStereo( const float* interleaved, uint32_t frameCount, uint32_t channelCount, bool useDownmix, float* left, float* right ) const
+{
+    if ( useDownmix )
+    {
+        Kernels_->Downmix( interleaved, frameCount, channelCount, DownmixCoefficients_[ 0 ], DownmixCoefficients_[ 1 ], left, right );
+    }
+    else if ( channelCount == 2 )
+    {
+        Kernels_->Deinterleave( interleaved, frameCount, left, right );
+    }
+    else
+    {
+        ::memcpy( left, interleaved, sizeof( float ) * frameCount );
+        ::memcpy( right, interleaved, sizeof( float ) * frameCount );
+    }
+}
+
+void AudioSource::WriteRing( const float* left, const float* right, size_t frameCount )
+{
+    // Write in spans that stop at the end of the ring, so each one is contiguous on both sides.
+    while ( frameCount > 0 )
+    {
+        size_t where = static_cast< size_t >( Cursor_ & ( BufferSize_ - 1 ) );
+        size_t span  = BufferSize_ - where < frameCount ? BufferSize_ - where : frameCount;
+
+        ::memcpy( Channels_[ 0 ] + where, left, sizeof( float ) * span );
+        ::memcpy( Channels_[ 1 ] + where, right, sizeof( float ) * span );
+        ::memcpy( Channels_[ 0 ] + where + BufferSize_, left, sizeof( float ) * span );
+        ::memcpy( Channels_[ 1 ] + where + BufferSize_, right, sizeof( float ) * span );
+
+        left       += span;
+        right      += span;
+        frameCount -= span;
+        Cursor_    += span;
+    }
+}
+
+void AudioSource::WriteFrames( const float* interleaved, uint32_t frameCount, uint32_t channelCount, uint64_t timestamp )
+{
+    if ( timestamp == 0 )
+    {
+        WriteTimestamp_ = LatencyTimestamp();
+    }
+    else if ( frameCount > 0 )
+    {
+        WriteTimestamp_ = timestamp + ( static_cast< uint64_t >( frameCount - 1 ) * 1000000 ) / InputSampleRate_;
+    }
+
+    if ( channelCount > 2 && channelCount != DownmixChannels_ )
+    {
+        SetDownmixForLayout( channelCount, 0 );
+    }
+
+    bool useDownmix = channelCount == DownmixChannels_;
+
+    if ( channelCount == 0 || ( channelCount > 2 && !useDownmix ) )
+    {
+        return;
+    }
+
+    IsMono_ = channelCount == 1 && !useDownmix;
+
+    if ( Resampler_.IsInitialized() )
+    {
+        // The newest resampled frame lags the newest input by the filter delay.
+        WriteTimestamp_ = WriteTimestamp_ > Resampler_.DelayMicroseconds() ? WriteTimestamp_ - Resampler_.DelayMicroseconds() : WriteTimestamp_;
+
+        while ( frameCount > 0 )
+        {
+            uint32_t block = frameCount < RESAMPLE_FRAMES ? frameCount : RESAMPLE_FRAMES;
+
+            ConvertToStereo( interleaved, block, channelCount, useDownmix, Staging_[ 0 ], Staging_[ 1 ] );
+
+            size_t resampled = Resampler_.Process( Staging_[ 0 ], Staging_[ 1 ], block, Staging_[ 2 ], Staging_[ 3 ] );
+
+            WriteRing( Staging_[ 2 ], Staging_[ 3 ], resampled );
+
+            interleaved += static_cast< size_t >( block ) * channelCount;
+            frameCount  -= block;
+        }
+
+        return;
+    }
+
+    // Write in spans that stop at the end of the ring, so each one is contiguous on both sides.
+    while ( frameCount > 0 )
+    {
+        size_t   where = static_cast< size_t >( Cursor_ & ( BufferSize_ - 1 ) );
+        uint32_t span  = static_cast< uint32_t >( BufferSize_ - where < frameCount ? BufferSize_ - where : frameCount );
+        float*   left  = Channels_[ 0 ] + where;
+        float*   right = Channels_[ 1 ] + where;
+
+        ConvertToStereo( interleaved, span, channelCount, useDownmix, left, right );
+
+        // Then the mirror copy.
+        ::memcpy( left + BufferSize_, left, sizeof( float ) * span );
+        ::memcpy( right + BufferSize_, right, sizeof( float ) * span );
+
+        interleaved += static_cast< size_t >( span ) * channelCount;
+        frameCount  -= span;
+        Cursor_     += span;
+    }
+}
+
+void AudioSource::ResetCursor()
+{
+    Cursor_         = 0;
+    LastReadCursor_ = 0;
+
+    Resampler_.Reset();
+}
+
+size_t AudioSource::FramesUntilUpdate() const
+{
+    uint64_t nextUpdate = LastReadCursor_ + HopSamples_;
+
+    // The first window needs a whole period.
+    if ( nextUpdate < SamplesPerPeriod() )
+    {
+        nextUpdate = SamplesPerPeriod();
+    }
+
+    return nextUpdate > Cursor_ ? static_cast< size_t >( nextUpdate - Cursor_ ) : 0;
+}
+
+uint64_t AudioSource::NextWindowEnd() const
+{
+    uint64_t next = LastReadCursor_ + HopSamples_ < PeriodSamples_ ? PeriodSamples_ : LastReadCursor_ + HopSamples_;
+
+    if ( BacklogPeriods_ > 0 && Cursor_ > BufferSize_ )
+    {
+        // Windows that start before the oldest frame still in the ring have been overwritten.
+        uint64_t oldest = Cursor_ - BufferSize_ + PeriodSamples_;
+
+        oldest = ( oldest + HopSamples_ - 1 ) & ~( static_cast< uint64_t >( HopSamples_ ) - 1 );
+        next   = next > oldest ? next : oldest;
+    }
+
+    return next;
+}
+
+size_t AudioSource::PendingWindows() const
+{
+    uint64_t latest = Cursor_ & ~( static_cast< uint64_t >( HopSamples_ ) - 1 );
+    uint64_t next   = NextWindowEnd();
+
+    return next > latest ? 0 : static_cast< size_t >( ( latest - next ) / HopSamples_ + 1 );
+}
+
+AudioUpdateResult AudioSource::CheckForUpdate()
+{
+    AudioUpdateResult result =
+        FramesUntilUpdate() == 0 ?
+            AudioUpdateResult::UPDATED :
+            AudioUpdateResult::NOT_UPDATED;
+
+    if ( result == AudioUpdateResult::UPDATED )
+    {
+        uint64_t expected  = LastReadCursor_ + HopSamples_ < PeriodSamples_ ? PeriodSamples_ : LastReadCursor_ + HopSamples_;
+        uint64_t windowEnd = BacklogPeriods_ > 0 ? NextWindowEnd() : Cursor_ & ~( static_cast< uint64_t >( HopSamples_ ) - 1 );
+
+        SkippedWindows_ += ( windowEnd - expected ) / HopSamples_;
+        LastReadCursor_  = windowEnd;
+
+        // The window ends before the last frame written when it's rounded down to the hop.
+        uint64_t framesAfterWindow = ( ( Cursor_ - LastReadCursor_ ) * 1000000 ) / SampleRate_;
+
+        WindowTimestamp_ = WriteTimestamp_ > framesAfterWindow ? WriteTimestamp_ - framesAfterWindow : WriteTimestamp_;
+    }
+
+    return result;
+}
@@ -0,0 +1,179 @@
+#ifndef BOONDOGGLE_AUDIO_SOURCE_H__
+#define BOONDOGGLE_AUDIO_SOURCE_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "audio_kernels.h"
+#include "audio_resampler.h"
+
+enum class AudioUpdateResult
+{
+    UPDATED       = 0,
+    NOT_UPDATED   = 1,
+    AUDIO_ERROR   = 2,
+    END_OF_STREAM = 3
+};
+
+// Base for anything that can feed audio into the processing pipeline.
+// Owns a ring buffer of two periods per channel (always stereo, more when catching up), derived
+// sources pull from wherever their audio comes from and write frames into it.
+// Sources with more than 2 channels are mixed down to stereo with a downmix matrix.
+// The ring is mirrored (each sample is written twice, one buffer apart), so the
+// analysis window is always contiguous no matter where the hop lands.
+// With an analysis rate set, audio at any other rate is resampled to it on the way into the ring,
+// so the period and everything derived from it are the same whatever the device runs at.
+class AudioSource
+{
+public:
+
+    // Most channels a source can have.
+    static const uint32_t MAX_CHANNELS = 32;
+
+    AudioSource();
+
+    virtual ~AudioSource();
+
+    // Initialize the source with a required "base frequency" that is the
+    // minimum frequency we need to capture in an audio update.
+    virtual bool Initialize( uint32_t requiredFrequency ) = 0;
+
+    // Pull audio from the source, returns UPDATED when we've filled enough
+    // buffer for another hop (a full period on the first update).
+    virtual AudioUpdateResult PullAudio() = 0;
+
+    // Hand out every window in order (one hop apart) instead of skipping to the latest, so a consumer that stalls
+    // can catch up on what it missed. The ring holds backlogPeriods more periods for that, windows that fall out
+    // of it before they're read are skipped. 0 (the default) skips to the latest window. Call before Initialize.
+    void SetCatchUp( uint32_t backlogPeriods ) { BacklogPeriods_ = backlogPeriods; }
+
+    // Move on to the next window already in the ring without pulling more audio, returns UPDATED if there was one.
+    // Only catching up leaves windows behind, otherwise the last update is always the latest.
+    AudioUpdateResult NextBufferedWindow() { return CheckForUpdate(); }
+
+    // Complete windows in the ring that haven't been read yet.
+    size_t PendingWindows() const;
+
+    // Windows that were never read, because they were passed over for a later one or fell out of the ring.
+    uint64_t SkippedWindows() const { return SkippedWindows_; }
+
+    // Set the number of samples between analysis windows. Must be a power of two 
+    // no bigger than the period, 0 gives a hop of a whole period (no overlap).
+    // Call after Initialize.
+    bool SetHopSamples( uint32_t hopSamples );
+
+    // Set the matrix used to mix sources of channelCount channels down to stereo, one coefficient per
+    // source channel for each side. Replaces the standard downmix for the layout. Returns false if there are too many channels.
+    bool SetDownmix( uint32_t channelCount, const float* leftCoefficients, const float* rightCoefficients );
+
+    // Use the standard downmix for a speaker layout. channelMask has a bit set for each speaker position
+    // present, in channel order, like WAVEFORMATEXTENSIBLE (0 gives the usual layout for the channel count).
+    // Mono and stereo layouts don't need a matrix. Returns false if there are too many channels.
+    bool SetDownmixForLayout( uint32_t channelCount, uint32_t channelMask );
+
+    // Resample the audio to this rate before it goes in the ring, 0 (the default) keeps the source's own rate.
+    // Call before Initialize. Rates that can't be resampled to (too many filter phases) fall back to the source rate.
+    void SetAnalysisRate( uint32_t analysisRate ) { AnalysisRate_ = analysisRate; }
+
+    // Use a particular set of kernels for writing frames (the best supported by default).
+    void SetKernels( const AudioKernels& kernels ) { Kernels_ = &kernels; }
+
+    // The sample rate of the audio in the ring, the analysis rate when resampling.
+    uint32_t SampleRate() const { return SampleRate_; }
+
+    // The sample rate the source delivers audio at.
+    uint32_t InputSampleRate() const { return InputSampleRate_; }
+
+    // True when the source audio is being resampled to the analysis rate.
+    bool IsResampling() const { return Resampler_.IsInitialized(); }
+
+    // Number of samples in an individual period (the analysis window).
+    size_t SamplesPerPeriod() const { return PeriodSamples_; }
+
+    // Number of samples between the end of each analysis window.
+    size_t HopSamples() const { return HopSamples_; }
+
+    // True when the source audio is mono and both channels hold the same samples.
+    bool IsMono() const { return IsMono_; }
+
+    // Total frames written up to the end of the window from the last update (resets on discontinuities).
+    uint64_t WindowEndCursor() const { return LastReadCursor_; }
+
+    // Latency timestamp of when the last frame of the window from the last update was captured.
+    uint64_t WindowTimestamp() const { return WindowTimestamp_; }
+
+    // The number of frames that need to be written before another window is complete.
+    size_t FramesUntilUpdate() const;
+
+    // Get left=0 or right=1 channel (always stereo) for the window ending at the last update,
+    // SamplesPerPeriod() samples long.
+    const float* GetChannel( uint32_t channel ) const
+    {
+        uint64_t windowStart = ( LastReadCursor_ - SamplesPerPeriod() ) & ( BufferSize_ - 1 );
+
+        return Channels_[ channel ] + windowStart;
+    }
+
+    AudioSource( const AudioSource& ) = delete;
+
+    AudioSource& operator=( const AudioSource& ) = delete;
+
+protected:
+
+    // Allocate the ring buffer for audio at a particular sample rate, choosing the period
+    // so that the rate / period is at or below the required frequency. Sets up resampling
+    // when an analysis rate is set, then the period is chosen for the analysis rate.
+    bool InitializeBuffer( uint32_t sampleRate, uint32_t requiredFrequency );
+
+    // Source frames to write for the next window to be complete, FramesUntilUpdate() at the source rate.
+    size_t InputFramesUntilUpdate() const
+    {
+        return Resampler_.IsInitialized() ? Resampler_.InputFramesFor( FramesUntilUpdate() ) : FramesUntilUpdate();
+    }
+
+    // Write interleaved frames into the ring buffer. Mono is duplicated into both channels,
+    // anything with more than 2 channels is mixed down (using the standard layout if no downmix was set
+    // for the channel count). Frames with more than MAX_CHANNELS are dropped. timestamp is the LatencyTimestamp
+    // the first frame was captured at, 0 if the source doesn't know (then it's taken as now for the last frame).
+    void WriteFrames( const float* interleaved, uint32_t frameCount, uint32_t channelCount, uint64_t timestamp = 0 );
+
+    // Mix or split frames into stereo.
+    void ConvertToStereo( const float* interleaved, uint32_t frameCount, uint32_t channelCount, bool useDownmix, float* left, float* right ) const;
+
+    // Write stereo frames into the ring (and its mirror).
+    void WriteRing( const float* left, const float* right, size_t frameCount );
+
+    // Reset the cursors after a discontinuity in the incoming audio.
+    void ResetCursor();
+
+    // Check if we've got a complete hop since the last update and mark it as read if we have.
+    // If more than one hop is ready, skips to the latest unless catching up, then it's the next in order.
+    AudioUpdateResult CheckForUpdate();
+
+    // End of the next window to read, the oldest still in the ring if catching up has fallen that far behind.
+    uint64_t NextWindowEnd() const;
+
+    uint64_t             Cursor_;
+    uint64_t             LastReadCursor_;
+    uint64_t             WriteTimestamp_; // latency timestamp of the last frame written.
+    uint64_t             WindowTimestamp_;
+    uint64_t             SkippedWindows_;
+    float*               Channels_[ 2 ];
+    float*               Staging_[ 4 ]; // stereo frames before and after resampling, left and right of each.
+    StereoResampler      Resampler_;
+    const AudioKernels*  Kernels_;
+    float                DownmixCoefficients_[ 2 ][ MAX_CHANNELS ]; // left and right, zero past the channel count.
+    uint32_t             DownmixChannels_; // channel count the downmix is for, 0 for none.
+    size_t               BufferSize_; // must be power of two
+    size_t               PeriodSamples_;
+    size_t               HopSamples_; // must be power of two
+    uint32_t             SampleRate_;
+    uint32_t             InputSampleRate_;
+    uint32_t             AnalysisRate_; // 0 for none.
+    uint32_t             BacklogPeriods_; // 0 when not catching up.
+    bool                 IsMono_;
+
+};
+
+#endif // -- BOONDOGGLE_AUDIO_SOURCE_H__
@@ -0,0 +1,180 @@
+#include "audio_thread.h"
+#include "../common/boondoggle_helpers.h"
+#include <string.h>
+#include <chrono>
+
+namespace
+{
+    // Bounds on how long the audio thread sleeps when it's waiting for more audio.
+    const uint64_t MIN_WAIT_MICROSECONDS = 500;
+    const uint64_t MAX_WAIT_MICROSECONDS = 5000;
+}
+
+void CopyAudioConstants( const PerFrameConstants& from, PerFrameConstants& to )
+{
+    ::memcpy( to.SoundFrequencyBuckets, from.SoundFrequencyBuckets, sizeof( from.SoundFrequencyBuckets ) );
+
+    to.SoundRMS[ 0 ]          = from.SoundRMS[ 0 ];
+    to.SoundRMS[ 1 ]          = from.SoundRMS[ 1 ];
+    to.SoundRMSdbSPL[ 0 ]     = from.SoundRMSdbSPL[ 0 ];
+    to.SoundRMSdbSPL[ 1 ]     = from.SoundRMSdbSPL[ 1 ];
+    to.SoundSampleRate        = from.SoundSampleRate;
+    to.SoundSamples           = from.SoundSamples;
+    to.NoiseFloorDbSPL        = from.NoiseFloorDbSPL;
+    to.SoundOnsetStrength     = from.SoundOnsetStrength;
+    to.SoundBPM               = from.SoundBPM;
+    to.SoundBeatPhase         = from.SoundBeatPhase;
+    to.SoundBeatConfidence    = from.SoundBeatConfidence;
+    to.SoundLoudnessMomentary = from.SoundLoudnessMomentary;
+    to.SoundLoudnessShortTerm = from.SoundLoudnessShortTerm;
+    to.SoundLoudnessGain      = from.SoundLoudnessGain;
+}
+
+AudioThread::AudioThread() :
+    Processing_( nullptr ),
+    TextureMemory_( nullptr ),
+    TextureSamples_( 0 ),
+    TextureBytes_( 0 ),
+    TextureFormat_( SoundTextureFormat::FLOAT32 ),
+    Back_( 0 ),
+    Front_( 2 ),
+    Sequence_( 0 ),
+    StopRequested_( false ),
+    Error_( false ),
+    Shared_( 1 )
+{
+    for ( AudioSnapshot& snapshot : Snapshots_ )
+    {
+        snapshot.TextureData    = nullptr;
+        snapshot.Timestamps     = AudioTimestamps();
+        snapshot.Sequence       = 0;
+        snapshot.HistoryWritten = 0;
+    }
+}
+
+AudioThread::~AudioThread()
+{
+    Stop();
+
+    AlignedFree( TextureMemory_ );
+}
+
+bool AudioThread::Start( AudioProcessing& processing, const PerFrameConstants& initialConstants, uint32_t historyRows )
+{
+    Stop();
+
+    Processing_     = &processing;
+    TextureSamples_ = processing.SamplesPerPeriod();
+    TextureBytes_   = processing.AudioTextureBytes();
+    TextureFormat_  = processing.TextureFormat();
+    Working_        = initialConstants;
+    Sequence_       = 0;
+    Back_           = 0;
+    Front_          = 2;
+
+    Shared_.store( 1, std::memory_order_relaxed );
+    StopRequested_.store( false, std::memory_order_relaxed );
+    Error_.store( false, std::memory_order_relaxed );
+
+    AlignedFree( TextureMemory_ );
+
+    // Starts zeroed, so the texture is silence until the first update.
+    TextureMemory_ = reinterpret_cast< uint8_t* >( AlignedAllocateZeroed( TextureBytes_ * SNAPSHOT_COUNT, 16 ) );
+
+    if ( TextureMemory_ == nullptr ||
+         !History_.Initialize( historyRows, TextureSamples_, TextureFormat_, processing.BucketCount() ) )
+    {
+        return false;
+    }
+
+    for ( uint32_t slot = 0; slot < SNAPSHOT_COUNT; ++slot )
+    {
+        Snapshots_[ slot ].Constants      = initialConstants;
+        Snapshots_[ slot ].TextureData    = TextureMemory_ + slot * TextureBytes_;
+        Snapshots_[ slot ].Timestamps     = processing.Timestamps();
+        Snapshots_[ slot ].Sequence       = 0;
+        Snapshots_[ slot ].HistoryWritten = 0;
+    }
+
+    Thread_ = std::thread( &AudioThread::Run, this );
+
+    return true;
+}
+
+void AudioThread::Stop()
+{
+    if ( Thread_.joinable() )
+    {
+        StopRequested_.store( true, std::memory_order_release );
+        Thread_.join();
+    }
+}
+
+const AudioSnapshot* AudioThread::LatestSnapshot()
+{
+    if ( ( Shared_.load( std::memory_order_relaxed ) & FRESH_BIT ) == 0 )
+    {
+        return nullptr;
+    }
+
+    // Swap our front slot for the fresh one, the audio thread can only ever swap the shared slot
+    // with its back slot, so there's no race for the slot we get back.
+    Front_ = Shared_.exchange( Front_, std::memory_order_acq_rel ) & INDEX_MASK;
+
+    return &Snapshots_[ Front_ ];
+}
+
+void AudioThread::Publish()
+{
+    AudioSnapshot& snapshot = Snapshots_[ Back_ ];
+
+    // Every update goes in the history, even if the render thread never sees its snapshot. The row is
+    // written before the exchange below releases it along with the snapshot.
+    History_.Write( Processing_->AudioTexture(), Working_ );
+
+    snapshot.Constants      = Working_;
+    snapshot.Timestamps     = Processing_->Timestamps();
+    snapshot.Sequence       = ++Sequence_;
+    snapshot.HistoryWritten = History_.Written();
+
+    ::memcpy( TextureMemory_ + Back_ * TextureBytes_, Processing_->AudioTexture(), TextureBytes_ );
+
+    Back_ = Shared_.exchange( Back_ | FRESH_BIT, std::memory_order_acq_rel ) & INDEX_MASK;
+}
+
+void AudioThread::Run()
+{
+    const AudioSource& source = Processing_->Source();
+
+    while ( !StopRequested_.load( std::memory_order_acquire ) )
+    {
+        // Processing runs on the buffers from Initialize, debug builds assert updates don't touch the heap.
+        NoHeapAllocationScope updateAllocations;
+
+        AudioUpdateResult result = Processing_->Update( Working_ );
+
+        if ( result == AudioUpdateResult::AUDIO_ERROR )
+        {
+            Error_.store( true, std::memory_order_release );
+            return;
+        }
+        else if ( result == AudioUpdateResult::END_OF_STREAM )
+        {
+            return;
+        }
+        else if ( result == AudioUpdateResult::UPDATED )
+        {
+            Publish();
+            continue;
+        }
+
+        // Not enough audio for another window yet, so sleep for part of the time until there should be.
+        uint64_t waitMicroseconds =
+            ( static_cast< uint64_t >( source.FramesUntilUpdate() ) * 1000000 ) / ( static_cast< uint64_t >( source.SampleRate() ) * 2 );
+
+        waitMicroseconds = waitMicroseconds < MIN_WAIT_MICROSECONDS ? MIN_WAIT_MICROSECONDS : waitMicroseconds;
+        waitMicroseconds = waitMicroseconds > MAX_WAIT_MICROSECONDS ? MAX_WAIT_MICROSECONDS : waitMicroseconds;
+
+        std::this_thread::sleep_for( std::chrono::microseconds( waitMicroseconds ) );
+    }
+}
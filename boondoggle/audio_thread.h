@@ -0,0 +1,108 @@
+#ifndef BOONDOGGLE_AUDIO_THREAD_H__
+#define BOONDOGGLE_AUDIO_THREAD_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "audio.h"
+#include "audio_history.h"
+
+// Results of one audio analysis update, published from the audio thread.
+struct AudioSnapshot
+{
+    // Only the sound fields are valid, use CopyAudioConstants to take them.
+    PerFrameConstants Constants;
+
+    // Sound texture data, AudioThread::TextureSamples() texels in the AudioThread::TextureFormat().
+    const void*       TextureData;
+
+    // When the analysed window was captured, pulled and processed.
+    AudioTimestamps   Timestamps;
+
+    // Incremented for every update published, so consumers can tell if they skipped any.
+    uint64_t          Sequence;
+
+    // Sound history rows written up to and including this update, including those of updates skipped.
+    uint64_t          HistoryWritten;
+};
+
+// Copy just the fields AudioProcessing fills in from one set of constants to another.
+void CopyAudioConstants( const PerFrameConstants& from, PerFrameConstants& to );
+
+// Runs audio capture and analysis on its own thread, so the render thread never does audio I/O or
+// waits on audio. Results are published through a lock-free triple buffer: the audio thread always
+// has a slot to write to, the render thread always gets the latest complete update and neither waits on the other.
+class AudioThread
+{
+public:
+
+    AudioThread();
+
+    // Stops the thread if it's running.
+    ~AudioThread();
+
+    // Start processing on a new thread, keeping historyRows rows of sound history (0 for none). The processing
+    // must already be initialized, initialConstants being the constants it was initialized with, and it must
+    // outlive the thread (or Stop be called).
+    bool Start( AudioProcessing& processing, const PerFrameConstants& initialConstants, uint32_t historyRows );
+
+    // Stop the thread and wait for it to finish.
+    void Stop();
+
+    // True if the audio thread stopped because of an error pulling audio.
+    bool HasError() const { return Error_.load( std::memory_order_acquire ); }
+
+    // Number of texels in the sound texture data of each snapshot.
+    size_t TextureSamples() const { return TextureSamples_; }
+
+    // Size in bytes of the sound texture data of each snapshot.
+    size_t TextureBytes() const { return TextureBytes_; }
+
+    // Format of the sound texture data of each snapshot.
+    SoundTextureFormat TextureFormat() const { return TextureFormat_; }
+
+    // Sound history written by the audio thread, a row for every update. Rows up to a snapshot's HistoryWritten
+    // can be read on the render thread.
+    const AudioHistory& History() const { return History_; }
+
+    // Render thread only. Returns the latest snapshot if there has been an update since the last call,
+    // otherwise nullptr. The snapshot stays valid until the next call. Never blocks.
+    const AudioSnapshot* LatestSnapshot();
+
+    AudioThread( const AudioThread& ) = delete;
+
+    AudioThread& operator=( const AudioThread& ) = delete;
+
+private:
+
+    static const uint32_t SNAPSHOT_COUNT = 3;
+    static const uint32_t FRESH_BIT      = 0x4; // set on the shared index when it holds an unread update.
+    static const uint32_t INDEX_MASK     = 0x3;
+
+    void Run();
+
+    // Audio thread only, hand the back slot over as the latest update.
+    void Publish();
+
+    AudioProcessing*        Processing_;
+    std::thread             Thread_;
+    uint8_t*                TextureMemory_;
+    size_t                  TextureSamples_;
+    size_t                  TextureBytes_;
+    SoundTextureFormat      TextureFormat_;
+    AudioSnapshot           Snapshots_[ SNAPSHOT_COUNT ];
+    uint32_t                Back_;  // slot the audio thread is writing.
+    uint32_t                Front_; // slot the render thread is reading.
+    uint64_t                Sequence_;
+    PerFrameConstants       Working_; // constants being updated by processing on the audio thread.
+    AudioHistory            History_;
+    std::atomic< bool >     StopRequested_;
+    std::atomic< bool >     Error_;
+
+    // The slot in the middle, on its own cache line as both threads hit it.
+    alignas( 64 ) std::atomic< uint32_t > Shared_;
+};
+
+#endif // -- BOONDOGGLE_AUDIO_THREAD_H__
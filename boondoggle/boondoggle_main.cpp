@@ -1,17 +1,36 @@
 #include <windows.h>
+#include <wchar.h>
 #include "visualizer.h"
 
 int wmain( int argc, const wchar_t** argv )
 {
-    const wchar_t* packageFile = L"example.bdg";
-    
-    if ( argc >= 2 )
+    const wchar_t* packageFile  = L"example.bdg";
+    const wchar_t* featuresFile = nullptr;
+    bool           watchPackage = false;
+    int            positional   = 0;
+
+    for ( int argument = 1; argument < argc; ++argument )
     {
-        packageFile = argv[ 1 ];
+        // --watch reloads the package whenever it's rebuilt.
+        if ( ::wcscmp( argv[ argument ], L"--watch" ) == 0 )
+        {
+            watchPackage = true;
+        }
+        else if ( positional == 0 )
+        {
+            packageFile = argv[ argument ];
+            ++positional;
+        }
+        else if ( positional == 1 )
+        {
+            // Optionally play back a feature file written by the analyzer instead of capturing audio.
+            featuresFile = argv[ argument ];
+            ++positional;
+        }
     }
     
     // Try and run the oculus main loop.
-    bool oculusResult = DisplayOculusVR( packageFile );
+    bool oculusResult = DisplayOculusVR( packageFile, featuresFile, watchPackage );
 
     // if the oculus main loop couldn't run (no runtime or no HMD connected) then display in a window.
     if ( !oculusResult )
@@ -19,7 +38,7 @@ int wmain( int argc, const wchar_t** argv )
         uint32_t width  = static_cast< uint32_t >( ( GetSystemMetrics( SM_CXSCREEN ) * 5 ) / 6 );
         uint32_t height = static_cast< uint32_t >( ( GetSystemMetrics( SM_CYSCREEN ) * 5 ) / 6 );
 
-        DisplayWindowed( packageFile, width, height, 80.0f );
+        DisplayWindowed( packageFile, featuresFile, watchPackage, width, height, 80.0f );
     }
     
     return 0;
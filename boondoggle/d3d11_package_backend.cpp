@@ -0,0 +1,219 @@
+#include "d3d11_package_backend.h"
+#include "../external/ddstextureloader/DDSTextureLoader.h"
+#include <float.h>
+
+namespace
+{
+    // Translation for texture address modes.
+    D3D11_TEXTURE_ADDRESS_MODE ToAddressMode( TextureAddressMode mode )
+    {
+        switch ( mode )
+        {
+        case TextureAddressMode::CLAMP:
+
+            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_CLAMP;
+
+        case TextureAddressMode::MIRROR:
+
+            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_MIRROR;
+
+        case TextureAddressMode::MIRROR_ONCE:
+
+            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_MIRROR_ONCE;
+
+        case TextureAddressMode::WRAP:
+
+            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_WRAP;
+
+        }
+
+        return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_CLAMP;
+    }
+}
+
+
+void D3D11PackageBackend::Initialize( ID3D11Device* device, ID3D11DeviceContext* context, size_t textureMaxSize )
+{
+    Device_         = device;
+    Context_        = context;
+    TextureMaxSize_ = textureMaxSize;
+}
+
+
+void* D3D11PackageBackend::Create( const PackageView& package, PackageResourceKinds kind, uint32_t index )
+{
+    switch ( kind )
+    {
+    case PackageResourceKinds::PIXEL_SHADER:
+    {
+        PackageBlob         shader = package.Shaders()[ index ];
+        ID3D11PixelShader*  result = nullptr;
+
+        return Device_->CreatePixelShader( shader.Data, shader.Size, nullptr, &result ) == ERROR_SUCCESS ? result : nullptr;
+    }
+
+    case PackageResourceKinds::VERTEX_SHADER:
+    {
+        PackageBlob         shader = package.ScreenAlignedQuadVS();
+        ID3D11VertexShader* result = nullptr;
+
+        return Device_->CreateVertexShader( shader.Data, shader.Size, nullptr, &result ) == ERROR_SUCCESS ? result : nullptr;
+    }
+
+    case PackageResourceKinds::STATIC_TEXTURE:
+    {
+        PackageBlob               texture = package.StaticTextures()[ index ];
+        ID3D11ShaderResourceView* result  = nullptr;
+
+        HRESULT textureCreationResult =
+            DirectX::CreateDDSTextureFromMemory( Device_, Context_, texture.Data, texture.Size, nullptr, &result, TextureMaxSize_ );
+
+        return textureCreationResult == ERROR_SUCCESS ? result : nullptr;
+    }
+
+    case PackageResourceKinds::PROCEDURAL_TEXTURE:
+
+        return CreateProceduralTexture( package.ProceduralTextures()[ index ] );
+
+    case PackageResourceKinds::SAMPLER:
+
+        return CreateSampler( package.Samplers()[ index ] );
+    }
+
+    return nullptr;
+}
+
+
+void D3D11PackageBackend::Release( PackageResourceKinds kind, void* resource )
+{
+    switch ( kind )
+    {
+    case PackageResourceKinds::PIXEL_SHADER:
+
+        static_cast< ID3D11PixelShader* >( resource )->Release();
+        break;
+
+    case PackageResourceKinds::VERTEX_SHADER:
+
+        static_cast< ID3D11VertexShader* >( resource )->Release();
+        break;
+
+    case PackageResourceKinds::STATIC_TEXTURE:
+
+        static_cast< ID3D11ShaderResourceView* >( resource )->Release();
+        break;
+
+    case PackageResourceKinds::PROCEDURAL_TEXTURE:
+
+        delete static_cast< ProceduralTextureTarget* >( resource );
+        break;
+
+    case PackageResourceKinds::SAMPLER:
+
+        static_cast< ID3D11SamplerState* >( resource )->Release();
+        break;
+    }
+}
+
+
+ProceduralTextureTarget* D3D11PackageBackend::CreateProceduralTexture( const ProceduralTexture& procedural )
+{
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+
+    textureDesc.Width     = procedural.Width;
+    textureDesc.Height    = procedural.Height;
+    textureDesc.MipLevels = procedural.GenerateMipMaps ? 0 : 1;
+    textureDesc.ArraySize = 1;
+
+    switch ( procedural.Format )
+    {
+    case ProceduralFormats::R32F:
+
+        textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R32_FLOAT;
+        break;
+
+    case ProceduralFormats::RGBA16F:
+
+        textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R16G16B16A16_FLOAT;
+        break;
+
+    case ProceduralFormats::RGBA32F:
+
+        textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R32G32B32A32_FLOAT;
+        break;
+
+    case ProceduralFormats::RGBA8_UNORM:
+
+        textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
+        break;
+
+    case ProceduralFormats::RGBA8_UNORM_SRGB:
+
+        textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        break;
+    }
+
+    textureDesc.BindFlags        = D3D11_BIND_FLAG::D3D11_BIND_RENDER_TARGET | D3D11_BIND_FLAG::D3D11_BIND_SHADER_RESOURCE;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.MiscFlags        = D3D11_RESOURCE_MISC_FLAG::D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+    COMAutoPtr< ID3D11Texture2D > texture;
+
+    if ( Device_->CreateTexture2D( &textureDesc, nullptr, &texture.raw ) != ERROR_SUCCESS )
+    {
+        return nullptr;
+    }
+
+    ProceduralTextureTarget* result = new ProceduralTextureTarget();
+
+    if ( Device_->CreateRenderTargetView( texture.raw, nullptr, &result->Target.raw ) != ERROR_SUCCESS ||
+         Device_->CreateShaderResourceView( texture.raw, nullptr, &result->View.raw ) != ERROR_SUCCESS )
+    {
+        delete result;
+        return nullptr;
+    }
+
+    return result;
+}
+
+
+ID3D11SamplerState* D3D11PackageBackend::CreateSampler( const Sampler& sampler )
+{
+    D3D11_SAMPLER_DESC samplerDesc = {};
+
+    samplerDesc.AddressU = ToAddressMode( sampler.AddressModes[ 0 ] );
+    samplerDesc.AddressV = ToAddressMode( sampler.AddressModes[ 1 ] );
+    samplerDesc.AddressW = ToAddressMode( sampler.AddressModes[ 2 ] );
+    samplerDesc.MinLOD   = -FLT_MAX;
+    samplerDesc.MaxLOD   = FLT_MAX;
+
+    switch ( sampler.Filter )
+    {
+    case TextureFilterMode::BILINEAR:
+
+        samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+        break;
+
+    case TextureFilterMode::NEAREST:
+
+        samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_MIN_MAG_MIP_POINT;
+        break;
+
+    case TextureFilterMode::ANISOTROPIC:
+
+        samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_ANISOTROPIC;
+        samplerDesc.MaxAnisotropy = sampler.MaxAnisotropy;
+        break;
+
+    case TextureFilterMode::TRILINEAR:
+    default:
+
+        samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
+        break;
+
+    }
+
+    ID3D11SamplerState* result = nullptr;
+
+    return Device_->CreateSamplerState( &samplerDesc, &result ) == ERROR_SUCCESS ? result : nullptr;
+}
@@ -0,0 +1,45 @@
+#ifndef BOONDOGGLE_D3D11_PACKAGE_BACKEND_H__
+#define BOONDOGGLE_D3D11_PACKAGE_BACKEND_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <d3d11_1.h>
+#include "../common/boondoggle_helpers.h"
+#include "../common/package_resources.h"
+
+// A procedural texture's resource, the target it's rendered to and the view effects read it through.
+struct ProceduralTextureTarget
+{
+    COMAutoPtr< ID3D11RenderTargetView >   Target;
+    COMAutoPtr< ID3D11ShaderResourceView > View;
+};
+
+// Creates a package's resources on a D3D11 device. Pixel and vertex shaders are ID3D11PixelShader and
+// ID3D11VertexShader, static textures ID3D11ShaderResourceView, procedural textures ProceduralTextureTarget
+// and samplers ID3D11SamplerState. Resources are created on the thread that owns the context, since it's
+// used to generate the static textures' mip maps.
+class D3D11PackageBackend : public PackageResourceBackend
+{
+public:
+
+    D3D11PackageBackend() : Device_( nullptr ), Context_( nullptr ), TextureMaxSize_( 0 ) {}
+
+    void Initialize( ID3D11Device* device, ID3D11DeviceContext* context, size_t textureMaxSize );
+
+    void* Create( const PackageView& package, PackageResourceKinds kind, uint32_t index ) override;
+
+    void Release( PackageResourceKinds kind, void* resource ) override;
+
+private:
+
+    ProceduralTextureTarget* CreateProceduralTexture( const ProceduralTexture& procedural );
+
+    ID3D11SamplerState* CreateSampler( const Sampler& sampler );
+
+    ID3D11Device*        Device_;
+    ID3D11DeviceContext* Context_;
+    size_t               TextureMaxSize_;
+};
+
+#endif // -- BOONDOGGLE_D3D11_PACKAGE_BACKEND_H__
@@ -0,0 +1,177 @@
+#include "latency_stats.h"
+#include <string.h>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+namespace
+{
+    const char* const STAGE_NAMES[] =
+    {
+        "capture to pull",
+        "pull to processed",
+        "processed to upload",
+        "upload to present",
+        "capture to present"
+    };
+}
+
+uint64_t LatencyTimestamp()
+{
+#if defined( _WIN32 )
+    static const int64_t frequency = []()
+    {
+        LARGE_INTEGER result;
+
+        ::QueryPerformanceFrequency( &result );
+
+        return result.QuadPart;
+    }();
+
+    LARGE_INTEGER counter;
+
+    ::QueryPerformanceCounter( &counter );
+
+    // Split to avoid overflowing the multiply on long uptimes.
+    uint64_t seconds   = static_cast< uint64_t >( counter.QuadPart / frequency );
+    uint64_t remainder = static_cast< uint64_t >( counter.QuadPart % frequency );
+
+    return seconds * 1000000 + ( remainder * 1000000 ) / static_cast< uint64_t >( frequency );
+#else
+    return static_cast< uint64_t >(
+        std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+}
+
+uint64_t ProfileTimestamp()
+{
+#if defined( _WIN32 )
+    static const int64_t frequency = []()
+    {
+        LARGE_INTEGER result;
+
+        ::QueryPerformanceFrequency( &result );
+
+        return result.QuadPart;
+    }();
+
+    LARGE_INTEGER counter;
+
+    ::QueryPerformanceCounter( &counter );
+
+    uint64_t seconds   = static_cast< uint64_t >( counter.QuadPart / frequency );
+    uint64_t remainder = static_cast< uint64_t >( counter.QuadPart % frequency );
+
+    return seconds * 1000000000 + ( remainder * 1000000000 ) / static_cast< uint64_t >( frequency );
+#else
+    return static_cast< uint64_t >(
+        std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+}
+
+LatencyStats::LatencyStats()
+{
+    Reset();
+}
+
+void LatencyStats::Reset()
+{
+    ::memset( Stages_, 0, sizeof( Stages_ ) );
+}
+
+void LatencyStats::Record( LatencyStage stage, uint64_t from, uint64_t to )
+{
+    if ( from == 0 || to == 0 || to < from )
+    {
+        return;
+    }
+
+    Histogram& histogram = Stages_[ static_cast< uint32_t >( stage ) ];
+    uint64_t   latency   = to - from;
+    uint64_t   bucket    = latency / BUCKET_MICROSECONDS;
+
+    histogram.Buckets[ bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1 ] += 1;
+    histogram.Count                                                     += 1;
+    histogram.Total                                                     += latency;
+    histogram.Max                                                        = latency > histogram.Max ? latency : histogram.Max;
+}
+
+void LatencyStats::RecordFrame( const AudioTimestamps& audio, bool isNewAudio, uint64_t uploaded, uint64_t presented )
+{
+    if ( isNewAudio )
+    {
+        Record( LatencyStage::CAPTURE_TO_PULL, audio.Captured, audio.Pulled );
+        Record( LatencyStage::PULL_TO_PROCESSED, audio.Pulled, audio.Processed );
+    }
+
+    Record( LatencyStage::PROCESSED_TO_UPLOAD, audio.Processed, uploaded );
+    Record( LatencyStage::UPLOAD_TO_PRESENT, uploaded, presented );
+    Record( LatencyStage::CAPTURE_TO_PRESENT, audio.Captured, presented );
+}
+
+double LatencyStats::Percentile( const Histogram& histogram, double percentile )
+{
+    uint64_t target     = static_cast< uint64_t >( percentile * static_cast< double >( histogram.Count ) );
+    uint64_t cumulative = 0;
+
+    for ( uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket )
+    {
+        cumulative += histogram.Buckets[ bucket ];
+
+        if ( cumulative > target )
+        {
+            // upper edge of the bucket, so we never under-report.
+            return ( ( bucket + 1 ) * BUCKET_MICROSECONDS ) / 1000.0;
+        }
+    }
+
+    return ( BUCKET_COUNT * BUCKET_MICROSECONDS ) / 1000.0;
+}
+
+void LatencyStats::Print( FILE* output ) const
+{
+    fprintf( output, "%-20s %10s %9s %9s %9s %9s %9s\n", "Stage (ms)", "count", "mean", "p50", "p90", "p99", "max" );
+
+    for ( uint32_t stage = 0; stage < static_cast< uint32_t >( LatencyStage::COUNT ); ++stage )
+    {
+        const Histogram& histogram = Stages_[ stage ];
+
+        if ( histogram.Count == 0 )
+        {
+            fprintf( output, "%-20s %10u\n", STAGE_NAMES[ stage ], 0u );
+            continue;
+        }
+
+        fprintf( output,
+                 "%-20s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+                 STAGE_NAMES[ stage ],
+                 static_cast< unsigned long long >( histogram.Count ),
+                 ( static_cast< double >( histogram.Total ) / static_cast< double >( histogram.Count ) ) / 1000.0,
+                 Percentile( histogram, 0.5 ),
+                 Percentile( histogram, 0.9 ),
+                 Percentile( histogram, 0.99 ),
+                 static_cast< double >( histogram.Max ) / 1000.0 );
+    }
+}
+
+bool LatencyStats::AppendToFile( const char* path ) const
+{
+    FILE* output = ::fopen( path, "a" );
+
+    if ( output == nullptr )
+    {
+        return false;
+    }
+
+    Print( output );
+    fprintf( output, "\n" );
+
+    bool result = ferror( output ) == 0;
+
+    ::fclose( output );
+
+    return result;
+}
@@ -0,0 +1,78 @@
+#ifndef BOONDOGGLE_LATENCY_STATS_H__
+#define BOONDOGGLE_LATENCY_STATS_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Current time in microseconds for latency measurements. On windows this is the performance counter,
+// the same clock WASAPI reports packet positions on.
+uint64_t LatencyTimestamp();
+
+// Current time in nanoseconds, for timing stages of processing too short for LatencyTimestamp.
+uint64_t ProfileTimestamp();
+
+// Times (from LatencyTimestamp) an analysis window went through each stage of the audio pipeline.
+struct AudioTimestamps
+{
+    uint64_t Captured;  // the last frame of the window arrived at the device.
+    uint64_t Pulled;    // PullAudio returned with the window.
+    uint64_t Processed; // analysis of the window finished.
+};
+
+// Stages of the path from captured audio to a presented frame.
+enum class LatencyStage : uint32_t
+{
+    CAPTURE_TO_PULL     = 0,
+    PULL_TO_PROCESSED   = 1,
+    PROCESSED_TO_UPLOAD = 2,
+    UPLOAD_TO_PRESENT   = 3,
+    CAPTURE_TO_PRESENT  = 4,
+    COUNT               = 5
+};
+
+// Histograms of the latency of each stage, for tuning buffer sizes. Not thread safe, record from one thread.
+class LatencyStats
+{
+public:
+
+    LatencyStats();
+
+    // Record a latency for a stage, from and to being timestamps. Ignored if either is missing (0) or to is before from.
+    void Record( LatencyStage stage, uint64_t from, uint64_t to );
+
+    // Record all the stages for a frame that used the audio analysed at the given times. The audio
+    // stages are only recorded for the first frame to use an analysis window (when isNewAudio is true),
+    // the later stages every frame, so they include how stale the audio gets while we wait for more.
+    void RecordFrame( const AudioTimestamps& audio, bool isNewAudio, uint64_t uploaded, uint64_t presented );
+
+    // Forget everything recorded.
+    void Reset();
+
+    // Write a summary of each stage (count, mean, percentiles and max in milliseconds).
+    void Print( FILE* output ) const;
+
+    // Append a summary to a file, returns false if the file couldn't be written.
+    bool AppendToFile( const char* path ) const;
+
+private:
+
+    static const uint32_t BUCKET_MICROSECONDS = 100;
+    static const uint32_t BUCKET_COUNT        = 2000; // 200ms, anything longer goes in the last bucket.
+
+    struct Histogram
+    {
+        uint32_t Buckets[ BUCKET_COUNT ];
+        uint64_t Count;
+        uint64_t Total;
+        uint64_t Max;
+    };
+
+    // Latency in milliseconds at a percentile, from the bucket it falls in.
+    static double Percentile( const Histogram& histogram, double percentile );
+
+    Histogram Stages_[ static_cast< uint32_t >( LatencyStage::COUNT ) ];
+};
+
+#endif // -- BOONDOGGLE_LATENCY_STATS_H__
@@ -3,7 +3,19 @@
 
 #pragma once
 
-#define FREQUENCY_BUCKETS 16
+#include <stdint.h>
+
+// Most frequency buckets there's room for in the constants, the count in use is set per effects package.
+#define FREQUENCY_BUCKETS 32
+
+// Buckets for packages that don't set a count.
+#define DEFAULT_FREQUENCY_BUCKETS 16
+
+// Constant registers (float4s) the bucket values take up, two buckets to a register.
+inline uint32_t SoundBucketRegisters( uint32_t bucketCount )
+{
+    return ( bucketCount + 1 ) / 2;
+}
 
 struct PerFrameConstants
 {
@@ -14,10 +26,6 @@ struct PerFrameConstants
     float TransitionIn; 
     float TransitionOut;
 
-    // Each frequency bin has max dbSPL of the bin for channel 0 and channel 1 (with a cut off noise floor of -60), 
-    // as well as the min and max frequency of the bin.
-    float SoundFrequencyBuckets[ FREQUENCY_BUCKETS ][ 4 ]; 
-
     // Has the non-logarithmic RMS for each channel
     float SoundRMS[ 2 ];
 
@@ -31,7 +39,36 @@ struct PerFrameConstants
 
     float NoiseFloorDbSPL;
 
-    float Padding;
+    // Spectral flux onset strength, 0 to 1, jumps up on an onset and decays quickly after.
+    float SoundOnsetStrength;
+
+    // Tracked tempo in beats per minute, 0 until there's enough audio for an estimate.
+    float SoundBPM;
+
+    // Position in the current beat, 0 on the beat going up to 1 at the next.
+    float SoundBeatPhase;
+
+    // How periodic the onsets are at the tracked tempo, 0 to 1.
+    float SoundBeatConfidence;
+
+    // Row of the sound history texture holding the latest update, older updates are in the rows before
+    // it (wrapping around), so row ( SoundHistoryRow - age ) mod SoundHistoryRows is age updates ago.
+    float SoundHistoryRow;
+
+    // Rows in the sound history texture, 0 if there isn't one.
+    float SoundHistoryRows;
+
+    // K-weighted loudness (ITU-R BS.1770) of both channels over the last 400ms and 3s, in LUFS, -70 for silence.
+    float SoundLoudnessMomentary;
+    float SoundLoudnessShortTerm;
+
+    // Gain that would bring the short-term loudness to -23 LUFS, clamped to +/-24dB, for normalizing reactions to level.
+    float SoundLoudnessGain;
+
+    // Each frequency bucket has the dbSPL for channel 0 and channel 1 (with a cut off noise floor of -60).
+    // Only the package's bucket count is uploaded, after the per view constants; the frequency range of
+    // each bucket never changes, so it goes in its own immutable buffer (see AudioProcessing::BucketRanges).
+    float SoundFrequencyBuckets[ FREQUENCY_BUCKETS ][ 2 ];
 };
 
 struct PerViewConstants
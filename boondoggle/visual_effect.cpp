@@ -3,8 +3,8 @@
 #include "visual_effects.h"
 #include "../common/binary_effects_format.h"
 #include "../common/boondoggle_helpers.h"
-#include "../external/ddstextureloader/DDSTextureLoader.h"
-#include <float.h>
+#include <stddef.h>
+#include <wchar.h>
 
 namespace
 {
@@ -14,78 +14,65 @@ namespace
         float InverseResolution[ 2 ];
     };
     
+    // The constant buffer has the per frame constants up to the buckets, then the per render and per view constants,
+    // then the bucket values for the package's bucket count (see ps_constants.hlsl).
+    const size_t PER_FRAME_SIZE      = offsetof( PerFrameConstants, SoundFrequencyBuckets );
+    const size_t PER_RENDER_OFFSET   = PER_FRAME_SIZE;
+    const size_t PER_VIEW_OFFSET     = PER_RENDER_OFFSET + sizeof( PerRenderConstants );
+    const size_t SOUND_BUCKET_OFFSET = PER_VIEW_OFFSET + sizeof( PerViewConstants );
+
+    static_assert( PER_FRAME_SIZE % 16 == 0, "Per frame constants must fill whole registers" );
+
     // Functions for copying updates of different constants to a buffer.
 
     void UpdatePerRender( const PerRenderConstants& constants, uint8_t* buffer )
     {
-        ::memcpy( buffer + sizeof( PerFrameConstants ), &constants, sizeof( PerRenderConstants ) );
+        ::memcpy( buffer + PER_RENDER_OFFSET, &constants, sizeof( PerRenderConstants ) );
     }
     
-    void UpdatePerFrame( const PerFrameConstants& constants, uint8_t* buffer )
+    void UpdatePerFrame( const PerFrameConstants& constants, uint32_t bucketCount, uint8_t* buffer )
     {
-        ::memcpy( buffer, &constants, sizeof( PerFrameConstants ) );
+        ::memcpy( buffer, &constants, PER_FRAME_SIZE );
+        ::memcpy( buffer + SOUND_BUCKET_OFFSET, constants.SoundFrequencyBuckets, SoundBucketRegisters( bucketCount ) * sizeof( float ) * 4 );
     }
 
 
     void UpdatePerView( const PerViewConstants& constants, uint8_t* buffer )
     {
-        ::memcpy( buffer + sizeof( PerFrameConstants ) + sizeof( PerRenderConstants ), &constants, sizeof( PerViewConstants ) );
+        ::memcpy( buffer + PER_VIEW_OFFSET, &constants, sizeof( PerViewConstants ) );
     }
 
-    // Translation for texture address modes.
-    D3D11_TEXTURE_ADDRESS_MODE ToAddressMode( TextureAddressMode mode )
-    {
-        switch ( mode )
-        {
-        case TextureAddressMode::CLAMP:
-
-            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_CLAMP;
-
-        case TextureAddressMode::MIRROR:
-
-            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_MIRROR;
-
-        case TextureAddressMode::MIRROR_ONCE:
-
-            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_MIRROR_ONCE;
-
-        case TextureAddressMode::WRAP:
-
-            return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_WRAP;
-
-        }
-
-        return D3D11_TEXTURE_ADDRESS_MODE::D3D11_TEXTURE_ADDRESS_CLAMP;
-    }
+    // Address space reserved for the resource arrays of a watched package, so reloads can add resources.
+    const size_t RELOAD_ARENA_RESERVE = 1024 * 1024;
 }
 
 
 BoondoggleEffectsPackage::~BoondoggleEffectsPackage()
 {
-    if ( Package_ != nullptr )
-    {
-        ::UnmapViewOfFile( reinterpret_cast<const void*>( Package_ ) );
-        Package_ = nullptr;
-    }
+    // Stop any load in progress before the packages it could be loading into go.
+    Reloader_.Stop();
 
-    if ( FileHandle_ != nullptr )
-    {
-        ::CloseHandle( FileHandle_ );
-        FileHandle_ = nullptr;
-    }
-
-    delete[] ProceduralTargets_;
+    // The arrays are in the arena, but the COM pointers in them still need releasing.
+    ArenaAllocator::Destruct( ProceduralTargets_, ProceduralTargetCount_ );
     ProceduralTargets_ = nullptr;
 
-    delete[] TextureViews_;
+    ArenaAllocator::Destruct( TextureViews_, TextureViewCount_ );
     TextureViews_ = nullptr;
 
-    delete[] PixelShaders_;
+    ArenaAllocator::Destruct( PixelShaders_, PixelShaderCount_ );
     PixelShaders_ = nullptr;
 
-    delete[] Samplers_;
+    ArenaAllocator::Destruct( Samplers_, SamplerCount_ );
     Samplers_ = nullptr;
 
+    ScreenAlignedQuadVS_.Release();
+
+    for ( LoadedPackage& package : Packages_ )
+    {
+        package.Resources.Release();
+        package.View.Close();
+    }
+
     Device_ = nullptr;
     Context_ = nullptr;
 }
@@ -93,19 +80,32 @@ BoondoggleEffectsPackage::~BoondoggleEffectsPackage()
 
 uint32_t BoondoggleEffectsPackage::EffectCount() const
 {
-    return Package_->EffectCount;
+    return Package().Header().EffectCount;
+}
+
+
+uint32_t BoondoggleEffectsPackage::FrequencyBucketCount() const
+{
+    return Package().Header().FrequencyBucketCount;
+}
+
+
+size_t BoondoggleEffectsPackage::ConstantBufferSize( uint32_t bucketCount )
+{
+    return SOUND_BUCKET_OFFSET + SoundBucketRegisters( bucketCount ) * sizeof( float ) * 4;
 }
 
 
 bool BoondoggleEffectsPackage::RenderInitialTextures( const PerFrameParameters& frameParameters )
 {
-    const VisualEffect& effect = Package_->Effects[ frameParameters.Effect ];
+    const VisualEffect& effect = Package().Effects()[ frameParameters.Effect ];
 
     uint8_t* bufferMemory = frameParameters.BufferMemory;
 
-    TextureViews_[ 0 ] = frameParameters.SoundTextureSRV;
+    TextureViews_[ 0 ]                                     = frameParameters.SoundTextureSRV;
+    TextureViews_[ SoundHistoryTextureIndex( Package().Header() ) ] = frameParameters.SoundHistorySRV;
 
-    UpdatePerFrame( frameParameters.Constants, bufferMemory );
+    UpdatePerFrame( frameParameters.Constants, Package().Header().FrequencyBucketCount, bufferMemory );
 
     Context_->RSSetState( nullptr );
     Context_->IASetVertexBuffers( 0, 0, nullptr, nullptr, nullptr );
@@ -113,12 +113,13 @@ bool BoondoggleEffectsPackage::RenderInitialTextures( const PerFrameParameters&
     Context_->IASetInputLayout( nullptr );
     Context_->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
     Context_->PSSetConstantBuffers( 0, 1, &frameParameters.ConstantBuffer );
+    Context_->PSSetConstantBuffers( 1, 1, &frameParameters.BucketRangeBuffer );
     Context_->VSSetShader( ScreenAlignedQuadVS_.raw, nullptr, 0 );
     Context_->RSSetState( nullptr );
 
-    for ( uint32_t proceduralIndex = 0; proceduralIndex < Package_->ProceduralTextureCount; ++proceduralIndex )
+    for ( uint32_t proceduralIndex = 0; proceduralIndex < Package().Header().ProceduralTextureCount; ++proceduralIndex )
     {
-        if ( Package_->ProceduralTextures[ proceduralIndex ].GenerateAtStart )
+        if ( Package().ProceduralTextures()[ proceduralIndex ].GenerateAtStart )
         {
             bool proceduralResult = RenderProcedural( frameParameters, proceduralIndex );
 
@@ -135,7 +136,7 @@ bool BoondoggleEffectsPackage::RenderInitialTextures( const PerFrameParameters&
 
 bool BoondoggleEffectsPackage::RenderProcedural( const PerFrameParameters& frameParameters, uint32_t proceduralIndex )
 {
-    const ProceduralTexture& procedural = Package_->ProceduralTextures[ proceduralIndex ];
+    const ProceduralTexture& procedural = Package().ProceduralTextures()[ proceduralIndex ];
 
     Context_->OMSetRenderTargets( 1, &ProceduralTargets_[ proceduralIndex ].raw, nullptr );
 
@@ -189,7 +190,7 @@ bool BoondoggleEffectsPackage::RenderProcedural( const PerFrameParameters& frame
 
     if ( procedural.GenerateMipMaps )
     {
-        Context_->GenerateMips( TextureViews_[ 1 + Package_->StaticTextureCount + proceduralIndex ].raw );
+        Context_->GenerateMips( TextureViews_[ 1 + Package().Header().StaticTextureCount + proceduralIndex ].raw );
     }
 
     return true;
@@ -198,18 +199,19 @@ bool BoondoggleEffectsPackage::RenderProcedural( const PerFrameParameters& frame
 
 bool BoondoggleEffectsPackage::Render( const PerFrameParameters& frameParameters, /* array */ const PerViewParameters* views, uint32_t viewCount )
 {
-    if ( frameParameters.Effect >= Package_->EffectCount )
+    if ( frameParameters.Effect >= Package().Header().EffectCount )
     {
         return false;
     }
 
-    TextureViews_[ 0 ] = frameParameters.SoundTextureSRV;
+    TextureViews_[ 0 ]                                     = frameParameters.SoundTextureSRV;
+    TextureViews_[ SoundHistoryTextureIndex( Package().Header() ) ] = frameParameters.SoundHistorySRV;
 
-    const VisualEffect& effect = Package_->Effects[ frameParameters.Effect ];
+    const VisualEffect& effect = Package().Effects()[ frameParameters.Effect ];
 
     uint8_t* bufferMemory = frameParameters.BufferMemory;
 
-    UpdatePerFrame( frameParameters.Constants, bufferMemory );
+    UpdatePerFrame( frameParameters.Constants, Package().Header().FrequencyBucketCount, bufferMemory );
 
     ID3D11Buffer* vertexBuffer = nullptr;
     UINT          zero         = 0;
@@ -221,6 +223,7 @@ bool BoondoggleEffectsPackage::Render( const PerFrameParameters& frameParameters
     Context_->IASetInputLayout( nullptr );
     Context_->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY::D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
     Context_->PSSetConstantBuffers( 0, 1, &frameParameters.ConstantBuffer );
+    Context_->PSSetConstantBuffers( 1, 1, &frameParameters.BucketRangeBuffer );
     Context_->VSSetShader( ScreenAlignedQuadVS_.raw, nullptr, 0 );
 
     for ( uint32_t frameProceduralIndex = 0; frameProceduralIndex < effect.ProceduralTextureCount; ++frameProceduralIndex )
@@ -293,68 +296,64 @@ bool BoondoggleEffectsPackage::Render( const PerFrameParameters& frameParameters
 }
 
 
-bool BoondoggleEffectsPackage::CreateResources( ID3D11Device* device, ID3D11DeviceContext* context, HWND windowHandle, size_t textureMaxSize, const wchar_t* packageName )
+bool BoondoggleEffectsPackage::CreateResources( ID3D11Device* device,
+                                                ID3D11DeviceContext* context,
+                                                HWND windowHandle,
+                                                size_t textureMaxSize,
+                                                const wchar_t* packageName,
+                                                bool watch )
 {
-    Device_     = device;
-    Context_    = context;
-    FileHandle_ = ::CreateFileW( packageName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr );
-
-    if ( FileHandle_ == INVALID_HANDLE_VALUE || FileHandle_ == nullptr )
-    {
-        ::MessageBoxW( windowHandle, L"Couldn't open package file", L"Package Load Error", MB_OK | MB_ICONERROR );
-        return false;
-    }
+    Device_  = device;
+    Context_ = context;
 
-    LARGE_INTEGER fileSize;
-    BOOL          fileSizeResult = ::GetFileSizeEx( FileHandle_, &fileSize );
+    Backend_.Initialize( device, context, textureMaxSize );
 
-    if ( !fileSizeResult )
+    // A watched package is copied rather than mapped, so the file can be written over by a rebuild.
+    if ( !Current_->View.Open( packageName, PACKAGE_OPEN_DEFAULT | ( watch ? PACKAGE_OPEN_COPY : 0 ) ) )
     {
-        ::MessageBoxW( windowHandle, L"Couldn't get file size", L"Package Load Error", MB_OK | MB_ICONERROR );
+        ::MessageBoxW( windowHandle,
+                       Current_->View.Outdated() ? L"Package is from an older version of Boondoggle, recompile it with the current compiler" :
+                                                   L"Couldn't open package file or package not valid",
+                       L"Package Load Error",
+                       MB_OK | MB_ICONERROR );
         return false;
     }
 
-    PackageSize_ = static_cast< size_t >( fileSize.QuadPart );
+    // Every resource array is allocated up front so nothing is allocated while rendering. Reloads re-use the
+    // arena, so when watching there's room for a package to grow.
+    size_t arenaSize = ResourceArraysSize( Package() );
 
-    HANDLE fileMappingHandle = ::CreateFileMappingW( FileHandle_, nullptr, PAGE_READONLY, 0, 0, nullptr );
-
-    if ( fileMappingHandle == nullptr )
+    if ( watch && arenaSize < RELOAD_ARENA_RESERVE )
     {
-        ::MessageBoxW( windowHandle, L"Couldn't create file package mapping", L"Package Load Error", MB_OK | MB_ICONERROR );
-        return false;
+        arenaSize = RELOAD_ARENA_RESERVE;
     }
 
-    void* filePointer = ::MapViewOfFile( fileMappingHandle, FILE_MAP_READ, 0, 0, PackageSize_ );
-
-    Package_ = reinterpret_cast< const BoondogglePackageHeader* >( filePointer );
-
-    ::CloseHandle( fileMappingHandle );
-
-    if ( Package_ == nullptr ||
-         !ValidatePackage( *Package_, reinterpret_cast< const uint8_t* >( filePointer ) + PackageSize_ ) )
+    if ( !Arena_.Initialize( "effects package", arenaSize ) )
     {
-        ::MessageBoxW( windowHandle, L"Package file not valid", L"Package Load Error", MB_OK | MB_ICONERROR );
+        ::MessageBoxW( windowHandle, L"Couldn't reserve package memory", L"Package Load Error", MB_OK | MB_ICONERROR );
         return false;
     }
 
-    TextureViews_ = new COMAutoPtr< ID3D11ShaderResourceView >[ 1 + Package_->StaticTextureCount + Package_->ProceduralTextureCount ];
+    ArenaReserved_ = arenaSize;
 
-    for ( uint32_t textureIndex = 0; textureIndex < Package_->StaticTextureCount; ++textureIndex )
+    Current_->Resources.Prepare( Package() );
+
+    if ( !Current_->Resources.Create( Backend_, Package(), nullptr ) )
     {
-        HRESULT textureCreationResult =
-            DirectX::CreateDDSTextureFromMemory( device,
-                                                 context,
-                                                 Package_->StaticTextures[ textureIndex ].Data,
-                                                 Package_->StaticTextures[ textureIndex ].ResourceSize,
-                                                 nullptr,
-                                                 &TextureViews_[ textureIndex + 1 ].raw,
-                                                 textureMaxSize );
-
-        if ( textureCreationResult != ERROR_SUCCESS )
+        static const wchar_t* const FAILURE_MESSAGES[ PACKAGE_RESOURCE_KIND_COUNT ] =
         {
-            ::MessageBoxW( windowHandle, L"Couldn't create texture", L"Package Load Error", MB_OK | MB_ICONERROR );
-            return false;
-        }
+            L"Couldn't create pixel shader",
+            L"Couldn't create vertex shader",
+            L"Couldn't create texture",
+            L"Couldn't create procedural texture",
+            L"Couldn't create sampler"
+        };
+
+        ::MessageBoxW( windowHandle,
+                       FAILURE_MESSAGES[ static_cast< uint32_t >( Current_->Resources.FailedKind() ) ],
+                       L"Package Load Error",
+                       MB_OK | MB_ICONERROR );
+        return false;
     }
 
     D3D11_RASTERIZER_DESC rasterizerDesc = {};
@@ -403,154 +402,136 @@ bool BoondoggleEffectsPackage::CreateResources( ID3D11Device* device, ID3D11Devi
         return false;
     }
 
-    ProceduralTargets_ = new COMAutoPtr< ID3D11RenderTargetView >[ Package_->ProceduralTextureCount ];
+    BindResources();
 
-    for ( uint32_t proceduralIndex = 0; proceduralIndex < Package_->ProceduralTextureCount; ++proceduralIndex )
-    {
-        const ProceduralTexture& procedural  = Package_->ProceduralTextures[ proceduralIndex ];
-        D3D11_TEXTURE2D_DESC     textureDesc = {};
+    // The resources have copies of the payloads, so any decompressed sections can go.
+    Current_->View.ReleasePayloads();
 
-        textureDesc.Width     = procedural.Width;
-        textureDesc.Height    = procedural.Height;
-        textureDesc.MipLevels = procedural.GenerateMipMaps ? 0 : 1;
-        textureDesc.ArraySize = 1;
-
-        switch ( procedural.Format )
-        {
-        case ProceduralFormats::R32F:
+    if ( watch && !Reloader_.Start( packageName, Packages_[ 1 ] ) )
+    {
+        ::MessageBoxW( windowHandle, L"Couldn't watch package file", L"Package Load Error", MB_OK | MB_ICONERROR );
+        return false;
+    }
 
-            textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R32_FLOAT;
-            break;
+    return true;
+}
 
-        case ProceduralFormats::RGBA16F:
 
-            textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R16G16B16A16_FLOAT;
-            break;
+bool BoondoggleEffectsPackage::ApplyReload()
+{
+    LoadedPackage* loaded = Reloader_.TakeReady();
 
-        case ProceduralFormats::RGBA32F:
+    if ( loaded == nullptr )
+    {
+        return false;
+    }
 
-            textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R32G32B32A32_FLOAT;
-            break;
+    // The bucket count sizes the constant and bucket range buffers, and the arrays have to fit the arena.
+    if ( loaded->View.Header().FrequencyBucketCount != Package().Header().FrequencyBucketCount )
+    {
+        ::OutputDebugStringW( L"Package reload skipped, the frequency bucket count changed (restart to load it)\n" );
+        Reloader_.Recycle( *loaded );
+        return false;
+    }
 
-        case ProceduralFormats::RGBA8_UNORM:
+    if ( ResourceArraysSize( loaded->View ) > ArenaReserved_ )
+    {
+        ::OutputDebugStringW( L"Package reload skipped, too many resources (restart to load it)\n" );
+        Reloader_.Recycle( *loaded );
+        return false;
+    }
 
-            textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM;
-            break;
+    // Resources whose payload (or description) didn't change move over from the current package.
+    if ( !loaded->Resources.Create( Backend_, loaded->View, &Current_->Resources ) )
+    {
+        ::OutputDebugStringW( L"Package reload skipped, couldn't create its resources\n" );
+        Reloader_.Recycle( *loaded );
+        return false;
+    }
 
-        case ProceduralFormats::RGBA8_UNORM_SRGB:
+    loaded->View.ReleasePayloads();
 
-            textureDesc.Format = DXGI_FORMAT::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-            break;
-        }
+    LoadedPackage* previous = Current_;
 
-        textureDesc.BindFlags        = D3D11_BIND_FLAG::D3D11_BIND_RENDER_TARGET | D3D11_BIND_FLAG::D3D11_BIND_SHADER_RESOURCE;
-        textureDesc.SampleDesc.Count = 1;
-        textureDesc.MiscFlags        = D3D11_RESOURCE_MISC_FLAG::D3D11_RESOURCE_MISC_GENERATE_MIPS;
+    Current_ = loaded;
 
-        COMAutoPtr< ID3D11Texture2D > texture;
+    BindResources();
 
-        HRESULT createTextureResult = device->CreateTexture2D( &textureDesc, nullptr, &texture.raw );
+    // Releases whatever didn't move over.
+    Reloader_.Recycle( *previous );
 
-        if ( createTextureResult != ERROR_SUCCESS )
-        {
-            ::MessageBoxW( windowHandle, L"Couldn't create procedural texture", L"Package Load Error", MB_OK | MB_ICONERROR );
-            return false;
-        }
+    wchar_t message[ 128 ];
 
-        HRESULT createTargetResult = device->CreateRenderTargetView( texture.raw, nullptr, &ProceduralTargets_[ proceduralIndex ].raw );
+    ::swprintf( message,
+                sizeof( message ) / sizeof( wchar_t ),
+                L"Package reloaded, %u resources created, %u kept\n",
+                Current_->Resources.CreatedCount(),
+                Current_->Resources.ReusedCount() );
+    ::OutputDebugStringW( message );
 
-        if ( createTargetResult != ERROR_SUCCESS )
-        {
-            ::MessageBoxW( windowHandle, L"Couldn't create render target view", L"Package Load Error", MB_OK | MB_ICONERROR );
-            return false;
-        }
+    return true;
+}
 
-        HRESULT createViewResult = device->CreateShaderResourceView( texture.raw, nullptr, &TextureViews_[ 1 + Package_->StaticTextureCount + proceduralIndex ].raw );
 
-        if ( createViewResult != ERROR_SUCCESS )
-        {
-            ::MessageBoxW( windowHandle, L"Couldn't create shader resource view", L"Package Load Error", MB_OK | MB_ICONERROR );
-            return false;
-        }
+void BoondoggleEffectsPackage::BindResources()
+{
+    const BoondogglePackageHeader& header    = Package().Header();
+    const PackageResources&        resources = Current_->Resources;
+
+    ArenaAllocator::Destruct( ProceduralTargets_, ProceduralTargetCount_ );
+    ArenaAllocator::Destruct( TextureViews_, TextureViewCount_ );
+    ArenaAllocator::Destruct( PixelShaders_, PixelShaderCount_ );
+    ArenaAllocator::Destruct( Samplers_, SamplerCount_ );
+
+    Arena_.Reset();
+
+    // Slot 0 is the sound texture and the last the sound history, both set each frame.
+    TextureViewCount_      = SoundHistoryTextureIndex( header ) + 1;
+    TextureViews_          = Arena_.Allocate< COMAutoPtr< ID3D11ShaderResourceView > >( TextureViewCount_ );
+    ProceduralTargetCount_ = header.ProceduralTextureCount;
+    ProceduralTargets_     = Arena_.Allocate< COMAutoPtr< ID3D11RenderTargetView > >( ProceduralTargetCount_ );
+    PixelShaderCount_      = header.ShaderCount;
+    PixelShaders_          = Arena_.Allocate< COMAutoPtr< ID3D11PixelShader > >( PixelShaderCount_ );
+    SamplerCount_          = header.SamplerCount;
+    Samplers_              = Arena_.Allocate< COMAutoPtr< ID3D11SamplerState > >( SamplerCount_ );
+
+    // Assigning the raw pointers adds the references the arrays hold.
+    for ( uint32_t textureIndex = 0; textureIndex < header.StaticTextureCount; ++textureIndex )
+    {
+        TextureViews_[ 1 + textureIndex ] =
+            static_cast< ID3D11ShaderResourceView* >( resources.Get( PackageResourceKinds::STATIC_TEXTURE, textureIndex ) );
     }
 
-    PixelShaders_ = new COMAutoPtr< ID3D11PixelShader >[ Package_->ShaderCount ];
-
-    for ( uint32_t shaderIndex = 0; shaderIndex < Package_->ShaderCount; ++shaderIndex )
+    for ( uint32_t proceduralIndex = 0; proceduralIndex < ProceduralTargetCount_; ++proceduralIndex )
     {
-        HRESULT shaderResult =
-            device->CreatePixelShader( Package_->Shaders[ shaderIndex ].Data,
-                                       Package_->Shaders[ shaderIndex ].ResourceSize,
-                                       nullptr,
-                                       &PixelShaders_[ shaderIndex ].raw );
+        ProceduralTextureTarget* procedural =
+            static_cast< ProceduralTextureTarget* >( resources.Get( PackageResourceKinds::PROCEDURAL_TEXTURE, proceduralIndex ) );
 
-        if ( shaderResult != ERROR_SUCCESS )
-        {
-            ::MessageBoxW( windowHandle, L"Couldn't create pixel shader", L"Package Load Error", MB_OK | MB_ICONERROR );
-            return false;
-        }
+        ProceduralTargets_[ proceduralIndex ]                           = procedural->Target;
+        TextureViews_[ 1 + header.StaticTextureCount + proceduralIndex ] = procedural->View;
     }
 
-    HRESULT vertexShaderResult =
-        device->CreateVertexShader( Package_->ScreenAlignedQuadVS.Data,
-                                    Package_->ScreenAlignedQuadVS.ResourceSize,
-                                    nullptr,
-                                    &ScreenAlignedQuadVS_.raw );
-
-    if ( vertexShaderResult != ERROR_SUCCESS )
+    for ( uint32_t shaderIndex = 0; shaderIndex < PixelShaderCount_; ++shaderIndex )
     {
-        ::MessageBoxW( windowHandle, L"Couldn't create vertex shader", L"Package Load Error", MB_OK | MB_ICONERROR );
-        return false;
+        PixelShaders_[ shaderIndex ] = static_cast< ID3D11PixelShader* >( resources.Get( PackageResourceKinds::PIXEL_SHADER, shaderIndex ) );
     }
 
-    Samplers_ = new COMAutoPtr< ID3D11SamplerState >[ Package_->SamplerCount ];
-
-    for ( uint32_t samplerIndex = 0; samplerIndex < Package_->SamplerCount; ++samplerIndex )
+    for ( uint32_t samplerIndex = 0; samplerIndex < SamplerCount_; ++samplerIndex )
     {
-        const Sampler&     sampler     = Package_->Samplers[ samplerIndex ];
-        D3D11_SAMPLER_DESC samplerDesc = {};
-
-        samplerDesc.AddressU = ToAddressMode( sampler.AddressModes[ 0 ] );
-        samplerDesc.AddressV = ToAddressMode( sampler.AddressModes[ 1 ] );
-        samplerDesc.AddressW = ToAddressMode( sampler.AddressModes[ 2 ] );
-        samplerDesc.MinLOD   = -FLT_MAX;
-        samplerDesc.MaxLOD   = FLT_MAX;
-
-        switch ( sampler.Filter )
-        {
-        case TextureFilterMode::BILINEAR:
-
-            samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
-            break;
-
-        case TextureFilterMode::NEAREST:
-
-            samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_MIN_MAG_MIP_POINT;
-            break;
-
-        case TextureFilterMode::ANISOTROPIC:
-
-            samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_ANISOTROPIC;
-            samplerDesc.MaxAnisotropy = sampler.MaxAnisotropy;
-            break;
-
-        case TextureFilterMode::TRILINEAR:
-        default:
-
-            samplerDesc.Filter = D3D11_FILTER::D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
-            break;
+        Samplers_[ samplerIndex ] = static_cast< ID3D11SamplerState* >( resources.Get( PackageResourceKinds::SAMPLER, samplerIndex ) );
+    }
 
-        }
+    ScreenAlignedQuadVS_ = static_cast< ID3D11VertexShader* >( resources.Get( PackageResourceKinds::VERTEX_SHADER, 0 ) );
+}
 
-        HRESULT createSamplerResult =
-            device->CreateSamplerState( &samplerDesc, &Samplers_[ samplerIndex ].raw );
 
-        if ( createSamplerResult != ERROR_SUCCESS )
-        {
-            ::MessageBoxW( windowHandle, L"Couldn't create sampler", L"Package Load Error", MB_OK | MB_ICONERROR );
-            return false;
-        }
-    }
+size_t BoondoggleEffectsPackage::ResourceArraysSize( const PackageView& package )
+{
+    const BoondogglePackageHeader& header = package.Header();
 
-    return true;
+    return sizeof( COMAutoPtr< ID3D11ShaderResourceView > ) * ( SoundHistoryTextureIndex( header ) + 1 ) +
+           sizeof( COMAutoPtr< ID3D11RenderTargetView > ) * header.ProceduralTextureCount +
+           sizeof( COMAutoPtr< ID3D11PixelShader > ) * header.ShaderCount +
+           sizeof( COMAutoPtr< ID3D11SamplerState > ) * header.SamplerCount +
+           sizeof( void* ) * 4;
 }
@@ -5,20 +5,24 @@
 
 #include <stdint.h>
 #include "../common/boondoggle_helpers.h"
+#include "../common/arena_allocator.h"
+#include "../common/package_view.h"
+#include "../common/package_reloader.h"
 #include <d3d11_1.h>
 #include "shared_render_constants.h"
-
-struct BoondogglePackageHeader;
+#include "d3d11_package_backend.h"
 
 // The per frame parameters for rendering effects, including the constants.
 struct PerFrameParameters
 {
     ID3D11Buffer*             ConstantBuffer;
+    ID3D11Buffer*             BucketRangeBuffer; // immutable bucket frequency ranges, may be null before the audio starts.
     uint8_t*                  BufferMemory; // memory to copy to, for use to set the constant buffer.
-    size_t                    BufferMemorySize;
+    size_t                    BufferMemorySize; // ConstantBufferSize for the package's bucket count.
     uint32_t                  Effect;
     PerFrameConstants         Constants;
     ID3D11ShaderResourceView* SoundTextureSRV;
+    ID3D11ShaderResourceView* SoundHistorySRV; // may be null if there's no history texture.
 };
 
 // The per view parameters for rendering effects, including the constants.
@@ -37,21 +41,37 @@ class BoondoggleEffectsPackage
 public:
 
     BoondoggleEffectsPackage() :
-        Package_( nullptr ),
-        PackageSize_( 0 ),
-        FileHandle_( nullptr ),
+        Current_( &Packages_[ 0 ] ),
         ProceduralTargets_( nullptr ),
         TextureViews_( nullptr ),
         PixelShaders_( nullptr ),
         Samplers_( nullptr ),
+        ProceduralTargetCount_( 0 ),
+        TextureViewCount_( 0 ),
+        PixelShaderCount_( 0 ),
+        SamplerCount_( 0 ),
         ScreenAlignedQuadVS_( nullptr ),
+        ArenaReserved_( 0 ),
         Device_( nullptr ),
         Context_( nullptr )
     {
     }
 
-    // Create the resources for a particular package.
-    bool CreateResources( ID3D11Device* device, ID3D11DeviceContext* context, HWND windowHandle, size_t textureMaxSize, const wchar_t* packageName );
+    // Create the resources for a particular package. When watching, the package file is copied into memory
+    // rather than mapped, so it can be rebuilt while it's in use, and new versions are loaded in the
+    // background (see ApplyReload).
+    bool CreateResources( ID3D11Device* device,
+                          ID3D11DeviceContext* context,
+                          HWND windowHandle,
+                          size_t textureMaxSize,
+                          const wchar_t* packageName,
+                          bool watch = false );
+
+    // If a new version of a watched package has loaded, create the resources that changed (keeping the ones
+    // that didn't) and swap it in. Call between frames, this allocates. Returns true if the package changed,
+    // in which case the effect count may differ and the initial textures need rendering again. A version that
+    // changes the bucket count or whose resources can't be created is skipped and the current one kept.
+    bool ApplyReload();
 
     ~BoondoggleEffectsPackage();
 
@@ -64,6 +84,12 @@ public:
     // Number of effects in this package.
     uint32_t EffectCount() const;
 
+    // Number of frequency buckets the package's shaders use, only this many are uploaded each frame.
+    uint32_t FrequencyBucketCount() const;
+
+    // Size of the constant buffer for the given bucket count.
+    static size_t ConstantBufferSize( uint32_t bucketCount );
+
     BoondoggleEffectsPackage( const BoondoggleEffectsPackage& ) = delete;
 
     BoondoggleEffectsPackage& operator=( const BoondoggleEffectsPackage& ) = delete;
@@ -72,18 +98,32 @@ private:
 
     bool RenderProcedural( const PerFrameParameters& frameParameters, uint32_t proceduralIndex );
 
-    const BoondogglePackageHeader*          Package_;
+    // Point the resource arrays at the current package's resources.
+    void BindResources();
+
+    // Bytes of arena the resource arrays need for a package.
+    static size_t ResourceArraysSize( const PackageView& package );
+
+    const PackageView& Package() const { return Current_->View; }
 
-    size_t                                  PackageSize_;
-    HANDLE                                  FileHandle_;
+    D3D11PackageBackend                     Backend_;
+    LoadedPackage                           Packages_[ 2 ]; // the current package and the one reloads load into.
+    LoadedPackage*                          Current_;
+    PackageReloader                         Reloader_;
+    ArenaAllocator                          Arena_; // the resource arrays, these hold a reference to each resource.
     COMAutoPtr< ID3D11RenderTargetView >*   ProceduralTargets_;
     COMAutoPtr< ID3D11ShaderResourceView >* TextureViews_;
     COMAutoPtr< ID3D11PixelShader        >* PixelShaders_;
     COMAutoPtr< ID3D11SamplerState >*       Samplers_;
+    uint32_t                                ProceduralTargetCount_;
+    uint32_t                                TextureViewCount_;
+    uint32_t                                PixelShaderCount_;
+    uint32_t                                SamplerCount_;
     COMAutoPtr< ID3D11VertexShader >        ScreenAlignedQuadVS_;
     COMAutoPtr< ID3D11RasterizerState >     RasterizerState_;
     COMAutoPtr< ID3D11DepthStencilState >   DepthStencilState_;
     COMAutoPtr< ID3D11BlendState >          BlendState_;
+    size_t                                  ArenaReserved_;
 
     ID3D11Device*                           Device_;
     ID3D11DeviceContext*                    Context_;
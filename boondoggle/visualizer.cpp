@@ -5,20 +5,60 @@
 #include "visualizer.h"
 #include "oculus_helpers.h"
 #include "../common/boondoggle_helpers.h"
+#include "../common/allocation_tracker.h"
+#include "../common/arena_allocator.h"
 #include "OVR_CAPI_D3D.h"
 #include "visual_effects.h"
 #include <DirectXMath.h>
 #include "audio.h"
+#include "audio_capture.h"
+#include "audio_thread.h"
+#include "audio_history.h"
+#include "audio_features.h"
+#include "latency_stats.h"
 
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <wchar.h>
 
 namespace
 {
-    const WCHAR* const DISPLAY_CLASS_NAME = L"Boondoggle";
-    const WCHAR* const DISPLAY_TITLE      = L"Boondoggle";
-    const size_t       BufferSize         = 384;
+    const WCHAR* const DISPLAY_CLASS_NAME  = L"Boondoggle";
+    const WCHAR* const DISPLAY_TITLE       = L"Boondoggle";
+    const uint32_t     AudioHopSamples     = 256; // analyze the audio window every 256 samples for lower latency.
+    const uint32_t     AudioLowBandFactor  = 8; // bass buckets come from an 8x longer decimated window.
+    const char* const  LatencyReportPath   = "boondoggle_latency.txt"; // F8 and exiting append latency histograms and memory use here.
+    const uint32_t     SoundHistoryRows    = 128; // audio updates kept in the sound history texture, 0 for none.
+    const uint32_t     AudioAnalysisRate   = 48000; // devices at other rates get resampled, so the analysis is the same on all of them.
+    const uint32_t     AudioCatchUpWindows = 8; // windows missed while the audio thread was held up get analyzed, up to 8 an update.
+
+    // Half precision sound textures, half the upload and plenty of precision for visuals.
+    const SoundTextureFormat AudioTextureFormat = SoundTextureFormat::HALF;
+
+    // Mel spaced triangular filters for the buckets, which follow the energy in each band rather than flickering with its loudest bin.
+    const FrequencyBucketing AudioBucketing = FrequencyBucketing::MEL;
+
+    // Append the latency histograms and the memory each subsystem's arena peaked at to the report.
+    void AppendReport( const LatencyStats& latency )
+    {
+        latency.AppendToFile( LatencyReportPath );
+
+        FILE* output = ::fopen( LatencyReportPath, "a" );
+
+        if ( output != nullptr )
+        {
+            ArenaAllocator::PrintReport( output );
+            fprintf( output, "\n" );
+
+            ::fclose( output );
+        }
+    }
+
+    DXGI_FORMAT ToDXGIFormat( SoundTextureFormat format )
+    {
+        return format == SoundTextureFormat::HALF ? DXGI_FORMAT::DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT::DXGI_FORMAT_R32G32B32A32_FLOAT;
+    }
 
     struct VisualizerResources
     {
@@ -31,8 +71,13 @@ namespace
         ID3D11Texture2D*           BackBuffer;
         ID3D11RenderTargetView*    BackBufferTarget;
         ID3D11Buffer*              ConstantBuffer;
+        size_t                     ConstantBufferSize;
+        ID3D11Buffer*              BucketRangeBuffer;
         ID3D11Texture1D*           SoundTexture;
         ID3D11ShaderResourceView*  SoundTextureSRV;
+        ID3D11Texture2D*           SoundHistoryTexture;
+        ID3D11ShaderResourceView*  SoundHistorySRV;
+        uint64_t                   SoundHistoryUploaded; // history rows uploaded to the texture so far.
 
         LONG                       Width;
         LONG                       Height;
@@ -42,6 +87,7 @@ namespace
         
         int32_t                    LeftDown;
         int32_t                    RightDown;
+        int32_t                    LatencyDumps;
 
         VisualizerResources();
 
@@ -52,7 +98,22 @@ namespace
         // Returns false on failure.
         bool CreateD3D( /*optional*/ const LUID* luid = nullptr );
         
-        bool CreateSoundTexture( const AudioProcessing& from );
+        // Create the sound texture of samples texels in a format, initialized with the given texture data.
+        bool CreateSoundTexture( const void* textureData, size_t samples, SoundTextureFormat format );
+
+        // Upload new sound texture data (all of the texture, in its format).
+        void UpdateSoundTexture( const void* textureData, size_t bytes );
+
+        // Create the immutable buffer of bucket frequency ranges (FREQUENCY_BUCKETS low and high pairs).
+        bool CreateBucketRangeBuffer( const float* bucketRanges );
+
+        // Create the sound history texture for a history's rows, one per audio update. Sets the history constants.
+        // Does nothing if the history has no rows.
+        bool CreateSoundHistoryTexture( const AudioHistory& history, PerFrameConstants& constants );
+
+        // Upload the history rows written since the last upload, up to written (at most a texture's worth, in
+        // one or two boxes), and update the history constants.
+        void UpdateSoundHistory( const AudioHistory& history, uint64_t written, PerFrameConstants& constants );
 
         // Close the D3D device
         void CloseDevice();
@@ -69,8 +130,8 @@ namespace
         // Resize this window
         void Resize( uint32_t width, uint32_t height );
 
-        // Load package.
-        bool LoadPackage( const wchar_t* packageFile );
+        // Load package and create the constant buffer for its bucket count.
+        bool LoadPackage( const wchar_t* packageFile, bool watch );
 
         ~VisualizerResources();
 
@@ -131,6 +192,172 @@ namespace
         return ( (double)positiveDelta / (double)m_frequency );
     }
 
+    // Where the audio driving the visuals comes from. Either live capture analyzed on the audio thread,
+    // or a pre-analyzed feature file played back (looping) from when the feed started, with no analysis at runtime.
+    class AudioFeed
+    {
+    public:
+
+        AudioFeed() : Record_( 0 ), UseFeatures_( false ) {}
+
+        // Play back the feature file if featuresPath isn't null, otherwise start capture and analysis of bucketCount buckets.
+        // Keeps historyRows rows of sound history. Shows an error and returns false on failure.
+        bool Start( VisualizerResources& resources, const wchar_t* featuresPath, uint32_t bucketCount, uint32_t historyRows, PerFrameConstants& constants );
+
+        // True if the audio thread stopped because of an error.
+        bool HasError() const { return !UseFeatures_ && Thread_.HasError(); }
+
+        // Texels in the sound texture data.
+        size_t TextureSamples() const { return UseFeatures_ ? Features_.TextureSamples() : Thread_.TextureSamples(); }
+
+        // Size in bytes of the sound texture data.
+        size_t TextureBytes() const { return UseFeatures_ ? Features_.TextureSamples() * sizeof( float ) * 4 : Thread_.TextureBytes(); }
+
+        // Format of the sound texture data, feature files are always full precision.
+        SoundTextureFormat TextureFormat() const { return UseFeatures_ ? SoundTextureFormat::FLOAT32 : Thread_.TextureFormat(); }
+
+        // Sound texture data from starting, for the initial texture contents.
+        const void* InitialTextureData() const { return UseFeatures_ ? Features_.TextureData( 0 ) : Processing_.AudioTexture(); }
+
+        // Low and high frequency of each of the FREQUENCY_BUCKETS buckets.
+        const float* BucketRanges() const { return UseFeatures_ ? Features_.BucketRanges() : Processing_.BucketRanges(); }
+
+        // Timestamps from starting, all 0 for a feature file as there's no capture to measure.
+        AudioTimestamps InitialTimestamps() const { return UseFeatures_ ? AudioTimestamps() : Processing_.Timestamps(); }
+
+        // Sound history with a row for every update, those up to a snapshot's HistoryWritten can be uploaded.
+        const AudioHistory& History() const { return UseFeatures_ ? FeatureHistory_ : Thread_.History(); }
+
+        // The latest audio update if there's been one since the last call, otherwise nullptr. Never blocks.
+        const AudioSnapshot* LatestSnapshot();
+
+    private:
+
+        AudioCapture       Capture_;
+        AudioProcessing    Processing_;
+        AudioThread        Thread_; // after the processing, so it's stopped before the processing goes.
+        AudioFeatureStream Features_;
+        AudioHistory       FeatureHistory_; // written on the render thread, as records are played.
+        Clock              Playback_;
+        AudioSnapshot      Snapshot_;
+        uint64_t           Record_;
+        bool               UseFeatures_;
+    };
+
+    bool AudioFeed::Start( VisualizerResources& resources, const wchar_t* featuresPath, uint32_t bucketCount, uint32_t historyRows, PerFrameConstants& constants )
+    {
+        if ( featuresPath != nullptr )
+        {
+            if ( !Features_.Open( featuresPath ) )
+            {
+                resources.ShowError( L"Couldn't open audio feature file.", L"Audio feature error." );
+                return false;
+            }
+
+            // The shaders index the buckets up to the package's count, which the recording has to match.
+            if ( Features_.BucketCount() != bucketCount )
+            {
+                wchar_t message[ 160 ];
+
+                ::swprintf( message,
+                            sizeof( message ) / sizeof( wchar_t ),
+                            L"Audio feature file has %u frequency buckets, but the package was compiled for %u. Record it again with the analyzer's --buckets %u.",
+                            Features_.BucketCount(),
+                            bucketCount,
+                            bucketCount );
+                resources.ShowError( message, L"Audio feature error." );
+
+                Features_.Close();
+                return false;
+            }
+
+            if ( !FeatureHistory_.Initialize( historyRows, Features_.TextureSamples(), SoundTextureFormat::FLOAT32, bucketCount ) )
+            {
+                resources.ShowError( L"Couldn't allocate sound history.", L"Audio feature error." );
+                return false;
+            }
+
+            UseFeatures_ = true;
+            Record_      = 0;
+
+            Features_.ApplyRecord( 0, constants );
+            FeatureHistory_.Write( Features_.TextureData( 0 ), constants );
+
+            Snapshot_                = AudioSnapshot();
+            Snapshot_.Constants      = constants;
+            Snapshot_.TextureData    = Features_.TextureData( 0 );
+            Snapshot_.HistoryWritten = FeatureHistory_.Written();
+
+            Playback_.Reset();
+
+            return true;
+        }
+
+        AudioProcessingSettings audioSettings;
+
+        audioSettings.HopSamples        = AudioHopSamples;
+        audioSettings.LowBandDecimation = AudioLowBandFactor;
+        audioSettings.TextureFormat     = AudioTextureFormat;
+        audioSettings.AnalysisRate      = AudioAnalysisRate;
+        audioSettings.CatchUpWindows    = AudioCatchUpWindows;
+        audioSettings.Bucketing         = AudioBucketing;
+        audioSettings.BucketCount       = bucketCount;
+
+        if ( !Processing_.Initialize( Capture_, audioSettings, constants ) )
+        {
+            resources.ShowError( L"Couldn't initialize audio capture.", L"Audio capture error." );
+            return false;
+        }
+
+        if ( !Thread_.Start( Processing_, constants, historyRows ) )
+        {
+            resources.ShowError( L"Couldn't start audio thread.", L"Audio capture error." );
+            return false;
+        }
+
+        return true;
+    }
+
+    const AudioSnapshot* AudioFeed::LatestSnapshot()
+    {
+        if ( !UseFeatures_ )
+        {
+            return Thread_.LatestSnapshot();
+        }
+
+        double   seconds = ::fmod( Playback_.GetElapsedTime(), Features_.Duration() );
+        uint64_t record  = Features_.RecordAt( seconds );
+
+        if ( record == Record_ )
+        {
+            return nullptr;
+        }
+
+        // Every record played since the last call goes in the history, as captured updates do, wrapping round
+        // to the start when playback loops. Only a texture's worth can be seen.
+        uint64_t played = record > Record_ ? record - Record_ : Features_.RecordCount() - Record_ + record;
+        uint64_t rows   = FeatureHistory_.TextureRows();
+
+        for ( uint64_t skipped = played > rows ? played - rows : 0; skipped < played; ++skipped )
+        {
+            uint64_t          historyRecord = ( Record_ + 1 + skipped ) % Features_.RecordCount();
+            PerFrameConstants historyConstants = {};
+
+            Features_.ApplyRecord( historyRecord, historyConstants );
+            FeatureHistory_.Write( Features_.TextureData( historyRecord ), historyConstants );
+        }
+
+        // The texture data is read straight from the mapped file.
+        Record_                  = record;
+        Snapshot_.TextureData    = Features_.TextureData( record );
+        Snapshot_.Sequence      += 1;
+        Snapshot_.HistoryWritten = FeatureHistory_.Written();
+
+        Features_.ApplyRecord( record, Snapshot_.Constants );
+
+        return &Snapshot_;
+    }
+
     VisualizerResources::VisualizerResources() 
         : WindowHandle( nullptr ),
           Device( nullptr ),
@@ -140,11 +367,17 @@ namespace
           SwapChain( nullptr ),
           Effects( nullptr ),
           ConstantBuffer( nullptr ),
+          ConstantBufferSize( 0 ),
+          BucketRangeBuffer( nullptr ),
           LeftDown( 0 ),
           RightDown( 0 ),
+          LatencyDumps( 0 ),
           SoundTexture( nullptr ),
           SoundTextureSRV( nullptr ),
-          BufferMemory( reinterpret_cast< uint8_t* >( _aligned_malloc( BufferSize, 16 ) ) )
+          SoundHistoryTexture( nullptr ),
+          SoundHistorySRV( nullptr ),
+          SoundHistoryUploaded( 0 ),
+          BufferMemory( reinterpret_cast< uint8_t* >( _aligned_malloc( BoondoggleEffectsPackage::ConstantBufferSize( FREQUENCY_BUCKETS ), 16 ) ) )
     {
     }
     
@@ -152,7 +385,10 @@ namespace
     {
         COMRelease( SoundTexture );
         COMRelease( SoundTextureSRV );
+        COMRelease( SoundHistoryTexture );
+        COMRelease( SoundHistorySRV );
         COMRelease( ConstantBuffer );
+        COMRelease( BucketRangeBuffer );
         COMRelease( BackBufferTarget );
         COMRelease( BackBuffer );
         COMRelease( SwapChain );
@@ -210,19 +446,42 @@ namespace
 
 
     // Load package.
-    bool VisualizerResources::LoadPackage( const wchar_t* packageFile )
+    bool VisualizerResources::LoadPackage( const wchar_t* packageFile, bool watch )
     {
         Effects = new BoondoggleEffectsPackage();
     
-        bool result = Effects->CreateResources( Device, Context, WindowHandle, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, packageFile );
+        bool result = Effects->CreateResources( Device, Context, WindowHandle, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, packageFile, watch );
 
         if ( !result )
         {
             delete Effects;
             Effects = nullptr;
+
+            return false;
         }
 
-        return result;
+        // Sized for the package's buckets, so only those are uploaded each frame.
+        ConstantBufferSize = BoondoggleEffectsPackage::ConstantBufferSize( Effects->FrequencyBucketCount() );
+
+        D3D11_BUFFER_DESC constantBufferDesc = {};
+
+        constantBufferDesc.ByteWidth           = static_cast< UINT >( ConstantBufferSize ); 
+        constantBufferDesc.Usage               = D3D11_USAGE::D3D11_USAGE_DYNAMIC;
+        constantBufferDesc.BindFlags           = D3D11_BIND_FLAG::D3D11_BIND_CONSTANT_BUFFER;
+        constantBufferDesc.CPUAccessFlags      = D3D11_CPU_ACCESS_FLAG::D3D11_CPU_ACCESS_WRITE;
+        constantBufferDesc.MiscFlags           = 0;
+        constantBufferDesc.StructureByteStride = 0;
+
+        HRESULT bufferResult = Device->CreateBuffer( &constantBufferDesc, nullptr, &ConstantBuffer );
+
+        if ( bufferResult != ERROR_SUCCESS )
+        {
+            ShowError( L"Error creating constant buffer.", L"Error Initializing Direct 3D 11" );
+
+            return false;
+        }
+
+        return true;
     }
 
 
@@ -268,6 +527,11 @@ namespace
 
                 ++RightDown;
                 break;
+
+            case VK_F8:
+
+                ++LatencyDumps;
+                break;
             }
 
             break;
@@ -515,40 +779,26 @@ namespace
             return false;
         }
 
-        D3D11_BUFFER_DESC constantBufferDesc = {};
-
-        constantBufferDesc.ByteWidth           = BufferSize; 
-        constantBufferDesc.Usage               = D3D11_USAGE::D3D11_USAGE_DYNAMIC;
-        constantBufferDesc.BindFlags           = D3D11_BIND_FLAG::D3D11_BIND_CONSTANT_BUFFER;
-        constantBufferDesc.CPUAccessFlags      = D3D11_CPU_ACCESS_FLAG::D3D11_CPU_ACCESS_WRITE;
-        constantBufferDesc.MiscFlags           = 0;
-        constantBufferDesc.StructureByteStride = 0;
-
-        HRESULT bufferResult = Device->CreateBuffer( &constantBufferDesc, nullptr, &ConstantBuffer );
-
-        if ( bufferResult != ERROR_SUCCESS )
-        {
-            ShowError( L"Error creating constant buffer.", L"Error Initializing Direct 3D 11" );
-
-            return false;
-        }
-
         return true;
     }
     
-    bool VisualizerResources::CreateSoundTexture( const AudioProcessing& from )
+    bool VisualizerResources::CreateSoundTexture( const void* textureData, size_t samples, SoundTextureFormat format )
     {
         D3D11_TEXTURE1D_DESC textureDesc = {};
 
-        textureDesc.Width          = static_cast< UINT >( from.SamplesPerPeriod() );
+        textureDesc.Width          = static_cast< UINT >( samples );
         textureDesc.MipLevels      = 1;
         textureDesc.ArraySize      = 1;
-        textureDesc.Format         = DXGI_FORMAT::DXGI_FORMAT_R32G32B32A32_FLOAT;
+        textureDesc.Format         = ToDXGIFormat( format );
         textureDesc.BindFlags      = D3D11_BIND_FLAG::D3D11_BIND_SHADER_RESOURCE;
         textureDesc.Usage          = D3D11_USAGE::D3D11_USAGE_DYNAMIC;
         textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_FLAG::D3D11_CPU_ACCESS_WRITE;
 
-        HRESULT createTextureResult = Device->CreateTexture1D( &textureDesc, nullptr, &SoundTexture );
+        D3D11_SUBRESOURCE_DATA initialData = {};
+
+        initialData.pSysMem = textureData;
+
+        HRESULT createTextureResult = Device->CreateTexture1D( &textureDesc, &initialData, &SoundTexture );
     
         if ( createTextureResult != ERROR_SUCCESS )
         {
@@ -567,6 +817,137 @@ namespace
         return true;
     }
 
+    void VisualizerResources::UpdateSoundTexture( const void* textureData, size_t bytes )
+    {
+        D3D11_MAPPED_SUBRESOURCE subResource;
+
+        HRESULT mappingResult =
+            Context->Map( SoundTexture, 0, D3D11_MAP::D3D11_MAP_WRITE_DISCARD, 0, &subResource );
+
+        if ( SUCCEEDED( mappingResult ) )
+        {
+            ::memcpy( subResource.pData, textureData, bytes );
+
+            Context->Unmap( SoundTexture, 0 );
+        }
+    }
+
+    bool VisualizerResources::CreateBucketRangeBuffer( const float* bucketRanges )
+    {
+        D3D11_BUFFER_DESC bufferDesc = {};
+
+        bufferDesc.ByteWidth = static_cast< UINT >( sizeof( float ) * FREQUENCY_BUCKETS * 2 );
+        bufferDesc.Usage     = D3D11_USAGE::D3D11_USAGE_IMMUTABLE;
+        bufferDesc.BindFlags = D3D11_BIND_FLAG::D3D11_BIND_CONSTANT_BUFFER;
+
+        D3D11_SUBRESOURCE_DATA initialData = {};
+
+        initialData.pSysMem = bucketRanges;
+
+        HRESULT bufferResult = Device->CreateBuffer( &bufferDesc, &initialData, &BucketRangeBuffer );
+
+        if ( bufferResult != ERROR_SUCCESS )
+        {
+            ShowError( L"Error creating bucket range buffer.", L"Error Initializing Direct 3D 11" );
+            return false;
+        }
+
+        return true;
+    }
+
+    bool VisualizerResources::CreateSoundHistoryTexture( const AudioHistory& history, PerFrameConstants& constants )
+    {
+        uint32_t rows = history.TextureRows();
+
+        constants.SoundHistoryRow  = 0.0f;
+        constants.SoundHistoryRows = 0.0f;
+        SoundHistoryUploaded       = 0;
+
+        if ( rows == 0 )
+        {
+            return true;
+        }
+
+        D3D11_TEXTURE2D_DESC textureDesc = {};
+
+        textureDesc.Width            = history.RowTexels();
+        textureDesc.Height           = rows;
+        textureDesc.MipLevels        = 1;
+        textureDesc.ArraySize        = 1;
+        textureDesc.Format           = ToDXGIFormat( history.Format() );
+        textureDesc.SampleDesc.Count = 1;
+        textureDesc.BindFlags        = D3D11_BIND_FLAG::D3D11_BIND_SHADER_RESOURCE;
+
+        // Default usage so we can update just the new rows, a dynamic texture would have to be re-written completely.
+        textureDesc.Usage            = D3D11_USAGE::D3D11_USAGE_DEFAULT;
+
+        // Start with silence rather than whatever was in the memory (zero bits are zero in either format).
+        size_t   pitch   = history.RowBytes();
+        uint8_t* silence = new uint8_t[ pitch * rows ]();
+
+        D3D11_SUBRESOURCE_DATA initialData = {};
+
+        initialData.pSysMem     = silence;
+        initialData.SysMemPitch = static_cast< UINT >( pitch );
+
+        HRESULT createTextureResult = Device->CreateTexture2D( &textureDesc, &initialData, &SoundHistoryTexture );
+
+        delete[] silence;
+
+        if ( createTextureResult != ERROR_SUCCESS )
+        {
+            ShowError( L"Couldn't create sound history texture", L"Error Initializing Sound Texture" );
+            return false;
+        }
+
+        HRESULT srvResult = Device->CreateShaderResourceView( SoundHistoryTexture, nullptr, &SoundHistorySRV );
+
+        if ( srvResult != ERROR_SUCCESS )
+        {
+            ShowError( L"Couldn't create sound history texture resource view", L"Error Initializing Sound Texture" );
+            return false;
+        }
+
+        constants.SoundHistoryRows = static_cast< float >( rows );
+
+        return true;
+    }
+
+    void VisualizerResources::UpdateSoundHistory( const AudioHistory& history, uint64_t written, PerFrameConstants& constants )
+    {
+        uint64_t rows = history.TextureRows();
+
+        if ( SoundHistoryTexture == nullptr || written == SoundHistoryUploaded )
+        {
+            return;
+        }
+
+        // Rows older than a texture's worth would only be written over.
+        uint64_t row = written - SoundHistoryUploaded > rows ? written - rows : SoundHistoryUploaded;
+
+        // Rows are in the same order in the history's memory as in the texture, so the rows up to the end of
+        // the texture go in one box and the rest wrap around to the top in a second.
+        while ( row < written )
+        {
+            uint64_t  end      = ( row / rows + 1 ) * rows < written ? ( row / rows + 1 ) * rows : written;
+            D3D11_BOX rowsBox  = {};
+
+            rowsBox.left   = 0;
+            rowsBox.right  = history.RowTexels();
+            rowsBox.top    = static_cast< UINT >( row % rows );
+            rowsBox.bottom = static_cast< UINT >( row % rows + ( end - row ) );
+            rowsBox.front  = 0;
+            rowsBox.back   = 1;
+
+            Context->UpdateSubresource( SoundHistoryTexture, 0, &rowsBox, history.Row( row ), static_cast< UINT >( history.RowBytes() ), 0 );
+
+            row = end;
+        }
+
+        SoundHistoryUploaded      = written;
+        constants.SoundHistoryRow = static_cast< float >( ( written - 1 ) % rows );
+    }
+
     // Windows message pump. Returns false on quit message.
     bool PumpMessages()
     {
@@ -591,7 +972,7 @@ namespace
 
 using namespace DirectX;
 
-bool DisplayOculusVR( const wchar_t* packagePath )
+bool DisplayOculusVR( const wchar_t* packagePath, const wchar_t* featuresPath, bool watchPackage )
 {
     VisualizerResources resources;
 
@@ -627,7 +1008,7 @@ bool DisplayOculusVR( const wchar_t* packagePath )
             return true;
         }
 
-        bool packageLoaded = resources.LoadPackage( packagePath );
+        bool packageLoaded = resources.LoadPackage( packagePath, watchPackage );
 
         if ( !packageLoaded )
         {
@@ -689,7 +1070,7 @@ bool DisplayOculusVR( const wchar_t* packagePath )
         PerFrameParameters frameParameters = {};
 
         frameParameters.BufferMemory            = resources.BufferMemory;
-        frameParameters.BufferMemorySize        = BufferSize;
+        frameParameters.BufferMemorySize        = resources.ConstantBufferSize;
         frameParameters.ConstantBuffer          = resources.ConstantBuffer;
         frameParameters.Effect                  = 0;
         frameParameters.Constants.Time          = 0;
@@ -700,13 +1081,12 @@ bool DisplayOculusVR( const wchar_t* packagePath )
         
         ::ovr_SetTrackingOriginType( oculusSession.Session, ovrTrackingOrigin_FloorLevel );
 
-        AudioProcessing audio;
+        AudioFeed audio;
 
         Clock clock;
 
-        if ( !audio.Initialize( frameParameters.Constants ) )
+        if ( !audio.Start( resources, featuresPath, resources.Effects->FrequencyBucketCount(), SoundHistoryRows, frameParameters.Constants ) )
         {
-            resources.ShowError( L"Couldn't initialize audio capture.", L"Audio capture error." );
             return true;
         }
         
@@ -717,17 +1097,48 @@ bool DisplayOculusVR( const wchar_t* packagePath )
 
         bool isRenderEnabled = true;
 
-        if ( !resources.CreateSoundTexture( audio ) )
+        if ( !resources.CreateSoundTexture( audio.InitialTextureData(), audio.TextureSamples(), audio.TextureFormat() ) )
+        {
+            return true;
+        }
+
+        if ( !resources.CreateSoundHistoryTexture( audio.History(), frameParameters.Constants ) )
+        {
+            return true;
+        }
+
+        if ( !resources.CreateBucketRangeBuffer( audio.BucketRanges() ) )
         {
             return true;
         }
 
-        frameParameters.SoundTextureSRV = resources.SoundTextureSRV;
+        frameParameters.SoundTextureSRV   = resources.SoundTextureSRV;
+        frameParameters.SoundHistorySRV   = resources.SoundHistorySRV;
+        frameParameters.BucketRangeBuffer = resources.BucketRangeBuffer;
 
-        bool hasFirstAudioUpdate = false;
+        LatencyStats    latency;
+        AudioTimestamps audioTimestamps      = audio.InitialTimestamps();
+        int32_t         previousLatencyDumps = 0;
 
         while ( PumpMessages() )
         {
+            // A rebuilt package is swapped in between frames, before the allocation scope, as it creates resources.
+            if ( resources.Effects->ApplyReload() )
+            {
+                if ( effect >= static_cast< int32_t >( resources.Effects->EffectCount() ) )
+                {
+                    effect = 0;
+                }
+
+                frameParameters.Effect = static_cast< uint32_t >( effect );
+
+                clock.Reset();
+                resources.Effects->RenderInitialTextures( frameParameters );
+            }
+
+            // Everything a frame needs is set up before the loop, so debug builds assert frames don't touch the heap.
+            NoHeapAllocationScope frameAllocations;
+
             ::ovrInputState inputState = {};
 
             ::ovr_GetInputState( oculusSession.Session, ::ovrControllerType::ovrControllerType_Active, &inputState );
@@ -765,33 +1176,22 @@ bool DisplayOculusVR( const wchar_t* packagePath )
             previousLeftDown  = resources.LeftDown;
             previousRightDown = resources.RightDown;
             
-            AudioUpdateResult audioUpdateResult = audio.Update( frameParameters.Constants );
-
-            if ( audioUpdateResult == AudioUpdateResult::AUDIO_ERROR )
+            if ( audio.HasError() )
             {
                 resources.ShowError( L"Error pulling audio.", L"Audio capture error." );
                 return true;
             }
-            else if ( audioUpdateResult == AudioUpdateResult::UPDATED )
-            {
-                // Sound updated, so copy it as a texture.
-                D3D11_MAPPED_SUBRESOURCE subResource;
-
-                HRESULT mappingResult =
-                    resources.Context->Map( resources.SoundTexture, 0, D3D11_MAP::D3D11_MAP_WRITE_DISCARD, 0, &subResource );
-
-                ::memcpy( subResource.pData, audio.AudioTextureData(), audio.SamplesPerPeriod() * sizeof( float ) * 4 );
 
-                resources.Context->Unmap( resources.SoundTexture, 0 );
+            // Take the latest audio analysis if there's been an update, this never waits on the audio thread.
+            const AudioSnapshot* audioSnapshot = audio.LatestSnapshot();
 
-                hasFirstAudioUpdate = true;
-            }
-
-            // Until we actually have an audio update, wait a little.
-            if ( !hasFirstAudioUpdate )
+            if ( audioSnapshot != nullptr )
             {
-                ::Sleep( 1 );
-                continue;
+                CopyAudioConstants( audioSnapshot->Constants, frameParameters.Constants );
+                resources.UpdateSoundTexture( audioSnapshot->TextureData, audio.TextureBytes() );
+                resources.UpdateSoundHistory( audio.History(), audioSnapshot->HistoryWritten, frameParameters.Constants );
+
+                audioTimestamps = audioSnapshot->Timestamps;
             }
 
             ID3D11Device*        device  = resources.Device;
@@ -810,6 +1210,7 @@ bool DisplayOculusVR( const wchar_t* packagePath )
             ::ovr_GetEyePoses( oculusSession.Session, frameIndex, ovrTrue, eyeOffsets, eyePoses, &sensorSampleTime );
 
             PerViewParameters viewParameters[ 2 ];
+            uint64_t          uploadTimestamp = 0; // stays 0 when the frame isn't rendered, so it isn't recorded.
 
             float time = static_cast< float >( clock.GetElapsedTime() );
 
@@ -851,6 +1252,8 @@ bool DisplayOculusVR( const wchar_t* packagePath )
                     XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( view.Constants.RayScreenDown ), XMVectorSetW( rayScreenDown, 0.0f ) );
                 }
 
+                uploadTimestamp = LatencyTimestamp();
+
                 bool renderResult = resources.Effects->Render( frameParameters, viewParameters, 2 );
 
                 if ( !renderResult )
@@ -886,6 +1289,15 @@ bool DisplayOculusVR( const wchar_t* packagePath )
                 return true;
             }
 
+            // Submit returning is as close to photons as we can get without measuring the display.
+            latency.RecordFrame( audioTimestamps, audioSnapshot != nullptr, uploadTimestamp, LatencyTimestamp() );
+
+            if ( resources.LatencyDumps != previousLatencyDumps )
+            {
+                previousLatencyDumps = resources.LatencyDumps;
+                AppendReport( latency );
+            }
+
             isRenderEnabled = frameResult == ::ovrSuccess;
 
             ++frameIndex;
@@ -899,12 +1311,13 @@ bool DisplayOculusVR( const wchar_t* packagePath )
             resources.SwapChain->Present( 0, 0 );
         }
 
+        AppendReport( latency );
     }
 
     return true;
 }
 
-void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t height, float fovInDegrees )
+void DisplayWindowed( const wchar_t* packagePath, const wchar_t* featuresPath, bool watchPackage, uint32_t width, uint32_t height, float fovInDegrees )
 {
     VisualizerResources resources;
 
@@ -924,7 +1337,7 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
         return;
     }
 
-    bool packageLoaded = resources.LoadPackage( packagePath );
+    bool packageLoaded = resources.LoadPackage( packagePath, watchPackage );
 
     if ( !packageLoaded )
     {
@@ -959,7 +1372,7 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
     viewParameters.Constants.RayScreenDown[ 3 ] = 0.0f;
 
     frameParameters.BufferMemory            = resources.BufferMemory;
-    frameParameters.BufferMemorySize        = BufferSize;
+    frameParameters.BufferMemorySize        = resources.ConstantBufferSize;
     frameParameters.ConstantBuffer          = resources.ConstantBuffer;
     frameParameters.Effect                  = 0;
     frameParameters.Constants.Time          = 0;
@@ -972,13 +1385,12 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
        
     resources.Effects->RenderInitialTextures( frameParameters );
 
-    AudioProcessing audio;
+    AudioFeed audio;
 
     Clock clock;
 
-    if ( !audio.Initialize( frameParameters.Constants ) )
+    if ( !audio.Start( resources, featuresPath, resources.Effects->FrequencyBucketCount(), SoundHistoryRows, frameParameters.Constants ) )
     {
-        resources.ShowError( L"Couldn't initialize audio capture.", L"Audio capture error." );
         return;
     }
     
@@ -986,17 +1398,48 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
     int32_t previousRightDown = 0;
     int32_t effect            = 0;
 
-    if ( !resources.CreateSoundTexture( audio ) )
+    if ( !resources.CreateSoundTexture( audio.InitialTextureData(), audio.TextureSamples(), audio.TextureFormat() ) )
     {
         return;
     }
 
-    frameParameters.SoundTextureSRV = resources.SoundTextureSRV;
+    if ( !resources.CreateSoundHistoryTexture( audio.History(), frameParameters.Constants ) )
+    {
+        return;
+    }
+
+    if ( !resources.CreateBucketRangeBuffer( audio.BucketRanges() ) )
+    {
+        return;
+    }
+
+    frameParameters.SoundTextureSRV   = resources.SoundTextureSRV;
+    frameParameters.SoundHistorySRV   = resources.SoundHistorySRV;
+    frameParameters.BucketRangeBuffer = resources.BucketRangeBuffer;
 
-    bool hasFirstAudioUpdate = false;
+    LatencyStats    latency;
+    AudioTimestamps audioTimestamps      = audio.InitialTimestamps();
+    int32_t         previousLatencyDumps = 0;
 
     while ( PumpMessages() )
     {
+        // A rebuilt package is swapped in between frames, before the allocation scope, as it creates resources.
+        if ( resources.Effects->ApplyReload() )
+        {
+            if ( effect >= static_cast< int32_t >( resources.Effects->EffectCount() ) )
+            {
+                effect = 0;
+            }
+
+            frameParameters.Effect = static_cast< uint32_t >( effect );
+
+            clock.Reset();
+            resources.Effects->RenderInitialTextures( frameParameters );
+        }
+
+        // Everything a frame needs is set up before the loop, so debug builds assert frames don't touch the heap.
+        NoHeapAllocationScope frameAllocations;
+
         if ( resources.LeftDown != previousLeftDown )
         {
             --effect;
@@ -1025,31 +1468,22 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
         previousLeftDown  = resources.LeftDown;
         previousRightDown = resources.RightDown;
 
-        AudioUpdateResult audioUpdateResult = audio.Update( frameParameters.Constants );
-        
-        if ( audioUpdateResult == AudioUpdateResult::AUDIO_ERROR )
+        if ( audio.HasError() )
         {
             resources.ShowError( L"Error pulling audio.", L"Audio capture error." );
             return;
         }
-        else if ( audioUpdateResult == AudioUpdateResult::UPDATED )
-        {
-            D3D11_MAPPED_SUBRESOURCE subResource;
-
-            HRESULT mappingResult =
-                resources.Context->Map( resources.SoundTexture, 0, D3D11_MAP::D3D11_MAP_WRITE_DISCARD, 0, &subResource );
-
-            ::memcpy( subResource.pData, audio.AudioTextureData(), audio.SamplesPerPeriod() * sizeof( float ) * 4 );
-
-            resources.Context->Unmap( resources.SoundTexture, 0 );
 
-            hasFirstAudioUpdate = true;
-        }
+        // Take the latest audio analysis if there's been an update, this never waits on the audio thread.
+        const AudioSnapshot* audioSnapshot = audio.LatestSnapshot();
 
-        if ( !hasFirstAudioUpdate )
+        if ( audioSnapshot != nullptr )
         {
-            ::Sleep( 1 );
-            continue;
+            CopyAudioConstants( audioSnapshot->Constants, frameParameters.Constants );
+            resources.UpdateSoundTexture( audioSnapshot->TextureData, audio.TextureBytes() );
+            resources.UpdateSoundHistory( audio.History(), audioSnapshot->HistoryWritten, frameParameters.Constants );
+
+            audioTimestamps = audioSnapshot->Timestamps;
         }
 
         float time = static_cast< float >( clock.GetElapsedTime() );
@@ -1067,6 +1501,8 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
 
         resources.Context->ClearRenderTargetView( resources.BackBufferTarget, red );
 
+        uint64_t uploadTimestamp = LatencyTimestamp();
+
         bool renderResult = resources.Effects->Render( frameParameters, &viewParameters, 1 );
 
         if ( !renderResult )
@@ -1076,5 +1512,16 @@ void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t heigh
         }
 
         resources.SwapChain->Present( 1, 0 );
+
+        // Present returning (after the vsync wait) is as close to photons as we can get without measuring the display.
+        latency.RecordFrame( audioTimestamps, audioSnapshot != nullptr, uploadTimestamp, LatencyTimestamp() );
+
+        if ( resources.LatencyDumps != previousLatencyDumps )
+        {
+            previousLatencyDumps = resources.LatencyDumps;
+            AppendReport( latency );
+        }
     }
+
+    AppendReport( latency );
 }
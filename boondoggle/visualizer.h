@@ -8,9 +8,11 @@
 // Try and display on the oculus - if the oculus doesn't initialise, return false so we can try 
 // and display windowed.
 // Runs the display loop.
-bool DisplayOculusVR( const wchar_t* packagePath );
+// If featuresPath isn't null, the audio comes from that pre-analyzed feature file instead of capture.
+// If watchPackage is set, the package is reloaded when its file changes.
+bool DisplayOculusVR( const wchar_t* packagePath, const wchar_t* featuresPath, bool watchPackage );
 
 // Display Windowed. Runs the display loop.
-void DisplayWindowed( const wchar_t* packagePath, uint32_t width, uint32_t height, float fovInDegrees );
+void DisplayWindowed( const wchar_t* packagePath, const wchar_t* featuresPath, bool watchPackage, uint32_t width, uint32_t height, float fovInDegrees );
 
 #endif // -- BOONDOGGLE_VISUALIZER_H__
\ No newline at end of file
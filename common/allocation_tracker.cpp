@@ -0,0 +1,108 @@
+#include "allocation_tracker.h"
+
+#if defined( BOONDOGGLE_TRACK_ALLOCATIONS )
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+namespace
+{
+    thread_local uint64_t ThreadAllocations = 0;
+
+    void* TrackedAllocate( size_t size )
+    {
+        ++ThreadAllocations;
+
+        void* result = ::malloc( size != 0 ? size : 1 );
+
+        if ( result == nullptr )
+        {
+            throw std::bad_alloc();
+        }
+
+        return result;
+    }
+}
+
+// Replacing the global operators counts every new in the module, including those in the standard library.
+
+void* operator new( size_t size )
+{
+    return TrackedAllocate( size );
+}
+
+void* operator new[]( size_t size )
+{
+    return TrackedAllocate( size );
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+    ++ThreadAllocations;
+
+    return ::malloc( size != 0 ? size : 1 );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+    ++ThreadAllocations;
+
+    return ::malloc( size != 0 ? size : 1 );
+}
+
+void operator delete( void* toFree ) noexcept
+{
+    ::free( toFree );
+}
+
+void operator delete[]( void* toFree ) noexcept
+{
+    ::free( toFree );
+}
+
+void operator delete( void* toFree, const std::nothrow_t& ) noexcept
+{
+    ::free( toFree );
+}
+
+void operator delete[]( void* toFree, const std::nothrow_t& ) noexcept
+{
+    ::free( toFree );
+}
+
+uint64_t ThreadHeapAllocations()
+{
+    return ThreadAllocations;
+}
+
+void NoteHeapAllocation()
+{
+    ++ThreadAllocations;
+}
+
+NoHeapAllocationScope::~NoHeapAllocationScope()
+{
+    uint64_t allocations = ThreadAllocations - Start_;
+
+    if ( allocations != 0 )
+    {
+        fprintf( stderr, "%llu heap allocation(s) where there shouldn't be any\n", static_cast< unsigned long long >( allocations ) );
+    }
+
+    assert( allocations == 0 );
+}
+
+#else
+
+uint64_t ThreadHeapAllocations()
+{
+    return 0;
+}
+
+void NoteHeapAllocation()
+{
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef BOONDOGGLE_ALLOCATION_TRACKER_H__
+#define BOONDOGGLE_ALLOCATION_TRACKER_H__
+
+#pragma once
+
+#include <stdint.h>
+
+// Heap allocation tracking for debug builds. When BOONDOGGLE_TRACK_ALLOCATIONS is defined (debug configurations),
+// operator new and AlignedAllocateZeroed count the allocations each thread makes, so code that must not
+// touch the heap (the frame loop and audio updates) can assert it doesn't. Otherwise this all compiles away.
+
+// Heap allocations made by the calling thread so far, always 0 without tracking.
+uint64_t ThreadHeapAllocations();
+
+// Count a heap allocation that doesn't go through operator new.
+void NoteHeapAllocation();
+
+// Asserts no heap allocations are made on the thread while it's in scope.
+class NoHeapAllocationScope
+{
+public:
+
+#if defined( BOONDOGGLE_TRACK_ALLOCATIONS )
+
+    NoHeapAllocationScope() : Start_( ThreadHeapAllocations() ) {}
+
+    ~NoHeapAllocationScope();
+
+private:
+
+    uint64_t Start_;
+
+#else
+
+    NoHeapAllocationScope() {}
+
+#endif
+
+public:
+
+    NoHeapAllocationScope( const NoHeapAllocationScope& ) = delete;
+
+    NoHeapAllocationScope& operator=( const NoHeapAllocationScope& ) = delete;
+};
+
+#endif // -- BOONDOGGLE_ALLOCATION_TRACKER_H__
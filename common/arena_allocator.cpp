@@ -0,0 +1,168 @@
+#include "arena_allocator.h"
+#include <string.h>
+#include <mutex>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    // Initialized arenas, so a report can find them.
+    std::mutex      ArenaListLock;
+    ArenaAllocator* ArenaList = nullptr;
+
+    uint8_t* ReserveAddressSpace( size_t size )
+    {
+#if defined( _WIN32 )
+        return reinterpret_cast< uint8_t* >( ::VirtualAlloc( nullptr, size, MEM_RESERVE, PAGE_READWRITE ) );
+#else
+        void* result = ::mmap( nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+        return result != MAP_FAILED ? reinterpret_cast< uint8_t* >( result ) : nullptr;
+#endif
+    }
+
+    bool CommitAddressSpace( uint8_t* where, size_t size )
+    {
+#if defined( _WIN32 )
+        return ::VirtualAlloc( where, size, MEM_COMMIT, PAGE_READWRITE ) != nullptr;
+#else
+        return ::mprotect( where, size, PROT_READ | PROT_WRITE ) == 0;
+#endif
+    }
+
+    void ReleaseAddressSpace( uint8_t* where, size_t size )
+    {
+#if defined( _WIN32 )
+        ( void )size;
+        ::VirtualFree( where, 0, MEM_RELEASE );
+#else
+        ::munmap( where, size );
+#endif
+    }
+}
+
+ArenaAllocator::ArenaAllocator() :
+    Name_( nullptr ),
+    Base_( nullptr ),
+    Reserved_( 0 ),
+    Committed_( 0 ),
+    Used_( 0 ),
+    Peak_( 0 ),
+    Next_( nullptr ),
+    Previous_( nullptr )
+{
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    Release();
+}
+
+void ArenaAllocator::Release()
+{
+    if ( Base_ == nullptr )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard< std::mutex > lock( ArenaListLock );
+
+        ( Previous_ != nullptr ? Previous_->Next_ : ArenaList ) = Next_;
+
+        if ( Next_ != nullptr )
+        {
+            Next_->Previous_ = Previous_;
+        }
+    }
+
+    ReleaseAddressSpace( Base_, Reserved_ );
+
+    Base_      = nullptr;
+    Reserved_  = 0;
+    Committed_ = 0;
+    Used_      = 0;
+    Peak_      = 0;
+    Next_      = nullptr;
+    Previous_  = nullptr;
+}
+
+bool ArenaAllocator::Initialize( const char* name, size_t reserveSize )
+{
+    Release();
+
+    size_t reserved = ( reserveSize + COMMIT_BLOCK_SIZE - 1 ) & ~( COMMIT_BLOCK_SIZE - 1 );
+
+    Base_ = ReserveAddressSpace( reserved );
+
+    if ( Base_ == nullptr )
+    {
+        return false;
+    }
+
+    Name_     = name;
+    Reserved_ = reserved;
+
+    std::lock_guard< std::mutex > lock( ArenaListLock );
+
+    Next_ = ArenaList;
+
+    if ( ArenaList != nullptr )
+    {
+        ArenaList->Previous_ = this;
+    }
+
+    ArenaList = this;
+
+    return true;
+}
+
+void* ArenaAllocator::Allocate( size_t size, size_t alignment )
+{
+    size_t paddedBegin  = ( Used_ + alignment - 1 ) & ~( alignment - 1 );
+    size_t newWatermark = paddedBegin + size;
+
+    if ( Base_ == nullptr || newWatermark > Reserved_ || newWatermark < Used_ )
+    {
+        return nullptr;
+    }
+
+    if ( newWatermark > Committed_ )
+    {
+        size_t newCommitted = ( newWatermark + COMMIT_BLOCK_SIZE - 1 ) & ~( COMMIT_BLOCK_SIZE - 1 );
+
+        if ( !CommitAddressSpace( Base_ + Committed_, newCommitted - Committed_ ) )
+        {
+            return nullptr;
+        }
+
+        Committed_ = newCommitted;
+    }
+
+    Used_ = newWatermark;
+    Peak_ = Used_ > Peak_ ? Used_ : Peak_;
+
+    // Newly committed memory is already zero, but memory from before a reset isn't.
+    return ::memset( Base_ + paddedBegin, 0, size );
+}
+
+void ArenaAllocator::PrintReport( FILE* output )
+{
+    std::lock_guard< std::mutex > lock( ArenaListLock );
+
+    fprintf( output, "%-24s %12s %12s %12s\n", "arena", "used KB", "peak KB", "committed KB" );
+
+    for ( const ArenaAllocator* arena = ArenaList; arena != nullptr; arena = arena->Next_ )
+    {
+        fprintf( output,
+                 "%-24s %12.1f %12.1f %12.1f\n",
+                 arena->Name_,
+                 arena->Used_ / 1024.0,
+                 arena->Peak_ / 1024.0,
+                 arena->Committed_ / 1024.0 );
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef BOONDOGGLE_ARENA_ALLOCATOR_H__
+#define BOONDOGGLE_ARENA_ALLOCATOR_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <new>
+
+// Linear allocator that reserves a big hunk of address space up front and commits it as it's allocated,
+// so everything a subsystem allocates is in one place and allocations never move. Individual allocations
+// aren't freed, Reset releases them all at once. Allocations are zeroed.
+//
+// Each arena is named for the subsystem using it, and live arenas can be reported with PrintReport to
+// see how much memory each subsystem peaked at. Arenas should be initialized and destroyed on one thread,
+// but allocating from one on another thread is fine as long as only one thread does it at a time.
+class ArenaAllocator
+{
+public:
+
+    ArenaAllocator();
+
+    // Releases all the memory.
+    ~ArenaAllocator();
+
+    // Reserve reserveSize bytes of address space (rounded up to the commit block size) for the named subsystem,
+    // the name must outlive the arena. Releases anything from a previous initialize. Returns false on failure.
+    bool Initialize( const char* name, size_t reserveSize );
+
+    // Allocate zeroed memory with a particular (power of two) alignment. Returns nullptr if the reservation is exhausted.
+    void* Allocate( size_t size, size_t alignment );
+
+    // Allocate and default construct count objects, nullptr if the reservation is exhausted.
+    // Objects with destructors need Destruct called on them before the arena is reset or destroyed.
+    template < typename AllocationType >
+    AllocationType* Allocate( size_t count = 1, size_t alignment = alignof( AllocationType ) )
+    {
+        AllocationType* result = reinterpret_cast< AllocationType* >( Allocate( sizeof( AllocationType ) * count, alignment ) );
+
+        if ( result != nullptr )
+        {
+            for ( AllocationType* where = result, *end = result + count; where < end; ++where )
+            {
+                new ( where ) AllocationType();
+            }
+        }
+
+        return result;
+    }
+
+    // Call the destructors of count objects from Allocate, does nothing for nullptr.
+    template < typename AllocationType >
+    static void Destruct( AllocationType* allocation, size_t count )
+    {
+        for ( size_t where = 0; allocation != nullptr && where < count; ++where )
+        {
+            allocation[ where ].~AllocationType();
+        }
+    }
+
+    // Release all allocations, keeping the memory committed for re-use.
+    void Reset() { Used_ = 0; }
+
+    // Start of the arena's memory, allocations are contiguous from here.
+    const uint8_t* Base() const { return Base_; }
+
+    // Bytes allocated, including alignment padding.
+    size_t Used() const { return Used_; }
+
+    // Most bytes allocated at once since the arena was initialized.
+    size_t Peak() const { return Peak_; }
+
+    // Bytes of the reservation committed.
+    size_t Committed() const { return Committed_; }
+
+    // Write the name, used, peak and committed memory of each initialized arena, for all threads.
+    static void PrintReport( FILE* output );
+
+    // Release the reservation and leave the list of arenas, the arena can be initialized again after.
+    void Release();
+
+    ArenaAllocator( const ArenaAllocator& ) = delete;
+
+    ArenaAllocator& operator=( const ArenaAllocator& ) = delete;
+
+private:
+
+    static const size_t COMMIT_BLOCK_SIZE = 64 * 1024;
+
+    const char*     Name_;
+    uint8_t*        Base_;
+    size_t          Reserved_;
+    size_t          Committed_;
+    size_t          Used_;
+    size_t          Peak_;
+    ArenaAllocator* Next_; // in the list of initialized arenas, for reports.
+    ArenaAllocator* Previous_;
+};
+
+#endif // -- BOONDOGGLE_ARENA_ALLOCATOR_H__
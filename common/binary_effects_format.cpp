@@ -1,27 +1,197 @@
 #include "binary_effects_format.h"
+#include "../boondoggle/shared_render_constants.h"
+
+namespace
+{
+    // Is the section table of a version 2 package well formed, with every block inside the package.
+    bool AreSectionsValid( const BoondogglePackageHeader& package, const uint8_t* endOfPackage )
+    {
+        const uint8_t* packageStart = reinterpret_cast< const uint8_t* >( &package );
+
+        if ( package.SectionCount != PACKAGE_SECTION_COUNT ||
+             !package.Sections.IsValidNotNull( packageStart, endOfPackage, package.SectionCount ) )
+        {
+            return false;
+        }
+
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            const PackageSection& section = package.Sections[ sectionIndex ];
+
+            if ( section.Type != static_cast< PackageSectionTypes >( sectionIndex ) ||
+                 !section.Blocks.IsValidNotNull( packageStart, endOfPackage, section.BlockCount ) )
+            {
+                return false;
+            }
+
+            if ( section.Codec == SectionCodecs::NONE )
+            {
+                // Uncompressed sections are used in place, so they're a single block.
+                if ( section.BlockCount != 1 ||
+                     section.Blocks[ 0 ].StoredSize != section.Size ||
+                     !section.Blocks[ 0 ].Data.IsValid( packageStart, endOfPackage, section.Size ) ||
+                     ( section.Size > 0 && section.Blocks[ 0 ].Data.IsNull() ) )
+                {
+                    return false;
+                }
+            }
+            else if ( section.Codec == SectionCodecs::LZ4 && section.Type != PackageSectionTypes::METADATA )
+            {
+                if ( section.BlockCount != ( static_cast< uint64_t >( section.Size ) + SECTION_BLOCK_SIZE - 1 ) / SECTION_BLOCK_SIZE )
+                {
+                    return false;
+                }
+
+                for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
+                {
+                    const SectionBlock& block     = section.Blocks[ blockIndex ];
+                    uint32_t            blockSize = section.Size - blockIndex * SECTION_BLOCK_SIZE;
+
+                    blockSize = blockSize < SECTION_BLOCK_SIZE ? blockSize : SECTION_BLOCK_SIZE;
+
+                    if ( block.StoredSize == 0 ||
+                         block.StoredSize > blockSize ||
+                         !block.Data.IsValidNotNull( packageStart, endOfPackage, block.StoredSize ) )
+                    {
+                        return false;
+                    }
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        // The metadata is the start of the package used in place, and its hash has to vouch for the section and
+        // block tables, so it runs at least up to the first data block.
+        const PackageSection& metadata      = package.Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ];
+        const uint8_t*        endOfMetadata = packageStart + metadata.Size;
+
+        if ( metadata.Blocks[ 0 ].Data.Raw() != packageStart ||
+             metadata.Size < sizeof( BoondogglePackageHeader ) ||
+             !package.Sections.IsValidNotNull( packageStart, endOfMetadata, package.SectionCount ) )
+        {
+            return false;
+        }
+
+        const uint8_t* firstDataBlock = endOfPackage;
+
+        for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+        {
+            const PackageSection& section = package.Sections[ sectionIndex ];
+
+            if ( !section.Blocks.IsValidNotNull( packageStart, endOfMetadata, section.BlockCount ) )
+            {
+                return false;
+            }
+
+            for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount && sectionIndex > 0; ++blockIndex )
+            {
+                const uint8_t* blockData = section.Blocks[ blockIndex ].Data.Raw();
+
+                if ( blockData != nullptr && blockData < firstDataBlock )
+                {
+                    firstDataBlock = blockData;
+                }
+            }
+        }
+
+        return endOfMetadata >= firstDataBlock || firstDataBlock == endOfPackage;
+    }
+
+    // Where the tables of a package have to end, for version 2 packages they're all in the metadata section
+    // so its hash covers them.
+    const uint8_t* EndOfTables( const BoondogglePackageHeader& package, const uint8_t* endOfPackage )
+    {
+        return package.Version != CodeVersions::VERSION_2_0 ?
+            endOfPackage :
+            reinterpret_cast< const uint8_t* >( &package ) + package.Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ].Size;
+    }
+
+    // Is a flag read from the package a valid bool, anything but 0 or 1 isn't one and can't be loaded as one.
+    bool IsFlagValid( const bool& flag )
+    {
+        return *reinterpret_cast< const uint8_t* >( &flag ) <= 1;
+    }
+
+    // Is a blob's payload inside the package, or for version 2 packages, inside its data section.
+    bool IsBlobValid( const BoondogglePackageHeader& package, const ResourceBlob& blob, PackageSectionTypes dataSection, const uint8_t* endOfPackage )
+    {
+        const uint8_t* packageStart = reinterpret_cast< const uint8_t* >( &package );
+
+        if ( package.Version != CodeVersions::VERSION_2_0 )
+        {
+            return blob.Data.IsValidNotNull( packageStart, endOfPackage, blob.ResourceSize );
+        }
+
+        const PackageSection& section = package.Sections[ static_cast< uint32_t >( dataSection ) ];
+
+        return blob.Data.RelativeAddress >= 0 &&
+               static_cast< uint64_t >( blob.Data.RelativeAddress ) + blob.ResourceSize <= section.Size;
+    }
+}
+
+
+bool IsPackageOutdated( const BoondogglePackageHeader& package, const uint8_t* endOfPackage )
+{
+    const uint8_t* packageStart = reinterpret_cast< const uint8_t* >( &package );
+
+    return packageStart + offsetof( BoondogglePackageHeader, ShaderCount ) <= endOfPackage &&
+           package.MagicCode == MagicCodes::HEADER_CODE &&
+           package.Version < CodeVersions::VERSION_1_1;
+}
+
+
+bool ValidatePackageHeader( const BoondogglePackageHeader& package, const uint8_t* endOfPackage )
+{
+    const uint8_t* packageStart = reinterpret_cast< const uint8_t* >( &package );
+
+    // Check the header itself is all there first, version 1.1 headers stop before the section table.
+    if ( packageStart + offsetof( BoondogglePackageHeader, SectionCount ) > endOfPackage ||
+         package.MagicCode != MagicCodes::HEADER_CODE ||
+         ( package.Version != CodeVersions::VERSION_1_1 && package.Version != CodeVersions::VERSION_2_0 ) )
+    {
+        return false;
+    }
+
+    return package.Version != CodeVersions::VERSION_2_0 ||
+           ( packageStart + sizeof( BoondogglePackageHeader ) <= endOfPackage &&
+             AreSectionsValid( package, endOfPackage ) &&
+             package.SectionHashes.IsValidNotNull( packageStart, endOfPackage, PACKAGE_SECTION_COUNT ) );
+}
 
 
 bool ValidatePackage( const BoondogglePackageHeader& package, const uint8_t* endOfPackage )
 {
-    if ( package.MagicCode != MagicCodes::HEADER_CODE ||
-         !package.Shaders.IsValidNotNull( endOfPackage, package.ShaderCount ) ||
-         !package.StaticTextures.IsValidNotNull( endOfPackage, package.StaticTextureCount ) ||
-         !package.ProceduralTextures.IsValidNotNull( endOfPackage, package.ProceduralTextureCount ) ||
-         !package.Samplers.IsValidNotNull( endOfPackage, package.SamplerCount ) ||
-         !package.Effects.IsValidNotNull( endOfPackage, package.EffectCount ) ||
-         !package.ScreenAlignedQuadVS.Data.IsValidNotNull( endOfPackage, package.ScreenAlignedQuadVS.ResourceSize ) &&
-         package.EffectCount > 0 )
+    const uint8_t* packageStart = reinterpret_cast< const uint8_t* >( &package );
+
+    if ( !ValidatePackageHeader( package, endOfPackage ) )
+    {
+        return false;
+    }
+
+    const uint8_t* endOfTables = EndOfTables( package, endOfPackage );
+
+    if ( package.FrequencyBucketCount < 2 ||
+         package.FrequencyBucketCount > FREQUENCY_BUCKETS ||
+         !package.Shaders.IsValidNotNull( packageStart, endOfTables, package.ShaderCount ) ||
+         !package.StaticTextures.IsValidNotNull( packageStart, endOfTables, package.StaticTextureCount ) ||
+         !package.ProceduralTextures.IsValidNotNull( packageStart, endOfTables, package.ProceduralTextureCount ) ||
+         !package.Samplers.IsValidNotNull( packageStart, endOfTables, package.SamplerCount ) ||
+         !package.Effects.IsValidNotNull( packageStart, endOfTables, package.EffectCount ) ||
+         ( !IsBlobValid( package, package.ScreenAlignedQuadVS, PackageSectionTypes::SHADER_DATA, endOfPackage ) && package.EffectCount > 0 ) )
     {
         return false;
     }
 
-    uint32_t totalTextures = 1 + package.StaticTextureCount + package.ProceduralTextureCount;
+    uint32_t totalTextures = SoundHistoryTextureIndex( package ) + 1;
 
     for ( uint32_t shaderIndex = 0; shaderIndex < package.ShaderCount; ++shaderIndex )
     {
         const ResourceBlob& shader = package.Shaders[ shaderIndex ];
 
-        if ( !shader.Data.IsValidNotNull( endOfPackage, shader.ResourceSize ) )
+        if ( !IsBlobValid( package, shader, PackageSectionTypes::SHADER_DATA, endOfPackage ) )
         {
             return false;
         }
@@ -31,7 +201,7 @@ bool ValidatePackage( const BoondogglePackageHeader& package, const uint8_t* end
     {
         const ResourceBlob& staticTexture = package.StaticTextures[ staticTextureIndex ];
 
-        if ( !staticTexture.Data.IsValidNotNull( endOfPackage, staticTexture.ResourceSize ) )
+        if ( !IsBlobValid( package, staticTexture, PackageSectionTypes::TEXTURE_DATA, endOfPackage ) )
         {
             return false;
         }
@@ -42,8 +212,10 @@ bool ValidatePackage( const BoondogglePackageHeader& package, const uint8_t* end
         const ProceduralTexture& procedural = package.ProceduralTextures[ proceduralIndex ];
 
         if ( procedural.ShaderId >= package.ShaderCount ||
-             !procedural.SourceTextures.IsValidNotNull( endOfPackage, procedural.SourceTextureCount ) ||
-             !procedural.SourceSamplers.IsValidNotNull( endOfPackage, procedural.SourceSamplerCount ) )
+             !IsFlagValid( procedural.GenerateMipMaps ) ||
+             !IsFlagValid( procedural.GenerateAtStart ) ||
+             !procedural.SourceTextures.IsValidNotNull( packageStart, endOfTables, procedural.SourceTextureCount ) ||
+             !procedural.SourceSamplers.IsValidNotNull( packageStart, endOfTables, procedural.SourceSamplerCount ) )
         {
             return false;
         }
@@ -70,9 +242,10 @@ bool ValidatePackage( const BoondogglePackageHeader& package, const uint8_t* end
         const VisualEffect& effect = package.Effects[ effectIndex ];
 
         if ( effect.ShaderId >= package.ShaderCount ||
-             !effect.SourceTextures.IsValidNotNull( endOfPackage, effect.SourceTextureCount ) ||
-             !effect.SourceSamplers.IsValidNotNull( endOfPackage, effect.SourceSamplerCount ) ||
-             !effect.ProceduralTextures.IsValidNotNull( endOfPackage, effect.ProceduralTextureCount ) )
+             !IsFlagValid( effect.UseSoundTexture ) ||
+             !effect.SourceTextures.IsValidNotNull( packageStart, endOfTables, effect.SourceTextureCount ) ||
+             !effect.SourceSamplers.IsValidNotNull( packageStart, endOfTables, effect.SourceSamplerCount ) ||
+             !effect.ProceduralTextures.IsValidNotNull( packageStart, endOfTables, effect.ProceduralTextureCount ) )
         {
             return false;
         }
@@ -95,7 +268,7 @@ bool ValidatePackage( const BoondogglePackageHeader& package, const uint8_t* end
 
         for ( uint32_t sourceProceduralIndex = 0; sourceProceduralIndex < effect.ProceduralTextureCount; ++sourceProceduralIndex )
         {
-            if ( effect.SourceSamplers[ sourceProceduralIndex ] >= package.ProceduralTextureCount )
+            if ( effect.ProceduralTextures[ sourceProceduralIndex ] >= package.ProceduralTextureCount )
             {
                 return false;
             }
@@ -2,6 +2,7 @@
 #define BOONDOGGLE_BINARY_EFFECTS_FORMAT_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #pragma once
 
@@ -77,20 +78,36 @@ struct Relative
 
     BEF_FORCE_INLINE const PointedType& operator[]( size_t index ) const { return *( Raw() + index ); }
 
-    // Used to check this is in a valid range.
-    BEF_FORCE_INLINE bool IsValid( const uint8_t* endBuffer, uint32_t count = 1 ) const
+    // Used to check this is null, or count objects in the buffer aligned for the pointed type.
+    BEF_FORCE_INLINE bool IsValid( const uint8_t* startBuffer, const uint8_t* endBuffer, uint32_t count = 1 ) const
     {
-        return RelativeAddress == 0 || reinterpret_cast<const uint8_t*>( Raw() + count ) <= endBuffer;
+        return RelativeAddress == 0 || IsInBuffer( startBuffer, endBuffer, count );
     }
 
-    // Is this in a valid range and not null.
-    BEF_FORCE_INLINE bool IsValidNotNull( const uint8_t* endBuffer, uint32_t count = 1 ) const
+    // Is this count objects in the buffer aligned for the pointed type, and not null.
+    BEF_FORCE_INLINE bool IsValidNotNull( const uint8_t* startBuffer, const uint8_t* endBuffer, uint32_t count = 1 ) const
     {
-        return RelativeAddress != 0 && reinterpret_cast<const uint8_t*>( Raw() + count ) <= endBuffer;
+        return RelativeAddress != 0 && IsInBuffer( startBuffer, endBuffer, count );
     }
 
     // Is this null?
     BEF_FORCE_INLINE bool IsNull() const { return RelativeAddress == 0; }
+
+private:
+
+    // Done on integers, as a corrupt address can point anywhere and even forming a pointer outside the buffer
+    // isn't defined. The count can't overflow in 64 bits.
+    BEF_FORCE_INLINE bool IsInBuffer( const uint8_t* startBuffer, const uint8_t* endBuffer, uint32_t count ) const
+    {
+        uint64_t start   = reinterpret_cast< uintptr_t >( startBuffer );
+        uint64_t end     = reinterpret_cast< uintptr_t >( endBuffer );
+        uint64_t address = reinterpret_cast< uintptr_t >( &RelativeAddress ) + static_cast< int64_t >( RelativeAddress );
+
+        return address >= start &&
+               address <= end &&
+               address % alignof( PointedType ) == 0 &&
+               static_cast< uint64_t >( count ) * sizeof( PointedType ) <= end - address;
+    }
 };
 
 
@@ -115,11 +132,35 @@ enum class MagicCodes : uint32_t
     HEADER_CODE = 0xEA7B0075
 };
 
+// Bump the version whenever the package layout or anything the shaders see changes (the constant registers
+// in shared_render_constants.h, texture indices or FREQUENCY_BUCKETS), so packages compiled against the old
+// layout are refused rather than drawn with the wrong inputs.
 enum class CodeVersions : uint32_t
 {
-    VERSION_1_0 = 0x00010000
+    VERSION_1_0 = 0x00010000, // no longer loaded, recompile: no bucket count and the constant registers before the onset and sound history constants.
+    VERSION_1_1 = 0x00010001, // adds the frequency bucket count, and is the first with the current constant registers.
+    VERSION_2_0 = 0x00020000  // adds the section table, resource blob payloads move to (optionally compressed) data sections.
+};
+
+// Sections of a version 2 package, in the order they appear in the section table.
+enum class PackageSectionTypes : uint32_t
+{
+    METADATA     = 0, // the header, effects, samplers, procedurals and blob tables, always uncompressed and used in place.
+    SHADER_DATA  = 1, // pixel and vertex shader bytecode.
+    TEXTURE_DATA = 2  // static texture DDS files.
 };
 
+static const uint32_t PACKAGE_SECTION_COUNT = 3;
+
+enum class SectionCodecs : uint32_t
+{
+    NONE = 0, // stored as is in a single block.
+    LZ4  = 1  // independent LZ4 blocks of SECTION_BLOCK_SIZE bytes (the last can be short), see block_compression.h.
+};
+
+// Compressed sections are split into blocks of this many bytes so they can be decompressed in parallel.
+static const uint32_t SECTION_BLOCK_SIZE = 256 * 1024;
+
 enum class ProceduralFormats : uint32_t
 {
     RGBA8_UNORM      = 0,
@@ -131,12 +172,31 @@ enum class ProceduralFormats : uint32_t
 
 // Used for raw binary resources. 
 // We use a separate pointer instead of post-fixing the data so we can have a nice array of blobs.
+// In version 2 packages Data isn't a relative address, it holds the offset of the payload in the blob's
+// data section (use PackageSections::BlobData).
 struct ResourceBlob
 {
     uint32_t                           ResourceSize;
     Relative< uint8_t >                Data;
 };
 
+// A block of a section as stored in the file. Blocks of a compressed section whose StoredSize is their
+// decompressed size are stored uncompressed (they didn't compress).
+struct SectionBlock
+{
+    uint32_t                           StoredSize;
+    Relative< uint8_t >                Data;
+};
+
+struct PackageSection
+{
+    PackageSectionTypes                Type;
+    SectionCodecs                      Codec;
+    uint32_t                           Size;                   // Decompressed size.
+    uint32_t                           BlockCount;
+    Relative< SectionBlock >           Blocks;
+};
+
 
 struct ProceduralTexture
 {
@@ -194,8 +254,30 @@ struct BoondogglePackageHeader
     Relative< VisualEffect >           Effects;
 
     ResourceBlob                       ScreenAlignedQuadVS;
+
+    uint32_t                           FrequencyBucketCount;   // Buckets the shaders were compiled for (FREQUENCY_BUCKETS in the shaders).
+
+    // Version 2 only, version 1.1 headers end here.
+    uint32_t                           SectionCount;           // PACKAGE_SECTION_COUNT
+    Relative< PackageSection >         Sections;
+    Relative< uint64_t >               SectionHashes;          // Hash of each section's stored blocks (see HashSection), after all the sections.
 };
 
+// Texture indices go sound texture (0), static textures, procedural textures, then the sound history texture,
+// which is last so packages that don't use it keep the same indices.
+BEF_FORCE_INLINE uint32_t SoundHistoryTextureIndex( const BoondogglePackageHeader& package )
+{
+    return 1 + package.StaticTextureCount + package.ProceduralTextureCount;
+}
+
+// Is this a package from a version too old to load, which has to be recompiled.
+bool IsPackageOutdated( const BoondogglePackageHeader& package, const uint8_t* endOfPackage );
+
+// Check the header of a version 1.1 or 2 package and the section table of a version 2 one are well formed,
+// which is enough to find and hash the sections, but not to use anything in them.
+bool ValidatePackageHeader( const BoondogglePackageHeader& package, const uint8_t* endOfPackage );
+
+// Check a version 1.1 or 2 package is well formed, without decompressing or hashing any sections.
 bool ValidatePackage( const BoondogglePackageHeader& package, const uint8_t* endOfPackage );
 
 #endif // -- BOONDOGGLE_BINARY_EFFECTS_FORMAT_H__
\ No newline at end of file
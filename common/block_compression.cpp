@@ -0,0 +1,283 @@
+#include "block_compression.h"
+#include <string.h>
+
+namespace
+{
+    const size_t   MIN_MATCH     = 4;
+    const size_t   LAST_LITERALS = 5;  // the last bytes of a block are always literals.
+    const size_t   MATCH_LIMIT   = 12; // no match can start closer than this to the end of a block.
+    const size_t   MAX_OFFSET    = 65535;
+    const uint32_t HASH_BITS     = 12;
+    const size_t   RUN_MASK      = 15;
+    const size_t   WILD_COPY     = 16; // short copies are done this many bytes at a time when there's room.
+
+    inline uint32_t Read32( const uint8_t* where )
+    {
+        uint32_t result;
+
+        ::memcpy( &result, where, sizeof( result ) );
+
+        return result;
+    }
+
+    inline uint32_t Hash( uint32_t sequence )
+    {
+        return ( sequence * 2654435761U ) >> ( 32 - HASH_BITS );
+    }
+
+    // Write the extra bytes of a length that didn't fit in the token.
+    inline uint8_t* WriteLengthExtension( uint8_t* output, size_t length )
+    {
+        for ( ; length >= 255; length -= 255 )
+        {
+            *output++ = 255;
+        }
+
+        *output++ = static_cast< uint8_t >( length );
+
+        return output;
+    }
+
+    // Read the extra bytes of a length, false if they run off the end of the input.
+    inline bool ReadLengthExtension( const uint8_t*& input, const uint8_t* inputEnd, size_t& length )
+    {
+        uint8_t extension;
+
+        do
+        {
+            if ( input >= inputEnd )
+            {
+                return false;
+            }
+
+            extension = *input++;
+            length   += extension;
+        }
+        while ( extension == 255 );
+
+        return true;
+    }
+
+    // Write a sequence of literals followed by an optional match (matchLength of 0 for none).
+    inline uint8_t* WriteSequence( uint8_t* output, const uint8_t* outputEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength )
+    {
+        size_t encodedMatch = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+        size_t worstCase    = 1 + literalLength / 255 + 1 + literalLength + 2 + encodedMatch / 255 + 1;
+
+        if ( static_cast< size_t >( outputEnd - output ) < worstCase )
+        {
+            return nullptr;
+        }
+
+        uint8_t* token = output++;
+
+        *token = static_cast< uint8_t >( ( literalLength < RUN_MASK ? literalLength : RUN_MASK ) << 4 );
+
+        if ( literalLength >= RUN_MASK )
+        {
+            output = WriteLengthExtension( output, literalLength - RUN_MASK );
+        }
+
+        ::memcpy( output, literals, literalLength );
+
+        output += literalLength;
+
+        if ( matchLength > 0 )
+        {
+            *output++ = static_cast< uint8_t >( offset );
+            *output++ = static_cast< uint8_t >( offset >> 8 );
+
+            *token |= static_cast< uint8_t >( encodedMatch < RUN_MASK ? encodedMatch : RUN_MASK );
+
+            if ( encodedMatch >= RUN_MASK )
+            {
+                output = WriteLengthExtension( output, encodedMatch - RUN_MASK );
+            }
+        }
+
+        return output;
+    }
+}
+
+
+size_t CompressBlock( const uint8_t* source, size_t size, uint8_t* destination, size_t capacity )
+{
+    const uint8_t* end       = source + size;
+    const uint8_t* anchor    = source;
+    uint8_t*       output    = destination;
+    uint8_t*       outputEnd = destination + capacity;
+
+    if ( size > MATCH_LIMIT )
+    {
+        // Positions of the last sequence seen with each hash, relative to the source.
+        uint32_t       table[ 1 << HASH_BITS ] = {};
+        const uint8_t* inputLimit              = end - MATCH_LIMIT;
+        const uint8_t* matchLimit              = end - LAST_LITERALS;
+
+        for ( const uint8_t* input = source + 1; input < inputLimit; )
+        {
+            uint32_t       sequence  = Read32( input );
+            uint32_t       hash      = Hash( sequence );
+            const uint8_t* candidate = source + table[ hash ];
+
+            table[ hash ] = static_cast< uint32_t >( input - source );
+
+            if ( candidate >= input ||
+                 static_cast< size_t >( input - candidate ) > MAX_OFFSET ||
+                 Read32( candidate ) != sequence )
+            {
+                ++input;
+                continue;
+            }
+
+            // Grow the match backwards into the literals, then forwards as far as it goes.
+            while ( input > anchor && candidate > source && input[ -1 ] == candidate[ -1 ] )
+            {
+                --input;
+                --candidate;
+            }
+
+            const uint8_t* matchEnd     = input + MIN_MATCH;
+            const uint8_t* candidateEnd = candidate + MIN_MATCH;
+
+            while ( matchEnd < matchLimit && *matchEnd == *candidateEnd )
+            {
+                ++matchEnd;
+                ++candidateEnd;
+            }
+
+            output = WriteSequence( output,
+                                    outputEnd,
+                                    anchor,
+                                    static_cast< size_t >( input - anchor ),
+                                    static_cast< size_t >( input - candidate ),
+                                    static_cast< size_t >( matchEnd - input ) );
+
+            if ( output == nullptr )
+            {
+                return 0;
+            }
+
+            input  = matchEnd;
+            anchor = matchEnd;
+
+            // Remember a position inside the match too, repeats often start part way through one.
+            if ( input - 2 > source && input < inputLimit )
+            {
+                table[ Hash( Read32( input - 2 ) ) ] = static_cast< uint32_t >( input - 2 - source );
+            }
+        }
+    }
+
+    output = WriteSequence( output, outputEnd, anchor, static_cast< size_t >( end - anchor ), 0, 0 );
+
+    return output != nullptr ? static_cast< size_t >( output - destination ) : 0;
+}
+
+
+bool DecompressBlock( const uint8_t* source, size_t storedSize, uint8_t* destination, size_t size )
+{
+    const uint8_t* input     = source;
+    const uint8_t* inputEnd  = source + storedSize;
+    uint8_t*       output    = destination;
+    uint8_t*       outputEnd = destination + size;
+
+    for ( ;; )
+    {
+        if ( input >= inputEnd )
+        {
+            return false;
+        }
+
+        uint8_t token         = *input++;
+        size_t  literalLength = token >> 4;
+
+        if ( literalLength == RUN_MASK && !ReadLengthExtension( input, inputEnd, literalLength ) )
+        {
+            return false;
+        }
+
+        if ( literalLength > static_cast< size_t >( inputEnd - input ) ||
+             literalLength > static_cast< size_t >( outputEnd - output ) )
+        {
+            return false;
+        }
+
+        // Most literal runs are short, copying a fixed size is quicker when there's room to over-copy.
+        if ( literalLength <= WILD_COPY &&
+             static_cast< size_t >( inputEnd - input ) >= WILD_COPY &&
+             static_cast< size_t >( outputEnd - output ) >= WILD_COPY )
+        {
+            ::memcpy( output, input, WILD_COPY );
+        }
+        else
+        {
+            ::memcpy( output, input, literalLength );
+        }
+
+        input  += literalLength;
+        output += literalLength;
+
+        // The last sequence is only literals.
+        if ( input == inputEnd )
+        {
+            return output == outputEnd;
+        }
+
+        if ( inputEnd - input < 2 )
+        {
+            return false;
+        }
+
+        size_t offset = static_cast< size_t >( input[ 0 ] ) | ( static_cast< size_t >( input[ 1 ] ) << 8 );
+
+        input += 2;
+
+        if ( offset == 0 || offset > static_cast< size_t >( output - destination ) )
+        {
+            return false;
+        }
+
+        size_t matchLength = token & RUN_MASK;
+
+        if ( matchLength == RUN_MASK && !ReadLengthExtension( input, inputEnd, matchLength ) )
+        {
+            return false;
+        }
+
+        matchLength += MIN_MATCH;
+
+        if ( matchLength > static_cast< size_t >( outputEnd - output ) )
+        {
+            return false;
+        }
+
+        const uint8_t* match = output - offset;
+
+        size_t roundedLength = ( matchLength + WILD_COPY - 1 ) & ~( WILD_COPY - 1 );
+
+        if ( offset >= WILD_COPY && static_cast< size_t >( outputEnd - output ) >= roundedLength )
+        {
+            // Chunks don't overlap what they read at this offset, so a whole number of them can be copied.
+            for ( size_t copied = 0; copied < matchLength; copied += WILD_COPY )
+            {
+                ::memcpy( output + copied, match + copied, WILD_COPY );
+            }
+
+            output += matchLength;
+        }
+        else if ( offset >= matchLength )
+        {
+            ::memcpy( output, match, matchLength );
+            output += matchLength;
+        }
+        else
+        {
+            // Overlapping matches repeat the last offset bytes.
+            for ( uint8_t* matchEnd = output + matchLength; output < matchEnd; )
+            {
+                *output++ = *match++;
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef BOONDOGGLE_BLOCK_COMPRESSION_H__
+#define BOONDOGGLE_BLOCK_COMPRESSION_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fast LZ77 compression of independent blocks, in the LZ4 block format (sequences of a token, literals, a 16 bit
+// offset and match length, ending with literals). Compression is a greedy single hash probe, which gives up some
+// ratio to keep the compiler quick, decompression is a simple copy loop that checks every length and offset,
+// so it's safe on untrusted data.
+
+// Worst case compressed size of a block of size bytes (incompressible data grows a little).
+inline size_t CompressBlockBound( size_t size )
+{
+    return size + size / 255 + 16;
+}
+
+// Compress a block, returning the compressed size or 0 if it doesn't fit in capacity bytes.
+size_t CompressBlock( const uint8_t* source, size_t size, uint8_t* destination, size_t capacity );
+
+// Decompress a block that must decompress to exactly size bytes. Returns false if the block is corrupt.
+bool DecompressBlock( const uint8_t* source, size_t storedSize, uint8_t* destination, size_t size );
+
+#endif // -- BOONDOGGLE_BLOCK_COMPRESSION_H__
@@ -3,12 +3,47 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocation_tracker.h"
+
 #if defined( _MSC_VER )
+#include <malloc.h>
 #define BEH_FORCE_INLINE __forceinline
 #else
 #define BEH_FORCE_INLINE inline
 #endif
 
+// Allocate zeroed memory with a particular (power of two) alignment, free with AlignedFree.
+BEH_FORCE_INLINE void* AlignedAllocateZeroed( size_t size, size_t alignment )
+{
+    NoteHeapAllocation();
+
+#if defined( _MSC_VER )
+    return ::_aligned_recalloc( nullptr, size, 1, alignment );
+#else
+    void* result = nullptr;
+
+    if ( ::posix_memalign( &result, alignment < sizeof( void* ) ? sizeof( void* ) : alignment, size ) != 0 )
+    {
+        return nullptr;
+    }
+
+    return ::memset( result, 0, size );
+#endif
+}
+
+// Free memory allocated with AlignedAllocateZeroed.
+BEH_FORCE_INLINE void AlignedFree( void* toFree )
+{
+#if defined( _MSC_VER )
+    ::_aligned_free( toFree );
+#else
+    ::free( toFree );
+#endif
+}
+
 template < typename COMType >
 BEH_FORCE_INLINE void COMRelease( COMType*& toRelease )
 {
@@ -40,9 +75,9 @@ struct COMAutoPtr
 
     BEH_FORCE_INLINE const IntrusiveType* operator->() const { return raw; }
 
-    BEH_FORCE_INLINE IntrusiveType& operator*() { return *raw }
+    BEH_FORCE_INLINE IntrusiveType& operator*() { return *raw; }
 
-    BEH_FORCE_INLINE const IntrusiveType& operator*() const { return *raw }
+    BEH_FORCE_INLINE const IntrusiveType& operator*() const { return *raw; }
     
     BEH_FORCE_INLINE COMAutoPtr( const COMAutoPtr< IntrusiveType >& from )
     {
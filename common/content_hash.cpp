@@ -0,0 +1,233 @@
+#include "content_hash.h"
+#include <string.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define CONTENT_HASH_SSE 1
+#include <emmintrin.h>
+#else
+#define CONTENT_HASH_SSE 0
+#endif
+
+namespace
+{
+    const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    const uint32_t PRIME32_1 = 0x9E3779B1U;
+
+    const size_t LANES             = 8;
+    const size_t STRIPE_SIZE       = LANES * sizeof( uint64_t );
+    const size_t STRIPES_PER_BLOCK = 16; // lanes are scrambled every block, so the order of blocks matters.
+    const size_t KEY_COUNT         = LANES + STRIPES_PER_BLOCK - 1;
+
+    // Each stripe of a block takes its lane keys from a different offset in here, so the same data in two
+    // stripes of a block doesn't add up the same. The last LANES keys scramble the lanes.
+    const uint64_t KEYS[ KEY_COUNT ] =
+    {
+        0x2CB0F69F4ABEA221ULL, 0x9417034723148989ULL, 0xDD555950609DFE03ULL, 0xDBAFB150DEB12800ULL,
+        0x7E789B2E6C442CB6ULL, 0xF41E5636C7E4F8C4ULL, 0x0959D150F8FBA7E4ULL, 0xA97316F13CDB9EEAULL,
+        0x74CD8258F9520068ULL, 0x55C74A62E116868BULL, 0xD2F4C799A2023CBDULL, 0xDF98CB79A37B51B9ULL,
+        0x396F5885524F3905ULL, 0xAF1D56386CA3B276ULL, 0xA9FFBE6B5104E85AULL, 0x6BD0C51B9FD533B3ULL,
+        0x980CE91C50AB4B56ULL, 0x28AC395780FE62C5ULL, 0x768912E3A6BCEDC7ULL, 0x50B3E8C9332C7C88ULL,
+        0xCE3BBFE520BD47DAULL, 0xCBA6C8E8E0BB7C4FULL, 0xBF194DB8434A346DULL
+    };
+
+    const uint64_t* const SCRAMBLE_KEYS = KEYS + KEY_COUNT - LANES;
+
+    inline uint64_t Read64( const uint8_t* where )
+    {
+        uint64_t result;
+
+        ::memcpy( &result, where, sizeof( result ) );
+
+        return result;
+    }
+
+    inline uint64_t RotateLeft( uint64_t value, uint32_t bits )
+    {
+        return ( value << bits ) | ( value >> ( 64 - bits ) );
+    }
+
+    inline uint64_t Avalanche( uint64_t hash )
+    {
+        hash ^= hash >> 33;
+        hash *= PRIME64_2;
+        hash ^= hash >> 29;
+        hash *= PRIME64_3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+
+    void AccumulateStripeScalar( uint64_t* lanes, const uint8_t* stripe, const uint64_t* keys )
+    {
+        for ( size_t lane = 0; lane < LANES; ++lane )
+        {
+            uint64_t value = Read64( stripe + lane * sizeof( uint64_t ) );
+            uint64_t keyed = value ^ keys[ lane ];
+
+            lanes[ lane ^ 1 ] += value;
+            lanes[ lane ]     += static_cast< uint64_t >( static_cast< uint32_t >( keyed ) ) * ( keyed >> 32 );
+        }
+    }
+
+    void ScrambleScalar( uint64_t* lanes )
+    {
+        for ( size_t lane = 0; lane < LANES; ++lane )
+        {
+            uint64_t value = lanes[ lane ];
+
+            value ^= value >> 47;
+            value ^= SCRAMBLE_KEYS[ lane ];
+            value *= PRIME32_1;
+
+            lanes[ lane ] = value;
+        }
+    }
+
+    // Whole blocks and stripes of the input, returns how many bytes were taken.
+    size_t AccumulateScalar( uint64_t* lanes, const uint8_t* input, size_t size )
+    {
+        size_t stripes = size / STRIPE_SIZE;
+
+        for ( size_t stripe = 0; stripe < stripes; ++stripe )
+        {
+            AccumulateStripeScalar( lanes, input + stripe * STRIPE_SIZE, KEYS + stripe % STRIPES_PER_BLOCK );
+
+            if ( ( stripe + 1 ) % STRIPES_PER_BLOCK == 0 )
+            {
+                ScrambleScalar( lanes );
+            }
+        }
+
+        return stripes * STRIPE_SIZE;
+    }
+
+#if CONTENT_HASH_SSE
+    size_t AccumulateSSE2( uint64_t* lanes, const uint8_t* input, size_t size )
+    {
+        __m128i accumulators[ LANES / 2 ];
+        __m128i scrambleKeys[ LANES / 2 ];
+        __m128i prime = _mm_set1_epi32( static_cast< int >( PRIME32_1 ) );
+
+        for ( size_t pair = 0; pair < LANES / 2; ++pair )
+        {
+            accumulators[ pair ] = _mm_loadu_si128( reinterpret_cast< const __m128i* >( lanes ) + pair );
+            scrambleKeys[ pair ] = _mm_loadu_si128( reinterpret_cast< const __m128i* >( SCRAMBLE_KEYS ) + pair );
+        }
+
+        size_t stripes = size / STRIPE_SIZE;
+
+        for ( size_t stripe = 0; stripe < stripes; ++stripe )
+        {
+            const __m128i* data = reinterpret_cast< const __m128i* >( input + stripe * STRIPE_SIZE );
+            const __m128i* keys = reinterpret_cast< const __m128i* >( KEYS + stripe % STRIPES_PER_BLOCK );
+
+            for ( size_t pair = 0; pair < LANES / 2; ++pair )
+            {
+                __m128i value   = _mm_loadu_si128( data + pair );
+                __m128i keyed   = _mm_xor_si128( value, _mm_loadu_si128( keys + pair ) );
+                __m128i product = _mm_mul_epu32( keyed, _mm_srli_epi64( keyed, 32 ) );
+                __m128i swapped = _mm_shuffle_epi32( value, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+
+                accumulators[ pair ] = _mm_add_epi64( accumulators[ pair ], _mm_add_epi64( product, swapped ) );
+            }
+
+            if ( ( stripe + 1 ) % STRIPES_PER_BLOCK == 0 )
+            {
+                for ( size_t pair = 0; pair < LANES / 2; ++pair )
+                {
+                    __m128i value = accumulators[ pair ];
+
+                    value = _mm_xor_si128( value, _mm_srli_epi64( value, 47 ) );
+                    value = _mm_xor_si128( value, scrambleKeys[ pair ] );
+
+                    // 64 bit by 32 bit multiply from the low and high halves.
+                    __m128i low  = _mm_mul_epu32( value, prime );
+                    __m128i high = _mm_slli_epi64( _mm_mul_epu32( _mm_srli_epi64( value, 32 ), prime ), 32 );
+
+                    accumulators[ pair ] = _mm_add_epi64( low, high );
+                }
+            }
+        }
+
+        for ( size_t pair = 0; pair < LANES / 2; ++pair )
+        {
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( lanes ) + pair, accumulators[ pair ] );
+        }
+
+        return stripes * STRIPE_SIZE;
+    }
+#endif
+
+    // Fold in the bytes after the last whole stripe and merge the lanes.
+    uint64_t Finish( const uint64_t* lanes, const uint8_t* tail, size_t tailSize, size_t size, uint64_t seed )
+    {
+        uint64_t hash = static_cast< uint64_t >( size ) * PRIME64_1 ^ seed;
+
+        for ( size_t lane = 0; lane < LANES; lane += 2 )
+        {
+            uint64_t mixed = ( lanes[ lane ] ^ KEYS[ lane ] ) * ( lanes[ lane + 1 ] ^ PRIME64_4 );
+
+            hash += mixed ^ ( mixed >> 32 );
+            hash  = RotateLeft( hash, 27 ) * PRIME64_1 + PRIME64_4;
+        }
+
+        for ( ; tailSize >= sizeof( uint64_t ); tailSize -= sizeof( uint64_t ), tail += sizeof( uint64_t ) )
+        {
+            hash ^= RotateLeft( Read64( tail ) * PRIME64_2, 31 ) * PRIME64_1;
+            hash  = RotateLeft( hash, 27 ) * PRIME64_1 + PRIME64_4;
+        }
+
+        for ( ; tailSize > 0; --tailSize, ++tail )
+        {
+            hash ^= *tail * PRIME64_3;
+            hash  = RotateLeft( hash, 11 ) * PRIME64_1;
+        }
+
+        return Avalanche( hash );
+    }
+
+    void InitializeLanes( uint64_t* lanes, uint64_t seed )
+    {
+        lanes[ 0 ] = PRIME64_3 + seed;
+        lanes[ 1 ] = PRIME64_1 - seed;
+        lanes[ 2 ] = PRIME64_2 + seed;
+        lanes[ 3 ] = PRIME64_3 - seed;
+        lanes[ 4 ] = PRIME64_4 + seed;
+        lanes[ 5 ] = PRIME32_1 - seed;
+        lanes[ 6 ] = PRIME64_1 + seed;
+        lanes[ 7 ] = PRIME64_2 - seed;
+    }
+}
+
+
+uint64_t ContentHash64( const void* data, size_t size, uint64_t seed )
+{
+#if CONTENT_HASH_SSE
+    const uint8_t* input = reinterpret_cast< const uint8_t* >( data );
+    uint64_t       lanes[ LANES ];
+
+    InitializeLanes( lanes, seed );
+
+    size_t taken = AccumulateSSE2( lanes, input, size );
+
+    return Finish( lanes, input + taken, size - taken, size, seed );
+#else
+    return ContentHash64Scalar( data, size, seed );
+#endif
+}
+
+
+uint64_t ContentHash64Scalar( const void* data, size_t size, uint64_t seed )
+{
+    const uint8_t* input = reinterpret_cast< const uint8_t* >( data );
+    uint64_t       lanes[ LANES ];
+
+    InitializeLanes( lanes, seed );
+
+    size_t taken = AccumulateScalar( lanes, input, size );
+
+    return Finish( lanes, input + taken, size - taken, size, seed );
+}
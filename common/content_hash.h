@@ -0,0 +1,17 @@
+#ifndef BOONDOGGLE_CONTENT_HASH_H__
+#define BOONDOGGLE_CONTENT_HASH_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fast 64 bit non-cryptographic hash in the style of XXH3, for checking package contents. Data is taken
+// 64 bytes at a time into eight 64 bit lanes, each adding the product of the two 32 bit halves of the data
+// xored with a lane key, so SSE2 does two lanes per instruction. It catches corruption, not tampering.
+uint64_t ContentHash64( const void* data, size_t size, uint64_t seed = 0 );
+
+// The same hash without SIMD, to check the SIMD version against.
+uint64_t ContentHash64Scalar( const void* data, size_t size, uint64_t seed = 0 );
+
+#endif // -- BOONDOGGLE_CONTENT_HASH_H__
@@ -0,0 +1,209 @@
+#include "mapped_file.h"
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined( _WIN32 )
+
+namespace
+{
+    // Map all of an open file read only, or read it into copy if that's not null, closing the file and mapping
+    // handles. Returns null on failure.
+    const uint8_t* MapFile( HANDLE file, ArenaAllocator* copy, size_t& size, uint64_t& modifiedTime )
+    {
+        if ( file == INVALID_HANDLE_VALUE )
+        {
+            return nullptr;
+        }
+
+        LARGE_INTEGER  fileSize;
+        FILETIME       lastWrite;
+        const uint8_t* result = nullptr;
+
+        if ( ::GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart > 0 && ::GetFileTime( file, nullptr, nullptr, &lastWrite ) )
+        {
+            modifiedTime = ( static_cast< uint64_t >( lastWrite.dwHighDateTime ) << 32 ) | lastWrite.dwLowDateTime;
+            size         = static_cast< size_t >( fileSize.QuadPart );
+
+            if ( copy != nullptr )
+            {
+                uint8_t* memory = copy->Initialize( "file copy", size + 64 ) ? reinterpret_cast< uint8_t* >( copy->Allocate( size, 64 ) ) : nullptr;
+                size_t   read   = 0;
+
+                // ReadFile takes a DWORD, so big files take a few reads.
+                for ( DWORD chunkRead = 0; memory != nullptr && read < size; read += chunkRead )
+                {
+                    size_t chunk = size - read < 0x40000000 ? size - read : 0x40000000;
+
+                    if ( !::ReadFile( file, memory + read, static_cast< DWORD >( chunk ), &chunkRead, nullptr ) || chunkRead == 0 )
+                    {
+                        break;
+                    }
+                }
+
+                result = read == size ? memory : nullptr;
+            }
+            else
+            {
+                HANDLE mapping = ::CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+                if ( mapping != nullptr )
+                {
+                    result = reinterpret_cast< const uint8_t* >( ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+
+                    ::CloseHandle( mapping );
+                }
+            }
+        }
+
+        ::CloseHandle( file );
+
+        return result;
+    }
+}
+
+#endif
+
+MappedFile::MappedFile() : Data_( nullptr ), Size_( 0 ), ModifiedTime_( 0 )
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#if defined( _WIN32 )
+
+bool MappedFile::Open( const wchar_t* path, bool copy )
+{
+    Close();
+
+    HANDLE file = ::CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr );
+
+    Data_ = MapFile( file, copy ? &Copy_ : nullptr, Size_, ModifiedTime_ );
+
+    if ( Data_ == nullptr )
+    {
+        Close();
+    }
+
+    return Data_ != nullptr;
+}
+
+bool MappedFile::Open( const char* path, bool copy )
+{
+    Close();
+
+    HANDLE file = ::CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr );
+
+    Data_ = MapFile( file, copy ? &Copy_ : nullptr, Size_, ModifiedTime_ );
+
+    if ( Data_ == nullptr )
+    {
+        Close();
+    }
+
+    return Data_ != nullptr;
+}
+
+void MappedFile::Close()
+{
+    if ( Data_ != nullptr && Copy_.Base() == nullptr )
+    {
+        ::UnmapViewOfFile( Data_ );
+    }
+
+    Copy_.Release();
+
+    Data_         = nullptr;
+    Size_         = 0;
+    ModifiedTime_ = 0;
+}
+
+#else
+
+bool MappedFile::Open( const char* path, bool copy )
+{
+    Close();
+
+    int file = ::open( path, O_RDONLY );
+
+    if ( file < 0 )
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+
+    if ( ::fstat( file, &fileStat ) == 0 && fileStat.st_size > 0 )
+    {
+        size_t size = static_cast< size_t >( fileStat.st_size );
+
+        ModifiedTime_ = static_cast< uint64_t >( fileStat.st_mtime ) * 1000000000;
+
+#if defined( __linux__ )
+        ModifiedTime_ += static_cast< uint64_t >( fileStat.st_mtim.tv_nsec );
+#endif
+
+        if ( copy )
+        {
+            uint8_t* memory = Copy_.Initialize( "file copy", size + 64 ) ? reinterpret_cast< uint8_t* >( Copy_.Allocate( size, 64 ) ) : nullptr;
+            size_t   read   = 0;
+
+            for ( ssize_t chunkRead = 0; memory != nullptr && read < size; read += static_cast< size_t >( chunkRead ) )
+            {
+                chunkRead = ::read( file, memory + read, size - read );
+
+                if ( chunkRead <= 0 )
+                {
+                    break;
+                }
+            }
+
+            Data_ = read == size ? memory : nullptr;
+            Size_ = size;
+        }
+        else
+        {
+            void* mapping = ::mmap( nullptr, size, PROT_READ, MAP_SHARED, file, 0 );
+
+            if ( mapping != MAP_FAILED )
+            {
+                Data_ = reinterpret_cast< const uint8_t* >( mapping );
+                Size_ = size;
+            }
+        }
+    }
+
+    ::close( file );
+
+    if ( Data_ == nullptr )
+    {
+        Close();
+    }
+
+    return Data_ != nullptr;
+}
+
+void MappedFile::Close()
+{
+    if ( Data_ != nullptr && Copy_.Base() == nullptr )
+    {
+        ::munmap( const_cast< uint8_t* >( Data_ ), Size_ );
+    }
+
+    Copy_.Release();
+
+    Data_         = nullptr;
+    Size_         = 0;
+    ModifiedTime_ = 0;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef BOONDOGGLE_MAPPED_FILE_H__
+#define BOONDOGGLE_MAPPED_FILE_H__
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena_allocator.h"
+
+// All of a file mapped read only on Windows or POSIX, or read into memory so the file can be written over
+// while it's in use.
+class MappedFile
+{
+public:
+
+    MappedFile();
+
+    // Unmaps the file.
+    ~MappedFile();
+
+#if defined( _WIN32 )
+    // Map a file, or read it into memory if copy is set. Returns false if it couldn't be or is empty.
+    bool Open( const wchar_t* path, bool copy = false );
+#endif
+
+    // Map a file, or read it into memory if copy is set. Returns false if it couldn't be or is empty.
+    bool Open( const char* path, bool copy = false );
+
+    // Unmap (or free the copy of) the file.
+    void Close();
+
+    // The file's contents, nullptr if it isn't open.
+    const uint8_t* Data() const { return Data_; }
+
+    size_t Size() const { return Size_; }
+
+    // When the file was last written, in the platform's units, only for telling one version of a file from another.
+    uint64_t ModifiedTime() const { return ModifiedTime_; }
+
+    MappedFile( const MappedFile& ) = delete;
+
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+private:
+
+    const uint8_t* Data_;
+    size_t         Size_;
+    uint64_t       ModifiedTime_;
+    ArenaAllocator Copy_; // the file, if it was copied rather than mapped.
+};
+
+#endif // -- BOONDOGGLE_MAPPED_FILE_H__
@@ -0,0 +1,150 @@
+#include "package_reloader.h"
+#include <chrono>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined( _WIN32 )
+bool PackageReloader::Start( const wchar_t* path, LoadedPackage& spare, uint32_t pollMilliseconds )
+#else
+bool PackageReloader::Start( const char* path, LoadedPackage& spare, uint32_t pollMilliseconds )
+#endif
+{
+    Stop();
+
+    Path_ = path;
+
+    FileStamp seen;
+
+    if ( !ReadStamp( seen ) )
+    {
+        return false;
+    }
+
+    Spare_            = &spare;
+    Stopping_         = false;
+    PollMilliseconds_ = pollMilliseconds;
+    Worker_           = std::thread( &PackageReloader::Watch, this, seen );
+
+    return true;
+}
+
+void PackageReloader::Stop()
+{
+    if ( !Worker_.joinable() )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard< std::mutex > lock( Mutex_ );
+
+        Stopping_ = true;
+    }
+
+    Wake_.notify_one();
+    Worker_.join();
+
+    Spare_ = nullptr;
+    Ready_.store( nullptr );
+}
+
+void PackageReloader::Recycle( LoadedPackage& spare )
+{
+    spare.Resources.Release();
+    spare.View.Close();
+
+    std::lock_guard< std::mutex > lock( Mutex_ );
+
+    Spare_ = &spare;
+}
+
+bool PackageReloader::ReadStamp( FileStamp& stamp ) const
+{
+#if defined( _WIN32 )
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+    if ( !::GetFileAttributesExW( Path_.c_str(), GetFileExInfoStandard, &attributes ) )
+    {
+        return false;
+    }
+
+    stamp.Size         = ( static_cast< uint64_t >( attributes.nFileSizeHigh ) << 32 ) | attributes.nFileSizeLow;
+    stamp.ModifiedTime = ( static_cast< uint64_t >( attributes.ftLastWriteTime.dwHighDateTime ) << 32 ) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat fileStat;
+
+    if ( ::stat( Path_.c_str(), &fileStat ) != 0 )
+    {
+        return false;
+    }
+
+    stamp.Size         = static_cast< uint64_t >( fileStat.st_size );
+    stamp.ModifiedTime = static_cast< uint64_t >( fileStat.st_mtime ) * 1000000000;
+
+#if defined( __linux__ )
+    stamp.ModifiedTime += static_cast< uint64_t >( fileStat.st_mtim.tv_nsec );
+#endif
+#endif
+
+    return true;
+}
+
+bool PackageReloader::Open( PackageView& view ) const
+{
+    return view.Open( Path_.c_str(), PACKAGE_OPEN_COPY | PACKAGE_OPEN_CACHE_VERDICT );
+}
+
+void PackageReloader::Watch( FileStamp seen )
+{
+    std::unique_lock< std::mutex > lock( Mutex_ );
+
+    FileStamp settling = seen;
+
+    while ( !Stopping_ )
+    {
+        Wake_.wait_for( lock, std::chrono::milliseconds( PollMilliseconds_ ) );
+
+        FileStamp stamp;
+
+        // Nothing to load into until the last load is handed back, and a file that's missing is probably
+        // being replaced.
+        if ( Stopping_ || Spare_ == nullptr || !ReadStamp( stamp ) || stamp == seen )
+        {
+            settling = seen;
+            continue;
+        }
+
+        // Wait for a poll where it didn't change, it's likely still being written otherwise.
+        if ( stamp != settling )
+        {
+            settling = stamp;
+            continue;
+        }
+
+        LoadedPackage* spare = Spare_;
+
+        // A version that doesn't load isn't tried again, the next write will be noticed.
+        seen = stamp;
+
+        lock.unlock();
+
+        bool loaded = Open( spare->View );
+
+        if ( loaded )
+        {
+            spare->Resources.Prepare( spare->View );
+        }
+
+        lock.lock();
+
+        if ( loaded )
+        {
+            Spare_ = nullptr;
+            Ready_.store( spare );
+        }
+    }
+}
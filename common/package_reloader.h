@@ -0,0 +1,94 @@
+#ifndef BOONDOGGLE_PACKAGE_RELOADER_H__
+#define BOONDOGGLE_PACKAGE_RELOADER_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "package_view.h"
+#include "package_resources.h"
+
+// A package and its resources, what a reload produces.
+struct LoadedPackage
+{
+    PackageView      View;
+    PackageResources Resources;
+};
+
+// Watches a package file on a worker thread. When the file changes, and has then stayed the same for a poll so
+// it isn't read half written, the new version is loaded into a spare LoadedPackage: copied into memory (so the
+// file can be written again while it's in use), validated, decompressed and with its resources prepared, so all
+// that's left is to create the resources that changed and swap it in between frames.
+class PackageReloader
+{
+public:
+
+    PackageReloader() : Spare_( nullptr ), Ready_( nullptr ), Stopping_( false ), PollMilliseconds_( 0 ) {}
+
+    // Stops watching.
+    ~PackageReloader() { Stop(); }
+
+#if defined( _WIN32 )
+    // Start watching a package file, with the version there now counting as seen, loading new versions into
+    // spare. Returns false if the file isn't there.
+    bool Start( const wchar_t* path, LoadedPackage& spare, uint32_t pollMilliseconds = 250 );
+#else
+    // Start watching a package file, with the version there now counting as seen, loading new versions into
+    // spare. Returns false if the file isn't there.
+    bool Start( const char* path, LoadedPackage& spare, uint32_t pollMilliseconds = 250 );
+#endif
+
+    // Stop watching, waiting for any load in progress.
+    void Stop();
+
+    // Take the newly loaded package if there's one, otherwise nullptr. Never blocks or allocates, so it can be
+    // checked every frame. The package is the caller's until it's handed back to Recycle.
+    LoadedPackage* TakeReady() { return Ready_.exchange( nullptr ); }
+
+    // Hand back a package to load the next version into (the one a reload replaced, or one that was rejected),
+    // releasing its resources and closing it, and carry on watching.
+    void Recycle( LoadedPackage& spare );
+
+    PackageReloader( const PackageReloader& ) = delete;
+
+    PackageReloader& operator=( const PackageReloader& ) = delete;
+
+private:
+
+    // Enough of a file's identity to tell it's been written.
+    struct FileStamp
+    {
+        uint64_t Size;
+        uint64_t ModifiedTime;
+
+        bool operator==( const FileStamp& other ) const { return Size == other.Size && ModifiedTime == other.ModifiedTime; }
+
+        bool operator!=( const FileStamp& other ) const { return !( *this == other ); }
+    };
+
+    bool ReadStamp( FileStamp& stamp ) const;
+
+    bool Open( PackageView& view ) const;
+
+    // The worker thread.
+    void Watch( FileStamp seen );
+
+#if defined( _WIN32 )
+    std::wstring                  Path_;
+#else
+    std::string                   Path_;
+#endif
+    LoadedPackage*                Spare_; // what to load into, null while the caller has it.
+    std::atomic< LoadedPackage* > Ready_;
+    bool                          Stopping_;
+    uint32_t                      PollMilliseconds_;
+    std::mutex                    Mutex_; // guards Spare_ and Stopping_.
+    std::condition_variable       Wake_;
+    std::thread                   Worker_;
+};
+
+#endif // -- BOONDOGGLE_PACKAGE_RELOADER_H__
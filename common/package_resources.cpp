@@ -0,0 +1,172 @@
+#include "package_resources.h"
+#include "content_hash.h"
+#include <unordered_map>
+
+namespace
+{
+    uint64_t PayloadKey( const PackageBlob& blob )
+    {
+        return ContentHash64( blob.Data, blob.Size, blob.Size );
+    }
+
+    // A procedural texture's target only depends on its size and format, what's drawn into it is rendered again.
+    uint64_t ProceduralKey( const ProceduralTexture& procedural )
+    {
+        uint32_t description[ 4 ] =
+        {
+            procedural.Width,
+            procedural.Height,
+            static_cast< uint32_t >( procedural.Format ),
+            procedural.GenerateMipMaps ? 1U : 0U
+        };
+
+        return ContentHash64( description, sizeof( description ) );
+    }
+}
+
+
+void PackageResources::Prepare( const PackageView& package )
+{
+    Release();
+
+    PackageBlobSpan                  shaders     = package.Shaders();
+    PackageBlobSpan                  textures    = package.StaticTextures();
+    PackageSpan< ProceduralTexture > procedurals = package.ProceduralTextures();
+    PackageSpan< Sampler >           samplers    = package.Samplers();
+
+    for ( uint32_t shaderIndex = 0; shaderIndex < shaders.Count(); ++shaderIndex )
+    {
+        Resource resource = { PayloadKey( shaders[ shaderIndex ] ), nullptr };
+
+        Resources_[ static_cast< uint32_t >( PackageResourceKinds::PIXEL_SHADER ) ].push_back( resource );
+    }
+
+    Resource vertexShader = { PayloadKey( package.ScreenAlignedQuadVS() ), nullptr };
+
+    Resources_[ static_cast< uint32_t >( PackageResourceKinds::VERTEX_SHADER ) ].push_back( vertexShader );
+
+    for ( uint32_t textureIndex = 0; textureIndex < textures.Count(); ++textureIndex )
+    {
+        Resource resource = { PayloadKey( textures[ textureIndex ] ), nullptr };
+
+        Resources_[ static_cast< uint32_t >( PackageResourceKinds::STATIC_TEXTURE ) ].push_back( resource );
+    }
+
+    for ( const ProceduralTexture& procedural : procedurals )
+    {
+        Resource resource = { ProceduralKey( procedural ), nullptr };
+
+        Resources_[ static_cast< uint32_t >( PackageResourceKinds::PROCEDURAL_TEXTURE ) ].push_back( resource );
+    }
+
+    for ( const Sampler& sampler : samplers )
+    {
+        Resource resource = { ContentHash64( &sampler, sizeof( Sampler ) ), nullptr };
+
+        Resources_[ static_cast< uint32_t >( PackageResourceKinds::SAMPLER ) ].push_back( resource );
+    }
+}
+
+
+bool PackageResources::Create( PackageResourceBackend& backend, const PackageView& package, PackageResources* previous )
+{
+    const uint32_t NOT_REUSED = UINT32_MAX;
+
+    // Resources can only move over from a set made by the same backend.
+    if ( previous != nullptr && previous->Backend_ != &backend )
+    {
+        previous = nullptr;
+    }
+
+    std::vector< uint32_t > reusedFrom[ PACKAGE_RESOURCE_KIND_COUNT ];
+    bool                    failed = false;
+
+    Backend_      = &backend;
+    CreatedCount_ = 0;
+    ReusedCount_  = 0;
+
+    for ( uint32_t kind = 0; kind < PACKAGE_RESOURCE_KIND_COUNT && !failed; ++kind )
+    {
+        // Each of the previous resources can be taken once, by the first new resource with its key.
+        std::unordered_multimap< uint64_t, uint32_t > available;
+
+        for ( uint32_t index = 0; previous != nullptr && index < previous->Resources_[ kind ].size(); ++index )
+        {
+            if ( previous->Resources_[ kind ][ index ].Handle != nullptr )
+            {
+                available.insert( std::make_pair( previous->Resources_[ kind ][ index ].Key, index ) );
+            }
+        }
+
+        reusedFrom[ kind ].assign( Resources_[ kind ].size(), NOT_REUSED );
+
+        for ( uint32_t index = 0; index < Resources_[ kind ].size(); ++index )
+        {
+            Resource& resource = Resources_[ kind ][ index ];
+            auto      match    = available.find( resource.Key );
+
+            if ( match != available.end() )
+            {
+                resource.Handle             = previous->Resources_[ kind ][ match->second ].Handle;
+                reusedFrom[ kind ][ index ] = match->second;
+
+                available.erase( match );
+                ++ReusedCount_;
+                continue;
+            }
+
+            resource.Handle = backend.Create( package, static_cast< PackageResourceKinds >( kind ), index );
+
+            if ( resource.Handle == nullptr )
+            {
+                FailedKind_ = static_cast< PackageResourceKinds >( kind );
+                failed      = true;
+                break;
+            }
+
+            ++CreatedCount_;
+        }
+    }
+
+    for ( uint32_t kind = 0; kind < PACKAGE_RESOURCE_KIND_COUNT; ++kind )
+    {
+        for ( uint32_t index = 0; index < reusedFrom[ kind ].size(); ++index )
+        {
+            Resource& resource = Resources_[ kind ][ index ];
+
+            if ( failed )
+            {
+                // Only release what was made here, what would have been reused stays with previous.
+                if ( resource.Handle != nullptr && reusedFrom[ kind ][ index ] == NOT_REUSED )
+                {
+                    backend.Release( static_cast< PackageResourceKinds >( kind ), resource.Handle );
+                }
+
+                resource.Handle = nullptr;
+            }
+            else if ( reusedFrom[ kind ][ index ] != NOT_REUSED )
+            {
+                previous->Resources_[ kind ][ reusedFrom[ kind ][ index ] ].Handle = nullptr;
+            }
+        }
+    }
+
+    return !failed;
+}
+
+
+void PackageResources::Release()
+{
+    for ( uint32_t kind = 0; kind < PACKAGE_RESOURCE_KIND_COUNT; ++kind )
+    {
+        for ( Resource& resource : Resources_[ kind ] )
+        {
+            if ( resource.Handle != nullptr )
+            {
+                Backend_->Release( static_cast< PackageResourceKinds >( kind ), resource.Handle );
+            }
+        }
+
+        Resources_[ kind ].clear();
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef BOONDOGGLE_PACKAGE_RESOURCES_H__
+#define BOONDOGGLE_PACKAGE_RESOURCES_H__
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "package_view.h"
+
+// Kinds of device object made from a package.
+enum class PackageResourceKinds : uint32_t
+{
+    PIXEL_SHADER       = 0,
+    VERTEX_SHADER      = 1, // the screen aligned quad, there's only one.
+    STATIC_TEXTURE     = 2,
+    PROCEDURAL_TEXTURE = 3, // a render target and a view of it for reading.
+    SAMPLER            = 4
+};
+
+const uint32_t PACKAGE_RESOURCE_KIND_COUNT = 5;
+
+// Makes and releases the device objects for a package's resources, D3D11 in the runtime. Keeping the device
+// behind this lets reloading be exercised with a mock one, where there's no D3D.
+class PackageResourceBackend
+{
+public:
+
+    virtual ~PackageResourceBackend() {}
+
+    // Create the resource of a kind at an index in a package with its payloads loaded, returns nullptr on failure.
+    virtual void* Create( const PackageView& package, PackageResourceKinds kind, uint32_t index ) = 0;
+
+    // Release a resource made by Create.
+    virtual void Release( PackageResourceKinds kind, void* resource ) = 0;
+};
+
+// The device objects for each of a package's resources, each with a key from what it's made of (the hash of its
+// payload, or its description). When a package is reloaded, resources with the same key move over from the old
+// set and only the ones that changed are created.
+class PackageResources
+{
+public:
+
+    PackageResources() : Backend_( nullptr ), FailedKind_( PackageResourceKinds::PIXEL_SHADER ), CreatedCount_( 0 ), ReusedCount_( 0 ) {}
+
+    ~PackageResources() { Release(); }
+
+    // Work out the key of each of a package's resources, which needs its payloads loaded. Hashing the payloads
+    // is most of the work of a reload, so this can be done on another thread before Create.
+    void Prepare( const PackageView& package );
+
+    // Create the resources of the package this was prepared for, moving over any with the same key from previous
+    // (which can be null), which keeps the rest. Returns false if one couldn't be created, in which case the
+    // ones that were are released and previous is left as it was.
+    bool Create( PackageResourceBackend& backend, const PackageView& package, PackageResources* previous );
+
+    // Release the resources and forget the keys.
+    void Release();
+
+    uint32_t Count( PackageResourceKinds kind ) const { return static_cast< uint32_t >( Resources_[ static_cast< uint32_t >( kind ) ].size() ); }
+
+    // The resource of a kind at an index, which must be in range.
+    void* Get( PackageResourceKinds kind, uint32_t index ) const { return Resources_[ static_cast< uint32_t >( kind ) ][ index ].Handle; }
+
+    // Resources the last Create made and took from the previous set.
+    uint32_t CreatedCount() const { return CreatedCount_; }
+
+    uint32_t ReusedCount() const { return ReusedCount_; }
+
+    // The kind of resource that failed, if Create did.
+    PackageResourceKinds FailedKind() const { return FailedKind_; }
+
+    PackageResources( const PackageResources& ) = delete;
+
+    PackageResources& operator=( const PackageResources& ) = delete;
+
+private:
+
+    struct Resource
+    {
+        uint64_t Key;
+        void*    Handle;
+    };
+
+    std::vector< Resource > Resources_[ PACKAGE_RESOURCE_KIND_COUNT ];
+    PackageResourceBackend* Backend_; // what made the resources.
+    PackageResourceKinds    FailedKind_;
+    uint32_t                CreatedCount_;
+    uint32_t                ReusedCount_;
+};
+
+#endif // -- BOONDOGGLE_PACKAGE_RESOURCES_H__
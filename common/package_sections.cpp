@@ -0,0 +1,239 @@
+#include "package_sections.h"
+#include "block_compression.h"
+#include "content_hash.h"
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Decompress a block and/or hash its stored bytes.
+    struct SectionJob
+    {
+        const uint8_t* Source;
+        uint32_t       StoredSize;
+        uint8_t*       Destination; // null to only hash.
+        uint32_t       Size;
+        uint64_t*      Hashes;      // one per SECTION_BLOCK_SIZE of the stored bytes, null to only decompress.
+    };
+
+    // Most threads used to decompress, including the loading thread.
+    const uint32_t MAX_DECOMPRESSION_THREADS = 16;
+
+    uint32_t HashCount( uint32_t storedSize )
+    {
+        return static_cast< uint32_t >( ( static_cast< uint64_t >( storedSize ) + SECTION_BLOCK_SIZE - 1 ) / SECTION_BLOCK_SIZE );
+    }
+
+    void HashStoredBytes( const uint8_t* source, uint32_t storedSize, uint64_t* hashes )
+    {
+        for ( uint32_t offset = 0; offset < storedSize; offset += SECTION_BLOCK_SIZE )
+        {
+            uint32_t size = storedSize - offset;
+
+            *hashes++ = ContentHash64( source + offset, size < SECTION_BLOCK_SIZE ? size : SECTION_BLOCK_SIZE );
+        }
+    }
+
+    // Take jobs until they run out, or one fails. Blocks are hashed before decompressing, while they're in cache.
+    void RunSectionJobs( const SectionJob* jobs, uint32_t jobCount, std::atomic< uint32_t >* nextJob, std::atomic< bool >* failed )
+    {
+        for ( uint32_t jobIndex = nextJob->fetch_add( 1 ); jobIndex < jobCount && !failed->load(); jobIndex = nextJob->fetch_add( 1 ) )
+        {
+            const SectionJob& job = jobs[ jobIndex ];
+
+            if ( job.Hashes != nullptr )
+            {
+                HashStoredBytes( job.Source, job.StoredSize, job.Hashes );
+            }
+
+            if ( job.Destination == nullptr )
+            {
+                continue;
+            }
+
+            if ( job.StoredSize == job.Size )
+            {
+                ::memcpy( job.Destination, job.Source, job.Size );
+            }
+            else if ( !DecompressBlock( job.Source, job.StoredSize, job.Destination, job.Size ) )
+            {
+                failed->store( true );
+            }
+        }
+    }
+}
+
+
+uint64_t HashSection( const PackageSection& section )
+{
+    std::vector< uint64_t > hashes;
+
+    for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
+    {
+        const SectionBlock& block     = section.Blocks[ blockIndex ];
+        size_t              firstHash = hashes.size();
+
+        hashes.resize( firstHash + HashCount( block.StoredSize ) );
+
+        HashStoredBytes( block.Data.Raw(), block.StoredSize, hashes.data() + firstHash );
+    }
+
+    return ContentHash64( hashes.data(), hashes.size() * sizeof( uint64_t ) );
+}
+
+
+bool PackageSections::Load( const BoondogglePackageHeader& package, bool verifyHashes )
+{
+    Release();
+
+    Package_ = &package;
+
+    if ( package.Version != CodeVersions::VERSION_2_0 )
+    {
+        return true;
+    }
+
+    size_t   decompressedSize = 0;
+    uint32_t jobCount         = 0;
+    uint32_t hashCount        = 0;
+
+    for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        const PackageSection& section = package.Sections[ sectionIndex ];
+
+        for ( uint32_t blockIndex = 0; verifyHashes && blockIndex < section.BlockCount; ++blockIndex )
+        {
+            hashCount += HashCount( section.Blocks[ blockIndex ].StoredSize );
+        }
+
+        if ( section.Codec == SectionCodecs::NONE )
+        {
+            // Uncompressed sections only need hashing, a job for each piece so big sections still spread out.
+            Sections_[ sectionIndex ] = section.Blocks[ 0 ].Data.Raw();
+            jobCount                 += verifyHashes ? HashCount( section.Size ) : 0;
+        }
+        else
+        {
+            decompressedSize += section.Size;
+            jobCount         += section.BlockCount;
+        }
+    }
+
+    if ( jobCount == 0 && !verifyHashes )
+    {
+        return true;
+    }
+
+    if ( !Memory_.Initialize( "package sections",
+                              decompressedSize + sizeof( SectionJob ) * jobCount + sizeof( uint64_t ) * hashCount + 64 * ( PACKAGE_SECTION_COUNT + 2 ) ) )
+    {
+        return false;
+    }
+
+    SectionJob* jobs       = Memory_.Allocate< SectionJob >( jobCount );
+    uint64_t*   hashes     = verifyHashes ? Memory_.Allocate< uint64_t >( hashCount ) : nullptr;
+    uint32_t    jobIndex   = 0;
+    uint64_t*   nextHashes = hashes;
+
+    for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        const PackageSection& section = package.Sections[ sectionIndex ];
+
+        if ( section.Codec == SectionCodecs::NONE )
+        {
+            for ( uint32_t offset = 0; verifyHashes && offset < section.Size; offset += SECTION_BLOCK_SIZE, ++jobIndex, ++nextHashes )
+            {
+                uint32_t pieceSize = section.Size - offset;
+
+                jobs[ jobIndex ].Source      = section.Blocks[ 0 ].Data.Raw() + offset;
+                jobs[ jobIndex ].StoredSize  = pieceSize < SECTION_BLOCK_SIZE ? pieceSize : SECTION_BLOCK_SIZE;
+                jobs[ jobIndex ].Destination = nullptr;
+                jobs[ jobIndex ].Size        = 0;
+                jobs[ jobIndex ].Hashes      = nextHashes;
+            }
+
+            continue;
+        }
+
+        uint8_t* sectionMemory = reinterpret_cast< uint8_t* >( Memory_.Allocate( section.Size, 64 ) );
+
+        if ( sectionMemory == nullptr )
+        {
+            return false;
+        }
+
+        Sections_[ sectionIndex ] = sectionMemory;
+
+        for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex, ++jobIndex )
+        {
+            const SectionBlock& block     = section.Blocks[ blockIndex ];
+            uint32_t            blockStart = blockIndex * SECTION_BLOCK_SIZE;
+            uint32_t            blockSize  = section.Size - blockStart;
+
+            jobs[ jobIndex ].Source      = block.Data.Raw();
+            jobs[ jobIndex ].StoredSize  = block.StoredSize;
+            jobs[ jobIndex ].Destination = sectionMemory + blockStart;
+            jobs[ jobIndex ].Size        = blockSize < SECTION_BLOCK_SIZE ? blockSize : SECTION_BLOCK_SIZE;
+            jobs[ jobIndex ].Hashes      = verifyHashes ? nextHashes : nullptr;
+
+            nextHashes += verifyHashes ? HashCount( block.StoredSize ) : 0;
+        }
+    }
+
+    std::atomic< uint32_t > nextJob( 0 );
+    std::atomic< bool >     failed( false );
+    std::thread             workers[ MAX_DECOMPRESSION_THREADS - 1 ];
+    uint32_t                threadCount = std::thread::hardware_concurrency();
+
+    threadCount = threadCount < jobCount ? threadCount : jobCount;
+    threadCount = threadCount < MAX_DECOMPRESSION_THREADS ? threadCount : MAX_DECOMPRESSION_THREADS;
+
+    for ( uint32_t workerIndex = 1; workerIndex < threadCount; ++workerIndex )
+    {
+        workers[ workerIndex - 1 ] = std::thread( RunSectionJobs, jobs, jobCount, &nextJob, &failed );
+    }
+
+    RunSectionJobs( jobs, jobCount, &nextJob, &failed );
+
+    for ( uint32_t workerIndex = 1; workerIndex < threadCount; ++workerIndex )
+    {
+        workers[ workerIndex - 1 ].join();
+    }
+
+    if ( failed.load() )
+    {
+        return false;
+    }
+
+    // The hashes were filled in section by section, so each section's are together.
+    for ( uint32_t sectionIndex = 0; verifyHashes && sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        const PackageSection& section       = package.Sections[ sectionIndex ];
+        uint32_t              sectionHashes = 0;
+
+        for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
+        {
+            sectionHashes += HashCount( section.Blocks[ blockIndex ].StoredSize );
+        }
+
+        if ( ContentHash64( hashes, sectionHashes * sizeof( uint64_t ) ) != package.SectionHashes[ sectionIndex ] )
+        {
+            return false;
+        }
+
+        hashes += sectionHashes;
+    }
+
+    return true;
+}
+
+void PackageSections::Release()
+{
+    Memory_.Release();
+
+    Package_ = nullptr;
+
+    ::memset( Sections_, 0, sizeof( Sections_ ) );
+}
@@ -0,0 +1,52 @@
+#ifndef BOONDOGGLE_PACKAGE_SECTIONS_H__
+#define BOONDOGGLE_PACKAGE_SECTIONS_H__
+
+#pragma once
+
+#include <stdint.h>
+#include "binary_effects_format.h"
+#include "arena_allocator.h"
+
+// Hash of a version 2 section as stored, which is the hash of the hashes of its blocks' stored bytes taken
+// SECTION_BLOCK_SIZE bytes at a time. Hashing the pieces separately lets loading hash them in parallel, in the
+// same pass that decompresses them.
+uint64_t HashSection( const PackageSection& section );
+
+// The data sections of a loaded package, where resource blob payloads live. Uncompressed sections are used in
+// place in the package, compressed ones are decompressed into memory owned by this, with their blocks spread
+// over worker threads. Version 1.1 packages have no sections, their blobs point straight at their payloads.
+class PackageSections
+{
+public:
+
+    PackageSections() : Package_( nullptr ), Sections_() {}
+
+    // Get the sections of a validated package, which must outlive this, releasing those of any previous package.
+    // With verifyHashes every section of a version 2 package is hashed as it's read and checked against the
+    // package's section hashes. Returns false if a block doesn't decompress, a hash doesn't match or there
+    // isn't the memory to decompress into.
+    bool Load( const BoondogglePackageHeader& package, bool verifyHashes );
+
+    // Release the decompressed sections, blobs from them can't be used after this.
+    void Release();
+
+    // Payload of one of the package's blobs, from the data section it's in.
+    const uint8_t* BlobData( const ResourceBlob& blob, PackageSectionTypes dataSection ) const
+    {
+        return Package_->Version != CodeVersions::VERSION_2_0 ?
+            blob.Data.Raw() :
+            Sections_[ static_cast< uint32_t >( dataSection ) ] + blob.Data.RelativeAddress;
+    }
+
+    PackageSections( const PackageSections& ) = delete;
+
+    PackageSections& operator=( const PackageSections& ) = delete;
+
+private:
+
+    const BoondogglePackageHeader* Package_;
+    const uint8_t*                 Sections_[ PACKAGE_SECTION_COUNT ];
+    ArenaAllocator                 Memory_; // decompressed sections, only initialized if there are any.
+};
+
+#endif // -- BOONDOGGLE_PACKAGE_SECTIONS_H__
@@ -0,0 +1,283 @@
+#include "package_view.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// The record of a deep validated package, kept in "<package>.verified".
+struct PackageVerdict
+{
+    uint32_t MagicCode;
+    uint32_t Version;
+    uint64_t FileSize;
+    uint64_t ModifiedTime;
+    uint64_t SectionHashes[ PACKAGE_SECTION_COUNT ];
+};
+
+namespace
+{
+    const uint32_t VERDICT_MAGIC_CODE = 0xEA7B7E57;
+    const uint32_t VERDICT_VERSION    = 1;
+
+    // Read a verdict file, closing it. False if it couldn't be opened or isn't a verdict.
+    bool ReadVerdict( FILE* file, PackageVerdict& verdict )
+    {
+        if ( file == nullptr )
+        {
+            return false;
+        }
+
+        bool result = ::fread( &verdict, sizeof( verdict ), 1, file ) == 1 &&
+                      verdict.MagicCode == VERDICT_MAGIC_CODE &&
+                      verdict.Version == VERDICT_VERSION;
+
+        ::fclose( file );
+
+        return result;
+    }
+
+    // Write a verdict file, closing it. Failing to is fine, the package is just deep validated next time.
+    void WriteVerdict( FILE* file, const PackageVerdict& verdict )
+    {
+        if ( file != nullptr )
+        {
+            ::fwrite( &verdict, sizeof( verdict ), 1, file );
+            ::fclose( file );
+        }
+    }
+
+    // Open the verdict file next to a package.
+    FILE* OpenVerdict( const char* packagePath, bool write )
+    {
+        return ::fopen( ( std::string( packagePath ) + ".verified" ).c_str(), write ? "wb" : "rb" );
+    }
+
+#if defined( _WIN32 )
+    FILE* OpenVerdict( const wchar_t* packagePath, bool write )
+    {
+        return ::_wfopen( ( std::wstring( packagePath ) + L".verified" ).c_str(), write ? L"wb" : L"rb" );
+    }
+
+    // PrefetchVirtualMemory is Windows 8 and up, so it's looked up rather than linked.
+    struct PrefetchRangeEntry
+    {
+        void*  VirtualAddress;
+        size_t NumberOfBytes;
+    };
+
+    typedef BOOL ( WINAPI *PrefetchVirtualMemoryFunction )( HANDLE, ULONG_PTR, PrefetchRangeEntry*, ULONG );
+
+    void PrefetchRange( const uint8_t* start, size_t size )
+    {
+        static PrefetchVirtualMemoryFunction prefetchVirtualMemory =
+            reinterpret_cast< PrefetchVirtualMemoryFunction >( ::GetProcAddress( ::GetModuleHandleW( L"kernel32.dll" ), "PrefetchVirtualMemory" ) );
+
+        PrefetchRangeEntry range = { const_cast< uint8_t* >( start ), size };
+
+        if ( prefetchVirtualMemory != nullptr && size > 0 )
+        {
+            prefetchVirtualMemory( ::GetCurrentProcess(), 1, &range, 0 );
+        }
+    }
+#else
+    void PrefetchRange( const uint8_t* start, size_t size )
+    {
+        uintptr_t pageMask  = static_cast< uintptr_t >( ::sysconf( _SC_PAGESIZE ) ) - 1;
+        uintptr_t pageStart = reinterpret_cast< uintptr_t >( start ) & ~pageMask;
+
+        if ( size > 0 )
+        {
+            ::madvise( reinterpret_cast< void* >( pageStart ), reinterpret_cast< uintptr_t >( start ) + size - pageStart, MADV_WILLNEED );
+        }
+    }
+#endif
+}
+
+PackageView::PackageView() : Header_( nullptr ), Trusted_( false ), Outdated_( false )
+{
+}
+
+PackageView::~PackageView()
+{
+    Close();
+}
+
+template < typename CharType >
+bool PackageView::OpenFile( const CharType* path, uint32_t flags )
+{
+    Close();
+
+    PackageVerdict cached;
+    PackageVerdict verified;
+    bool           useCache = ( flags & PACKAGE_OPEN_CACHE_VERDICT ) != 0;
+
+    File_.Open( path, ( flags & PACKAGE_OPEN_COPY ) != 0 );
+
+    if ( !Load( flags, useCache && ReadVerdict( OpenVerdict( path, false ), cached ) ? &cached : nullptr, verified ) )
+    {
+        return false;
+    }
+
+    if ( useCache && !Trusted_ && Header_->Version == CodeVersions::VERSION_2_0 )
+    {
+        WriteVerdict( OpenVerdict( path, true ), verified );
+    }
+
+    return true;
+}
+
+#if defined( _WIN32 )
+
+bool PackageView::Open( const wchar_t* path, uint32_t flags )
+{
+    return OpenFile( path, flags );
+}
+
+#endif
+
+bool PackageView::Open( const char* path, uint32_t flags )
+{
+    return OpenFile( path, flags );
+}
+
+void PackageView::Close()
+{
+    Sections_.Release();
+    File_.Close();
+
+    Header_   = nullptr;
+    Trusted_  = false;
+    Outdated_ = false;
+}
+
+bool PackageView::Load( uint32_t flags, const PackageVerdict* cached, PackageVerdict& verified )
+{
+    const BoondogglePackageHeader* header   = reinterpret_cast< const BoondogglePackageHeader* >( File_.Data() );
+    const uint8_t*                 end      = File_.Data() + File_.Size();
+    bool                           prefetch = ( flags & PACKAGE_OPEN_PREFETCH ) != 0;
+
+    if ( header == nullptr || !ValidatePackageHeader( *header, end ) )
+    {
+        bool outdated = header != nullptr && IsPackageOutdated( *header, end );
+
+        Close();
+
+        Outdated_ = outdated;
+        return false;
+    }
+
+    // The verdict vouches for the structure only while the metadata is what was validated, which is small
+    // enough to check every time. The data sections are taken on trust.
+    Trusted_ = cached != nullptr &&
+               header->Version == CodeVersions::VERSION_2_0 &&
+               cached->FileSize == File_.Size() &&
+               cached->ModifiedTime == File_.ModifiedTime() &&
+               ::memcmp( cached->SectionHashes, header->SectionHashes.Raw(), sizeof( cached->SectionHashes ) ) == 0 &&
+               HashSection( header->Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ] ) ==
+                   header->SectionHashes[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ];
+
+    if ( !Trusted_ && !ValidatePackage( *header, end ) )
+    {
+        Close();
+        return false;
+    }
+
+    Header_ = header;
+
+    // Validation has paged in the metadata, so start the data on its way before decompressing any of it.
+    if ( prefetch && header->Version != CodeVersions::VERSION_2_0 )
+    {
+        Prefetch( PackageSectionTypes::METADATA );
+    }
+    else if ( prefetch )
+    {
+        Prefetch( PackageSectionTypes::SHADER_DATA );
+        Prefetch( PackageSectionTypes::TEXTURE_DATA );
+    }
+
+    if ( !Sections_.Load( *header, !Trusted_ ) )
+    {
+        Close();
+        return false;
+    }
+
+    if ( header->Version == CodeVersions::VERSION_2_0 )
+    {
+        verified.MagicCode    = VERDICT_MAGIC_CODE;
+        verified.Version      = VERDICT_VERSION;
+        verified.FileSize     = File_.Size();
+        verified.ModifiedTime = File_.ModifiedTime();
+
+        ::memcpy( verified.SectionHashes, header->SectionHashes.Raw(), sizeof( verified.SectionHashes ) );
+    }
+
+    return true;
+}
+
+PackageBlobSpan PackageView::Shaders() const
+{
+    return PackageBlobSpan( PackageSpan< ResourceBlob >( Header_->Shaders.Raw(), Header_->ShaderCount ), Sections_, PackageSectionTypes::SHADER_DATA );
+}
+
+PackageBlobSpan PackageView::StaticTextures() const
+{
+    return PackageBlobSpan( PackageSpan< ResourceBlob >( Header_->StaticTextures.Raw(), Header_->StaticTextureCount ), Sections_, PackageSectionTypes::TEXTURE_DATA );
+}
+
+PackageBlob PackageView::ScreenAlignedQuadVS() const
+{
+    PackageBlob result = { Sections_.BlobData( Header_->ScreenAlignedQuadVS, PackageSectionTypes::SHADER_DATA ), Header_->ScreenAlignedQuadVS.ResourceSize };
+
+    return result;
+}
+
+PackageSpan< ProceduralTexture > PackageView::ProceduralTextures() const
+{
+    return PackageSpan< ProceduralTexture >( Header_->ProceduralTextures.Raw(), Header_->ProceduralTextureCount );
+}
+
+PackageSpan< Sampler > PackageView::Samplers() const
+{
+    return PackageSpan< Sampler >( Header_->Samplers.Raw(), Header_->SamplerCount );
+}
+
+PackageSpan< VisualEffect > PackageView::Effects() const
+{
+    return PackageSpan< VisualEffect >( Header_->Effects.Raw(), Header_->EffectCount );
+}
+
+void PackageView::Prefetch( PackageSectionTypes sectionType ) const
+{
+    if ( Header_->Version != CodeVersions::VERSION_2_0 )
+    {
+        PrefetchRange( File_.Data(), File_.Size() );
+        return;
+    }
+
+    // The blocks of a section are normally contiguous, but prefetch whatever range they span.
+    const PackageSection& section = Header_->Sections[ static_cast< uint32_t >( sectionType ) ];
+    const uint8_t*        start   = File_.Data() + File_.Size();
+    const uint8_t*        end     = File_.Data();
+
+    for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
+    {
+        const SectionBlock& block = section.Blocks[ blockIndex ];
+
+        if ( block.StoredSize > 0 )
+        {
+            start = block.Data.Raw() < start ? block.Data.Raw() : start;
+            end   = block.Data.Raw() + block.StoredSize > end ? block.Data.Raw() + block.StoredSize : end;
+        }
+    }
+
+    if ( start < end )
+    {
+        PrefetchRange( start, static_cast< size_t >( end - start ) );
+    }
+}
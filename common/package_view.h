@@ -0,0 +1,183 @@
+#ifndef BOONDOGGLE_PACKAGE_VIEW_H__
+#define BOONDOGGLE_PACKAGE_VIEW_H__
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "binary_effects_format.h"
+#include "package_sections.h"
+#include "mapped_file.h"
+
+// A bounds checked array of objects in a package.
+template < typename ElementType >
+class PackageSpan
+{
+public:
+
+    PackageSpan() : Data_( nullptr ), Count_( 0 ) {}
+
+    PackageSpan( const ElementType* data, uint32_t count ) : Data_( data ), Count_( count ) {}
+
+    uint32_t Count() const { return Count_; }
+
+    // The element at an index, nullptr if it's out of range.
+    const ElementType* At( uint32_t index ) const { return index < Count_ ? Data_ + index : nullptr; }
+
+    // The element at an index, which must be in range.
+    const ElementType& operator[]( uint32_t index ) const
+    {
+        assert( index < Count_ );
+
+        return Data_[ index ];
+    }
+
+    const ElementType* begin() const { return Data_; }
+
+    const ElementType* end() const { return Data_ + Count_; }
+
+private:
+
+    const ElementType* Data_;
+    uint32_t           Count_;
+};
+
+// The payload of a resource blob.
+struct PackageBlob
+{
+    const uint8_t* Data;
+    uint32_t       Size;
+};
+
+// A bounds checked array of resource blobs, giving their payloads.
+class PackageBlobSpan
+{
+public:
+
+    PackageBlobSpan( const PackageSpan< ResourceBlob >& blobs, const PackageSections& sections, PackageSectionTypes dataSection )
+        : Blobs_( blobs ), Sections_( &sections ), DataSection_( dataSection ) {}
+
+    uint32_t Count() const { return Blobs_.Count(); }
+
+    // The payload of the blob at an index, empty if it's out of range.
+    PackageBlob operator[]( uint32_t index ) const
+    {
+        const ResourceBlob* blob   = Blobs_.At( index );
+        PackageBlob         result = { nullptr, 0 };
+
+        if ( blob != nullptr )
+        {
+            result.Data = Sections_->BlobData( *blob, DataSection_ );
+            result.Size = blob->ResourceSize;
+        }
+
+        return result;
+    }
+
+private:
+
+    PackageSpan< ResourceBlob > Blobs_;
+    const PackageSections*      Sections_;
+    PackageSectionTypes         DataSection_;
+};
+
+// Flags for opening a PackageView.
+const uint32_t PACKAGE_OPEN_PREFETCH      = 1; // hint the OS to read the data sections in ahead of use.
+const uint32_t PACKAGE_OPEN_CACHE_VERDICT = 2; // trust and write a "<package>.verified" record of deep validation.
+const uint32_t PACKAGE_OPEN_COPY          = 4; // read the file into memory instead of mapping it, so it can be rewritten while open.
+const uint32_t PACKAGE_OPEN_DEFAULT       = PACKAGE_OPEN_PREFETCH | PACKAGE_OPEN_CACHE_VERDICT;
+
+struct PackageVerdict;
+
+// A memory mapped effects package, on Windows or POSIX. Opening validates the package once, hints the OS to
+// read the data sections in ahead of use and decompresses any compressed ones, after which everything in the
+// package can be read through the bounds checked spans without checking again.
+//
+// Deep validation of a version 2 package walks its structure and checks every section against its hash as
+// the sections are decompressed. A passing package gets a small verdict file next to it, and opening the same
+// file again (same size, modified time and section hashes, with the metadata hash checked every time) skips
+// the structure walk and hashing the data sections.
+class PackageView
+{
+public:
+
+    PackageView();
+
+    // Unmaps the file.
+    ~PackageView();
+
+#if defined( _WIN32 )
+    // Map and load a package with PACKAGE_OPEN flags, returns false if it couldn't be mapped, isn't valid
+    // or didn't decompress. Without prefetch the data sections are paged in as they're used.
+    bool Open( const wchar_t* path, uint32_t flags = PACKAGE_OPEN_DEFAULT );
+#endif
+
+    // Map and load a package with PACKAGE_OPEN flags, returns false if it couldn't be mapped, isn't valid
+    // or didn't decompress. Without prefetch the data sections are paged in as they're used.
+    bool Open( const char* path, uint32_t flags = PACKAGE_OPEN_DEFAULT );
+
+    // Unmap (or free the copy of) the file and release any decompressed sections.
+    void Close();
+
+    bool IsOpen() const { return Header_ != nullptr; }
+
+    const BoondogglePackageHeader& Header() const { return *Header_; }
+
+    // Size of the package file.
+    size_t Size() const { return File_.Size(); }
+
+    // True if the last open trusted a cached verdict rather than deep validating the package.
+    bool Trusted() const { return Trusted_; }
+
+    // True if the last open failed because the package is from an older version of the format and has to be
+    // recompiled.
+    bool Outdated() const { return Outdated_; }
+
+    PackageBlobSpan Shaders() const;
+
+    PackageBlobSpan StaticTextures() const;
+
+    PackageBlob ScreenAlignedQuadVS() const;
+
+    PackageSpan< ProceduralTexture > ProceduralTextures() const;
+
+    PackageSpan< Sampler > Samplers() const;
+
+    PackageSpan< VisualEffect > Effects() const;
+
+    // An array of indices from an effect or procedural texture, these are checked by validation too.
+    static PackageSpan< uint32_t > Indices( const Relative< uint32_t >& indices, uint32_t count )
+    {
+        return PackageSpan< uint32_t >( indices.Raw(), count );
+    }
+
+    // Hint the OS to read a section of the file in ahead of it being used (all of a version 1.1 package).
+    void Prefetch( PackageSectionTypes section ) const;
+
+    // Release the decompressed data sections once the payloads have been used (for creating resources),
+    // blobs can't be read after this.
+    void ReleasePayloads() { Sections_.Release(); }
+
+    PackageView( const PackageView& ) = delete;
+
+    PackageView& operator=( const PackageView& ) = delete;
+
+private:
+
+    // Map (or copy) the file and load it, reading and writing the verdict next to it as the flags ask.
+    template < typename CharType >
+    bool OpenFile( const CharType* path, uint32_t flags );
+
+    // Validate the mapped file (trusting the cached verdict if it matches) and load the sections, closing it on
+    // failure. Fills in the verdict to cache for a version 2 package that was deep validated.
+    bool Load( uint32_t flags, const PackageVerdict* cached, PackageVerdict& verified );
+
+    MappedFile                     File_;
+    const BoondogglePackageHeader* Header_;
+    bool                           Trusted_;
+    bool                           Outdated_;
+    PackageSections                Sections_;
+};
+
+#endif // -- BOONDOGGLE_PACKAGE_VIEW_H__
@@ -3,10 +3,17 @@
 #include "../external/json/json.h"
 #include <stdlib.h>
 #include <unordered_map>
+#include <vector>
 #include <d3dcompiler.h>
 #include "../common/binary_effects_format.h"
 #include "../common/boondoggle_helpers.h"
+#include "../common/arena_allocator.h"
+#include "../common/block_compression.h"
+#include "../common/content_hash.h"
+#include "../common/package_sections.h"
+#include "../boondoggle/shared_render_constants.h"
 #include <memory.h>
+#include <math.h>
 
 namespace
 {
@@ -276,115 +283,147 @@ namespace
     }
 
 
-    // Allocator that allocates a big hunk of address space
-    // and progressively commits it as we allocate it.
-    // Gives us a single chunk of memory to write to a file. 
+    // Arena for the package, which gives us a single chunk of memory to write to a file.
+    // Running out of room is fatal, so allocations never return null.
     struct OutputAllocator
     {
-        static const size_t AllocationSize  = 1024 * 1024 * 1024;
-        static const size_t CommitBlockSize = 4 * 1024 * 1024;
+        static const size_t AllocationSize = 1024 * 1024 * 1024;
 
-        void*  Allocation;
-        size_t HighWatermark;
-        size_t Committed;
+        ArenaAllocator Arena;
 
-        OutputAllocator()
-            : Allocation( nullptr ),
-              HighWatermark( 0 ),
-              Committed( 0 )
-        {
-        }
-
-        // Reserve memory and perform initial allocation.
+        // Reserve memory for the package.
         bool Initialize()
         {
-            Allocation = ::VirtualAlloc( nullptr, AllocationSize, MEM_RESERVE, PAGE_READWRITE );
-
-            if ( Allocation == nullptr )
+            if ( !Arena.Initialize( "package output", AllocationSize ) )
             {
                 printf( "Couldn't reserve memory\n" );
                 return false;
             }
 
-            if ( ::VirtualAlloc( Allocation, CommitBlockSize, MEM_COMMIT, PAGE_READWRITE ) == nullptr )
-            {
-                printf( "Couldn't commit memory\n" );
-                return false;
-            }
-
-            Committed     = CommitBlockSize;
-            HighWatermark = 0;
-
             return true;
         }
 
-        // Free it all.
-        ~OutputAllocator()
+        // Allocate a block of a particular size with a particular alignment.
+        void* Allocate( size_t size, size_t alignment )
         {
-            if ( ::VirtualFree( Allocation, 0, MEM_RELEASE ) == FALSE )
+            void* result = Arena.Allocate( size, alignment );
+
+            if ( result == nullptr )
             {
-                printf( "Error freeing pool allocation.\n" );
+                printf( "Couldn't allocate memory, pool exhausted.\n" );
+                exit( EXIT_FAILURE ); // this isn't a great thing to-do, but we don't have any resources in destructors that won't be cleaned up by the OS            
             }
+
+            return result;
         }
 
-        // Allocate a block of a particular size with a particular alignment.
-        void* Allocate( size_t size, size_t alignment )
+        // Equivalent to new operator with default constructor.
+        template < typename AllocationType >
+        AllocationType* Allocate( size_t count = 1 )
         {
-            size_t paddedBegin  = ( HighWatermark + alignment - 1 ) & ~( alignment - 1 );
-            size_t newWaterMark = paddedBegin + size;
-            
-            if ( newWaterMark > AllocationSize )
+            AllocationType* result = Arena.Allocate< AllocationType >( count );
+
+            if ( result == nullptr )
             {
                 printf( "Couldn't allocate memory, pool exhausted.\n" );
-                exit( EXIT_FAILURE ); // this isn't a great thing to-do, but we don't have any resources in destructors that won't be cleaned up by the OS            
+                exit( EXIT_FAILURE );
             }
 
-            if ( newWaterMark > Committed )
+            return result;
+        }
+    };
+
+
+    // Payloads of the blobs in one of the data sections, collected as the package is built and
+    // written after the metadata once it's complete. Payloads are stored once by content, blobs with the
+    // same payload (a shader compiled with the same defines, a texture under two ids) share it.
+    struct DataSection
+    {
+        std::vector< uint8_t >                        Payloads;
+        std::unordered_multimap< uint64_t, uint32_t > PayloadsByHash;  // offset of each unique payload, by content hash.
+        uint32_t                                      SharedCount = 0; // blobs that reused a payload.
+        size_t                                        SharedSize  = 0; // bytes they would have added.
+
+        // Add a payload to the end of the section, or find the same one already in it, with the blob holding its
+        // offset in the section.
+        bool Store( ResourceBlob& blob, const void* data, size_t size )
+        {
+            if ( Payloads.size() + size > INT32_MAX )
             {
-                size_t newCommitted = ( Committed + ( newWaterMark - Committed ) + CommitBlockSize - 1 ) & ~( CommitBlockSize - 1 );
-                size_t extraCommit  = newCommitted - Committed;
+                printf( "Package data section is over 2GB\n" );
+                return false;
+            }
+
+            const uint8_t* payload = reinterpret_cast< const uint8_t* >( data );
+            uint64_t       hash    = ContentHash64( payload, size, size );
+            auto           matches = PayloadsByHash.equal_range( hash );
 
-                void* committedAllocation = 
-                    ::VirtualAlloc( static_cast<uint8_t*>( Allocation ) + Committed, extraCommit, MEM_COMMIT, PAGE_READWRITE );
+            blob.ResourceSize = static_cast< uint32_t >( size );
 
-                if ( committedAllocation == nullptr )
+            // Hashes only find candidates, a payload is shared only if it's byte for byte the same.
+            for ( auto match = matches.first; match != matches.second; ++match )
+            {
+                if ( match->second + size <= Payloads.size() && ::memcmp( Payloads.data() + match->second, payload, size ) == 0 )
                 {
-                    printf( "Couldn't commit memory.\n" );
-                    exit( EXIT_FAILURE ); // this isn't a great thing to-do, but we don't have any resources in destructors that won't be cleaned up by the OS
-                }
+                    blob.Data.RelativeAddress = static_cast< int32_t >( match->second );
 
-                Committed = newCommitted;
+                    ++SharedCount;
+                    SharedSize += size;
+
+                    return true;
+                }
             }
 
-            HighWatermark = newWaterMark;
+            blob.Data.RelativeAddress = static_cast< int32_t >( Payloads.size() );
 
-            return reinterpret_cast<uint8_t*>( Allocation ) + paddedBegin;
+            PayloadsByHash.insert( std::make_pair( hash, static_cast< uint32_t >( Payloads.size() ) ) );
+            Payloads.insert( Payloads.end(), payload, payload + size );
+
+            return true;
         }
 
-        // Equivalent to new operator with default constructor.
-        template < typename AllocationType >
-        AllocationType* Allocate( size_t count = 1 )
+        // Write the section's blocks to the end of the package, compressing them if asked (blocks that don't
+        // get smaller are stored as they are). The section's block table must already be allocated.
+        void Write( OutputAllocator& fileSpace, PackageSection& section, const char* name )
         {
-            AllocationType* result =
-                reinterpret_cast<AllocationType*>(
-                    Allocate( sizeof( AllocationType ) * count,
-                              alignof( AllocationType ) ) );
+            std::vector< uint8_t > compressed( CompressBlockBound( SECTION_BLOCK_SIZE ) );
 
-            if ( result != nullptr )
+            size_t storedSize = 0;
+
+            for ( uint32_t blockIndex = 0; blockIndex < section.BlockCount; ++blockIndex )
             {
-                for ( AllocationType* where = result, *end = result + count; where < end; ++where )
+                SectionBlock&  block        = section.Blocks[ blockIndex ];
+                const uint8_t* blockData    = Payloads.data() + static_cast< size_t >( blockIndex ) * SECTION_BLOCK_SIZE;
+                size_t         blockSize    = section.Codec == SectionCodecs::NONE ? Payloads.size() : Payloads.size() - static_cast< size_t >( blockIndex ) * SECTION_BLOCK_SIZE;
+                size_t         compressSize = 0;
+
+                blockSize = section.Codec == SectionCodecs::NONE || blockSize < SECTION_BLOCK_SIZE ? blockSize : SECTION_BLOCK_SIZE;
+
+                if ( section.Codec == SectionCodecs::LZ4 )
                 {
-                    new ( where ) AllocationType();
+                    compressSize = CompressBlock( blockData, blockSize, compressed.data(), compressed.size() );
                 }
-            }
 
-            return result;
-        }
+                if ( compressSize > 0 && compressSize < blockSize )
+                {
+                    blockData = compressed.data();
+                    blockSize = compressSize;
+                }
 
-        // Reset the allocation back to zero.
-        void Reset()
-        {
-            HighWatermark = 0;
+                block.StoredSize = static_cast< uint32_t >( blockSize );
+                block.Data       = reinterpret_cast< uint8_t* >( fileSpace.Allocate( blockSize, 16 ) );
+
+                ::memcpy( block.Data.Raw(), blockData, blockSize );
+
+                storedSize += blockSize;
+            }
+
+            printf( "%s: %.1f KB, %.1f KB stored, %u shared payloads saved %.1f KB\n",
+                    name,
+                    Payloads.size() / 1024.0,
+                    storedSize / 1024.0,
+                    SharedCount,
+                    SharedSize / 1024.0 );
         }
     };
 }
@@ -493,6 +532,23 @@ int wmain( int argc, const wchar_t** argv )
         return EXIT_FAILURE;
     }
 
+    double frequencyBuckets = DEFAULT_FREQUENCY_BUCKETS;
+
+    if ( TryGetNumber( rootObject, "frequency_buckets", &frequencyBuckets ) &&
+         ( frequencyBuckets < 2 || frequencyBuckets > FREQUENCY_BUCKETS || frequencyBuckets != floor( frequencyBuckets ) ) )
+    {
+        printf( "Frequency buckets must be a whole number from 2 to %u\n", FREQUENCY_BUCKETS );
+        return EXIT_FAILURE;
+    }
+
+    // Data sections are compressed unless asked not to, for quick test iterations.
+    bool compressSections = GetBool( rootObject, "compress_sections", true );
+
+    // Pixel shaders are compiled with the bucket count defined, so they declare only the buckets the package uses.
+    char frequencyBucketsDefinition[ 16 ];
+
+    ::sprintf_s( frequencyBucketsDefinition, "%u", static_cast< uint32_t >( frequencyBuckets ) );
+
     OutputAllocator fileSpace;
 
     if ( !fileSpace.Initialize() )
@@ -504,9 +560,13 @@ int wmain( int argc, const wchar_t** argv )
     BoondogglePackageHeader* header = fileSpace.Allocate< BoondogglePackageHeader >();
 
     header->MagicCode   = MagicCodes::HEADER_CODE;
-    header->Version     = CodeVersions::VERSION_1_0;
-    header->ShaderCount = static_cast< uint32_t >( shadersArray->length );
-    header->Shaders     = fileSpace.Allocate< ResourceBlob >( shadersArray->length );
+    header->Version              = CodeVersions::VERSION_2_0;
+    header->ShaderCount          = static_cast< uint32_t >( shadersArray->length );
+    header->Shaders              = fileSpace.Allocate< ResourceBlob >( shadersArray->length );
+    header->FrequencyBucketCount = static_cast< uint32_t >( frequencyBuckets );
+
+    DataSection shaderData;
+    DataSection textureData;
 
     StringIdMap shaderIdMap;
 
@@ -539,7 +599,7 @@ int wmain( int argc, const wchar_t** argv )
 
         if ( definesArray != nullptr )
         {
-            defines.reserve( definesArray->length + 1 );
+            defines.reserve( definesArray->length + 2 );
 
             for ( const json_array_element_s* defineEntry = definesArray->start;
                   defineEntry != nullptr;
@@ -568,8 +628,10 @@ int wmain( int argc, const wchar_t** argv )
             }
         }
 
-        D3D_SHADER_MACRO nullTerminator = { nullptr, nullptr };
+        D3D_SHADER_MACRO frequencyBucketsMacro = { "FREQUENCY_BUCKETS", frequencyBucketsDefinition };
+        D3D_SHADER_MACRO nullTerminator        = { nullptr, nullptr };
 
+        defines.push_back( frequencyBucketsMacro );
         defines.push_back( nullTerminator );
 
         ConvertedWideString convertedFilePath( shaderFilePath );
@@ -599,10 +661,10 @@ int wmain( int argc, const wchar_t** argv )
 
         ResourceBlob& storedShaderBlob = header->Shaders[ shaderIndex ];
 
-        storedShaderBlob.ResourceSize = static_cast< uint32_t >( shaderBlob->GetBufferSize() );
-        storedShaderBlob.Data         = reinterpret_cast< uint8_t* >( fileSpace.Allocate( shaderBlob->GetBufferSize(), 1 ) );
-
-        ::memcpy( storedShaderBlob.Data.Raw(), shaderBlob->GetBufferPointer(), storedShaderBlob.ResourceSize );
+        if ( !shaderData.Store( storedShaderBlob, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize() ) )
+        {
+            return EXIT_FAILURE;
+        }
 
         shaderIdMap[ id ] = shaderIndex;
     }
@@ -705,10 +767,10 @@ int wmain( int argc, const wchar_t** argv )
             }
             
             // parse address modes and filter - note, will use default 
-            textureBlob.ResourceSize = static_cast< uint32_t >( textureFile.Size );
-            textureBlob.Data         = reinterpret_cast< uint8_t* >( fileSpace.Allocate( textureFile.Size, 1 ) );
-
-            ::memcpy( textureBlob.Data.Raw(), textureFile.Data, textureFile.Size );
+            if ( !textureData.Store( textureBlob, textureFile.Data, textureFile.Size ) )
+            {
+                return EXIT_FAILURE;
+            }
 
             textureIdMap[ id ] = textureIndex;
 
@@ -724,6 +786,10 @@ int wmain( int argc, const wchar_t** argv )
 
     StringIdMap proceduralTextureIdMap;
 
+    // The sound history texture comes after the procedural textures (see SoundHistoryTextureIndex).
+    textureIdMap[ "sound_history" ] = 
+        textureIndex + ( proceduralTexturesArray != nullptr ? static_cast< uint32_t >( proceduralTexturesArray->length ) : 0 );
+
     if ( proceduralTexturesArray != nullptr )
     {
         header->ProceduralTextureCount = static_cast< uint32_t >( proceduralTexturesArray->length );
@@ -1149,13 +1215,67 @@ int wmain( int argc, const wchar_t** argv )
 
         ResourceBlob& storedShaderBlob = header->ScreenAlignedQuadVS;
 
-        storedShaderBlob.ResourceSize = static_cast< uint32_t >( shaderBlob->GetBufferSize() );
-        storedShaderBlob.Data         = reinterpret_cast< uint8_t* >( fileSpace.Allocate( shaderBlob->GetBufferSize(), 1 ) );
+        if ( !shaderData.Store( storedShaderBlob, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize() ) )
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The section table and block tables finish the metadata, then the data sections follow it.
+    DataSection*  dataSections[ PACKAGE_SECTION_COUNT ] = { nullptr, &shaderData, &textureData };
+    const char*   sectionNames[ PACKAGE_SECTION_COUNT ] = { "Metadata", "Shader data", "Texture data" };
 
-        ::memcpy( storedShaderBlob.Data.Raw(), shaderBlob->GetBufferPointer(), storedShaderBlob.ResourceSize );
+    header->SectionCount = PACKAGE_SECTION_COUNT;
+    header->Sections     = fileSpace.Allocate< PackageSection >( PACKAGE_SECTION_COUNT );
+
+    for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        PackageSection& section = header->Sections[ sectionIndex ];
+
+        section.Type = static_cast< PackageSectionTypes >( sectionIndex );
+
+        if ( dataSections[ sectionIndex ] == nullptr )
+        {
+            section.Codec      = SectionCodecs::NONE;
+            section.BlockCount = 1;
+        }
+        else
+        {
+            size_t size = dataSections[ sectionIndex ]->Payloads.size();
+
+            section.Codec      = compressSections ? SectionCodecs::LZ4 : SectionCodecs::NONE;
+            section.Size       = static_cast< uint32_t >( size );
+            section.BlockCount = compressSections ? static_cast< uint32_t >( ( size + SECTION_BLOCK_SIZE - 1 ) / SECTION_BLOCK_SIZE ) : 1;
+        }
+
+        section.Blocks = fileSpace.Allocate< SectionBlock >( section.BlockCount );
     }
 
-    bool packageValid = ValidatePackage( *header, static_cast<const uint8_t*>( fileSpace.Allocation ) + fileSpace.HighWatermark );
+    PackageSection& metadataSection = header->Sections[ static_cast< uint32_t >( PackageSectionTypes::METADATA ) ];
+
+    // Pad the metadata out to where the first data block goes, so it covers everything before the data.
+    fileSpace.Allocate( 0, 16 );
+
+    metadataSection.Size                   = static_cast< uint32_t >( fileSpace.Arena.Used() );
+    metadataSection.Blocks[ 0 ].StoredSize = metadataSection.Size;
+    metadataSection.Blocks[ 0 ].Data       = reinterpret_cast< const uint8_t* >( header );
+
+    printf( "%s: %.1f KB\n", sectionNames[ 0 ], metadataSection.Size / 1024.0 );
+
+    for ( uint32_t sectionIndex = 1; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        dataSections[ sectionIndex ]->Write( fileSpace, header->Sections[ sectionIndex ], sectionNames[ sectionIndex ] );
+    }
+
+    // The hashes go after everything they cover, so the metadata's covers the pointer to them but not them.
+    header->SectionHashes = fileSpace.Allocate< uint64_t >( PACKAGE_SECTION_COUNT );
+
+    for ( uint32_t sectionIndex = 0; sectionIndex < PACKAGE_SECTION_COUNT; ++sectionIndex )
+    {
+        header->SectionHashes[ sectionIndex ] = HashSection( header->Sections[ sectionIndex ] );
+    }
+
+    bool packageValid = ValidatePackage( *header, fileSpace.Arena.Base() + fileSpace.Arena.Used() );
 
     if ( !packageValid )
     {
@@ -1163,6 +1283,14 @@ int wmain( int argc, const wchar_t** argv )
         return EXIT_FAILURE;
     }
 
+    PackageSections sections;
+
+    if ( !sections.Load( *header, true ) )
+    {
+        printf( "Output package sections failed to decompress or verify\n" );
+        return EXIT_FAILURE;
+    }
+
     HANDLE outputFile = ::CreateFileW( argv[ 2 ], GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
 
     if ( outputFile == INVALID_HANDLE_VALUE || outputFile == nullptr )
@@ -1174,15 +1302,15 @@ int wmain( int argc, const wchar_t** argv )
     DWORD bytesWritten    = 0;
     BOOL  writeFileResult = 
         ::WriteFile( outputFile, 
-                     fileSpace.Allocation, 
-                     static_cast<DWORD>( fileSpace.HighWatermark ), 
+                     fileSpace.Arena.Base(), 
+                     static_cast<DWORD>( fileSpace.Arena.Used() ), 
                      &bytesWritten, 
                      nullptr );
 
     ::CloseHandle( outputFile );
     outputFile = nullptr;
 
-    if ( writeFileResult == FALSE || bytesWritten != static_cast<DWORD>( fileSpace.HighWatermark ) )
+    if ( writeFileResult == FALSE || bytesWritten != static_cast<DWORD>( fileSpace.Arena.Used() ) )
     {
         printf( "Couldn't write output file.\n" );
         return EXIT_FAILURE;
@@ -58,7 +58,7 @@ float2 SceneDistance( float3 from )
 
     float  bucketIndex     = 15 - ( floor( abs( from.x ) / 10 ) + ( floor( abs( from.z ) / 10 ) ) ) % 16;// + abs( floor( from.x / 2 ) + floor( from.z / 2 ) ) * 39 ) % 16 );
 
-    float2 soundBucket     = SoundFrequencyBuckets[ (uint)bucketIndex ];
+    float2 soundBucket     = SoundBucket( (uint)bucketIndex );
     float  normalizedSound = 1 + ( ( from.x < 0 ? -soundBucket.x : -soundBucket.y ) * scale * 4 );
 
     float3 repeatedFrom = { abs( from.x ) % 10, from.y, abs( from.z ) % 10 };
@@ -77,17 +77,17 @@ float2 SceneDistance( float3 from )
 
     if ( from.x < 0 )
     {
-        lowFrequency     = 1 - ( SoundFrequencyBuckets[ 0 ].x + SoundFrequencyBuckets[ 1 ].x + SoundFrequencyBuckets[ 2 ].x + SoundFrequencyBuckets[ 3 ].x ) * scale;
-        midLowFrequency  = 1 - ( SoundFrequencyBuckets[ 4 ].x + SoundFrequencyBuckets[ 5 ].x + SoundFrequencyBuckets[ 6 ].x + SoundFrequencyBuckets[ 7 ].x ) * scale;
-        midHighFrequency = 1 - ( SoundFrequencyBuckets[ 8 ].x + SoundFrequencyBuckets[ 9 ].x + SoundFrequencyBuckets[ 10 ].x + SoundFrequencyBuckets[ 11 ].x ) * scale;
-        highFrequency    = 1 - ( SoundFrequencyBuckets[ 12 ].x + SoundFrequencyBuckets[ 13 ].y + SoundFrequencyBuckets[ 14 ].x + SoundFrequencyBuckets[ 15 ].x ) * scale;
+        lowFrequency     = 1 - ( SoundBucket( 0 ).x + SoundBucket( 1 ).x + SoundBucket( 2 ).x + SoundBucket( 3 ).x ) * scale;
+        midLowFrequency  = 1 - ( SoundBucket( 4 ).x + SoundBucket( 5 ).x + SoundBucket( 6 ).x + SoundBucket( 7 ).x ) * scale;
+        midHighFrequency = 1 - ( SoundBucket( 8 ).x + SoundBucket( 9 ).x + SoundBucket( 10 ).x + SoundBucket( 11 ).x ) * scale;
+        highFrequency    = 1 - ( SoundBucket( 12 ).x + SoundBucket( 13 ).y + SoundBucket( 14 ).x + SoundBucket( 15 ).x ) * scale;
     }
     else
     {
-        lowFrequency     = 1 - ( SoundFrequencyBuckets[ 0 ].y + SoundFrequencyBuckets[ 1 ].y + SoundFrequencyBuckets[ 2 ].y + SoundFrequencyBuckets[ 3 ].y ) * scale;
-        midLowFrequency  = 1 - ( SoundFrequencyBuckets[ 4 ].y + SoundFrequencyBuckets[ 5 ].y + SoundFrequencyBuckets[ 6 ].y + SoundFrequencyBuckets[ 7 ].y ) * scale;
-        midHighFrequency = 1 - ( SoundFrequencyBuckets[ 8 ].y + SoundFrequencyBuckets[ 9 ].y + SoundFrequencyBuckets[ 10 ].y + SoundFrequencyBuckets[ 11 ].y ) * scale;
-        highFrequency    = 1 - ( SoundFrequencyBuckets[ 12 ].y + SoundFrequencyBuckets[ 13 ].y + SoundFrequencyBuckets[ 14 ].y + SoundFrequencyBuckets[ 15 ].y ) * scale;
+        lowFrequency     = 1 - ( SoundBucket( 0 ).y + SoundBucket( 1 ).y + SoundBucket( 2 ).y + SoundBucket( 3 ).y ) * scale;
+        midLowFrequency  = 1 - ( SoundBucket( 4 ).y + SoundBucket( 5 ).y + SoundBucket( 6 ).y + SoundBucket( 7 ).y ) * scale;
+        midHighFrequency = 1 - ( SoundBucket( 8 ).y + SoundBucket( 9 ).y + SoundBucket( 10 ).y + SoundBucket( 11 ).y ) * scale;
+        highFrequency    = 1 - ( SoundBucket( 12 ).y + SoundBucket( 13 ).y + SoundBucket( 14 ).y + SoundBucket( 15 ).y ) * scale;
     }
 
     float distortion = lowFrequency * lowFrequency * 0.8 * sin( 1.24 * from.x + Time ) * sin( 1.25 * from.y + Time * 0.9f ) * sin( 1.26 * from.z + Time * 1.1f ) +
@@ -1,3 +1,10 @@
+// Buckets in the package, the compiler defines this from the package's "frequency_buckets".
+#ifndef FREQUENCY_BUCKETS
+#define FREQUENCY_BUCKETS 16
+#endif
+
+#define FREQUENCY_BUCKET_PAIRS ( ( FREQUENCY_BUCKETS + 1 ) / 2 )
+
 cbuffer Parameters : register( b0 )
 {
     float Time : packoffset( c0.x );
@@ -5,20 +12,55 @@ cbuffer Parameters : register( b0 )
     float TransitionIn : packoffset( c0.z );
     float TransitionOut : packoffset( c0.w );
 
-    float4 SoundFrequencyBuckets[ 16 ] : packoffset( c1 );
+    float2 SoundRMS : packoffset( c1.x );
+    float2 SoundRMSdbSPL : packoffset( c1.z );
+
+    float SoundSampleRate : packoffset( c2.x );
+    float SoundSamples : packoffset( c2.y );
+    float NoiseFloorDbSPL : packoffset( c2.z );
+    float SoundOnsetStrength : packoffset( c2.w );
+
+    float SoundBPM : packoffset( c3.x );
+    float SoundBeatPhase : packoffset( c3.y );
+    float SoundBeatConfidence : packoffset( c3.z );
+    float SoundHistoryRow : packoffset( c3.w );
+
+    float SoundHistoryRows : packoffset( c4.x );
+    float SoundLoudnessMomentary : packoffset( c4.y );
+    float SoundLoudnessShortTerm : packoffset( c4.z );
+    float SoundLoudnessGain : packoffset( c4.w );
+
+    float2 Resolution : packoffset( c5.x );
+    float2 InverseResolution : packoffset( c5.z );
 
-    float2 SoundRMS : packoffset( c17.x );
-    float2 SoundRMSdbSPL : packoffset( c17.z );
+    float4 EyePosition : packoffset( c6 );
+    float4 RayScreenUpperLeft : packoffset( c7 );
+    float4 RayScreenRight : packoffset( c8 );
+    float4 RayScreenDown : packoffset( c9 );
 
-    float SoundSampleRate : packoffset( c18.x );
-    float SoundSamples : packoffset( c18.y );
-    float NoiseFloorDbSPL : packoffset( c18.z );
+    // Channel 0 and 1 dbSPL of two buckets per register, use SoundBucket to read them.
+    float4 SoundFrequencyBucketPairs[ FREQUENCY_BUCKET_PAIRS ] : packoffset( c10 );
+};
 
-    float2 Resolution : packoffset( c19.x );
-    float2 InverseResolution : packoffset( c19.z );
+// Set once when the audio starts, as the bucket frequencies never change.
+cbuffer BucketRanges : register( b1 )
+{
+    // Low and high frequency in Hz of two buckets per register, use SoundBucketRange to read them.
+    float4 SoundFrequencyRangePairs[ FREQUENCY_BUCKET_PAIRS ];
+};
+
+// The dbSPL of channel 0 and channel 1 for a bucket.
+float2 SoundBucket( uint bucket )
+{
+    float4 pair = SoundFrequencyBucketPairs[ bucket / 2 ];
+
+    return ( bucket & 1 ) != 0 ? pair.zw : pair.xy;
+}
+
+// The low and high frequency of a bucket, both 0 for a bucket without any bins.
+float2 SoundBucketRange( uint bucket )
+{
+    float4 pair = SoundFrequencyRangePairs[ bucket / 2 ];
 
-    float4 EyePosition : packoffset( c20 );
-    float4 RayScreenUpperLeft : packoffset( c21 );
-    float4 RayScreenRight : packoffset( c22 );
-    float4 RayScreenDown : packoffset( c23 );
-};
\ No newline at end of file
+    return ( bucket & 1 ) != 0 ? pair.zw : pair.xy;
+}
\ No newline at end of file
@@ -71,7 +71,7 @@ float2 SceneDistance( float3 from, bool testSpheres, bool withATwist )
 
     uint bucketIndex = 15 - ( uint )( floor( abs( from.x ) / 10 ) + ( floor( abs( from.z ) / 10 ) ) ) % 16;// + abs( floor( from.x / 2 ) + floor( from.z / 2 ) ) * 39 ) % 16 );
 
-    float normalizedSound = 1 + ( ( from.x < 0 ? -SoundFrequencyBuckets[ bucketIndex ].x : -SoundFrequencyBuckets[ bucketIndex ].y ) * scale * 4 );
+    float normalizedSound = 1 + ( ( from.x < 0 ? -SoundBucket( bucketIndex ).x : -SoundBucket( bucketIndex ).y ) * scale * 4 );
 
     float3 rotatedFrom;
     float3 repeatedFrom = { abs( from.x ) % 10, from.y, abs( from.z ) % 10 };
@@ -100,10 +100,10 @@ float2 SceneDistance( float3 from, bool testSpheres, bool withATwist )
  
     if ( testSpheres )
     {
-        float2 lowFrequency = 1 - ( SoundFrequencyBuckets[ 0 ].xy + SoundFrequencyBuckets[ 1 ].xy + SoundFrequencyBuckets[ 2 ].xy + SoundFrequencyBuckets[ 3 ].xy ) * scale;
-        float2 midLowFrequency = 1 - ( SoundFrequencyBuckets[ 4 ].xy + SoundFrequencyBuckets[ 5 ].xy + SoundFrequencyBuckets[ 6 ].xy + SoundFrequencyBuckets[ 7 ].xy ) * scale;
-        float2 midHighFrequency = 1 - ( SoundFrequencyBuckets[ 8 ].xy + SoundFrequencyBuckets[ 9 ].xy + SoundFrequencyBuckets[ 10 ].xy + SoundFrequencyBuckets[ 11 ].xy ) * scale;
-        float2 highFrequency = 1 - ( SoundFrequencyBuckets[ 12 ].xy + SoundFrequencyBuckets[ 13 ].xy + SoundFrequencyBuckets[ 14 ].xy + SoundFrequencyBuckets[ 15 ].xy ) * scale;
+        float2 lowFrequency = 1 - ( SoundBucket( 0 ).xy + SoundBucket( 1 ).xy + SoundBucket( 2 ).xy + SoundBucket( 3 ).xy ) * scale;
+        float2 midLowFrequency = 1 - ( SoundBucket( 4 ).xy + SoundBucket( 5 ).xy + SoundBucket( 6 ).xy + SoundBucket( 7 ).xy ) * scale;
+        float2 midHighFrequency = 1 - ( SoundBucket( 8 ).xy + SoundBucket( 9 ).xy + SoundBucket( 10 ).xy + SoundBucket( 11 ).xy ) * scale;
+        float2 highFrequency = 1 - ( SoundBucket( 12 ).xy + SoundBucket( 13 ).xy + SoundBucket( 14 ).xy + SoundBucket( 15 ).xy ) * scale;
 
         float2 distortion = lowFrequency * lowFrequency * 0.8 * sin( 1.24 * from.x + Time ) * sin( 1.25 * from.y + Time * 0.9f ) * sin( 1.26 * from.z + Time * 1.1f ) +
                             midLowFrequency * midLowFrequency * midLowFrequency * 0.4 * sin( 3.0 * from.x + Time * 1.5 ) * sin( 3.1 * from.y + Time * 1.3f ) * sin( 3.2 * from.z + -Time * 1.6f ) +
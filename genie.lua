@@ -35,6 +35,7 @@ solution "boondoggle"
 
 		configuration "Debug*"
 			flags { "Symbols" }
+			defines { "BOONDOGGLE_TRACK_ALLOCATIONS" }
 			
 		configuration "Release*"
 			flags { "OptimizeSpeed" }
@@ -66,6 +67,7 @@ solution "boondoggle"
 
 		configuration "Debug*"
 			flags { "Symbols" }
+			defines { "BOONDOGGLE_TRACK_ALLOCATIONS" }
 			
 		configuration "Release*"
 			flags { "OptimizeSpeed" }
@@ -80,4 +82,76 @@ solution "boondoggle"
 			targetdir ( path.join( "bin", "32", "debug" ) )
 
 		configuration { "x32", "Release" }
-			targetdir ( path.join( "bin", "32", "release" ) )
\ No newline at end of file
+			targetdir ( path.join( "bin", "32", "release" ) )
+	project "boondoggle_analyzer"
+		language "C++"
+		kind "ConsoleApp"
+		files { "analyzer/**.cpp", 
+		        "analyzer/**.h", 
+				"boondoggle/audio.cpp",
+				"boondoggle/audio.h",
+				"boondoggle/audio_source.cpp",
+				"boondoggle/audio_source.h",
+				"boondoggle/audio_file_source.cpp",
+				"boondoggle/audio_file_source.h",
+				"boondoggle/audio_decimator.cpp",
+				"boondoggle/audio_decimator.h",
+				"boondoggle/audio_resampler.cpp",
+				"boondoggle/audio_resampler.h",
+				"boondoggle/audio_loudness.cpp",
+				"boondoggle/audio_loudness.h",
+				"boondoggle/audio_filterbank.cpp",
+				"boondoggle/audio_filterbank.h",
+				"boondoggle/audio_fft.cpp",
+				"boondoggle/audio_fft.h",
+				"boondoggle/audio_kernels.cpp",
+				"boondoggle/audio_kernels.h",
+				"boondoggle/audio_onset.cpp",
+				"boondoggle/audio_onset.h",
+				"boondoggle/audio_features.cpp",
+				"boondoggle/audio_features.h",
+				"boondoggle/latency_stats.cpp",
+				"boondoggle/latency_stats.h",
+				"boondoggle/shared_render_constants.h",
+				"common/boondoggle_helpers.h",
+				"common/arena_allocator.cpp",
+				"common/arena_allocator.h",
+				"common/allocation_tracker.cpp",
+				"common/allocation_tracker.h",
+				"common/binary_effects_format.cpp",
+				"common/binary_effects_format.h",
+				"common/block_compression.cpp",
+				"common/block_compression.h",
+				"common/content_hash.cpp",
+				"common/content_hash.h",
+				"common/package_sections.cpp",
+				"common/package_sections.h",
+				"common/mapped_file.cpp",
+				"common/mapped_file.h",
+				"common/package_view.cpp",
+				"common/package_view.h",
+				"common/package_resources.cpp",
+				"common/package_resources.h",
+				"common/package_reloader.cpp",
+				"common/package_reloader.h",
+				"external/kissfft/*.c",
+				"external/kissfft/*.h" }
+
+		configuration "Debug*"
+			flags { "Symbols" }
+			defines { "BOONDOGGLE_TRACK_ALLOCATIONS" }
+			
+		configuration "Release*"
+			flags { "OptimizeSpeed" }
+
+		configuration { "x64", "Debug" }
+			targetdir ( path.join( "bin", "64", "debug" ) )
+
+		configuration { "x64", "Release" }
+			targetdir ( path.join( "bin", "64", "release" ) )
+			
+		configuration { "x32", "Debug" }
+			targetdir ( path.join( "bin", "32", "debug" ) )
+
+		configuration { "x32", "Release" }
+			targetdir ( path.join( "bin", "32", "release" ) )